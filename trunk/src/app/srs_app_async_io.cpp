@@ -0,0 +1,671 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include <srs_app_async_io.hpp>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_core_performance.hpp>
+
+SrsAsyncIO* _srs_async_io = new SrsAsyncIO();
+
+ISrsAsyncIOHandler::ISrsAsyncIOHandler()
+{
+}
+
+ISrsAsyncIOHandler::~ISrsAsyncIOHandler()
+{
+}
+
+SrsAsyncIOJob::SrsAsyncIOJob(SrsAsyncIOType t, int f, ISrsAsyncIOHandler* h)
+{
+    type = t;
+    fd = f;
+    buf = NULL;
+    size = 0;
+    capacity = 0;
+    offset = -1;
+    error = 0;
+    handler = h;
+}
+
+SrsAsyncIOJob::~SrsAsyncIOJob()
+{
+    srs_freepa(buf);
+}
+
+void SrsAsyncIOJob::execute()
+{
+    if (type == SrsAsyncIOClose) {
+        if (::close(fd) < 0) {
+            error = errno;
+        }
+        return;
+    }
+    
+    char* p = buf;
+    int left = size;
+    int64_t pos = offset;
+    
+    while (left > 0) {
+        ssize_t nwrite = 0;
+        if (offset >= 0) {
+            nwrite = ::pwrite(fd, p, left, (off_t)pos);
+        } else {
+            nwrite = ::write(fd, p, left);
+        }
+        
+        if (nwrite < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error = errno;
+            return;
+        }
+        
+        p += nwrite;
+        left -= (int)nwrite;
+        pos += nwrite;
+    }
+}
+
+SrsAsyncIOWorker::SrsAsyncIOWorker(SrsAsyncIO* p)
+{
+    pool = p;
+    nb_bytes = 0;
+    quit = false;
+    started = false;
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&cond, NULL);
+}
+
+SrsAsyncIOWorker::~SrsAsyncIOWorker()
+{
+    stop();
+    
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&lock);
+}
+
+int SrsAsyncIOWorker::start()
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (pthread_create(&tid, NULL, SrsAsyncIOWorker::worker_fn, this) != 0) {
+        ret = ERROR_SYSTEM_CREATE_THREAD;
+        srs_error("create async io thread failed. ret=%d", ret);
+        return ret;
+    }
+    started = true;
+    
+    return ret;
+}
+
+void SrsAsyncIOWorker::stop()
+{
+    if (!started) {
+        return;
+    }
+    
+    // the worker quit when all jobs done.
+    pthread_mutex_lock(&lock);
+    quit = true;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&lock);
+    
+    pthread_join(tid, NULL);
+    started = false;
+}
+
+void SrsAsyncIOWorker::push(SrsAsyncIOJob* job)
+{
+    pthread_mutex_lock(&lock);
+    jobs.push_back(job);
+    nb_bytes += job->size;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&lock);
+}
+
+int64_t SrsAsyncIOWorker::pending()
+{
+    pthread_mutex_lock(&lock);
+    int64_t v = nb_bytes;
+    pthread_mutex_unlock(&lock);
+    
+    return v;
+}
+
+void SrsAsyncIOWorker::cycle()
+{
+    while (true) {
+        pthread_mutex_lock(&lock);
+        while (jobs.empty() && !quit) {
+            pthread_cond_wait(&cond, &lock);
+        }
+        if (jobs.empty()) {
+            pthread_mutex_unlock(&lock);
+            break;
+        }
+        SrsAsyncIOJob* job = jobs.front();
+        jobs.pop_front();
+        pthread_mutex_unlock(&lock);
+        
+        job->execute();
+        
+        pthread_mutex_lock(&lock);
+        nb_bytes -= job->size;
+        pthread_mutex_unlock(&lock);
+        
+        pool->on_done(job);
+    }
+}
+
+void* SrsAsyncIOWorker::worker_fn(void* arg)
+{
+    SrsAsyncIOWorker* worker = (SrsAsyncIOWorker*)arg;
+    worker->cycle();
+    return NULL;
+}
+
+SrsAsyncIO::SrsAsyncIO()
+{
+    max_queue = SRS_PERF_ASYNC_IO_MAX_QUEUE;
+    batch_time = 0;
+    nb_drops = 0;
+    nb_reported_drops = 0;
+    pthread_mutex_init(&lock, NULL);
+    done_pipe[0] = done_pipe[1] = -1;
+    done_stfd = NULL;
+    pthread = new SrsEndlessThread("async-io", this);
+}
+
+SrsAsyncIO::~SrsAsyncIO()
+{
+    srs_freep(pthread);
+    
+    // write the merged logs, before the workers stopped.
+    flush_batches(-1, false);
+    
+    // stop all workers, which finish the left jobs.
+    std::vector<SrsAsyncIOWorker*>::iterator it;
+    for (it = workers.begin(); it != workers.end(); ++it) {
+        SrsAsyncIOWorker* worker = *it;
+        srs_freep(worker);
+    }
+    workers.clear();
+    
+    std::vector<SrsAsyncIOJob*>::iterator jt;
+    for (jt = done.begin(); jt != done.end(); ++jt) {
+        SrsAsyncIOJob* job = *jt;
+        srs_freep(job);
+    }
+    done.clear();
+    
+    if (done_stfd) {
+        st_netfd_close(done_stfd);
+        done_stfd = NULL;
+        done_pipe[0] = -1;
+    }
+    if (done_pipe[0] > 0) {
+        ::close(done_pipe[0]);
+    }
+    if (done_pipe[1] > 0) {
+        ::close(done_pipe[1]);
+    }
+    
+    pthread_mutex_destroy(&lock);
+}
+
+int SrsAsyncIO::initialize(int nb_threads)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (nb_threads <= 0) {
+        srs_trace("async io disabled, write file in st thread.");
+        return ret;
+    }
+    
+    if (pipe(done_pipe) < 0) {
+        ret = ERROR_SYSTEM_CREATE_PIPE;
+        srs_error("create async io pipe failed. ret=%d", ret);
+        return ret;
+    }
+    
+    // the io thread never block when notify st.
+    int flags = fcntl(done_pipe[1], F_GETFL, 0);
+    fcntl(done_pipe[1], F_SETFL, flags | O_NONBLOCK);
+    
+    if ((done_stfd = st_netfd_open(done_pipe[0])) == NULL) {
+        ret = ERROR_SYSTEM_CREATE_PIPE;
+        srs_error("create async io st pipe failed. ret=%d", ret);
+        return ret;
+    }
+    
+    if ((ret = pthread->start()) != ERROR_SUCCESS) {
+        srs_error("start async io st thread failed. ret=%d", ret);
+        return ret;
+    }
+    
+    for (int i = 0; i < nb_threads; i++) {
+        SrsAsyncIOWorker* worker = new SrsAsyncIOWorker(this);
+        workers.push_back(worker);
+        
+        if ((ret = worker->start()) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    srs_trace("async io started, threads=%d", nb_threads);
+    
+    return ret;
+}
+
+bool SrsAsyncIO::enabled()
+{
+    return !workers.empty();
+}
+
+void SrsAsyncIO::dispose()
+{
+    if (workers.empty()) {
+        return;
+    }
+    
+    flush_batches(-1, false);
+    
+    // stop all workers, which finish the left jobs.
+    std::vector<SrsAsyncIOWorker*>::iterator it;
+    for (it = workers.begin(); it != workers.end(); ++it) {
+        SrsAsyncIOWorker* worker = *it;
+        srs_freep(worker);
+    }
+    workers.clear();
+    
+    // the writers maybe wait for the done jobs.
+    notify_done();
+    srs_trace("async io disposed, drops=%"PRId64, nb_drops);
+}
+
+void SrsAsyncIO::submit(SrsAsyncIOJob* job)
+{
+    // the merged logs must be written before the job of fd, for instance, the close.
+    if (batches.find(job->fd) != batches.end()) {
+        flush_batches(job->fd, false);
+    }
+    
+    if (workers.empty()) {
+        job->execute();
+        notify(job);
+        return;
+    }
+    
+    // the jobs of a fd always go to the same worker, to keep the order.
+    worker_of(job->fd)->push(job);
+}
+
+bool SrsAsyncIO::full(int fd)
+{
+    if (workers.empty()) {
+        return false;
+    }
+    
+    return worker_of(fd)->pending() >= max_queue;
+}
+
+void SrsAsyncIO::append(int fd, char* buf, int size, bool flush)
+{
+    if (workers.empty()) {
+        SrsAsyncIOJob* job = new SrsAsyncIOJob(SrsAsyncIOWrite, fd, NULL);
+        job->buf = new char[size];
+        job->size = job->capacity = size;
+        memcpy(job->buf, buf, size);
+        submit(job);
+        return;
+    }
+    
+    SrsAsyncIOJob* job = NULL;
+    std::map<int, SrsAsyncIOJob*>::iterator it = batches.find(fd);
+    if (it != batches.end()) {
+        job = it->second;
+    }
+    
+    // write the merged logs when no space.
+    if (job && job->size + size > job->capacity) {
+        flush_batches(fd, true);
+        job = NULL;
+    }
+    
+    if (!job) {
+        job = new SrsAsyncIOJob(SrsAsyncIOWrite, fd, NULL);
+        job->capacity = srs_max(SRS_PERF_ASYNC_IO_LOG_BATCH, size);
+        job->buf = new char[job->capacity];
+        batches[fd] = job;
+        
+        if (batch_time <= 0) {
+            batch_time = srs_get_system_time_ms();
+        }
+    }
+    
+    memcpy(job->buf + job->size, buf, size);
+    job->size += size;
+    
+    if (flush || srs_get_system_time_ms() - batch_time >= SRS_PERF_ASYNC_IO_LOG_FLUSH_MS) {
+        flush_batches(-1, true);
+    }
+}
+
+void SrsAsyncIO::on_done(SrsAsyncIOJob* job)
+{
+    pthread_mutex_lock(&lock);
+    bool wakeup = done.empty();
+    done.push_back(job);
+    pthread_mutex_unlock(&lock);
+    
+    // only wakeup st for the first done job,
+    // for st will consume all done jobs when wakeup.
+    if (wakeup) {
+        char v = 0;
+        if (::write(done_pipe[1], &v, 1) < 0) {
+            // ignore, the pipe is full and st will wakeup.
+        }
+    }
+}
+
+int SrsAsyncIO::cycle()
+{
+    int ret = ERROR_SUCCESS;
+    
+    // wakeup in time to write the merged logs.
+    char buf[64];
+    ssize_t nread = st_read(done_stfd, buf, sizeof(buf), SRS_PERF_ASYNC_IO_LOG_FLUSH_MS * 1000);
+    
+    if (!batches.empty() && srs_update_system_time_ms() - batch_time >= SRS_PERF_ASYNC_IO_LOG_FLUSH_MS) {
+        flush_batches(-1, true);
+    }
+    
+    if (nb_drops > nb_reported_drops) {
+        srs_warn("async io drop %"PRId64" logs for queue full, max=%"PRId64, nb_drops - nb_reported_drops, max_queue);
+        nb_reported_drops = nb_drops;
+    }
+    
+    if (nread > 0) {
+        notify_done();
+    }
+    
+    return ret;
+}
+
+SrsAsyncIOWorker* SrsAsyncIO::worker_of(int fd)
+{
+    return workers.at(fd % (int)workers.size());
+}
+
+void SrsAsyncIO::notify(SrsAsyncIOJob* job)
+{
+    if (job->handler) {
+        job->handler->on_async_io(job);
+    }
+    srs_freep(job);
+}
+
+void SrsAsyncIO::notify_done()
+{
+    std::vector<SrsAsyncIOJob*> copies;
+    pthread_mutex_lock(&lock);
+    copies.swap(done);
+    pthread_mutex_unlock(&lock);
+    
+    std::vector<SrsAsyncIOJob*>::iterator it;
+    for (it = copies.begin(); it != copies.end(); ++it) {
+        SrsAsyncIOJob* job = *it;
+        notify(job);
+    }
+}
+
+void SrsAsyncIO::flush_batches(int fd, bool drop)
+{
+    std::map<int, SrsAsyncIOJob*>::iterator it;
+    for (it = batches.begin(); it != batches.end();) {
+        if (fd >= 0 && it->first != fd) {
+            ++it;
+            continue;
+        }
+        
+        SrsAsyncIOJob* job = it->second;
+        batches.erase(it++);
+        
+        if (workers.empty()) {
+            job->execute();
+            notify(job);
+            continue;
+        }
+        
+        // never block st for logs, drop when the disk is too slow.
+        SrsAsyncIOWorker* worker = worker_of(job->fd);
+        if (drop && worker->pending() >= max_queue) {
+            nb_drops++;
+            srs_freep(job);
+            continue;
+        }
+        worker->push(job);
+    }
+    
+    if (batches.empty()) {
+        batch_time = 0;
+    }
+}
+
+SrsAsyncFileWriter::SrsAsyncFileWriter()
+{
+    fd = -1;
+    offset = 0;
+    buffer_offset = 0;
+    nb_jobs = 0;
+    nb_pending = 0;
+    error = 0;
+    wait = st_cond_new();
+}
+
+SrsAsyncFileWriter::~SrsAsyncFileWriter()
+{
+    close();
+    st_cond_destroy(wait);
+}
+
+int SrsAsyncFileWriter::open(string p)
+{
+    return do_open(p, O_CREAT|O_WRONLY|O_TRUNC);
+}
+
+int SrsAsyncFileWriter::open_append(string p)
+{
+    return do_open(p, O_APPEND|O_WRONLY);
+}
+
+void SrsAsyncFileWriter::close()
+{
+    if (fd < 0) {
+        return;
+    }
+    
+    // write the left bytes and wait for all done.
+    flush();
+    wait_jobs(0);
+    
+    if (error) {
+        srs_error("async write file %s failed, errno=%d. ret=%d", path.c_str(), error, ERROR_SYSTEM_FILE_WRITE);
+    }
+    
+    if (::close(fd) < 0) {
+        srs_error("close file %s failed. ret=%d", path.c_str(), ERROR_SYSTEM_FILE_CLOSE);
+    }
+    fd = -1;
+}
+
+bool SrsAsyncFileWriter::is_open()
+{
+    return fd > 0;
+}
+
+void SrsAsyncFileWriter::lseek(int64_t o)
+{
+    if (o == offset) {
+        return;
+    }
+    
+    // the merged bytes must write at the previous position.
+    flush();
+    
+    offset = o;
+    buffer_offset = o;
+}
+
+int64_t SrsAsyncFileWriter::tellg()
+{
+    return offset;
+}
+
+int SrsAsyncFileWriter::write(void* buf, size_t count, ssize_t* pnwrite)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (error) {
+        ret = ERROR_SYSTEM_FILE_WRITE;
+        srs_error("write to file %s failed, errno=%d. ret=%d", path.c_str(), error, ret);
+        return ret;
+    }
+    
+    if (count > 0) {
+        buffer.insert(buffer.end(), (char*)buf, (char*)buf + count);
+        offset += count;
+    }
+    
+    if (pnwrite != NULL) {
+        *pnwrite = count;
+    }
+    
+    if ((int)buffer.size() < SRS_PERF_ASYNC_IO_CHUNK) {
+        return ret;
+    }
+    
+    if ((ret = flush()) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // the disk is too slow, wait for the pending bytes.
+    return wait_jobs(SRS_PERF_ASYNC_IO_MAX_PENDING);
+}
+
+void SrsAsyncFileWriter::on_async_io(SrsAsyncIOJob* job)
+{
+    nb_jobs--;
+    nb_pending -= job->size;
+    
+    if (job->error && !error) {
+        error = job->error;
+    }
+    
+    st_cond_signal(wait);
+}
+
+int SrsAsyncFileWriter::do_open(string p, int flags)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (fd > 0) {
+        ret = ERROR_SYSTEM_FILE_ALREADY_OPENED;
+        srs_error("file %s already opened. ret=%d", path.c_str(), ret);
+        return ret;
+    }
+    
+    mode_t mode = S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH;
+    if ((fd = ::open(p.c_str(), flags, mode)) < 0) {
+        ret = ERROR_SYSTEM_FILE_OPENE;
+        srs_error("open file %s failed. ret=%d", p.c_str(), ret);
+        return ret;
+    }
+    
+    path = p;
+    error = 0;
+    buffer.clear();
+    offset = (flags & O_APPEND)? (int64_t)::lseek(fd, 0, SEEK_END) : 0;
+    buffer_offset = offset;
+    
+    return ret;
+}
+
+int SrsAsyncFileWriter::flush()
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (buffer.empty()) {
+        return ret;
+    }
+    
+    SrsAsyncIOJob* job = new SrsAsyncIOJob(SrsAsyncIOWrite, fd, this);
+    job->size = (int)buffer.size();
+    job->buf = new char[job->size];
+    memcpy(job->buf, &buffer[0], job->size);
+    job->offset = buffer_offset;
+    
+    buffer_offset += job->size;
+    buffer.clear();
+    
+    // the queue of io thread is full, wait for the jobs of file to keep it bounded.
+    while (nb_jobs > 0 && _srs_async_io->full(fd)) {
+        st_cond_wait(wait);
+    }
+    
+    // the job maybe done in place when async io disabled.
+    nb_jobs++;
+    nb_pending += job->size;
+    _srs_async_io->submit(job);
+    
+    return ret;
+}
+
+int SrsAsyncFileWriter::wait_jobs(int64_t max_pending)
+{
+    int ret = ERROR_SUCCESS;
+    
+    while (nb_jobs > 0 && nb_pending > max_pending) {
+        st_cond_wait(wait);
+    }
+    
+    if (error) {
+        ret = ERROR_SYSTEM_FILE_WRITE;
+        srs_error("write to file %s failed, errno=%d. ret=%d", path.c_str(), error, ret);
+        return ret;
+    }
+    
+    return ret;
+}
@@ -0,0 +1,268 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef SRS_APP_ASYNC_IO_HPP
+#define SRS_APP_ASYNC_IO_HPP
+
+/*
+#include <srs_app_async_io.hpp>
+*/
+#include <srs_core.hpp>
+
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+
+#include <srs_app_st.hpp>
+#include <srs_app_thread.hpp>
+#include <srs_kernel_file.hpp>
+
+class SrsAsyncIO;
+class SrsAsyncIOJob;
+
+/**
+ * the type of async io job.
+ */
+enum SrsAsyncIOType
+{
+    // write the buf to fd at offset, or append when offset is -1.
+    SrsAsyncIOWrite,
+    // close the fd, after all jobs of fd are done.
+    SrsAsyncIOClose
+};
+
+/**
+ * the handler of async io, notified in st when job done.
+ */
+class ISrsAsyncIOHandler
+{
+public:
+    ISrsAsyncIOHandler();
+    virtual ~ISrsAsyncIOHandler();
+public:
+    /**
+     * when job is done by the io thread.
+     * @remark the job is freed by pool after callback.
+     */
+    virtual void on_async_io(SrsAsyncIOJob* job) = 0;
+};
+
+/**
+ * the job to execute in io thread, never use st or log in io thread.
+ */
+class SrsAsyncIOJob
+{
+public:
+    SrsAsyncIOType type;
+    int fd;
+    // the bytes to write, the job own it.
+    char* buf;
+    int size;
+    // the allocated bytes of buf, to merge the logs.
+    int capacity;
+    // the offset to write at, -1 to write at current position.
+    int64_t offset;
+    // the errno of io, 0 for success.
+    int error;
+    // the handler to notify, NULL to ignore.
+    ISrsAsyncIOHandler* handler;
+public:
+    SrsAsyncIOJob(SrsAsyncIOType t, int f, ISrsAsyncIOHandler* h);
+    virtual ~SrsAsyncIOJob();
+public:
+    /**
+     * execute the job in io thread.
+     */
+    virtual void execute();
+};
+
+/**
+ * the io thread, execute the jobs one by one,
+ * so the jobs of the same fd must go to the same worker to keep order.
+ */
+class SrsAsyncIOWorker
+{
+private:
+    pthread_t tid;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    std::deque<SrsAsyncIOJob*> jobs;
+    // the bytes of jobs to write, include the executing one.
+    int64_t nb_bytes;
+    bool quit;
+    bool started;
+    // the pool to notify the done jobs.
+    SrsAsyncIO* pool;
+public:
+    SrsAsyncIOWorker(SrsAsyncIO* p);
+    virtual ~SrsAsyncIOWorker();
+public:
+    virtual int start();
+    virtual void stop();
+    virtual void push(SrsAsyncIOJob* job);
+    /**
+     * the bytes queued to write.
+     */
+    virtual int64_t pending();
+private:
+    virtual void cycle();
+    static void* worker_fn(void* arg);
+};
+
+/**
+ * the pool of io threads, to offload the blocking disk io from st,
+ * for a slow disk never stalls the connections on st.
+ * the done jobs are notified to st by a pipe, and the handler is
+ * called in st thread.
+ * the logs are merged then written in a job, and dropped when the
+ * queue of io thread exceed max_queue.
+ * @remark when pool not started, the jobs are executed in place.
+ */
+class SrsAsyncIO : public ISrsEndlessThreadHandler
+{
+protected:
+    std::vector<SrsAsyncIOWorker*> workers;
+    // the max bytes queued in an io thread.
+    int64_t max_queue;
+    // the merged logs to write, key is fd.
+    std::map<int, SrsAsyncIOJob*> batches;
+    // the time in ms when the first log merged.
+    int64_t batch_time;
+    // the dropped logs for the queue is full, and the reported ones.
+    int64_t nb_drops;
+    int64_t nb_reported_drops;
+private:
+    // the done jobs, pushed by io threads.
+    pthread_mutex_t lock;
+    std::vector<SrsAsyncIOJob*> done;
+    // the pipe to wakeup st when jobs done.
+    int done_pipe[2];
+    st_netfd_t done_stfd;
+    SrsEndlessThread* pthread;
+public:
+    SrsAsyncIO();
+    virtual ~SrsAsyncIO();
+public:
+    /**
+     * start the io threads, must be called after st initialized and daemon forked.
+     * @param nb_threads the number of io threads, 0 to disable.
+     */
+    virtual int initialize(int nb_threads);
+    /**
+     * whether the io threads are running.
+     */
+    virtual bool enabled();
+    /**
+     * flush the merged logs and stop the io threads, which finish the left jobs,
+     * then the jobs are executed in place.
+     */
+    virtual void dispose();
+    /**
+     * submit the job to io thread, the pool own the job.
+     * @remark the job is executed in place when pool disabled.
+     */
+    virtual void submit(SrsAsyncIOJob* job);
+    /**
+     * whether the queue of io thread for fd is full,
+     * the writer should wait for its jobs to keep the bytes bounded.
+     */
+    virtual bool full(int fd);
+    /**
+     * merge the log to write in io thread, which is written when merged
+     * SRS_PERF_ASYNC_IO_LOG_BATCH bytes or SRS_PERF_ASYNC_IO_LOG_FLUSH_MS.
+     * @param flush whether write the merged logs now, for instance, the error.
+     * @remark the log is dropped when the queue is full, never block st.
+     */
+    virtual void append(int fd, char* buf, int size, bool flush);
+    /**
+     * called by io thread when job done.
+     */
+    virtual void on_done(SrsAsyncIOJob* job);
+// interface ISrsEndlessThreadHandler.
+public:
+    virtual int cycle();
+private:
+    virtual SrsAsyncIOWorker* worker_of(int fd);
+    virtual void notify(SrsAsyncIOJob* job);
+    virtual void notify_done();
+    /**
+     * write the merged logs, drop when the queue is full.
+     * @param fd the fd to flush, -1 for all.
+     */
+    virtual void flush_batches(int fd, bool drop);
+};
+
+/**
+ * the file writer which write in io threads,
+ * the bytes are merged then write in a time,
+ * and the writer wait in st when close or too many bytes pending.
+ * @remark the write error is returned by the next write or close.
+ */
+class SrsAsyncFileWriter : public SrsFileWriter, public ISrsAsyncIOHandler
+{
+private:
+    std::string path;
+    int fd;
+    // the logic position of file.
+    int64_t offset;
+    // the merged bytes to write at buffer_offset.
+    std::vector<char> buffer;
+    int64_t buffer_offset;
+    // the pending jobs and bytes in io threads.
+    int nb_jobs;
+    int64_t nb_pending;
+    // the errno of the first failed job.
+    int error;
+    st_cond_t wait;
+public:
+    SrsAsyncFileWriter();
+    virtual ~SrsAsyncFileWriter();
+public:
+    virtual int open(std::string p);
+    virtual int open_append(std::string p);
+    /**
+     * close the writer, wait for all bytes written.
+     */
+    virtual void close();
+public:
+    virtual bool is_open();
+    virtual void lseek(int64_t offset);
+    virtual int64_t tellg();
+public:
+    virtual int write(void* buf, size_t count, ssize_t* pnwrite);
+// interface ISrsAsyncIOHandler
+public:
+    virtual void on_async_io(SrsAsyncIOJob* job);
+private:
+    virtual int do_open(std::string p, int flags);
+    virtual int flush();
+    virtual int wait_jobs(int64_t max_pending);
+};
+
+// the global async io pool.
+extern SrsAsyncIO* _srs_async_io;
+
+#endif
@@ -42,6 +42,7 @@ using namespace std;
 #include <srs_app_utility.hpp>
 #include <srs_rtmp_amf0.hpp>
 #include <srs_kernel_utility.hpp>
+#include <srs_app_publisher.hpp>
 
 #define SRS_HTTP_FLV_STREAM_BUFFER 4096
 
@@ -123,6 +124,7 @@ SrsDynamicHttpConn::SrsDynamicHttpConn(IConnectionManager* cm, st_netfd_t fd, Sr
     client = NULL;
     stfd = NULL;
     stream_id = 0;
+    publisher = NULL;
     
     pprint = SrsPithyPrint::create_caster();
 }
@@ -247,6 +249,13 @@ int SrsDynamicHttpConn::rtmp_write_packet(char type, u_int32_t timestamp, char*
                   msg->is_audio()? "A":msg->is_video()? "V":"N", pprint->age(), msg->timestamp, msg->size);
     }
     
+    // feed the source directly for local publisher.
+    if (publisher) {
+        ret = publisher->on_message(msg);
+        srs_freep(msg);
+        return ret;
+    }
+    
     // send out encoded msg.
     if ((ret = client->send_and_free_message(msg, stream_id)) != ERROR_SUCCESS) {
         return ret;
@@ -259,9 +268,16 @@ int SrsDynamicHttpConn::connect()
 {
     int ret = ERROR_SUCCESS;
     
+    // the local publisher unpublished for idle timeout, drop it to republish,
+    // util the unpublish hooks are done, which run in the idle thread.
+    if (publisher && !publisher->is_publishing() && publisher->is_finished()) {
+        srs_warn("flv: local publisher unpublished, republish it.");
+        srs_freep(publisher);
+    }
+    
     // when ok, ignore.
     // TODO: FIXME: should reconnect when disconnected.
-    if (io || client) {
+    if (io || client || publisher) {
         return ret;
     }
     
@@ -283,6 +299,17 @@ int SrsDynamicHttpConn::connect()
                              req->param);
     }
     
+    // publish to the source of local server in process.
+    if (SrsLocalPublisher::is_local(req)) {
+        publisher = new SrsLocalPublisher();
+        if ((ret = publisher->publish(req, ip)) != ERROR_SUCCESS) {
+            srs_error("flv: publish in process failed, stream=%s. ret=%d", req->stream.c_str(), ret);
+            srs_freep(publisher);
+            return ret;
+        }
+        return ret;
+    }
+    
     // connect host.
     if ((ret = srs_socket_connect(req->host, ::atoi(req->port.c_str()), ST_UTIME_NO_TIMEOUT, &stfd)) != ERROR_SUCCESS) {
         srs_error("mpegts: connect server %s:%s failed. ret=%d", req->host.c_str(), req->port.c_str(), ret);
@@ -371,6 +398,7 @@ int SrsDynamicHttpConn::connect_app(string ep_server, string ep_port)
 
 void SrsDynamicHttpConn::close()
 {
+    srs_freep(publisher);
     srs_freep(client);
     srs_freep(io);
     srs_freep(req);
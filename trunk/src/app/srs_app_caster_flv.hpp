@@ -43,6 +43,7 @@ class SrsRequest;
 class SrsPithyPrint;
 class ISrsHttpResponseReader;
 class SrsFlvDecoder;
+class SrsLocalPublisher;
 
 #include <srs_app_st.hpp>
 #include <srs_app_listener.hpp>
@@ -90,6 +91,8 @@ private:
     SrsStSocket* io;
     SrsRtmpClient* client;
     int stream_id;
+    // publish to source in process when output to local server.
+    SrsLocalPublisher* publisher;
 public:
     SrsDynamicHttpConn(IConnectionManager* cm, st_netfd_t fd, SrsHttpServeMux* m);
     virtual ~SrsDynamicHttpConn();
@@ -101,7 +104,7 @@ private:
     virtual int do_proxy(ISrsHttpResponseReader* rr, SrsFlvDecoder* dec);
     virtual int rtmp_write_packet(char type, u_int32_t timestamp, char* data, int size);
 private:
-    // connect to rtmp output url.
+    // connect to rtmp output url, or publish in process for local server.
     // @remark ignore when not connected, reconnect when disconnected.
     virtual int connect();
     virtual int connect_app(std::string ep_server, std::string ep_port);
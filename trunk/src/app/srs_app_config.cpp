@@ -46,6 +46,7 @@ using namespace std;
 #include <srs_kernel_file.hpp>
 #include <srs_app_utility.hpp>
 #include <srs_core_performance.hpp>
+#include <srs_kernel_cidr.hpp>
 
 using namespace _srs_internal;
 
@@ -70,6 +71,8 @@ const char* _srs_version = "XCORE-"RTMP_SIG_SRS_SERVER;
 #define SRS_CONF_DEFAULT_UTC_TIME false
 
 #define SRS_CONF_DEFAULT_MAX_CONNECTIONS 1000
+#define SRS_CONF_DEFAULT_WORKERS 1
+#define SRS_CONF_DEFAULT_WORKER_RELAY_PORT 19350
 #define SRS_CONF_DEFAULT_HLS_PATH "./objs/nginx/html"
 #define SRS_CONF_DEFAULT_HLS_M3U8_FILE "[app]/[stream].m3u8"
 #define SRS_CONF_DEFAULT_HLS_TS_FILE "[app]/[stream]-[seq].ts"
@@ -125,6 +128,7 @@ const char* _srs_version = "XCORE-"RTMP_SIG_SRS_SERVER;
 #define SRS_CONF_DEFAULT_STREAM_CASTER_MPEGTS_OVER_UDP "mpegts_over_udp"
 #define SRS_CONF_DEFAULT_STREAM_CASTER_RTSP "rtsp"
 #define SRS_CONF_DEFAULT_STREAM_CASTER_FLV "flv"
+#define SRS_CONF_DEFAULT_STREAM_CASTER_RECV_BUFFER 8388608
 
 #define SRS_CONF_DEFAULT_STATS_NETWORK_DEVICE_INDEX 0
 
@@ -132,6 +136,9 @@ const char* _srs_version = "XCORE-"RTMP_SIG_SRS_SERVER;
 
 #define SRS_CONF_DEFAULT_INGEST_TYPE_FILE "file"
 #define SRS_CONF_DEFAULT_INGEST_TYPE_STREAM "stream"
+#define SRS_CONF_DEFAULT_INGEST_TYPE_HLS "hls"
+#define SRS_CONF_DEFAULT_INGEST_HLS_PREFETCH 3
+#define SRS_CONF_DEFAULT_INGEST_HLS_JITTER 5
 
 #define SRS_CONF_DEFAULT_TRANSCODE_IFORMAT "flv"
 #define SRS_CONF_DEFAULT_TRANSCODE_OFORMAT "flv"
@@ -451,6 +458,19 @@ int SrsConfDirective::read_token(SrsConfigBuffer* buffer, vector<string>& args,
     return ret;
 }
 
+SrsVhostConfig::SrsVhostConfig()
+{
+    conf = NULL;
+    security_allow = new SrsCidrTrie();
+    security_deny = new SrsCidrTrie();
+}
+
+SrsVhostConfig::~SrsVhostConfig()
+{
+    srs_freep(security_allow);
+    srs_freep(security_deny);
+}
+
 SrsConfig::SrsConfig()
 {
     dolphin = false;
@@ -462,10 +482,21 @@ SrsConfig::SrsConfig()
     root = new SrsConfDirective();
     root->conf_line = 0;
     root->name = "root";
+    
+    // the settings when vhost not found.
+    default_vhost = compile_vhost(NULL);
 }
 
 SrsConfig::~SrsConfig()
 {
+    std::map<std::string, SrsVhostConfig*>::iterator it;
+    for (it = vhost_configs.begin(); it != vhost_configs.end(); ++it) {
+        SrsVhostConfig* vc = it->second;
+        srs_freep(vc);
+    }
+    vhost_configs.clear();
+    
+    srs_freep(default_vhost);
     srs_freep(root);
 }
 
@@ -494,26 +525,25 @@ void SrsConfig::set_config_directive(SrsConfDirective* parent, string dir, strin
 
 void SrsConfig::subscribe(ISrsReloadHandler* handler)
 {
-    std::vector<ISrsReloadHandler*>::iterator it;
-    
-    it = std::find(subscribes.begin(), subscribes.end(), handler);
-    if (it != subscribes.end()) {
+    if (subscribe_handles.find(handler) != subscribe_handles.end()) {
         return;
     }
     
     subscribes.push_back(handler);
+    subscribe_handles[handler] = --subscribes.end();
 }
 
 void SrsConfig::unsubscribe(ISrsReloadHandler* handler)
 {
-    std::vector<ISrsReloadHandler*>::iterator it;
+    std::map<ISrsReloadHandler*, std::list<ISrsReloadHandler*>::iterator>::iterator it;
     
-    it = std::find(subscribes.begin(), subscribes.end(), handler);
-    if (it == subscribes.end()) {
+    it = subscribe_handles.find(handler);
+    if (it == subscribe_handles.end()) {
         return;
     }
     
-    subscribes.erase(it);
+    subscribes.erase(it->second);
+    subscribe_handles.erase(it);
 }
 
 int SrsConfig::reload()
@@ -543,7 +573,7 @@ int SrsConfig::reload_vhost(SrsConfDirective* old_root)
     int ret = ERROR_SUCCESS;
     
     // merge config.
-    std::vector<ISrsReloadHandler*>::iterator it;
+    std::list<ISrsReloadHandler*>::iterator it;
     
     // state graph
     //      old_vhost       new_vhost
@@ -879,8 +909,12 @@ int SrsConfig::reload_conf(SrsConfig* conf)
     root = conf->root;
     conf->root = NULL;
     
+    // rebuild the vhosts before notify the subscribers,
+    // which read the new config by getters.
+    compile();
+    
     // merge config.
-    std::vector<ISrsReloadHandler*>::iterator it;
+    std::list<ISrsReloadHandler*>::iterator it;
 
     // never support reload:
     //      daemon
@@ -1012,7 +1046,7 @@ int SrsConfig::reload_http_api(SrsConfDirective* old_root)
     int ret = ERROR_SUCCESS;
     
     // merge config.
-    std::vector<ISrsReloadHandler*>::iterator it;
+    std::list<ISrsReloadHandler*>::iterator it;
     
     // state graph
     //      old_http_api    new_http_api
@@ -1077,7 +1111,7 @@ int SrsConfig::reload_http_stream(SrsConfDirective* old_root)
     int ret = ERROR_SUCCESS;
     
     // merge config.
-    std::vector<ISrsReloadHandler*>::iterator it;
+    std::list<ISrsReloadHandler*>::iterator it;
     
     // state graph
     //      old_http_stream     new_http_stream
@@ -1166,7 +1200,7 @@ int SrsConfig::reload_transcode(SrsConfDirective* new_vhost, SrsConfDirective* o
         }
     }
     
-    std::vector<ISrsReloadHandler*>::iterator it;
+    std::list<ISrsReloadHandler*>::iterator it;
     
     std::string vhost = new_vhost->arg0();
     
@@ -1250,7 +1284,7 @@ int SrsConfig::reload_ingest(SrsConfDirective* new_vhost, SrsConfDirective* old_
         }
     }
     
-    std::vector<ISrsReloadHandler*>::iterator it;
+    std::list<ISrsReloadHandler*>::iterator it;
     
     std::string vhost = new_vhost->arg0();
     
@@ -1568,6 +1602,7 @@ int SrsConfig::check_config()
             && n != "http_api" && n != "stats" && n != "vhost" && n != "pithy_print_ms"
             && n != "http_stream" && n != "http_server" && n != "stream_caster"
             && n != "utc_time" && n != "external_shell"
+            && n != "workers" && n != "worker_relay_port"
         ) {
             ret = ERROR_SYSTEM_CONFIG_INVALID;
             srs_error("unsupported directive %s, ret=%d", n.c_str(), ret);
@@ -1790,7 +1825,7 @@ int SrsConfig::check_config()
             SrsConfDirective* conf = stream_caster->at(i);
             string n = conf->name;
             if (n != "enabled" && n != "caster" && n != "output"
-                && n != "listen" && n != "rtp_port_min" && n != "rtp_port_max"
+                && n != "listen" && n != "rtp_port_min" && n != "rtp_port_max" && n != "recv_buffer"
                 ) {
                 ret = ERROR_SYSTEM_CONFIG_INVALID;
                 srs_error("unsupported stream_caster directive %s, ret=%d", n.c_str(), ret);
@@ -1881,7 +1916,9 @@ int SrsConfig::check_config()
             } else if (n == "http_remux") {
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name.c_str();
-                    if (m != "enabled" && m != "mount" && m != "fast_cache" && m != "hstrs") {
+                    if (m != "enabled" && m != "mount" && m != "fast_cache" && m != "hstrs"
+                        && m != "mw_latency" && m != "mw_msgs"
+                    ) {
                         ret = ERROR_SYSTEM_CONFIG_INVALID;
                         srs_error("unsupported vhost http_remux directive %s, ret=%d", m.c_str(), ret);
                         return ret;
@@ -1903,7 +1940,7 @@ int SrsConfig::check_config()
             } else if (n == "http_hooks") {
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name.c_str();
-                    if (m != "enabled" && m != "on_connect" && m != "on_close" && m != "on_publish"
+                    if (m != "enabled" && m != "cache_ttl" && m != "on_connect" && m != "on_close" && m != "on_publish"
                         && m != "on_unpublish" && m != "on_play" && m != "on_stop"
                         && m != "on_dvr" && m != "on_hls" && m != "on_hls_notify"
                         ) {
@@ -2082,6 +2119,8 @@ int SrsConfig::parse_buffer(SrsConfigBuffer* buffer)
         set_config_directive(root, "daemon", "off");
         set_config_directive(root, "srs_log_tank", "console");
     }
+    
+    compile();
 
     return ret;
 }
@@ -2125,6 +2164,30 @@ int SrsConfig::get_max_connections()
     return ::atoi(conf->arg0().c_str());
 }
 
+int SrsConfig::get_workers()
+{
+    srs_assert(root);
+    
+    SrsConfDirective* conf = root->get("workers");
+    if (!conf || conf->arg0().empty()) {
+        return SRS_CONF_DEFAULT_WORKERS;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+int SrsConfig::get_worker_relay_port()
+{
+    srs_assert(root);
+    
+    SrsConfDirective* conf = root->get("worker_relay_port");
+    if (!conf || conf->arg0().empty()) {
+        return SRS_CONF_DEFAULT_WORKER_RELAY_PORT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
 std::string SrsConfig::get_external_shell()
 {
     srs_assert(root);
@@ -2275,10 +2338,44 @@ int SrsConfig::get_stream_caster_rtp_port_max(SrsConfDirective* sc)
     return ::atoi(conf->arg0().c_str());
 }
 
+int SrsConfig::get_stream_caster_recv_buffer(SrsConfDirective* sc)
+{
+    srs_assert(sc);
+
+    SrsConfDirective* conf = sc->get("recv_buffer");
+    if (!conf || conf->arg0().empty()) {
+        return SRS_CONF_DEFAULT_STREAM_CASTER_RECV_BUFFER;
+    }
+
+    return ::atoi(conf->arg0().c_str());
+}
+
 SrsConfDirective* SrsConfig::get_vhost(string vhost)
+{
+    return get_vhost_config(vhost)->conf;
+}
+
+SrsVhostConfig* SrsConfig::get_vhost_config(string vhost)
+{
+    std::map<std::string, SrsVhostConfig*>::iterator it = vhost_configs.find(vhost);
+    if (it != vhost_configs.end()) {
+        return it->second;
+    }
+    
+    if (vhost != SRS_CONSTS_RTMP_DEFAULT_VHOST) {
+        return get_vhost_config(SRS_CONSTS_RTMP_DEFAULT_VHOST);
+    }
+    
+    return default_vhost;
+}
+
+void SrsConfig::compile()
 {
     srs_assert(root);
     
+    // build the new index then swap, the old directives maybe still used by it.
+    std::map<std::string, SrsVhostConfig*> compiled;
+    
     for (int i = 0; i < (int)root->directives.size(); i++) {
         SrsConfDirective* conf = root->at(i);
         
@@ -2286,16 +2383,52 @@ SrsConfDirective* SrsConfig::get_vhost(string vhost)
             continue;
         }
         
-        if (conf->arg0() == vhost) {
-            return conf;
+        // use the first one for the duplicated vhost.
+        if (compiled.find(conf->arg0()) != compiled.end()) {
+            continue;
         }
+        
+        compiled[conf->arg0()] = compile_vhost(conf);
     }
     
-    if (vhost != SRS_CONSTS_RTMP_DEFAULT_VHOST) {
-        return get_vhost(SRS_CONSTS_RTMP_DEFAULT_VHOST);
+    std::swap(vhost_configs, compiled);
+    
+    std::map<std::string, SrsVhostConfig*>::iterator it;
+    for (it = compiled.begin(); it != compiled.end(); ++it) {
+        SrsVhostConfig* vc = it->second;
+        srs_freep(vc);
     }
     
-    return NULL;
+    srs_info("compile %d vhosts of config.", (int)vhost_configs.size());
+}
+
+SrsVhostConfig* SrsConfig::compile_vhost(SrsConfDirective* vhost)
+{
+    SrsVhostConfig* vc = new SrsVhostConfig();
+    
+    vc->conf = vhost;
+    vc->enabled = get_vhost_enabled(vhost);
+    vc->is_edge = get_vhost_is_edge(vhost);
+    vc->gop_cache = get_gop_cache(vhost);
+    vc->queue_length = get_queue_length(vhost);
+    vc->atc = get_atc(vhost);
+    vc->atc_auto = get_atc_auto(vhost);
+    vc->time_jitter = get_time_jitter(vhost);
+    vc->mix_correct = get_mix_correct(vhost);
+    vc->parse_sps = get_parse_sps(vhost);
+    vc->reduce_sequence_header = get_reduce_sequence_header(vhost);
+    vc->mr_enabled = get_mr_enabled(vhost);
+    vc->mr_sleep_ms = get_mr_sleep_ms(vhost);
+    vc->mw_sleep_ms = get_mw_sleep_ms(vhost);
+    vc->realtime = get_realtime_enabled(vhost);
+    vc->tcp_nodelay = get_tcp_nodelay(vhost);
+    vc->send_min_interval = get_send_min_interval(vhost);
+    vc->hls_enabled = get_hls_enabled(vhost);
+    vc->hls_on_error = get_hls_on_error(vhost);
+    compile_security(vhost, "allow", vc->security_allow);
+    compile_security(vhost, "deny", vc->security_deny);
+    
+    return vc;
 }
 
 void SrsConfig::get_vhosts(vector<SrsConfDirective*>& vhosts)
@@ -2315,9 +2448,7 @@ void SrsConfig::get_vhosts(vector<SrsConfDirective*>& vhosts)
 
 bool SrsConfig::get_vhost_enabled(string vhost)
 {
-    SrsConfDirective* vhost_conf = get_vhost(vhost);
-    
-    return get_vhost_enabled(vhost_conf);
+    return get_vhost_config(vhost)->enabled;
 }
 
 bool SrsConfig::get_vhost_enabled(SrsConfDirective* vhost)
@@ -2336,7 +2467,12 @@ bool SrsConfig::get_vhost_enabled(SrsConfDirective* vhost)
 
 bool SrsConfig::get_gop_cache(string vhost)
 {
-    SrsConfDirective* conf = get_vhost(vhost);
+    return get_vhost_config(vhost)->gop_cache;
+}
+
+bool SrsConfig::get_gop_cache(SrsConfDirective* vhost)
+{
+    SrsConfDirective* conf = vhost;
 
     if (!conf) {
         return SRS_PERF_GOP_CACHE;
@@ -2368,7 +2504,12 @@ bool SrsConfig::get_debug_srs_upnode(string vhost)
 
 bool SrsConfig::get_atc(string vhost)
 {
-    SrsConfDirective* conf = get_vhost(vhost);
+    return get_vhost_config(vhost)->atc;
+}
+
+bool SrsConfig::get_atc(SrsConfDirective* vhost)
+{
+    SrsConfDirective* conf = vhost;
 
     if (!conf) {
         return false;
@@ -2384,7 +2525,12 @@ bool SrsConfig::get_atc(string vhost)
 
 bool SrsConfig::get_atc_auto(string vhost)
 {
-    SrsConfDirective* conf = get_vhost(vhost);
+    return get_vhost_config(vhost)->atc_auto;
+}
+
+bool SrsConfig::get_atc_auto(SrsConfDirective* vhost)
+{
+    SrsConfDirective* conf = vhost;
 
     if (!conf) {
         return SRS_CONF_DEFAULT_ATC_AUTO;
@@ -2400,7 +2546,12 @@ bool SrsConfig::get_atc_auto(string vhost)
 
 int SrsConfig::get_time_jitter(string vhost)
 {
-    SrsConfDirective* conf = get_vhost(vhost);
+    return get_vhost_config(vhost)->time_jitter;
+}
+
+int SrsConfig::get_time_jitter(SrsConfDirective* vhost)
+{
+    SrsConfDirective* conf = vhost;
     
     std::string time_jitter = SRS_CONF_DEFAULT_TIME_JITTER;
     
@@ -2417,7 +2568,12 @@ int SrsConfig::get_time_jitter(string vhost)
 
 bool SrsConfig::get_mix_correct(string vhost)
 {
-    SrsConfDirective* conf = get_vhost(vhost);
+    return get_vhost_config(vhost)->mix_correct;
+}
+
+bool SrsConfig::get_mix_correct(SrsConfDirective* vhost)
+{
+    SrsConfDirective* conf = vhost;
     
     if (!conf) {
         return SRS_CONF_DEFAULT_MIX_CORRECT;
@@ -2433,7 +2589,12 @@ bool SrsConfig::get_mix_correct(string vhost)
 
 double SrsConfig::get_queue_length(string vhost)
 {
-    SrsConfDirective* conf = get_vhost(vhost);
+    return get_vhost_config(vhost)->queue_length;
+}
+
+double SrsConfig::get_queue_length(SrsConfDirective* vhost)
+{
+    SrsConfDirective* conf = vhost;
 
     if (!conf) {
         return SRS_PERF_PLAY_QUEUE;
@@ -2505,10 +2666,15 @@ int SrsConfig::get_chunk_size(string vhost)
 }
 
 bool SrsConfig::get_parse_sps(string vhost)
+{
+    return get_vhost_config(vhost)->parse_sps;
+}
+
+bool SrsConfig::get_parse_sps(SrsConfDirective* vhost)
 {
     static bool DEFAULT = true;
     
-    SrsConfDirective* conf = get_vhost(vhost);
+    SrsConfDirective* conf = vhost;
     
     if (!conf) {
         return DEFAULT;
@@ -2529,7 +2695,12 @@ bool SrsConfig::get_parse_sps(string vhost)
 
 bool SrsConfig::get_mr_enabled(string vhost)
 {
-    SrsConfDirective* conf = get_vhost(vhost);
+    return get_vhost_config(vhost)->mr_enabled;
+}
+
+bool SrsConfig::get_mr_enabled(SrsConfDirective* vhost)
+{
+    SrsConfDirective* conf = vhost;
 
     if (!conf) {
         return SRS_PERF_MR_ENABLED;
@@ -2550,7 +2721,12 @@ bool SrsConfig::get_mr_enabled(string vhost)
 
 int SrsConfig::get_mr_sleep_ms(string vhost)
 {
-    SrsConfDirective* conf = get_vhost(vhost);
+    return get_vhost_config(vhost)->mr_sleep_ms;
+}
+
+int SrsConfig::get_mr_sleep_ms(SrsConfDirective* vhost)
+{
+    SrsConfDirective* conf = vhost;
 
     if (!conf) {
         return SRS_PERF_MR_SLEEP;
@@ -2571,7 +2747,12 @@ int SrsConfig::get_mr_sleep_ms(string vhost)
 
 int SrsConfig::get_mw_sleep_ms(string vhost)
 {
-    SrsConfDirective* conf = get_vhost(vhost);
+    return get_vhost_config(vhost)->mw_sleep_ms;
+}
+
+int SrsConfig::get_mw_sleep_ms(SrsConfDirective* vhost)
+{
+    SrsConfDirective* conf = vhost;
 
     if (!conf) {
         return SRS_PERF_MW_SLEEP;
@@ -2587,7 +2768,12 @@ int SrsConfig::get_mw_sleep_ms(string vhost)
 
 bool SrsConfig::get_realtime_enabled(string vhost)
 {
-    SrsConfDirective* conf = get_vhost(vhost);
+    return get_vhost_config(vhost)->realtime;
+}
+
+bool SrsConfig::get_realtime_enabled(SrsConfDirective* vhost)
+{
+    SrsConfDirective* conf = vhost;
 
     if (!conf) {
         return SRS_PERF_MIN_LATENCY_ENABLED;
@@ -2602,10 +2788,15 @@ bool SrsConfig::get_realtime_enabled(string vhost)
 }
 
 bool SrsConfig::get_tcp_nodelay(string vhost)
+{
+    return get_vhost_config(vhost)->tcp_nodelay;
+}
+
+bool SrsConfig::get_tcp_nodelay(SrsConfDirective* vhost)
 {
     static bool DEFAULT = false;
     
-    SrsConfDirective* conf = get_vhost(vhost);
+    SrsConfDirective* conf = vhost;
     if (!conf) {
         return DEFAULT;
     }
@@ -2619,10 +2810,15 @@ bool SrsConfig::get_tcp_nodelay(string vhost)
 }
 
 double SrsConfig::get_send_min_interval(string vhost)
+{
+    return get_vhost_config(vhost)->send_min_interval;
+}
+
+double SrsConfig::get_send_min_interval(SrsConfDirective* vhost)
 {
     static double DEFAULT = 0.0;
     
-    SrsConfDirective* conf = get_vhost(vhost);
+    SrsConfDirective* conf = vhost;
     if (!conf) {
         return DEFAULT;
     }
@@ -2636,10 +2832,15 @@ double SrsConfig::get_send_min_interval(string vhost)
 }
 
 bool SrsConfig::get_reduce_sequence_header(string vhost)
+{
+    return get_vhost_config(vhost)->reduce_sequence_header;
+}
+
+bool SrsConfig::get_reduce_sequence_header(SrsConfDirective* vhost)
 {
     static bool DEFAULT = false;
     
-    SrsConfDirective* conf = get_vhost(vhost);
+    SrsConfDirective* conf = vhost;
     if (!conf) {
         return DEFAULT;
     }
@@ -2738,6 +2939,23 @@ bool SrsConfig::get_vhost_http_hooks_enabled(string vhost)
     return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
+int SrsConfig::get_vhost_http_hooks_cache_ttl(string vhost)
+{
+    static int DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("cache_ttl");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
 SrsConfDirective* SrsConfig::get_vhost_on_connect(string vhost)
 {
     SrsConfDirective* conf = get_vhost_http_hooks(vhost);
@@ -2923,8 +3141,7 @@ int SrsConfig::get_bw_check_limit_kbps(string vhost)
 
 bool SrsConfig::get_vhost_is_edge(string vhost)
 {
-    SrsConfDirective* conf = get_vhost(vhost);
-    return get_vhost_is_edge(conf);
+    return get_vhost_config(vhost)->is_edge;
 }
 
 bool SrsConfig::get_vhost_is_edge(SrsConfDirective* vhost)
@@ -3024,6 +3241,56 @@ SrsConfDirective* SrsConfig::get_security_rules(string vhost)
     return security;
 }
 
+SrsCidrTrie* SrsConfig::get_security_allow(string vhost)
+{
+    return get_vhost_config(vhost)->security_allow;
+}
+
+SrsCidrTrie* SrsConfig::get_security_deny(string vhost)
+{
+    return get_vhost_config(vhost)->security_deny;
+}
+
+void SrsConfig::compile_security(SrsConfDirective* vhost, string action, SrsCidrTrie* trie)
+{
+    SrsConfDirective* security = vhost? vhost->get("security") : NULL;
+    if (!security) {
+        return;
+    }
+    
+    for (int i = 0; i < (int)security->directives.size(); i++) {
+        SrsConfDirective* rule = security->at(i);
+        
+        if (rule->name != action) {
+            continue;
+        }
+        
+        int mask = 0;
+        if (rule->arg0() == "play") {
+            mask = SRS_SECURITY_PLAY;
+        } else if (rule->arg0() == "publish") {
+            mask = SRS_SECURITY_PUBLISH;
+        } else {
+            srs_warn("ignore security %s %s of vhost %s", action.c_str(), rule->arg0().c_str(), vhost->arg0().c_str());
+            continue;
+        }
+        
+        // load the prefixes from file, for instance, deny play file ./conf/blacklist.txt;
+        if (rule->arg1() == "file") {
+            if (trie->load(rule->arg2(), mask, NULL) != ERROR_SUCCESS) {
+                srs_warn("ignore security %s %s file %s of vhost %s",
+                    action.c_str(), rule->arg0().c_str(), rule->arg2().c_str(), vhost->arg0().c_str());
+            }
+            continue;
+        }
+        
+        if (trie->add(rule->arg1(), mask) != ERROR_SUCCESS) {
+            srs_warn("ignore security %s %s %s of vhost %s",
+                action.c_str(), rule->arg0().c_str(), rule->arg1().c_str(), vhost->arg0().c_str());
+        }
+    }
+}
+
 SrsConfDirective* SrsConfig::get_transcode(string vhost, string scope)
 {
     SrsConfDirective* conf = get_vhost(vhost);
@@ -3516,6 +3783,48 @@ string SrsConfig::get_ingest_input_url(SrsConfDirective* ingest)
     return conf->arg0();
 }
 
+int SrsConfig::get_ingest_hls_prefetch(SrsConfDirective* ingest)
+{
+    if (!ingest) {
+        return SRS_CONF_DEFAULT_INGEST_HLS_PREFETCH;
+    }
+    
+    SrsConfDirective* conf = ingest->get("input");
+    
+    if (!conf) {
+        return SRS_CONF_DEFAULT_INGEST_HLS_PREFETCH;
+    }
+
+    conf = conf->get("prefetch");
+    
+    if (!conf || conf->arg0().empty()) {
+        return SRS_CONF_DEFAULT_INGEST_HLS_PREFETCH;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+int SrsConfig::get_ingest_hls_jitter(SrsConfDirective* ingest)
+{
+    if (!ingest) {
+        return SRS_CONF_DEFAULT_INGEST_HLS_JITTER;
+    }
+    
+    SrsConfDirective* conf = ingest->get("input");
+    
+    if (!conf) {
+        return SRS_CONF_DEFAULT_INGEST_HLS_JITTER;
+    }
+
+    conf = conf->get("jitter");
+    
+    if (!conf || conf->arg0().empty()) {
+        return SRS_CONF_DEFAULT_INGEST_HLS_JITTER;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
 bool SrsConfig::get_log_tank_file()
 {
     srs_assert(root);
@@ -3583,7 +3892,12 @@ SrsConfDirective* SrsConfig::get_hls(string vhost)
 
 bool SrsConfig::get_hls_enabled(string vhost)
 {
-    SrsConfDirective* hls = get_hls(vhost);
+    return get_vhost_config(vhost)->hls_enabled;
+}
+
+bool SrsConfig::get_hls_enabled(SrsConfDirective* vhost)
+{
+    SrsConfDirective* hls = vhost? vhost->get("hls") : NULL;
     
     if (!hls) {
         return false;
@@ -3753,7 +4067,12 @@ double SrsConfig::get_hls_window(string vhost)
 
 string SrsConfig::get_hls_on_error(string vhost)
 {
-    SrsConfDirective* hls = get_hls(vhost);
+    return get_vhost_config(vhost)->hls_on_error;
+}
+
+string SrsConfig::get_hls_on_error(SrsConfDirective* vhost)
+{
+    SrsConfDirective* hls = vhost? vhost->get("hls") : NULL;
     
     if (!hls) {
         return SRS_CONF_DEFAULT_HLS_ON_ERROR;
@@ -4373,6 +4692,52 @@ bool SrsConfig::get_vhost_http_remux_hstrs(string vhost)
     return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
+int SrsConfig::get_vhost_http_remux_mw_sleep_ms(string vhost)
+{
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return SRS_PERF_MW_SLEEP;
+    }
+    
+    conf = conf->get("http_remux");
+    if (!conf) {
+        return get_mw_sleep_ms(vhost);
+    }
+    
+    conf = conf->get("mw_latency");
+    if (!conf || conf->arg0().empty()) {
+        return get_mw_sleep_ms(vhost);
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+int SrsConfig::get_vhost_http_remux_mw_msgs(string vhost, bool is_realtime)
+{
+#ifdef SRS_PERF_QUEUE_COND_WAIT
+    int DEFAULT = is_realtime? 0 : SRS_PERF_MW_MIN_MSGS;
+#else
+    int DEFAULT = 0;
+#endif
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("http_remux");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("mw_msgs");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
 SrsConfDirective* SrsConfig::get_heartbeart()
 {
     return root->get("heartbeat");
@@ -4607,6 +4972,11 @@ bool srs_config_ingest_is_stream(string type)
     return type == SRS_CONF_DEFAULT_INGEST_TYPE_STREAM;
 }
 
+bool srs_config_ingest_is_hls(string type)
+{
+    return type == SRS_CONF_DEFAULT_INGEST_TYPE_HLS;
+}
+
 bool srs_config_dvr_is_plan_segment(string plan)
 {
     return plan == SRS_CONF_DEFAULT_DVR_PLAN_SEGMENT;
@@ -31,14 +31,25 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include <vector>
 #include <string>
+#include <map>
+#include <list>
 
 #include <srs_app_reload.hpp>
 
+class SrsCidrTrie;
+
 namespace _srs_internal
 {
     class SrsConfigBuffer;
 }
 
+/**
+* the type mask of security rules compiled in cidr trie.
+* @see SrsVhostConfig::security_allow
+*/
+#define SRS_SECURITY_PLAY 0x01
+#define SRS_SECURITY_PUBLISH 0x02
+
 /**
 * the config directive.
 * the config file is a group of directives,
@@ -168,6 +179,43 @@ private:
     virtual int read_token(_srs_internal::SrsConfigBuffer* buffer, std::vector<std::string>& args, int& line_start);
 };
 
+/**
+* the compiled settings of vhost, parsed from the vhost directive,
+* for the getters used in the hot path, for instance, for each packet,
+* to read the field directly, without search the directives.
+* @remark it's immutable, rebuilt when config parsed or reloaded.
+*/
+class SrsVhostConfig
+{
+public:
+    // the vhost directive, NULL for the default settings.
+    SrsConfDirective* conf;
+    bool enabled;
+    bool is_edge;
+    bool gop_cache;
+    double queue_length;
+    bool atc;
+    bool atc_auto;
+    int time_jitter;
+    bool mix_correct;
+    bool parse_sps;
+    bool reduce_sequence_header;
+    bool mr_enabled;
+    int mr_sleep_ms;
+    int mw_sleep_ms;
+    bool realtime;
+    bool tcp_nodelay;
+    double send_min_interval;
+    bool hls_enabled;
+    std::string hls_on_error;
+    // the allow and deny rules of security, the mask is SRS_SECURITY_*.
+    SrsCidrTrie* security_allow;
+    SrsCidrTrie* security_deny;
+public:
+    SrsVhostConfig();
+    virtual ~SrsVhostConfig();
+};
+
 /**
 * the config service provider.
 * for the config supports reload, so never keep the reference cross st-thread,
@@ -220,12 +268,23 @@ private:
     * the directive root.
     */
     SrsConfDirective* root;
+    /**
+    * the compiled vhosts, index by vhost name.
+    * @remark, the default_vhost is the settings when vhost not found.
+    */
+    std::map<std::string, SrsVhostConfig*> vhost_configs;
+    SrsVhostConfig* default_vhost;
 // reload section
 private:
     /**
-    * the reload subscribers, when reload, callback all handlers.
+    * the reload subscribers, when reload, callback all handlers in order.
     */
-    std::vector<ISrsReloadHandler*> subscribes;
+    std::list<ISrsReloadHandler*> subscribes;
+    /**
+    * the position of subscriber in list, for each connection subscribes
+    * and unsubscribes, which should never scan all subscribers.
+    */
+    std::map<ISrsReloadHandler*, std::list<ISrsReloadHandler*>::iterator> subscribe_handles;
 public:
     SrsConfig();
     virtual ~SrsConfig();
@@ -349,6 +408,18 @@ public:
     *       of SRS.
     */
     virtual int                 get_max_connections();
+    /**
+     * get the number of worker processes, each worker runs a st loop
+     * and accepts the rtmp clients on the shared listen ports.
+     * @remark 0 or 1 to run in single process.
+     * @remark, donot support reload.
+     */
+    virtual int                 get_workers();
+    /**
+     * get the base port for workers to relay streams to each other,
+     * the worker N listens at 127.0.0.1:(base+N).
+     */
+    virtual int                 get_worker_relay_port();
     /**
      * get the external shell to run befor every connect.
      */
@@ -408,6 +479,12 @@ public:
     * get the max udp port for rtp of stream caster rtsp.
     */
     virtual int                 get_stream_caster_rtp_port_max(SrsConfDirective* sc);
+    /**
+    * get the recv buffer(SO_RCVBUF) in bytes of udp socket of stream caster,
+    * for the mpegts_over_udp and the rtp of rtsp.
+    * @return the size in bytes, 0 to use the system default.
+    */
+    virtual int                 get_stream_caster_recv_buffer(SrsConfDirective* sc);
 // vhost specified section
 public:
     /**
@@ -415,6 +492,38 @@ public:
     * @param vhost, the name of vhost to get.
     */
     virtual SrsConfDirective*   get_vhost(std::string vhost);
+    /**
+    * get the compiled settings of vhost, use the default vhost when not found.
+    * @remark never NULL, use default settings when default vhost not found.
+    */
+    virtual SrsVhostConfig*     get_vhost_config(std::string vhost);
+protected:
+    /**
+    * build the index and settings of all vhosts from directives.
+    */
+    virtual void compile();
+    virtual SrsVhostConfig* compile_vhost(SrsConfDirective* vhost);
+    /**
+    * the settings parsed from vhost directive, NULL for default.
+    * @see get_vhost_config(), the getters by vhost name read the compiled settings.
+    */
+    virtual bool                get_gop_cache(SrsConfDirective* vhost);
+    virtual bool                get_atc(SrsConfDirective* vhost);
+    virtual bool                get_atc_auto(SrsConfDirective* vhost);
+    virtual int                 get_time_jitter(SrsConfDirective* vhost);
+    virtual bool                get_mix_correct(SrsConfDirective* vhost);
+    virtual double              get_queue_length(SrsConfDirective* vhost);
+    virtual bool                get_parse_sps(SrsConfDirective* vhost);
+    virtual bool                get_mr_enabled(SrsConfDirective* vhost);
+    virtual int                 get_mr_sleep_ms(SrsConfDirective* vhost);
+    virtual int                 get_mw_sleep_ms(SrsConfDirective* vhost);
+    virtual bool                get_realtime_enabled(SrsConfDirective* vhost);
+    virtual bool                get_tcp_nodelay(SrsConfDirective* vhost);
+    virtual double              get_send_min_interval(SrsConfDirective* vhost);
+    virtual bool                get_reduce_sequence_header(SrsConfDirective* vhost);
+    virtual bool                get_hls_enabled(SrsConfDirective* vhost);
+    virtual std::string         get_hls_on_error(SrsConfDirective* vhost);
+public:
     /**
     * get all vhosts in config file.
     */
@@ -574,6 +683,11 @@ public:
     */
     virtual bool                get_vhost_http_hooks_enabled(std::string vhost);
     /**
+    * get the seconds to cache the decision of on_connect and on_play.
+    * @remark, 0 to disable the cache.
+    */
+    virtual int                 get_vhost_http_hooks_cache_ttl(std::string vhost);
+    /**
     * get the on_connect callbacks of vhost.
     * @return the on_connect callback directive, the args is the url to callback.
     */
@@ -684,6 +798,18 @@ public:
     * get the security rules.
     */
     virtual SrsConfDirective*   get_security_rules(std::string vhost);
+    /**
+    * get the compiled allow or deny rules of security,
+    * the mask of prefix is SRS_SECURITY_PLAY or SRS_SECURITY_PUBLISH.
+    */
+    virtual SrsCidrTrie*        get_security_allow(std::string vhost);
+    virtual SrsCidrTrie*        get_security_deny(std::string vhost);
+private:
+    /**
+    * compile the allow or deny rules of security to trie,
+    * the rule is ip, cidr, all or the file of prefixes.
+    */
+    virtual void                compile_security(SrsConfDirective* vhost, std::string action, SrsCidrTrie* trie);
 // vhost transcode section
 public:
     /**
@@ -820,13 +946,21 @@ public:
     */
     virtual std::string         get_ingest_ffmpeg(SrsConfDirective* ingest);
     /**
-    * get the ingest input type, file or stream.
+    * get the ingest input type, file, stream or hls.
     */
     virtual std::string         get_ingest_input_type(SrsConfDirective* ingest);
     /**
     * get the ingest input url.
     */
     virtual std::string         get_ingest_input_url(SrsConfDirective* ingest);
+    /**
+    * get the max segments to fetch concurrently for hls ingest.
+    */
+    virtual int                 get_ingest_hls_prefetch(SrsConfDirective* ingest);
+    /**
+    * get the max segments in jitter buffer for hls ingest.
+    */
+    virtual int                 get_ingest_hls_jitter(SrsConfDirective* ingest);
 // log section
 public:
     /**
@@ -1075,6 +1209,16 @@ public:
     * get whether the hstrs(http stream trigger rtmp source) enabled.
     */
     virtual bool                get_vhost_http_remux_hstrs(std::string vhost);
+    /**
+    * get the mw(merged-write) sleep time in ms for http live stream,
+    * the vhost mw_latency is used when not specified.
+    */
+    virtual int                 get_vhost_http_remux_mw_sleep_ms(std::string vhost);
+    /**
+    * get the min msgs to wait for http live stream to merged-write.
+    * @param is_realtime whether the vhost is realtime(min_latency), wait 0 msgs for it.
+    */
+    virtual int                 get_vhost_http_remux_mw_msgs(std::string vhost, bool is_realtime);
 // http heartbeart section
 private:
     /**
@@ -1169,6 +1313,7 @@ extern bool srs_config_hls_is_on_error_ignore(std::string strategy);
 extern bool srs_config_hls_is_on_error_continue(std::string strategy);
 extern bool srs_config_ingest_is_file(std::string type);
 extern bool srs_config_ingest_is_stream(std::string type);
+extern bool srs_config_ingest_is_hls(std::string type);
 extern bool srs_config_dvr_is_plan_segment(std::string plan);
 extern bool srs_config_dvr_is_plan_session(std::string plan);
 extern bool srs_config_dvr_is_plan_append(std::string plan);
@@ -38,6 +38,7 @@ IConnectionManager::~IConnectionManager()
 SrsConnection::SrsConnection(IConnectionManager* cm, st_netfd_t c)
 {
     id = 0;
+    handle = -1;
     manager = cm;
     stfd = c;
     disposed = false;
@@ -117,9 +118,24 @@ int SrsConnection::srs_id()
     return id;
 }
 
+int SrsConnection::manager_handle()
+{
+    return handle;
+}
+
+void SrsConnection::set_manager_handle(int v)
+{
+    handle = v;
+}
+
 void SrsConnection::expire()
 {
     expired = true;
 }
 
+int SrsConnection::get_recv_buffer_size()
+{
+    return 0;
+}
+
 
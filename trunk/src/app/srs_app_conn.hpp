@@ -70,6 +70,11 @@ private:
     * the id of connection.
     */
     int id;
+    /**
+    * the handle of connection in manager, that is, the index in the connections,
+    * for manager to remove the connection in O(1). -1 when not managed.
+    */
+    int handle;
 protected:
     /**
     * the manager object to manage the connection.
@@ -134,6 +139,16 @@ public:
      * set connection to expired.
      */
     virtual void expire();
+    /**
+    * get or set the handle in manager.
+    */
+    virtual int manager_handle();
+    virtual void set_manager_handle(int v);
+    /**
+     * get the size of recv buffer, for statistic.
+     * @remark 0 for the connection without recv buffer.
+     */
+    virtual int get_recv_buffer_size();
 protected:
     /**
     * for concrete connection to do the cycle.
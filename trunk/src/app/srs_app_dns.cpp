@@ -0,0 +1,725 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <srs_app_dns.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <algorithm>
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_stream.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_core_autofree.hpp>
+
+// the dns message, @see https://tools.ietf.org/html/rfc1035#section-4.1
+#define SRS_DNS_PORT 53
+#define SRS_DNS_HEADER_SIZE 12
+#define SRS_DNS_FLAG_RESPONSE 0x8000
+#define SRS_DNS_FLAG_TRUNCATED 0x0200
+#define SRS_DNS_FLAG_RECURSION 0x0100
+#define SRS_DNS_RCODE_NXDOMAIN 3
+#define SRS_DNS_TYPE_A 1
+#define SRS_DNS_TYPE_CNAME 5
+#define SRS_DNS_CLASS_IN 1
+// the max size of name, and the max pointers to follow in a name.
+#define SRS_DNS_MAX_NAME 255
+#define SRS_DNS_MAX_POINTERS 16
+// the ids to read from /dev/urandom in a time.
+#define SRS_DNS_RANDOM_IDS 256
+
+SrsDnsResolver* _srs_dns = new SrsDnsResolver();
+
+SrsDnsEntry::SrsDnsEntry()
+{
+    expire = 0;
+}
+
+SrsDnsEntry::~SrsDnsEntry()
+{
+}
+
+SrsDnsQuery::SrsDnsQuery()
+{
+    done = st_cond_new();
+    nb_refs = 1;
+}
+
+SrsDnsQuery::~SrsDnsQuery()
+{
+    st_cond_destroy(done);
+}
+
+/**
+* read the name of question or answer, follow the compression pointers,
+* @see https://tools.ietf.org/html/rfc1035#section-4.1.4
+* @param stream the whole message, the pointer is the offset to it.
+*/
+int srs_dns_read_name(SrsStream* stream, string& name)
+{
+    int ret = ERROR_SUCCESS;
+    
+    char* msg = stream->data();
+    int size = stream->size();
+    int pos = stream->pos();
+    
+    // the position after name, which ends at the first pointer.
+    int end = -1;
+    int nb_pointers = 0;
+    
+    name = "";
+    while (true) {
+        if (pos >= size) {
+            ret = ERROR_SYSTEM_DNS_RESOLVE;
+            srs_error("dns decode name failed. ret=%d", ret);
+            return ret;
+        }
+        
+        u_int8_t len = (u_int8_t)msg[pos++];
+        if (len == 0) {
+            break;
+        }
+        
+        // the pointer to name, 2bytes, must point to the prior name.
+        if ((len & 0xc0) == 0xc0) {
+            if (pos >= size) {
+                ret = ERROR_SYSTEM_DNS_RESOLVE;
+                srs_error("dns decode name pointer failed. ret=%d", ret);
+                return ret;
+            }
+            
+            int offset = ((len & 0x3f) << 8) | (u_int8_t)msg[pos];
+            if (offset >= pos - 1 || ++nb_pointers > SRS_DNS_MAX_POINTERS) {
+                ret = ERROR_SYSTEM_DNS_RESOLVE;
+                srs_error("dns invalid name pointer %d at %d. ret=%d", offset, pos - 1, ret);
+                return ret;
+            }
+            
+            if (end < 0) {
+                end = pos + 1;
+            }
+            pos = offset;
+            continue;
+        }
+        
+        // the 0x40 and 0x80 are reserved.
+        if ((len & 0xc0) != 0 || pos + len > size) {
+            ret = ERROR_SYSTEM_DNS_RESOLVE;
+            srs_error("dns decode name label failed, len=%d. ret=%d", len, ret);
+            return ret;
+        }
+        
+        if (!name.empty()) {
+            name.append(".");
+        }
+        name.append(msg + pos, len);
+        pos += len;
+        
+        if ((int)name.length() > SRS_DNS_MAX_NAME) {
+            ret = ERROR_SYSTEM_DNS_RESOLVE;
+            srs_error("dns decode name overflow. ret=%d", ret);
+            return ret;
+        }
+    }
+    
+    if (end < 0) {
+        end = pos;
+    }
+    stream->skip(end - stream->pos());
+    
+    return ret;
+}
+
+u_int16_t srs_dns_random_id()
+{
+    // open /dev/urandom once and read the ids in batch,
+    // refill for the forked worker, which must not reuse the ids of parent.
+    static int fd = -1;
+    static pid_t pid = 0;
+    static u_int16_t ids[SRS_DNS_RANDOM_IDS];
+    static int nb_ids = 0;
+    
+    if (pid != getpid()) {
+        pid = getpid();
+        nb_ids = 0;
+        
+        if (fd < 0 && (fd = ::open("/dev/urandom", O_RDONLY)) >= 0) {
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+        
+        // fallback to the random of libc, seed by time and pid.
+        srandom((unsigned int)(srs_get_system_time_ms() ^ pid));
+    }
+    
+    if (nb_ids <= 0 && fd >= 0) {
+        ssize_t nb_read = ::read(fd, ids, sizeof(ids));
+        if (nb_read > 0) {
+            nb_ids = (int)(nb_read / sizeof(u_int16_t));
+        }
+    }
+    
+    if (nb_ids > 0) {
+        return ids[--nb_ids];
+    }
+    return (u_int16_t)random();
+}
+
+int srs_dns_encode_query(u_int16_t id, string host, char* buf, int size, int* pnb_query)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsStream stream;
+    if ((ret = stream.initialize(buf, size)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // the header, with only one question.
+    if (!stream.require(SRS_DNS_HEADER_SIZE)) {
+        ret = ERROR_SYSTEM_DNS_RESOLVE;
+        srs_error("dns encode query header failed. ret=%d", ret);
+        return ret;
+    }
+    stream.write_2bytes(id);
+    stream.write_2bytes(SRS_DNS_FLAG_RECURSION);
+    stream.write_2bytes(1);
+    stream.write_2bytes(0);
+    stream.write_2bytes(0);
+    stream.write_2bytes(0);
+    
+    // the labels of host, for example, 3www6ossrs3net0
+    size_t start = 0;
+    while (start < host.length()) {
+        size_t end = host.find(".", start);
+        if (end == std::string::npos) {
+            end = host.length();
+        }
+        
+        std::string label = host.substr(start, end - start);
+        start = end + 1;
+        
+        if (label.empty() || label.length() > 63 || !stream.require((int)label.length() + 1 + 5)) {
+            ret = ERROR_SYSTEM_DNS_RESOLVE;
+            srs_error("dns invalid host %s. ret=%d", host.c_str(), ret);
+            return ret;
+        }
+        stream.write_1bytes((int8_t)label.length());
+        stream.write_string(label);
+    }
+    
+    if (host.empty() || !stream.require(5)) {
+        ret = ERROR_SYSTEM_DNS_RESOLVE;
+        srs_error("dns invalid host %s. ret=%d", host.c_str(), ret);
+        return ret;
+    }
+    stream.write_1bytes(0);
+    stream.write_2bytes(SRS_DNS_TYPE_A);
+    stream.write_2bytes(SRS_DNS_CLASS_IN);
+    
+    *pnb_query = stream.pos();
+    
+    return ret;
+}
+
+int srs_dns_decode_response(u_int16_t id, string host, char* buf, int size, string& pip, int& pttl)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsStream stream;
+    if ((ret = stream.initialize(buf, size)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if (!stream.require(SRS_DNS_HEADER_SIZE)) {
+        ret = ERROR_SYSTEM_DNS_MISMATCH;
+        srs_warn("dns ignore response of %s, size=%d. ret=%d", host.c_str(), size, ret);
+        return ret;
+    }
+    
+    u_int16_t rid = (u_int16_t)stream.read_2bytes();
+    u_int16_t flags = (u_int16_t)stream.read_2bytes();
+    int nb_questions = (u_int16_t)stream.read_2bytes();
+    int nb_answers = (u_int16_t)stream.read_2bytes();
+    stream.skip(4);
+    
+    // the response must echo the id and the only question,
+    // the name is case-insensitive.
+    if (rid != id || (flags & SRS_DNS_FLAG_RESPONSE) == 0 || nb_questions != 1) {
+        ret = ERROR_SYSTEM_DNS_MISMATCH;
+        srs_warn("dns ignore response of %s, id=%d/%d, flags=%#x, questions=%d. ret=%d",
+            host.c_str(), rid, id, flags, nb_questions, ret);
+        return ret;
+    }
+    
+    std::string name;
+    if ((ret = srs_dns_read_name(&stream, name)) != ERROR_SUCCESS || !stream.require(4)) {
+        ret = ERROR_SYSTEM_DNS_MISMATCH;
+        srs_warn("dns ignore response of %s, invalid question. ret=%d", host.c_str(), ret);
+        return ret;
+    }
+    
+    int qtype = (u_int16_t)stream.read_2bytes();
+    int qclass = (u_int16_t)stream.read_2bytes();
+    if (strcasecmp(name.c_str(), host.c_str()) != 0 || qtype != SRS_DNS_TYPE_A || qclass != SRS_DNS_CLASS_IN) {
+        ret = ERROR_SYSTEM_DNS_MISMATCH;
+        srs_warn("dns ignore response of %s, question mismatch, name=%s, type=%d, class=%d. ret=%d",
+            host.c_str(), name.c_str(), qtype, qclass, ret);
+        return ret;
+    }
+    
+    if ((flags & 0x0f) != 0) {
+        ret = ERROR_SYSTEM_DNS_RESOLVE;
+        srs_error("dns response of %s error, flags=%#x, nxdomain=%d. ret=%d",
+            host.c_str(), flags, (flags & 0x0f) == SRS_DNS_RCODE_NXDOMAIN, ret);
+        return ret;
+    }
+    
+    // the truncated response maybe lost some answers, use the complete ones,
+    // for we never retry over tcp.
+    bool truncated = (flags & SRS_DNS_FLAG_TRUNCATED) != 0;
+    
+    // follow the CNAME chain of host to the A record.
+    std::string target = host;
+    int ttl = SRS_DNS_MAX_TTL;
+    for (int i = 0; i < nb_answers; i++) {
+        if ((ret = srs_dns_read_name(&stream, name)) != ERROR_SUCCESS) {
+            break;
+        }
+        if (!stream.require(10)) {
+            ret = ERROR_SYSTEM_DNS_RESOLVE;
+            break;
+        }
+        
+        int type = (u_int16_t)stream.read_2bytes();
+        int klass = (u_int16_t)stream.read_2bytes();
+        int rttl = stream.read_4bytes();
+        int nb_data = (u_int16_t)stream.read_2bytes();
+        if (!stream.require(nb_data)) {
+            ret = ERROR_SYSTEM_DNS_RESOLVE;
+            break;
+        }
+        int data_end = stream.pos() + nb_data;
+        
+        // ignore the records of other names and classes.
+        if (klass != SRS_DNS_CLASS_IN || strcasecmp(name.c_str(), target.c_str()) != 0) {
+            stream.skip(nb_data);
+            continue;
+        }
+        
+        if (type == SRS_DNS_TYPE_CNAME) {
+            if ((ret = srs_dns_read_name(&stream, target)) != ERROR_SUCCESS) {
+                break;
+            }
+            stream.skip(data_end - stream.pos());
+            ttl = srs_min(ttl, rttl);
+            continue;
+        }
+        
+        if (type != SRS_DNS_TYPE_A || nb_data != 4) {
+            stream.skip(nb_data);
+            continue;
+        }
+        
+        char ipv4[16];
+        memset(ipv4, 0, sizeof(ipv4));
+        inet_ntop(AF_INET, stream.data() + stream.pos(), ipv4, sizeof(ipv4));
+        
+        pip = ipv4;
+        pttl = srs_max(SRS_DNS_MIN_TTL, srs_min(ttl, rttl));
+        return ERROR_SUCCESS;
+    }
+    
+    ret = ERROR_SYSTEM_DNS_RESOLVE;
+    srs_error("dns no A record of %s, target=%s, answers=%d, truncated=%d. ret=%d",
+        host.c_str(), target.c_str(), nb_answers, truncated, ret);
+    
+    return ret;
+}
+
+SrsDnsResolver::SrsDnsResolver()
+{
+    hosts_mtime = 0;
+    hosts_checked = 0;
+    servers_loaded = false;
+    ndots = SRS_DNS_DEFAULT_NDOTS;
+}
+
+SrsDnsResolver::~SrsDnsResolver()
+{
+    std::map<std::string, SrsDnsEntry*>::iterator it;
+    for (it = cache.begin(); it != cache.end(); ++it) {
+        SrsDnsEntry* entry = it->second;
+        srs_freep(entry);
+    }
+    cache.clear();
+    
+    // the queries are freed by its coroutines.
+}
+
+int SrsDnsResolver::resolve(string host, string& pip, int64_t timeout)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (inet_addr(host.c_str()) != INADDR_NONE) {
+        pip = host;
+        return ret;
+    }
+    
+    if (timeout == (int64_t)ST_UTIME_NO_TIMEOUT) {
+        timeout = SRS_DNS_QUERY_TIMEOUT_US;
+    }
+    
+    // the hosts file, before the cache for the changed hosts to take effect.
+    load_hosts();
+    std::map<std::string, std::string>::iterator it_host = hosts.find(host);
+    if (it_host != hosts.end()) {
+        pip = it_host->second;
+        return ret;
+    }
+    
+    // the cached positive or negative entry.
+    std::map<std::string, SrsDnsEntry*>::iterator it = cache.find(host);
+    if (it != cache.end() && it->second->expire > srs_get_system_time_ms()) {
+        pip = it->second->ip;
+        if (pip.empty()) {
+            ret = ERROR_SYSTEM_DNS_RESOLVE;
+            srs_info("dns resolve %s failed for negative cache. ret=%d", host.c_str(), ret);
+        }
+        return ret;
+    }
+    
+    // wait for the query of same host in progress.
+    std::map<std::string, SrsDnsQuery*>::iterator it_query = queries.find(host);
+    if (it_query != queries.end()) {
+        SrsDnsQuery* q = it_query->second;
+        
+        q->nb_refs++;
+        int r0 = st_cond_wait(q->done);
+        if (--q->nb_refs == 0) {
+            srs_freep(q);
+        }
+        
+        if (r0 != 0) {
+            ret = ERROR_SYSTEM_DNS_RESOLVE;
+            srs_error("dns wait for query %s failed. ret=%d", host.c_str(), ret);
+            return ret;
+        }
+        
+        if ((it = cache.find(host)) == cache.end() || it->second->ip.empty()) {
+            ret = ERROR_SYSTEM_DNS_RESOLVE;
+            srs_error("dns resolve %s failed by other query. ret=%d", host.c_str(), ret);
+            return ret;
+        }
+        
+        pip = it->second->ip;
+        return ret;
+    }
+    
+    SrsDnsQuery* q = new SrsDnsQuery();
+    queries[host] = q;
+    
+    int ttl = SRS_DNS_NEGATIVE_TTL;
+    std::string ip;
+    if ((ret = query(host, timeout, ip, ttl)) != ERROR_SUCCESS) {
+        ip = "";
+        ttl = SRS_DNS_NEGATIVE_TTL;
+    }
+    update_cache(host, ip, ttl);
+    srs_trace("dns resolve %s to %s, ttl=%ds, waiters=%d, ret=%d", host.c_str(), ip.c_str(), ttl, q->nb_refs - 1, ret);
+    
+    // notify the waiters, which read the cache.
+    queries.erase(host);
+    st_cond_broadcast(q->done);
+    if (--q->nb_refs == 0) {
+        srs_freep(q);
+    }
+    
+    pip = ip;
+    return ret;
+}
+
+void SrsDnsResolver::load_hosts()
+{
+    int64_t now = srs_get_system_time_ms();
+    if (hosts_checked > 0 && now - hosts_checked < SRS_DNS_HOSTS_CHECK_MS) {
+        return;
+    }
+    hosts_checked = now;
+    
+    struct stat st;
+    if (stat("/etc/hosts", &st) != 0) {
+        hosts.clear();
+        return;
+    }
+    if ((int64_t)st.st_mtime == hosts_mtime) {
+        return;
+    }
+    hosts_mtime = (int64_t)st.st_mtime;
+    
+    FILE* f = fopen("/etc/hosts", "r");
+    if (f == NULL) {
+        srs_warn("open hosts file failed, ignore.");
+        return;
+    }
+    
+    hosts.clear();
+    
+    static char buf[1024];
+    while (fgets(buf, sizeof(buf), f)) {
+        // ignore the comments.
+        char* p = strchr(buf, '#');
+        if (p) {
+            *p = 0;
+        }
+        
+        // ip host [alias...]
+        char* saveptr = NULL;
+        char* ip = strtok_r(buf, " \t\r\n", &saveptr);
+        if (!ip || inet_addr(ip) == INADDR_NONE) {
+            continue;
+        }
+        
+        char* name = NULL;
+        while ((name = strtok_r(NULL, " \t\r\n", &saveptr)) != NULL) {
+            // use the first ip of host.
+            if (hosts.find(name) == hosts.end()) {
+                hosts[name] = ip;
+            }
+        }
+    }
+    
+    fclose(f);
+    srs_trace("dns load %d hosts from hosts file.", (int)hosts.size());
+}
+
+void SrsDnsResolver::load_servers()
+{
+    if (servers_loaded) {
+        return;
+    }
+    servers_loaded = true;
+    
+    FILE* f = fopen("/etc/resolv.conf", "r");
+    if (f) {
+        static char buf[1024];
+        while (fgets(buf, sizeof(buf), f)) {
+            char* saveptr = NULL;
+            char* name = strtok_r(buf, " \t\r\n", &saveptr);
+            if (!name) {
+                continue;
+            }
+            
+            // only support ipv4 name server.
+            if (strcmp(name, "nameserver") == 0) {
+                char* ip = strtok_r(NULL, " \t\r\n", &saveptr);
+                if (ip && inet_addr(ip) != INADDR_NONE) {
+                    servers.push_back(ip);
+                }
+                continue;
+            }
+            
+            // the domain and search are mutually exclusive, the last one wins.
+            if (strcmp(name, "domain") == 0 || strcmp(name, "search") == 0) {
+                searches.clear();
+                char* domain = NULL;
+                while ((domain = strtok_r(NULL, " \t\r\n", &saveptr)) != NULL) {
+                    std::string v = domain;
+                    if (!v.empty() && v.at(v.length() - 1) == '.') {
+                        v = v.substr(0, v.length() - 1);
+                    }
+                    if (!v.empty()) {
+                        searches.push_back(v);
+                    }
+                }
+                continue;
+            }
+            
+            // options ndots:n
+            if (strcmp(name, "options") == 0) {
+                char* opt = NULL;
+                while ((opt = strtok_r(NULL, " \t\r\n", &saveptr)) != NULL) {
+                    if (strncmp(opt, "ndots:", 6) == 0) {
+                        ndots = srs_max(0, srs_min(15, ::atoi(opt + 6)));
+                    }
+                }
+            }
+        }
+        fclose(f);
+    }
+    
+    // use the local name server when not configed, like the libc.
+    if (servers.empty()) {
+        servers.push_back("127.0.0.1");
+    }
+    
+    srs_trace("dns load %d name servers, first is %s, searches=%d, ndots=%d",
+        (int)servers.size(), servers.at(0).c_str(), (int)searches.size(), ndots);
+}
+
+int SrsDnsResolver::query(string host, int64_t timeout, string& pip, int& pttl)
+{
+    int ret = ERROR_SUCCESS;
+    
+    load_servers();
+    
+    std::vector<std::string> names = search_names(host);
+    for (int i = 0; i < (int)names.size(); i++) {
+        std::string name = names.at(i);
+        
+        for (int j = 0; j < (int)servers.size(); j++) {
+            std::string server = servers.at(j);
+            if ((ret = query_server(server, name, timeout, pip, pttl)) == ERROR_SUCCESS) {
+                return ret;
+            }
+            srs_warn("dns query %s from %s failed. ret=%d", name.c_str(), server.c_str(), ret);
+        }
+    }
+    
+    return ret;
+}
+
+vector<string> SrsDnsResolver::search_names(string host)
+{
+    std::vector<std::string> names;
+    
+    // the absolute host, never apply the search list.
+    if (!host.empty() && host.at(host.length() - 1) == '.') {
+        names.push_back(host.substr(0, host.length() - 1));
+        return names;
+    }
+    
+    // try the host as is first when it has enough dots.
+    int nb_dots = (int)std::count(host.begin(), host.end(), '.');
+    if (nb_dots >= ndots) {
+        names.push_back(host);
+    }
+    
+    for (int i = 0; i < (int)searches.size(); i++) {
+        names.push_back(host + "." + searches.at(i));
+    }
+    
+    if (nb_dots < ndots) {
+        names.push_back(host);
+    }
+    
+    return names;
+}
+
+int SrsDnsResolver::query_server(string server, string host, int64_t timeout, string& pip, int& pttl)
+{
+    int ret = ERROR_SUCCESS;
+    
+    char req[SRS_DNS_MAX_MESSAGE];
+    char buf[SRS_DNS_MAX_MESSAGE];
+    
+    u_int16_t id = srs_dns_random_id();
+    int nb_query = 0;
+    if ((ret = srs_dns_encode_query(id, host, req, sizeof(req), &nb_query)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // send the query over udp.
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd == -1) {
+        ret = ERROR_SOCKET_CREATE;
+        srs_error("dns create socket failed. ret=%d", ret);
+        return ret;
+    }
+    
+    st_netfd_t stfd = st_netfd_open_socket(fd);
+    if (stfd == NULL) {
+        ::close(fd);
+        ret = ERROR_ST_OPEN_SOCKET;
+        srs_error("dns open socket failed. ret=%d", ret);
+        return ret;
+    }
+    
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(SRS_DNS_PORT);
+    addr.sin_addr.s_addr = inet_addr(server.c_str());
+    
+    if (st_sendto(stfd, req, nb_query, (sockaddr*)&addr, sizeof(sockaddr_in), timeout) != nb_query) {
+        srs_close_stfd(stfd);
+        ret = ERROR_SOCKET_WRITE;
+        srs_error("dns send query to %s failed. ret=%d", server.c_str(), ret);
+        return ret;
+    }
+    
+    // recv the response of query, ignore the others.
+    int64_t starttime = srs_update_system_time_ms();
+    while (true) {
+        int64_t left = timeout - (srs_update_system_time_ms() - starttime) * 1000;
+        if (left <= 0) {
+            ret = ERROR_SOCKET_TIMEOUT;
+            break;
+        }
+        
+        sockaddr_in from;
+        int nb_from = sizeof(sockaddr_in);
+        int nb_recv = 0;
+        if ((nb_recv = st_recvfrom(stfd, buf, sizeof(buf), (sockaddr*)&from, &nb_from, left)) <= 0) {
+            ret = (errno == ETIME)? ERROR_SOCKET_TIMEOUT : ERROR_SOCKET_READ;
+            break;
+        }
+        
+        if (from.sin_addr.s_addr != addr.sin_addr.s_addr || from.sin_port != addr.sin_port) {
+            continue;
+        }
+        
+        if ((ret = srs_dns_decode_response(id, host, buf, nb_recv, pip, pttl)) != ERROR_SYSTEM_DNS_MISMATCH) {
+            break;
+        }
+    }
+    srs_close_stfd(stfd);
+    
+    return ret;
+}
+
+void SrsDnsResolver::update_cache(string host, string ip, int ttl)
+{
+    SrsDnsEntry* entry = NULL;
+    
+    std::map<std::string, SrsDnsEntry*>::iterator it = cache.find(host);
+    if (it != cache.end()) {
+        entry = it->second;
+    } else {
+        entry = cache[host] = new SrsDnsEntry();
+    }
+    
+    entry->ip = ip;
+    entry->expire = srs_get_system_time_ms() + ttl * 1000;
+}
+
@@ -0,0 +1,169 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef SRS_APP_DNS_HPP
+#define SRS_APP_DNS_HPP
+
+/*
+#include <srs_app_dns.hpp>
+*/
+#include <srs_core.hpp>
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <srs_app_st.hpp>
+
+// the timeout in us to query each name server.
+#define SRS_DNS_QUERY_TIMEOUT_US (int64_t)(3*1000*1000LL)
+// the ttl in seconds range to cache the resolved ip.
+#define SRS_DNS_MIN_TTL 10
+#define SRS_DNS_MAX_TTL 3600
+// the ttl in seconds to cache the failed host.
+#define SRS_DNS_NEGATIVE_TTL 10
+// the interval in ms to check whether the hosts file changed.
+#define SRS_DNS_HOSTS_CHECK_MS 3000
+// the default ndots of resolv.conf, the host with less dots
+// is tried with the search list first.
+#define SRS_DNS_DEFAULT_NDOTS 1
+// the max size of dns message over udp.
+#define SRS_DNS_MAX_MESSAGE 512
+
+/**
+* the resolved ip of host, cache it before expired.
+*/
+class SrsDnsEntry
+{
+public:
+    // the ipv4, empty when resolve failed.
+    std::string ip;
+    // the time in ms to expire.
+    int64_t expire;
+public:
+    SrsDnsEntry();
+    virtual ~SrsDnsEntry();
+};
+
+/**
+* the query of host in progress, the other coroutines
+* which resolve the same host wait for it.
+*/
+class SrsDnsQuery
+{
+public:
+    st_cond_t done;
+    // the owner and the waiters of query, free when no ref.
+    int nb_refs;
+public:
+    SrsDnsQuery();
+    virtual ~SrsDnsQuery();
+};
+
+/**
+* the dns resolver over st udp, never block the st scheduler,
+* which is used to resolve the host to connect, for edge, forward,
+* http hooks and casters.
+* the resolver lookup the /etc/hosts, then query the name servers
+* in /etc/resolv.conf with its search list like the libc, and cache
+* the result by the ttl of answer, while the failed host is cached
+* for SRS_DNS_NEGATIVE_TTL.
+* the id of query is random and the question must be echoed by the
+* response, to reject the spoofed answers.
+* @remark the resolver only support ipv4, that is the A record.
+*/
+class SrsDnsResolver
+{
+protected:
+    // the cached entries, key is host.
+    std::map<std::string, SrsDnsEntry*> cache;
+    // the queries in progress, key is host.
+    std::map<std::string, SrsDnsQuery*> queries;
+    // the hosts file, key is host, value is ip.
+    std::map<std::string, std::string> hosts;
+    // the last modify time of hosts file, and the time to check it.
+    int64_t hosts_mtime;
+    int64_t hosts_checked;
+    // the ipv4 of name servers.
+    std::vector<std::string> servers;
+    bool servers_loaded;
+    // the search list of domain or search in resolv.conf.
+    std::vector<std::string> searches;
+    // the ndots of options in resolv.conf.
+    int ndots;
+public:
+    SrsDnsResolver();
+    virtual ~SrsDnsResolver();
+public:
+    /**
+    * resolve the host to ipv4.
+    * @param host the host to resolve, return directly when it's ipv4.
+    * @param pip output the resolved ipv4.
+    * @param timeout the timeout in us to query each name server,
+    *       use SRS_DNS_QUERY_TIMEOUT_US when ST_UTIME_NO_TIMEOUT.
+    */
+    virtual int resolve(std::string host, std::string& pip, int64_t timeout);
+protected:
+    virtual void load_hosts();
+    virtual void load_servers();
+    /**
+    * query the names of host in the search list, from name servers one by one.
+    * @param pttl output the ttl in seconds of answer.
+    */
+    virtual int query(std::string host, int64_t timeout, std::string& pip, int& pttl);
+    /**
+    * get the names to query for host, apply the search list when the
+    * host is not absolute, @see man resolv.conf
+    */
+    virtual std::vector<std::string> search_names(std::string host);
+    virtual int query_server(std::string server, std::string host, int64_t timeout, std::string& pip, int& pttl);
+    virtual void update_cache(std::string host, std::string ip, int ttl);
+};
+
+/**
+* generate the random id of query, which is unpredictable to defense the spoofed response.
+*/
+extern u_int16_t srs_dns_random_id();
+
+/**
+* encode the query of A record for host.
+* @param buf the buffer of query, SRS_DNS_MAX_MESSAGE is enough.
+* @param pnb_query output the size of query.
+*/
+extern int srs_dns_encode_query(u_int16_t id, std::string host, char* buf, int size, int* pnb_query);
+
+/**
+* decode the response of query, use the A record of host or its CNAME chain.
+* @param id the id of query, which must be echoed by the response.
+* @param host the host of query, which must be the only question of response.
+* @param pttl output the ttl in seconds, the min ttl of the chain.
+* @return ERROR_SYSTEM_DNS_MISMATCH when the response is not for the query,
+*       which should be ignored to wait for the right one.
+*/
+extern int srs_dns_decode_response(u_int16_t id, std::string host, char* buf, int size, std::string& pip, int& pttl);
+
+// the global dns resolver.
+extern SrsDnsResolver* _srs_dns;
+
+#endif
+
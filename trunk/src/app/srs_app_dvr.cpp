@@ -42,6 +42,7 @@ using namespace std;
 #include <srs_kernel_stream.hpp>
 #include <srs_protocol_json.hpp>
 #include <srs_app_utility.hpp>
+#include <srs_app_async_io.hpp>
 
 // update the flv duration and filesize every this interval in ms.
 #define SRS_DVR_UPDATE_DURATION_INTERVAL 60000
@@ -52,7 +53,7 @@ SrsFlvSegment::SrsFlvSegment(SrsDvrPlan* p)
     jitter = NULL;
     plan = p;
 
-    fs = new SrsFileWriter();
+    fs = new SrsAsyncFileWriter();
     enc = new SrsFlvEncoder();
     jitter_algorithm = SrsRtmpJitterAlgorithmOFF;
 
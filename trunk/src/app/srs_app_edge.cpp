@@ -27,6 +27,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <sstream>
 
 using namespace std;
 
@@ -44,6 +45,7 @@ using namespace std;
 #include <srs_app_utility.hpp>
 #include <srs_rtmp_amf0.hpp>
 #include <srs_kernel_utility.hpp>
+#include <srs_app_worker.hpp>
 
 // when error, edge ingester sleep for a while and retry.
 #define SRS_EDGE_INGESTER_SLEEP_US (int64_t)(1*1000*1000LL)
@@ -65,6 +67,7 @@ SrsEdgeIngester::SrsEdgeIngester()
     io = NULL;
     kbps = new SrsKbps();
     client = NULL;
+    _source = NULL;
     _edge = NULL;
     _req = NULL;
     origin_index = 0;
@@ -114,8 +117,11 @@ void SrsEdgeIngester::stop()
     srs_freep(io);
     kbps->set_io(NULL, NULL);
     
-    // notice to unpublish.
-    _source->on_unpublish();
+    // notice to unpublish, ignore when not initialized,
+    // for example, the source failed to initialize is freed.
+    if (_source) {
+        _source->on_unpublish();
+    }
 }
 
 int SrsEdgeIngester::cycle()
@@ -340,28 +346,41 @@ int SrsEdgeIngester::connect_server(string& ep_server, string& ep_port)
     // reopen
     close_underlayer_socket();
     
-    SrsConfDirective* conf = _srs_config->get_vhost_edge_origin(_req->vhost);
-    
-    // @see https://github.com/ossrs/srs/issues/79
-    // when origin is error, for instance, server is shutdown,
-    // then user remove the vhost then reload, the conf is empty.
-    if (!conf) {
-        ret = ERROR_EDGE_VHOST_REMOVED;
-        srs_warn("vhost %s removed. ret=%d", _req->vhost.c_str(), ret);
-        return ret;
-    }
-    
-    // select the origin.
-    std::string server = conf->args.at(origin_index % conf->args.size());
-    origin_index = (origin_index + 1) % conf->args.size();
-    
+    std::string server;
     std::string s_port = SRS_CONSTS_RTMP_DEFAULT_PORT;
     int port = ::atoi(SRS_CONSTS_RTMP_DEFAULT_PORT);
-    size_t pos = server.find(":");
-    if (pos != std::string::npos) {
-        s_port = server.substr(pos + 1);
-        server = server.substr(0, pos);
-        port = ::atoi(s_port.c_str());
+    
+    // relay the stream from the worker which it's published to.
+    int worker = _source->relay_worker();
+    if (worker >= 0) {
+        server = "127.0.0.1";
+        port = _srs_workers->relay_port(worker);
+        
+        std::stringstream ss;
+        ss << port;
+        s_port = ss.str();
+    } else {
+        SrsConfDirective* conf = _srs_config->get_vhost_edge_origin(_req->vhost);
+        
+        // @see https://github.com/ossrs/srs/issues/79
+        // when origin is error, for instance, server is shutdown,
+        // then user remove the vhost then reload, the conf is empty.
+        if (!conf) {
+            ret = ERROR_EDGE_VHOST_REMOVED;
+            srs_warn("vhost %s removed. ret=%d", _req->vhost.c_str(), ret);
+            return ret;
+        }
+        
+        // select the origin.
+        server = conf->args.at(origin_index % conf->args.size());
+        origin_index = (origin_index + 1) % conf->args.size();
+        
+        size_t pos = server.find(":");
+        if (pos != std::string::npos) {
+            s_port = server.substr(pos + 1);
+            server = server.substr(0, pos);
+            port = ::atoi(s_port.c_str());
+        }
     }
     
     // output the connected server and port.
@@ -50,6 +50,8 @@ using namespace std;
 #include <srs_kernel_ts.hpp>
 #include <srs_app_utility.hpp>
 #include <srs_app_http_hooks.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_kernel_pool.hpp>
 
 // drop the segment when duration of ts too small.
 #define SRS_AUTO_HLS_SEGMENT_MIN_DURATION_MS 100
@@ -61,6 +63,107 @@ using namespace std;
 // reset the piece id when deviation overflow this.
 #define SRS_JUMP_WHEN_PIECE_DEVIATION 20
 
+// the block size of hls shared buffer, double from min to max,
+// in power of 2 for the size class of memory pool.
+#define SRS_HLS_BLOCK_MIN_SIZE 4096
+#define SRS_HLS_BLOCK_MAX_SIZE 65536
+
+SrsHlsSharedBuffer::SrsHlsSharedBuffer()
+{
+    nb_bytes = 0;
+    block = NULL;
+    nb_block = 0;
+    block_size = SRS_HLS_BLOCK_MIN_SIZE;
+}
+
+SrsHlsSharedBuffer::~SrsHlsSharedBuffer()
+{
+    std::vector<SrsSharedPtrMessage*>::iterator it;
+    for (it = blocks.begin(); it != blocks.end(); ++it) {
+        SrsSharedPtrMessage* msg = *it;
+        srs_freep(msg);
+    }
+    blocks.clear();
+    
+    srs_pool_freepa(block);
+}
+
+void SrsHlsSharedBuffer::append(char* data, int size)
+{
+    while (size > 0) {
+        if (!block) {
+            block = srs_pool_alloc(block_size);
+            nb_block = 0;
+        }
+        
+        int nb_copy = srs_min(size, block_size - nb_block);
+        memcpy(block + nb_block, data, nb_copy);
+        nb_block += nb_copy;
+        data += nb_copy;
+        size -= nb_copy;
+        
+        if (nb_block == block_size) {
+            flush();
+            block_size = srs_min(block_size * 2, SRS_HLS_BLOCK_MAX_SIZE);
+        }
+    }
+}
+
+void SrsHlsSharedBuffer::flush()
+{
+    if (!block) {
+        return;
+    }
+    
+    // the shared message own the block, never fail.
+    SrsMessageHeader header;
+    SrsSharedPtrMessage* msg = new SrsSharedPtrMessage();
+    if (msg->create(&header, block, nb_block) != ERROR_SUCCESS) {
+        srs_freep(msg);
+        srs_pool_freepa(block);
+        return;
+    }
+    
+    blocks.push_back(msg);
+    nb_bytes += nb_block;
+    
+    block = NULL;
+    nb_block = 0;
+}
+
+SrsHlsSharedBuffer* SrsHlsSharedBuffer::copy()
+{
+    SrsHlsSharedBuffer* cp = new SrsHlsSharedBuffer();
+    
+    std::vector<SrsSharedPtrMessage*>::iterator it;
+    for (it = blocks.begin(); it != blocks.end(); ++it) {
+        SrsSharedPtrMessage* msg = *it;
+        cp->blocks.push_back(msg->copy());
+    }
+    cp->nb_bytes = nb_bytes;
+    
+    return cp;
+}
+
+int64_t SrsHlsSharedBuffer::length()
+{
+    return nb_bytes;
+}
+
+int SrsHlsSharedBuffer::size()
+{
+    return (int)blocks.size();
+}
+
+void SrsHlsSharedBuffer::dump(iovec* iovs)
+{
+    for (int i = 0; i < (int)blocks.size(); i++) {
+        SrsSharedPtrMessage* msg = blocks.at(i);
+        iovs[i].iov_base = msg->payload;
+        iovs[i].iov_len = msg->size;
+    }
+}
+
 ISrsHlsHandler::ISrsHlsHandler()
 {
 }
@@ -78,10 +181,12 @@ SrsHlsCacheWriter::SrsHlsCacheWriter(bool write_cache, bool write_file)
 {
     should_write_cache = write_cache;
     should_write_file = write_file;
+    data = new SrsHlsSharedBuffer();
 }
 
 SrsHlsCacheWriter::~SrsHlsCacheWriter()
 {
+    srs_freep(data);
 }
 
 int SrsHlsCacheWriter::open(string file)
@@ -124,7 +229,7 @@ int SrsHlsCacheWriter::write(void* buf, size_t count, ssize_t* pnwrite)
 {
     if (should_write_cache) {
         if (count > 0) {
-            data.append((char*)buf, count);
+            data->append((char*)buf, (int)count);
         }
     }
 
@@ -135,8 +240,9 @@ int SrsHlsCacheWriter::write(void* buf, size_t count, ssize_t* pnwrite)
     return ERROR_SUCCESS;
 }
 
-string SrsHlsCacheWriter::cache()
+SrsHlsSharedBuffer* SrsHlsCacheWriter::cache()
 {
+    data->flush();
     return data;
 }
 
@@ -885,7 +991,8 @@ int SrsHlsMuxer::_refresh_m3u8(string m3u8_file)
         return ret;
     }
 
-    SrsHlsCacheWriter writer(should_write_cache, should_write_file);
+    // the m3u8 is small, notify the handler by string.
+    SrsHlsCacheWriter writer(false, should_write_file);
     if ((ret = writer.open(m3u8_file)) != ERROR_SUCCESS) {
         srs_error("open m3u8 file %s failed. ret=%d", m3u8_file.c_str(), ret);
         return ret;
@@ -959,7 +1066,7 @@ int SrsHlsMuxer::_refresh_m3u8(string m3u8_file)
     srs_info("write m3u8 %s success.", m3u8_file.c_str());
 
     // notify handler for update m3u8.
-    if (handler && (ret = handler->on_update_m3u8(req, writer.cache())) != ERROR_SUCCESS) {
+    if (handler && (ret = handler->on_update_m3u8(req, should_write_cache? m3u8 : "")) != ERROR_SUCCESS) {
         srs_error("notify handler for update m3u8 failed. ret=%d", ret);
         return ret;
     }
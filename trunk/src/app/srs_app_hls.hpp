@@ -35,6 +35,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <srs_kernel_codec.hpp>
 #include <srs_kernel_file.hpp>
 #include <srs_app_async_call.hpp>
+#include <srs_app_async_io.hpp>
 
 class SrsSharedPtrMessage;
 class SrsCodecSample;
@@ -53,6 +54,54 @@ class SrsHlsSegment;
 class SrsTsCache;
 class SrsTsContext;
 
+/**
+* the refcounted immutable ts of hls in memory, for the hls served by http,
+* the muxer writes the ts once to the blocks, then the http handler shares
+* the blocks by copy() and writev them to all viewers.
+* @remark the blocks are alloc from memory pool, never changed once flushed.
+*/
+class SrsHlsSharedBuffer
+{
+private:
+    // the flushed blocks, shared by all copies.
+    std::vector<SrsSharedPtrMessage*> blocks;
+    int64_t nb_bytes;
+    // the block in writing, only for the buffer of muxer.
+    char* block;
+    int nb_block;
+    int block_size;
+public:
+    SrsHlsSharedBuffer();
+    virtual ~SrsHlsSharedBuffer();
+public:
+    /**
+    * append bytes to the block in writing, flush it when full.
+    */
+    virtual void append(char* data, int size);
+    /**
+    * flush the block in writing, so the bytes are visible to copies.
+    */
+    virtual void flush();
+    /**
+    * copy the flushed blocks, increase the reference count of blocks
+    * and never copy the bytes.
+    */
+    virtual SrsHlsSharedBuffer* copy();
+public:
+    /**
+    * the bytes of flushed blocks.
+    */
+    virtual int64_t length();
+    /**
+    * the number of flushed blocks, the iovs to dump.
+    */
+    virtual int size();
+    /**
+    * dump the flushed blocks to iovs, user must provides size() iovs.
+    */
+    virtual void dump(iovec* iovs);
+};
+
 /**
 * the handler for hls event.
 * for example, we use memory only hls for
@@ -73,8 +122,9 @@ public:
     virtual int on_update_m3u8(SrsRequest* r, std::string m3u8) = 0;
     /**
      * when reap new ts file.
+     * @param ts the ts in memory, handler should copy() it to keep.
      */
-    virtual int on_update_ts(SrsRequest* r, std::string uri, std::string ts) = 0;
+    virtual int on_update_ts(SrsRequest* r, std::string uri, SrsHlsSharedBuffer* ts) = 0;
     /**
      * when remove the specified ts file,
      * for the hls to remove the expired ts not in hls window.
@@ -97,8 +147,8 @@ public:
 class SrsHlsCacheWriter : public SrsFileWriter
 {
 private:
-    SrsFileWriter impl;
-    std::string data;
+    SrsAsyncFileWriter impl;
+    SrsHlsSharedBuffer* data;
     bool should_write_cache;
     bool should_write_file;
 public:
@@ -121,9 +171,9 @@ public:
     virtual int write(void* buf, size_t count, ssize_t* pnwrite);
 public:
     /**
-    * get the string cache.
+    * flush and get the ts cache, user should never free it.
     */
-    virtual std::string cache();
+    virtual SrsHlsSharedBuffer* cache();
 };
 
 /**
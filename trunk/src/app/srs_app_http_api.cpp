@@ -27,6 +27,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include <sstream>
 #include <stdlib.h>
+#include <unistd.h>
 using namespace std;
 
 #include <srs_kernel_log.hpp>
@@ -42,6 +43,10 @@ using namespace std;
 #include <srs_app_config.hpp>
 #include <srs_app_source.hpp>
 #include <srs_app_http_conn.hpp>
+#include <srs_app_worker.hpp>
+#include <srs_kernel_pool.hpp>
+#include <srs_rtmp_handshake.hpp>
+#include <srs_app_http_hooks.hpp>
 
 int srs_api_response_jsonp(ISrsHttpResponseWriter* w, string callback, string data)
 {
@@ -205,6 +210,10 @@ int SrsGoApiV1::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
             << SRS_JFIELD_STR("vhosts", "manage all vhosts or specified vhost") << SRS_JFIELD_CONT
             << SRS_JFIELD_STR("streams", "manage all streams or specified stream") << SRS_JFIELD_CONT
             << SRS_JFIELD_STR("clients", "manage all clients or specified client, default query top 10 clients") << SRS_JFIELD_CONT
+            << SRS_JFIELD_STR("workers", "the worker processes and the streams published to them") << SRS_JFIELD_CONT
+            << SRS_JFIELD_STR("pools", "the memory pool of messages and payloads") << SRS_JFIELD_CONT
+            << SRS_JFIELD_STR("hooks", "the latency of http hooks") << SRS_JFIELD_CONT
+            << SRS_JFIELD_STR("handshakes", "the rate of rtmp handshakes and the pool of keys") << SRS_JFIELD_CONT
             << SRS_JFIELD_ORG("tests", SRS_JOBJECT_START)
                 << SRS_JFIELD_STR("requests", "show the request info") << SRS_JFIELD_CONT
                 << SRS_JFIELD_STR("errors", "always return an error 100") << SRS_JFIELD_CONT
@@ -752,10 +761,11 @@ int SrsGoApiStreams::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
         if (!stream) {
             ret = stat->dumps_streams(data);
             
+            // the streams of all workers, from the snapshot of other workers.
             ss << SRS_JOBJECT_START
                     << SRS_JFIELD_ERROR(ret) << SRS_JFIELD_CONT
                     << SRS_JFIELD_ORG("server", stat->server_id()) << SRS_JFIELD_CONT
-                    << SRS_JFIELD_ORG("streams", data.str())
+                    << SRS_JFIELD_ORG("streams", _srs_workers->aggregate_streams(data.str()))
                 << SRS_JOBJECT_END;
         } else {
             ret = stream->dumps(data);
@@ -815,10 +825,11 @@ int SrsGoApiClients::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
         if (!client) {
             ret = stat->dumps_clients(data, 0, 10);
             
+            // the top 10 clients of each worker, from the snapshot of other workers.
             ss << SRS_JOBJECT_START
                     << SRS_JFIELD_ERROR(ret) << SRS_JFIELD_CONT
                     << SRS_JFIELD_ORG("server", stat->server_id()) << SRS_JFIELD_CONT
-                    << SRS_JFIELD_ORG("clients", data.str())
+                    << SRS_JFIELD_ORG("clients", _srs_workers->aggregate_clients(data.str()))
                 << SRS_JOBJECT_END;
         } else {
             ret = client->dumps(data);
@@ -838,6 +849,148 @@ int SrsGoApiClients::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
     return ret;
 }
 
+SrsGoApiWorkers::SrsGoApiWorkers()
+{
+}
+
+SrsGoApiWorkers::~SrsGoApiWorkers()
+{
+}
+
+int SrsGoApiWorkers::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsStatistic* stat = SrsStatistic::instance();
+    std::stringstream ss;
+    
+    std::stringstream data;
+    ret = _srs_workers->dumps(data);
+    
+    ss << SRS_JOBJECT_START
+            << SRS_JFIELD_ERROR(ret) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("server", stat->server_id()) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("data", data.str())
+        << SRS_JOBJECT_END;
+    
+    return srs_api_response(w, r, ss.str());
+}
+
+SrsGoApiPools::SrsGoApiPools()
+{
+}
+
+SrsGoApiPools::~SrsGoApiPools()
+{
+}
+
+int SrsGoApiPools::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    SrsStatistic* stat = SrsStatistic::instance();
+    SrsMemoryPool* pool = SrsMemoryPool::instance();
+    std::stringstream ss;
+    
+    ss << SRS_JOBJECT_START
+        << SRS_JFIELD_ERROR(ERROR_SUCCESS) << SRS_JFIELD_CONT
+        << SRS_JFIELD_ORG("server", stat->server_id()) << SRS_JFIELD_CONT
+        << SRS_JFIELD_ORG("data", SRS_JOBJECT_START)
+            << SRS_JFIELD_BOOL("enabled", pool->is_enabled()) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("pid", getpid()) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("resident", pool->resident()) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("heap_allocs", pool->heap_allocs()) << SRS_JFIELD_CONT
+            << SRS_JFIELD_NAME("classes") << SRS_JARRAY_START;
+    
+    for (int i = 0; i < pool->size(); i++) {
+        SrsPoolClass* c = pool->at(i);
+        if (i > 0) {
+            ss << SRS_JFIELD_CONT;
+        }
+        ss << SRS_JOBJECT_START
+            << SRS_JFIELD_ORG("size", c->size) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("slabs", c->nb_slabs) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("used", c->nb_used) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("free", c->nb_free) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("hits", c->hits) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("misses", c->misses)
+            << SRS_JOBJECT_END;
+    }
+    
+    ss      << SRS_JARRAY_END
+        << SRS_JOBJECT_END
+        << SRS_JOBJECT_END;
+    
+    return srs_api_response(w, r, ss.str());
+}
+
+SrsGoApiHooks::SrsGoApiHooks()
+{
+}
+
+SrsGoApiHooks::~SrsGoApiHooks()
+{
+}
+
+int SrsGoApiHooks::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsStatistic* stat = SrsStatistic::instance();
+    std::stringstream ss;
+    
+    std::stringstream data;
+#ifdef SRS_AUTO_HTTP_CALLBACK
+    ret = SrsHttpHooks::dumps(data);
+#else
+    data << SRS_JOBJECT_START << SRS_JOBJECT_END;
+#endif
+    
+    ss << SRS_JOBJECT_START
+            << SRS_JFIELD_ERROR(ret) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("server", stat->server_id()) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("data", data.str())
+        << SRS_JOBJECT_END;
+    
+    return srs_api_response(w, r, ss.str());
+}
+
+SrsGoApiHandshakes::SrsGoApiHandshakes()
+{
+}
+
+SrsGoApiHandshakes::~SrsGoApiHandshakes()
+{
+}
+
+int SrsGoApiHandshakes::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    SrsStatistic* stat = SrsStatistic::instance();
+    SrsHandshakeKeyPool* pool = SrsHandshakeKeyPool::instance();
+    std::stringstream ss;
+    
+    ss << SRS_JOBJECT_START
+        << SRS_JFIELD_ERROR(ERROR_SUCCESS) << SRS_JFIELD_CONT
+        << SRS_JFIELD_ORG("server", stat->server_id()) << SRS_JFIELD_CONT
+        << SRS_JFIELD_ORG("data", SRS_JOBJECT_START)
+            << SRS_JFIELD_ORG("pid", getpid()) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("simple", pool->simples()) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("complex", pool->complexes()) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("rate", pool->rate()) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("peak_rate", pool->peak_rate()) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("keys", SRS_JOBJECT_START)
+                << SRS_JFIELD_BOOL("enabled", pool->enabled()) << SRS_JFIELD_CONT
+                << SRS_JFIELD_ORG("capacity", pool->capacity()) << SRS_JFIELD_CONT
+                << SRS_JFIELD_ORG("size", pool->size()) << SRS_JFIELD_CONT
+                << SRS_JFIELD_ORG("generated", pool->generated()) << SRS_JFIELD_CONT
+                << SRS_JFIELD_ORG("errors", pool->errors()) << SRS_JFIELD_CONT
+                << SRS_JFIELD_ORG("hits", pool->hits()) << SRS_JFIELD_CONT
+                << SRS_JFIELD_ORG("misses", pool->misses())
+            << SRS_JOBJECT_END
+        << SRS_JOBJECT_END
+        << SRS_JOBJECT_END;
+    
+    return srs_api_response(w, r, ss.str());
+}
+
 SrsGoApiError::SrsGoApiError()
 {
 }
@@ -177,6 +177,42 @@ public:
     virtual int serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
 };
 
+class SrsGoApiWorkers : public ISrsHttpHandler
+{
+public:
+    SrsGoApiWorkers();
+    virtual ~SrsGoApiWorkers();
+public:
+    virtual int serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
+class SrsGoApiPools : public ISrsHttpHandler
+{
+public:
+    SrsGoApiPools();
+    virtual ~SrsGoApiPools();
+public:
+    virtual int serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
+class SrsGoApiHooks : public ISrsHttpHandler
+{
+public:
+    SrsGoApiHooks();
+    virtual ~SrsGoApiHooks();
+public:
+    virtual int serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
+class SrsGoApiHandshakes : public ISrsHttpHandler
+{
+public:
+    SrsGoApiHandshakes();
+    virtual ~SrsGoApiHandshakes();
+public:
+    virtual int serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
 class SrsGoApiError : public ISrsHttpHandler
 {
 public:
@@ -37,12 +37,15 @@ using namespace std;
 #include <srs_core_autofree.hpp>
 #include <srs_app_http_conn.hpp>
 
+SrsHttpClientPool* _srs_http_client_pool = new SrsHttpClientPool();
+
 SrsHttpClient::SrsHttpClient()
 {
     connected = false;
     stfd = NULL;
     skt = NULL;
     parser = NULL;
+    retryable = false;
     timeout_us = 0;
 }
 
@@ -68,15 +71,40 @@ int SrsHttpClient::initialize(string h, int p, int64_t t_us)
     port = p;
     timeout_us = t_us;
     
+    // for the keep-alive client, update the timeout.
+    if (skt) {
+        skt->set_recv_timeout(timeout_us);
+        skt->set_send_timeout(timeout_us);
+    }
+    
     return ret;
 }
 
+string SrsHttpClient::server()
+{
+    std::stringstream ss;
+    ss << host << ":" << port;
+    return ss.str();
+}
+
+bool SrsHttpClient::is_connected()
+{
+    return connected;
+}
+
+bool SrsHttpClient::can_retry()
+{
+    return retryable;
+}
+
 int SrsHttpClient::post(string path, string req, ISrsHttpMessage** ppmsg)
 {
     *ppmsg = NULL;
     
     int ret = ERROR_SUCCESS;
     
+    retryable = false;
+    
     if ((ret = connect()) != ERROR_SUCCESS) {
         srs_warn("http connect server failed. ret=%d", ret);
         return ret;
@@ -97,15 +125,25 @@ int SrsHttpClient::post(string path, string req, ISrsHttpMessage** ppmsg)
     
     std::string data = ss.str();
     if ((ret = skt->write((void*)data.c_str(), data.length(), NULL)) != ERROR_SUCCESS) {
-        // disconnect when error.
+        // disconnect when error, the request is incomplete, safe to retry.
+        retryable = true;
         disconnect();
         
         srs_error("write http post failed. ret=%d", ret);
         return ret;
     }
     
+    int64_t nb_recv = skt->get_recv_bytes();
+    
     ISrsHttpMessage* msg = NULL;
     if ((ret = parser->parse_message(skt, NULL, &msg)) != ERROR_SUCCESS) {
+        // the keep-alive connection maybe closed by server, safe to retry when EOF
+        // before any response, but the server maybe processing it when timeout.
+        retryable = (ret != ERROR_SOCKET_TIMEOUT && skt->get_recv_bytes() == nb_recv);
+        
+        // disconnect when error.
+        disconnect();
+        
         srs_error("parse http post response failed. ret=%d", ret);
         return ret;
     }
@@ -123,6 +161,8 @@ int SrsHttpClient::get(string path, std::string req, ISrsHttpMessage** ppmsg)
 
     int ret = ERROR_SUCCESS;
 
+    retryable = false;
+    
     if ((ret = connect()) != ERROR_SUCCESS) {
         srs_warn("http connect server failed. ret=%d", ret);
         return ret;
@@ -143,15 +183,25 @@ int SrsHttpClient::get(string path, std::string req, ISrsHttpMessage** ppmsg)
 
     std::string data = ss.str();
     if ((ret = skt->write((void*)data.c_str(), data.length(), NULL)) != ERROR_SUCCESS) {
-        // disconnect when error.
+        // disconnect when error, the request is incomplete, safe to retry.
+        retryable = true;
         disconnect();
 
         srs_error("write http get failed. ret=%d", ret);
         return ret;
     }
 
+    int64_t nb_recv = skt->get_recv_bytes();
+    
     ISrsHttpMessage* msg = NULL;
     if ((ret = parser->parse_message(skt, NULL, &msg)) != ERROR_SUCCESS) {
+        // the keep-alive connection maybe closed by server, safe to retry when EOF
+        // before any response, but the server maybe processing it when timeout.
+        retryable = (ret != ERROR_SOCKET_TIMEOUT && skt->get_recv_bytes() == nb_recv);
+        
+        // disconnect when error.
+        disconnect();
+        
         srs_error("parse http post response failed. ret=%d", ret);
         return ret;
     }
@@ -200,5 +250,101 @@ int SrsHttpClient::connect()
     return ret;
 }
 
+SrsHttpClientPool::SrsHttpClientPool()
+{
+}
+
+SrsHttpClientPool::~SrsHttpClientPool()
+{
+    std::map<std::string, std::vector<std::pair<SrsHttpClient*, int64_t> > >::iterator it;
+    for (it = idles.begin(); it != idles.end(); ++it) {
+        std::vector<std::pair<SrsHttpClient*, int64_t> >& clients = it->second;
+        for (int i = 0; i < (int)clients.size(); i++) {
+            SrsHttpClient* client = clients.at(i).first;
+            srs_freep(client);
+        }
+    }
+    idles.clear();
+    
+    std::map<std::string, st_cond_t>::iterator it2;
+    for (it2 = releases.begin(); it2 != releases.end(); ++it2) {
+        st_cond_destroy(it2->second);
+    }
+    releases.clear();
+}
+
+int SrsHttpClientPool::acquire(string host, int port, int64_t timeout_us, SrsHttpClient** pclient)
+{
+    int ret = ERROR_SUCCESS;
+    
+    std::stringstream ss;
+    ss << host << ":" << port;
+    std::string server = ss.str();
+    
+    // wait when exceed the max connections of server.
+    int64_t deadline = srs_update_system_time_ms() + timeout_us / 1000;
+    while (actives[server] >= SRS_HTTP_CLIENT_POOL_MAX_CONNS) {
+        // the cond is not available before st initialized.
+        st_cond_t released = releases[server];
+        if (!released) {
+            released = releases[server] = st_cond_new();
+        }
+        
+        int64_t wait = deadline - srs_update_system_time_ms();
+        if (wait <= 0 || st_cond_timedwait(released, wait * 1000) != 0) {
+            ret = ERROR_HTTP_CLIENT_POOL_BUSY;
+            srs_error("http client pool busy, server=%s, actives=%d. ret=%d", server.c_str(), actives[server], ret);
+            return ret;
+        }
+    }
+    
+    // reuse the last idle client, close the expired ones.
+    SrsHttpClient* client = NULL;
+    std::vector<std::pair<SrsHttpClient*, int64_t> >& clients = idles[server];
+    while (!client && !clients.empty()) {
+        std::pair<SrsHttpClient*, int64_t> idle = clients.back();
+        clients.pop_back();
+        
+        if (srs_get_system_time_ms() - idle.second < SRS_HTTP_CLIENT_POOL_IDLE_TIMEOUT_MS) {
+            client = idle.first;
+        } else {
+            srs_freep(idle.first);
+        }
+    }
+    
+    if (!client) {
+        client = new SrsHttpClient();
+    }
+    
+    if ((ret = client->initialize(host, port, timeout_us)) != ERROR_SUCCESS) {
+        srs_freep(client);
+        return ret;
+    }
+    
+    actives[server]++;
+    *pclient = client;
+    
+    return ret;
+}
+
+void SrsHttpClientPool::release(SrsHttpClient* client, bool reusable)
+{
+    std::string server = client->server();
+    actives[server]--;
+    
+    std::vector<std::pair<SrsHttpClient*, int64_t> >& clients = idles[server];
+    if (reusable && client->is_connected() && (int)clients.size() < SRS_HTTP_CLIENT_POOL_MAX_IDLES) {
+        clients.push_back(std::make_pair(client, srs_get_system_time_ms()));
+    } else {
+        srs_freep(client);
+    }
+    
+    // wakeup a waiter of server, for only a client released.
+    std::map<std::string, st_cond_t>::iterator it = releases.find(server);
+    if (it != releases.end()) {
+        st_cond_signal(it->second);
+    }
+}
+
 #endif
 
@@ -30,6 +30,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <srs_core.hpp>
 
 #include <string>
+#include <vector>
+#include <map>
 
 #ifdef SRS_AUTO_HTTP_CORE
 
@@ -43,6 +45,14 @@ class SrsStSocket;
 // the default timeout for http client.
 #define SRS_HTTP_CLIENT_TIMEOUT_US (int64_t)(30*1000*1000LL)
 
+// the max connections to each server of http client pool,
+// the request waits for a connection when exceed.
+#define SRS_HTTP_CLIENT_POOL_MAX_CONNS 32
+// the max idle connections to keep alive for each server.
+#define SRS_HTTP_CLIENT_POOL_MAX_IDLES 8
+// the idle connection is closed when not used in this time.
+#define SRS_HTTP_CLIENT_POOL_IDLE_TIMEOUT_MS 15000
+
 /**
 * http client to GET/POST/PUT/DELETE uri
 */
@@ -53,6 +63,8 @@ private:
     st_netfd_t stfd;
     SrsStSocket* skt;
     SrsHttpParser* parser;
+    // whether the last request failed before server got it.
+    bool retryable;
 private:
     int64_t timeout_us;
     // host name or ip.
@@ -66,6 +78,21 @@ public:
     * initialize the client, connect to host and port.
     */
     virtual int initialize(std::string h, int p, int64_t t_us = SRS_HTTP_CLIENT_TIMEOUT_US);
+    /**
+    * the server of client, the host:port.
+    */
+    virtual std::string server();
+    /**
+    * whether the connection to server is opened,
+    * for the keep-alive client to send another request.
+    */
+    virtual bool is_connected();
+    /**
+    * whether the last request is safe to retry, that is, the keep-alive connection
+    * closed by server, the write failed or EOF before any byte of response.
+    * @remark never retry when timeout, the server maybe processing the request.
+    */
+    virtual bool can_retry();
 public:
     /**
     * to post data to the uri.
@@ -81,11 +108,50 @@ public:
     * @param ppmsg output the http message to read the response.
     */
     virtual int get(std::string path, std::string req, ISrsHttpMessage** ppmsg);
-private:
+public:
     virtual void disconnect();
+private:
     virtual int connect();
 };
 
+/**
+* the pool of keep-alive http clients, by server of client,
+* for the http hooks to reuse the connections, and limit
+* the connections to the api server when lots of clients come.
+* @remark each client sends a request and reads the response in a time,
+*       that is, never pipeline the requests in a connection.
+*/
+class SrsHttpClientPool
+{
+private:
+    // the idle clients and the time to idle, by server.
+    std::map<std::string, std::vector<std::pair<SrsHttpClient*, int64_t> > > idles;
+    // the number of clients in use, by server.
+    std::map<std::string, int> actives;
+    // signal the waiters of server when client released,
+    // the cond per server, for the waiter of other server never wakeup.
+    std::map<std::string, st_cond_t> releases;
+public:
+    SrsHttpClientPool();
+    virtual ~SrsHttpClientPool();
+public:
+    /**
+    * get a client of server, reuse the idle one if possible,
+    * and wait for the client to release when exceed the max connections.
+    * @param pclient output the client, user must release it to pool.
+    */
+    virtual int acquire(std::string host, int port, int64_t timeout_us, SrsHttpClient** pclient);
+    /**
+    * release the client to pool.
+    * @param reusable whether the client can send another request,
+    *       false if error or server not keep-alive, to close it.
+    */
+    virtual void release(SrsHttpClient* client, bool reusable);
+};
+
+// the global http client pool.
+extern SrsHttpClientPool* _srs_http_client_pool;
+
 #endif
 
 #endif
@@ -162,6 +162,30 @@ int SrsHttpResponseWriter::writev(iovec* iov, int iovcnt, ssize_t* pnwrite)
 {
     int ret = ERROR_SUCCESS;
     
+    // directly send all ioves with content length.
+    if (header_wrote && content_length != -1) {
+        char* data = (iovcnt > 0)? (char*)iov[0].iov_base : NULL;
+        int size = (iovcnt > 0)? (int)iov[0].iov_len : 0;
+        if ((ret = send_header(data, size)) != ERROR_SUCCESS) {
+            srs_error("http: send header failed. ret=%d", ret);
+            return ret;
+        }
+        
+        for (int i = 0; i < iovcnt; i++) {
+            written += iov[i].iov_len;
+        }
+        if (written > content_length) {
+            ret = ERROR_HTTP_CONTENT_LENGTH;
+            srs_error("http: exceed content length. ret=%d", ret);
+            return ret;
+        }
+        
+        if (iovcnt <= 0) {
+            return ret;
+        }
+        return srs_write_large_iovs(skt, iov, iovcnt, pnwrite);
+    }
+    
     // when header not ready, or not chunked, send one by one.
     if (!header_wrote || content_length != -1) {
         ssize_t nwrite = 0;
@@ -1412,7 +1436,7 @@ int SrsHttpServer::hls_update_m3u8(SrsRequest* r, std::string m3u8)
     return http_stream->hls_update_m3u8(r, m3u8);
 }
 
-int SrsHttpServer::hls_update_ts(SrsRequest* r, std::string uri, std::string ts)
+int SrsHttpServer::hls_update_ts(SrsRequest* r, std::string uri, SrsHlsSharedBuffer* ts)
 {
     return http_stream->hls_update_ts(r, uri, ts);
 }
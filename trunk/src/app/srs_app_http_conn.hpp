@@ -69,6 +69,7 @@ class SrsConnection;
 class SrsHttpMessage;
 class SrsHttpStreamServer;
 class SrsHttpStaticServer;
+class SrsHlsSharedBuffer;
 
 // the http chunked header size,
 // for writev, there always one chunk to send it.
@@ -451,7 +452,7 @@ public:
 public:
     virtual int mount_hls(SrsRequest* r);
     virtual int hls_update_m3u8(SrsRequest* r, std::string m3u8);
-    virtual int hls_update_ts(SrsRequest* r, std::string uri, std::string ts);
+    virtual int hls_update_ts(SrsRequest* r, std::string uri, SrsHlsSharedBuffer* ts);
     virtual int hls_remove_ts(SrsRequest* r, std::string uri);
     virtual void unmount_hls(SrsRequest* r);
 };
@@ -49,6 +49,66 @@ using namespace std;
 // the timeout for hls notify, in us.
 #define SRS_HLS_NOTIFY_TIMEOUT_US (int64_t)(10*1000*1000LL)
 
+SrsHttpHookStat::SrsHttpHookStat()
+{
+    nb_requests = 0;
+    nb_errors = 0;
+    total_ms = 0;
+    max_ms = 0;
+    for (int i = 0; i < SRS_HTTP_HOOK_NB_BUCKETS; i++) {
+        buckets[i] = 0;
+    }
+}
+
+SrsHttpHookStat::~SrsHttpHookStat()
+{
+}
+
+void SrsHttpHookStat::update(int64_t ms, int ret)
+{
+    static int64_t limits[SRS_HTTP_HOOK_NB_BUCKETS - 1] = {5, 10, 50, 100, 500, 1000, 3000};
+    
+    nb_requests++;
+    if (ret != ERROR_SUCCESS) {
+        nb_errors++;
+    }
+    total_ms += ms;
+    max_ms = srs_max(max_ms, ms);
+    
+    int i = 0;
+    while (i < SRS_HTTP_HOOK_NB_BUCKETS - 1 && ms > limits[i]) {
+        i++;
+    }
+    buckets[i]++;
+}
+
+int SrsHttpHookStat::dumps(std::stringstream& ss)
+{
+    int ret = ERROR_SUCCESS;
+    
+    ss << SRS_JOBJECT_START
+            << SRS_JFIELD_ORG("requests", nb_requests) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("errors", nb_errors) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("avg_ms", (nb_requests > 0? total_ms / nb_requests : 0)) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("max_ms", max_ms) << SRS_JFIELD_CONT
+            << SRS_JFIELD_OBJ("histogram")
+                << SRS_JFIELD_ORG("5ms", buckets[0]) << SRS_JFIELD_CONT
+                << SRS_JFIELD_ORG("10ms", buckets[1]) << SRS_JFIELD_CONT
+                << SRS_JFIELD_ORG("50ms", buckets[2]) << SRS_JFIELD_CONT
+                << SRS_JFIELD_ORG("100ms", buckets[3]) << SRS_JFIELD_CONT
+                << SRS_JFIELD_ORG("500ms", buckets[4]) << SRS_JFIELD_CONT
+                << SRS_JFIELD_ORG("1000ms", buckets[5]) << SRS_JFIELD_CONT
+                << SRS_JFIELD_ORG("3000ms", buckets[6]) << SRS_JFIELD_CONT
+                << SRS_JFIELD_ORG("more", buckets[7])
+            << SRS_JOBJECT_END
+        << SRS_JOBJECT_END;
+    
+    return ret;
+}
+
+std::map<std::string, SrsHttpHookDecision> SrsHttpHooks::decisions;
+std::map<std::string, SrsHttpHookStat*> SrsHttpHooks::stats;
+
 SrsHttpHooks::SrsHttpHooks()
 {
 }
@@ -63,6 +123,13 @@ int SrsHttpHooks::on_connect(string url, SrsRequest* req)
     
     int client_id = _srs_context->get_id();
     
+    // use the cached decision of the same request.
+    std::string key = decision_key("on_connect", url, req);
+    if (fetch_decision(req->vhost, key, ret)) {
+        srs_info("http hook on_connect cached. client_id=%d, url=%s, ret=%d", client_id, url.c_str(), ret);
+        return ret;
+    }
+    
     std::stringstream ss;
     ss << SRS_JOBJECT_START
         << SRS_JFIELD_STR("action", "on_connect") << SRS_JFIELD_CONT
@@ -76,8 +143,15 @@ int SrsHttpHooks::on_connect(string url, SrsRequest* req)
         
     std::string data = ss.str();
     std::string res;
-    int status_code;
-    if ((ret = do_post(url, data, status_code, res)) != ERROR_SUCCESS) {
+    int status_code = 0;
+    ret = do_post("on_connect", url, data, status_code, res);
+    
+    // cache the decision only when server allow or deny it.
+    if (is_decision(status_code, ret)) {
+        save_decision(req->vhost, key, ret);
+    }
+    
+    if (ret != ERROR_SUCCESS) {
         srs_error("http post on_connect uri failed. "
             "client_id=%d, url=%s, request=%s, response=%s, code=%d, ret=%d",
             client_id, url.c_str(), data.c_str(), res.c_str(), status_code, ret);
@@ -110,8 +184,8 @@ void SrsHttpHooks::on_close(string url, SrsRequest* req, int64_t send_bytes, int
         
     std::string data = ss.str();
     std::string res;
-    int status_code;
-    if ((ret = do_post(url, data, status_code, res)) != ERROR_SUCCESS) {
+    int status_code = 0;
+    if ((ret = do_post("on_close", url, data, status_code, res)) != ERROR_SUCCESS) {
         srs_warn("http post on_close uri failed, ignored. "
             "client_id=%d, url=%s, request=%s, response=%s, code=%d, ret=%d",
             client_id, url.c_str(), data.c_str(), res.c_str(), status_code, ret);
@@ -144,8 +218,8 @@ int SrsHttpHooks::on_publish(string url, SrsRequest* req)
         
     std::string data = ss.str();
     std::string res;
-    int status_code;
-    if ((ret = do_post(url, data, status_code, res)) != ERROR_SUCCESS) {
+    int status_code = 0;
+    if ((ret = do_post("on_publish", url, data, status_code, res)) != ERROR_SUCCESS) {
         srs_error("http post on_publish uri failed. "
             "client_id=%d, url=%s, request=%s, response=%s, code=%d, ret=%d",
             client_id, url.c_str(), data.c_str(), res.c_str(), status_code, ret);
@@ -177,8 +251,8 @@ void SrsHttpHooks::on_unpublish(string url, SrsRequest* req)
         
     std::string data = ss.str();
     std::string res;
-    int status_code;
-    if ((ret = do_post(url, data, status_code, res)) != ERROR_SUCCESS) {
+    int status_code = 0;
+    if ((ret = do_post("on_unpublish", url, data, status_code, res)) != ERROR_SUCCESS) {
         srs_warn("http post on_unpublish uri failed, ignored. "
             "client_id=%d, url=%s, request=%s, response=%s, code=%d, ret=%d",
             client_id, url.c_str(), data.c_str(), res.c_str(), status_code, ret);
@@ -198,6 +272,13 @@ int SrsHttpHooks::on_play(string url, SrsRequest* req)
     
     int client_id = _srs_context->get_id();
     
+    // use the cached decision of the same request.
+    std::string key = decision_key("on_play", url, req);
+    if (fetch_decision(req->vhost, key, ret)) {
+        srs_info("http hook on_play cached. client_id=%d, url=%s, ret=%d", client_id, url.c_str(), ret);
+        return ret;
+    }
+    
     std::stringstream ss;
     ss << SRS_JOBJECT_START
         << SRS_JFIELD_STR("action", "on_play") << SRS_JFIELD_CONT
@@ -211,8 +292,15 @@ int SrsHttpHooks::on_play(string url, SrsRequest* req)
         
     std::string data = ss.str();
     std::string res;
-    int status_code;
-    if ((ret = do_post(url, data, status_code, res)) != ERROR_SUCCESS) {
+    int status_code = 0;
+    ret = do_post("on_play", url, data, status_code, res);
+    
+    // cache the decision only when server allow or deny it.
+    if (is_decision(status_code, ret)) {
+        save_decision(req->vhost, key, ret);
+    }
+    
+    if (ret != ERROR_SUCCESS) {
         srs_error("http post on_play uri failed. "
             "client_id=%d, url=%s, request=%s, response=%s, code=%d, ret=%d",
             client_id, url.c_str(), data.c_str(), res.c_str(), status_code, ret);
@@ -244,8 +332,8 @@ void SrsHttpHooks::on_stop(string url, SrsRequest* req)
         
     std::string data = ss.str();
     std::string res;
-    int status_code;
-    if ((ret = do_post(url, data, status_code, res)) != ERROR_SUCCESS) {
+    int status_code = 0;
+    if ((ret = do_post("on_stop", url, data, status_code, res)) != ERROR_SUCCESS) {
         srs_warn("http post on_stop uri failed, ignored. "
             "client_id=%d, url=%s, request=%s, response=%s, code=%d, ret=%d",
             client_id, url.c_str(), data.c_str(), res.c_str(), status_code, ret);
@@ -280,8 +368,8 @@ int SrsHttpHooks::on_dvr(int cid, string url, SrsRequest* req, string file)
         
     std::string data = ss.str();
     std::string res;
-    int status_code;
-    if ((ret = do_post(url, data, status_code, res)) != ERROR_SUCCESS) {
+    int status_code = 0;
+    if ((ret = do_post("on_dvr", url, data, status_code, res)) != ERROR_SUCCESS) {
         srs_error("http post on_dvr uri failed, ignored. "
             "client_id=%d, url=%s, request=%s, response=%s, code=%d, ret=%d",
             client_id, url.c_str(), data.c_str(), res.c_str(), status_code, ret);
@@ -327,8 +415,8 @@ int SrsHttpHooks::on_hls(int cid, string url, SrsRequest* req, string file, stri
         
     std::string data = ss.str();
     std::string res;
-    int status_code;
-    if ((ret = do_post(url, data, status_code, res)) != ERROR_SUCCESS) {
+    int status_code = 0;
+    if ((ret = do_post("on_hls", url, data, status_code, res)) != ERROR_SUCCESS) {
         srs_error("http post on_hls uri failed, ignored. "
             "client_id=%d, url=%s, request=%s, response=%s, code=%d, ret=%d",
             client_id, url.c_str(), data.c_str(), res.c_str(), status_code, ret);
@@ -410,6 +498,25 @@ int SrsHttpHooks::on_hls_notify(int cid, std::string url, SrsRequest* req, std::
     return ret;
 }
 
+int SrsHttpHooks::do_post(std::string action, std::string url, std::string req, int& code, string& res)
+{
+    int ret = ERROR_SUCCESS;
+    
+    int64_t starttime = srs_update_system_time_ms();
+    ret = do_post(url, req, code, res);
+    
+    SrsHttpHookStat* stat = NULL;
+    std::map<std::string, SrsHttpHookStat*>::iterator it = stats.find(action);
+    if (it != stats.end()) {
+        stat = it->second;
+    } else {
+        stat = stats[action] = new SrsHttpHookStat();
+    }
+    stat->update(srs_update_system_time_ms() - starttime, ret);
+    
+    return ret;
+}
+
 int SrsHttpHooks::do_post(std::string url, std::string req, int& code, string& res)
 {
     int ret = ERROR_SUCCESS;
@@ -420,19 +527,32 @@ int SrsHttpHooks::do_post(std::string url, std::string req, int& code, string& r
         return ret;
     }
     
-    SrsHttpClient http;
-    if ((ret = http.initialize(uri.get_host(), uri.get_port())) != ERROR_SUCCESS) {
+    // use the keep-alive connection of pool.
+    SrsHttpClient* http = NULL;
+    if ((ret = _srs_http_client_pool->acquire(uri.get_host(), uri.get_port(), SRS_HTTP_CLIENT_TIMEOUT_US, &http)) != ERROR_SUCCESS) {
         return ret;
     }
     
+    // retry once for the keep-alive connection maybe closed by server.
+    bool reused = http->is_connected();
+    
     ISrsHttpMessage* msg = NULL;
-    if ((ret = http.post(uri.get_path(), req, &msg)) != ERROR_SUCCESS) {
-        return ret;
+    if ((ret = http->post(uri.get_path(), req, &msg)) != ERROR_SUCCESS && reused && http->can_retry()) {
+        srs_warn("http: post by keep-alive connection failed, retry. url=%s, ret=%d", url.c_str(), ret);
+        ret = http->post(uri.get_path(), req, &msg);
     }
-    SrsAutoFree(ISrsHttpMessage, msg);
     
-    code = msg->status_code();
-    if ((ret = msg->body_read_all(res)) != ERROR_SUCCESS) {
+    if (ret == ERROR_SUCCESS) {
+        code = msg->status_code();
+        ret = msg->body_read_all(res);
+    }
+    
+    // release the connection once the response is read.
+    bool reusable = (ret == ERROR_SUCCESS && msg->is_keep_alive());
+    srs_freep(msg);
+    _srs_http_client_pool->release(http, reusable);
+    
+    if (ret != ERROR_SUCCESS) {
         return ret;
     }
     
@@ -474,7 +594,7 @@ int SrsHttpHooks::do_post(std::string url, std::string req, int& code, string& r
     SrsJsonObject* res_info = info->to_object();
     SrsJsonAny* res_code = NULL;
     if ((res_code = res_info->ensure_property_integer("code")) == NULL) {
-        ret = ERROR_RESPONSE_CODE;
+        ret = ERROR_HTTP_DATA_INVALID;
         srs_error("invalid response without code, ret=%d", ret);
         return ret;
     }
@@ -488,4 +608,95 @@ int SrsHttpHooks::do_post(std::string url, std::string req, int& code, string& r
     return ret;
 }
 
+int SrsHttpHooks::dumps(std::stringstream& ss)
+{
+    int ret = ERROR_SUCCESS;
+    
+    ss << SRS_JOBJECT_START
+        << SRS_JFIELD_ORG("cached", decisions.size());
+    
+    std::map<std::string, SrsHttpHookStat*>::iterator it;
+    for (it = stats.begin(); it != stats.end(); ++it) {
+        ss << SRS_JFIELD_CONT << SRS_JFIELD_NAME(it->first);
+        if ((ret = it->second->dumps(ss)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    ss << SRS_JOBJECT_END;
+    
+    return ret;
+}
+
+string SrsHttpHooks::decision_key(string action, string url, SrsRequest* req)
+{
+    // the request without client_id, which is same for the clients of a page.
+    std::stringstream ss;
+    ss << action << " " << url << " " << req->ip << " " << req->vhost << " " << req->app
+        << " " << req->stream << " " << req->tcUrl << " " << req->pageUrl;
+    return ss.str();
+}
+
+bool SrsHttpHooks::fetch_decision(string vhost, string key, int& ret)
+{
+    if (_srs_config->get_vhost_http_hooks_cache_ttl(vhost) <= 0) {
+        return false;
+    }
+    
+    std::map<std::string, SrsHttpHookDecision>::iterator it = decisions.find(key);
+    if (it == decisions.end()) {
+        return false;
+    }
+    
+    SrsHttpHookDecision& decision = it->second;
+    if (decision.expire < srs_get_system_time_ms()) {
+        decisions.erase(it);
+        return false;
+    }
+    
+    ret = decision.ret;
+    return true;
+}
+
+void SrsHttpHooks::save_decision(string vhost, string key, int ret)
+{
+    int ttl = _srs_config->get_vhost_http_hooks_cache_ttl(vhost);
+    if (ttl <= 0) {
+        return;
+    }
+    
+    int64_t now = srs_get_system_time_ms();
+    
+    // remove the expired decisions when cache grows.
+    if ((int)decisions.size() >= SRS_HTTP_HOOK_MAX_DECISIONS) {
+        std::map<std::string, SrsHttpHookDecision>::iterator it;
+        for (it = decisions.begin(); it != decisions.end();) {
+            if (it->second.expire < now) {
+                decisions.erase(it++);
+            } else {
+                ++it;
+            }
+        }
+        
+        if ((int)decisions.size() >= SRS_HTTP_HOOK_MAX_DECISIONS) {
+            srs_warn("http hook decisions exceed %d, ignore.", SRS_HTTP_HOOK_MAX_DECISIONS);
+            return;
+        }
+    }
+    
+    SrsHttpHookDecision& decision = decisions[key];
+    decision.ret = ret;
+    decision.expire = now + ttl * 1000;
+}
+
+bool SrsHttpHooks::is_decision(int code, int ret)
+{
+    if (code != SRS_CONSTS_HTTP_OK) {
+        return false;
+    }
+    
+    // allowed, or denied by the code of response object.
+    return ret == ERROR_SUCCESS || ret == ERROR_RESPONSE_CODE;
+}
+
 #endif
@@ -30,17 +30,56 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <srs_core.hpp>
 
 #include <string>
+#include <map>
+#include <sstream>
 
 #ifdef SRS_AUTO_HTTP_CALLBACK
 
-#include <http_parser.h>
-
 class SrsHttpUri;
 class SrsStSocket;
 class SrsRequest;
 class SrsHttpParser;
 class SrsFlvSegment;
 
+// the buckets of hook latency histogram.
+#define SRS_HTTP_HOOK_NB_BUCKETS 8
+// the max decisions to cache.
+#define SRS_HTTP_HOOK_MAX_DECISIONS 10000
+
+/**
+* the decision of on_connect or on_play,
+* cached for the clients of the same request.
+*/
+class SrsHttpHookDecision
+{
+public:
+    // the ret of hook, ERROR_SUCCESS when allowed.
+    int ret;
+    // the time in ms to expire.
+    int64_t expire;
+};
+
+/**
+* the latency stat of a hook action.
+*/
+class SrsHttpHookStat
+{
+private:
+    int64_t nb_requests;
+    int64_t nb_errors;
+    int64_t total_ms;
+    int64_t max_ms;
+    // the histogram of latency, the limits in ms are:
+    //      5, 10, 50, 100, 500, 1000, 3000, more.
+    int64_t buckets[SRS_HTTP_HOOK_NB_BUCKETS];
+public:
+    SrsHttpHookStat();
+    virtual ~SrsHttpHookStat();
+public:
+    virtual void update(int64_t ms, int ret);
+    virtual int dumps(std::stringstream& ss);
+};
+
 /**
 * the http hooks, http callback api,
 * for some event, such as on_connect, call
@@ -119,8 +158,35 @@ public:
      * @param cid the source connection cid, for the on_dvr is async call.
      */
     static int on_hls_notify(int cid, std::string url, SrsRequest* req, std::string ts_url, int nb_notify);
-private:
+public:
+    /**
+    * dumps the latency stat of hooks to json.
+    */
+    static int dumps(std::stringstream& ss);
+protected:
+    /**
+    * post the request and update the latency stat of action.
+    */
+    static int do_post(std::string action, std::string url, std::string req, int& code, std::string& res);
     static int do_post(std::string url, std::string req, int& code, std::string& res);
+protected:
+    // the cached decisions, by decision_key().
+    static std::map<std::string, SrsHttpHookDecision> decisions;
+    // the latency stat, by action.
+    static std::map<std::string, SrsHttpHookStat*> stats;
+    /**
+    * the decisions is cached for vhost http_hooks.cache_ttl seconds,
+    * for the clients with same request, not include the client_id.
+    */
+    static std::string decision_key(std::string action, std::string url, SrsRequest* req);
+    static bool fetch_decision(std::string vhost, std::string key, int& ret);
+    static void save_decision(std::string vhost, std::string key, int ret);
+    /**
+    * whether the response of do_post is a decision of api server, that is,
+    * a 200 with valid body, the 5xx or malformed response is never cached,
+    * for the api server maybe recovered soon.
+    */
+    static bool is_decision(int code, int ret);
 };
 
 #endif
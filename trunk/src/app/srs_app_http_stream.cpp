@@ -25,12 +25,19 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #define SRS_STREAM_CACHE_CYCLE_SECONDS 30
 
+// the min and max chunks of shared ts remux to keep for slow viewers.
+#define SRS_TS_CHUNKS_MIN 16
+#define SRS_TS_CHUNKS_MAX 1024
+// the min size of the block to write ts chunk.
+#define SRS_TS_CHUNK_BLOCK_SIZE (16 * 1024)
+
 #if defined(SRS_AUTO_HTTP_CORE)
 
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <sstream>
 using namespace std;
@@ -51,9 +58,14 @@ using namespace std;
 #include <srs_kernel_aac.hpp>
 #include <srs_kernel_mp3.hpp>
 #include <srs_kernel_ts.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_codec.hpp>
+#include <srs_kernel_pool.hpp>
 #include <srs_app_pithy_print.hpp>
 #include <srs_app_source.hpp>
 #include <srs_app_server.hpp>
+#include <srs_app_worker.hpp>
+#include <srs_app_hls.hpp>
 
 #endif
 
@@ -135,7 +147,7 @@ int SrsStreamCache::cycle()
         pprint->elapse();
 
         // get messages from consumer.
-        // each msg in msgs.msgs must be free, for the SrsMessageArray never free them.
+        // each msg in msgs.msgs is owned by consumer, which is released when dump next time.
         int count = 0;
         if ((ret = consumer->dump_packets(&msgs, count)) != ERROR_SUCCESS) {
             srs_error("http: get messages from consumer failed. ret=%d", ret);
@@ -156,16 +168,437 @@ int SrsStreamCache::cycle()
                 count, pprint->age(), SRS_PERF_MW_MIN_MSGS, SRS_CONSTS_RTMP_PULSE_TIMEOUT_US / 1000);
         }
     
-        // free the messages.
+        // cache the messages, copy it for the msgs is owned by consumer.
         for (int i = 0; i < count; i++) {
             SrsSharedPtrMessage* msg = msgs.msgs[i];
-            queue->enqueue(msg);
+            queue->enqueue(msg->copy());
+        }
+    }
+    
+    return ret;
+}
+
+SrsTsChunk::SrsTsChunk(int64_t seq, bool key, SrsSharedPtrMessage* msg)
+{
+    sequence = seq;
+    is_key = key;
+    packets = msg;
+}
+
+SrsTsChunk::~SrsTsChunk()
+{
+    srs_freep(packets);
+}
+
+SrsTsChunkWriter::SrsTsChunkWriter()
+{
+    block = NULL;
+    nb_block = 0;
+    block_size = SRS_TS_CHUNK_BLOCK_SIZE;
+}
+
+SrsTsChunkWriter::~SrsTsChunkWriter()
+{
+    srs_pool_freepa(block);
+}
+
+int SrsTsChunkWriter::open(string /*file*/)
+{
+    return ERROR_SUCCESS;
+}
+
+void SrsTsChunkWriter::close()
+{
+}
+
+bool SrsTsChunkWriter::is_open()
+{
+    return true;
+}
+
+int64_t SrsTsChunkWriter::tellg()
+{
+    return nb_block;
+}
+
+int SrsTsChunkWriter::write(void* buf, size_t count, ssize_t* pnwrite)
+{
+    if (count > 0) {
+        if (!block) {
+            block = srs_pool_alloc(block_size);
+            nb_block = 0;
+        }
+        
+        // grow the block when full, rarely for the size of last chunk.
+        if (nb_block + (int)count > block_size) {
+            while (nb_block + (int)count > block_size) {
+                block_size *= 2;
+            }
+            
+            char* p = srs_pool_alloc(block_size);
+            memcpy(p, block, nb_block);
+            srs_pool_freepa(block);
+            block = p;
+        }
+        
+        memcpy(block + nb_block, buf, count);
+        nb_block += (int)count;
+    }
+    
+    if (pnwrite) {
+        *pnwrite = count;
+    }
+    
+    return ERROR_SUCCESS;
+}
+
+SrsSharedPtrMessage* SrsTsChunkWriter::detach()
+{
+    int size = nb_block;
+    if (size <= 0) {
+        return NULL;
+    }
+    
+    char* payload = block;
+    block = NULL;
+    nb_block = 0;
+    block_size = srs_max(SRS_TS_CHUNK_BLOCK_SIZE, size);
+    
+    // the shared message own the block, never fail.
+    SrsMessageHeader header;
+    SrsSharedPtrMessage* msg = new SrsSharedPtrMessage();
+    if (msg->create(&header, payload, size) != ERROR_SUCCESS) {
+        srs_freep(msg);
+        srs_pool_freepa(payload);
+        return NULL;
+    }
+    
+    return msg;
+}
+
+SrsTsStreamCache::SrsTsStreamCache(SrsSource* s, SrsRequest* r)
+{
+    req = r->copy();
+    source = s;
+    pthread = new SrsReusableThread2("http-ts-stream", this, SRS_CONSTS_RTMP_PULSE_TIMEOUT_US);
+    
+    realtime = false;
+    mw_sleep = SRS_PERF_MW_SLEEP;
+    mw_msgs = 0;
+    
+    nb_viewers = 0;
+    next_sequence = 0;
+    last_key_sequence = -1;
+    prev_key_sequence = -1;
+    wait_chunks = st_cond_new();
+    
+    enc = NULL;
+    writer = NULL;
+    writing_key = false;
+    has_video = false;
+}
+
+SrsTsStreamCache::~SrsTsStreamCache()
+{
+    srs_freep(pthread);
+    
+    clear_chunks();
+    srs_freep(enc);
+    srs_freep(writer);
+    
+    st_cond_destroy(wait_chunks);
+    srs_freep(req);
+}
+
+int SrsTsStreamCache::start()
+{
+    return pthread->start();
+}
+
+void SrsTsStreamCache::stop()
+{
+    pthread->stop();
+    
+    // cleanup the remux, for the thread maybe interrupted in the middle.
+    clear_chunks();
+    srs_freep(enc);
+    srs_freep(writer);
+    
+    st_cond_broadcast(wait_chunks);
+}
+
+void SrsTsStreamCache::attach()
+{
+    nb_viewers++;
+}
+
+void SrsTsStreamCache::detach()
+{
+    nb_viewers--;
+}
+
+void SrsTsStreamCache::wait(int64_t cursor, int64_t timeout)
+{
+    // there are chunks to consume.
+    if (cursor >= 0 && cursor < next_sequence) {
+        return;
+    }
+    
+    // the new viewer start from the keyframe.
+    if (cursor < 0 && last_key_sequence >= 0) {
+        return;
+    }
+    
+    st_cond_timedwait(wait_chunks, timeout);
+}
+
+int SrsTsStreamCache::dump_chunks(int64_t& cursor, SrsMessageArray* msgs, int& count)
+{
+    int ret = ERROR_SUCCESS;
+    
+    count = 0;
+    if (chunks.empty()) {
+        // the remux restarted, start from the next keyframe.
+        if (cursor >= 0 && cursor < next_sequence) {
+            cursor = -1;
         }
+        return ret;
+    }
+    
+    // start from the last keyframe for new viewer,
+    // and jump to the last keyframe when the viewer is too slow.
+    int64_t first = chunks.front()->sequence;
+    if (cursor < first) {
+        if (cursor >= 0) {
+            srs_warn("http: ts viewer too slow, jump from %"PRId64" to keyframe %"PRId64, cursor, last_key_sequence);
+        }
+        
+        cursor = last_key_sequence;
+        if (cursor < 0) {
+            return ret;
+        }
+    }
+    
+    for (int i = (int)(cursor - first); i < (int)chunks.size() && count < msgs->max; i++) {
+        SrsTsChunk* chunk = chunks.at(i);
+        msgs->msgs[count++] = chunk->packets->copy();
+        cursor = chunk->sequence + 1;
     }
     
     return ret;
 }
 
+int SrsTsStreamCache::cycle()
+{
+    int ret = ERROR_SUCCESS;
+    
+    // only remux when there are viewers.
+    if (nb_viewers <= 0) {
+        return ret;
+    }
+    
+    // the ts cache will create consumer to remux stream,
+    // which will trigger to fetch stream from origin for edge.
+    SrsConsumer* consumer = NULL;
+    if ((ret = source->create_consumer(NULL, consumer, true, true, true)) != ERROR_SUCCESS) {
+        srs_error("http: create ts consumer failed. ret=%d", ret);
+        return ret;
+    }
+    SrsAutoFree(SrsConsumer, consumer);
+    
+    ret = do_cycle(consumer);
+    
+    // cleanup the remux, restart when viewers come again.
+    clear_chunks();
+    srs_freep(enc);
+    srs_freep(writer);
+    
+    return ret;
+}
+
+int SrsTsStreamCache::on_reload_vhost_http_remux_updated(string vhost)
+{
+    return on_reload_vhost_mw(vhost);
+}
+
+int SrsTsStreamCache::on_reload_vhost_mw(string vhost)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (req->vhost != vhost) {
+        return ret;
+    }
+    
+    update_mw();
+    srs_trace("http: reload ts remux mw_sleep=%d, mw_msgs=%d, realtime=%d", mw_sleep, mw_msgs, realtime);
+    
+    return ret;
+}
+
+int SrsTsStreamCache::on_reload_vhost_realtime(string vhost)
+{
+    return on_reload_vhost_mw(vhost);
+}
+
+void SrsTsStreamCache::update_mw()
+{
+    // use the mw config of http remux, the chunk is sent to viewers in a time.
+    realtime = _srs_config->get_realtime_enabled(req->vhost);
+    mw_sleep = _srs_config->get_vhost_http_remux_mw_sleep_ms(req->vhost);
+    mw_msgs = _srs_config->get_vhost_http_remux_mw_msgs(req->vhost, realtime);
+}
+
+int SrsTsStreamCache::do_cycle(SrsConsumer* consumer)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_freep(enc);
+    srs_freep(writer);
+    enc = new SrsTsEncoder();
+    writer = new SrsTsChunkWriter();
+    writing_key = false;
+    has_video = false;
+    
+    if ((ret = enc->initialize(writer)) != ERROR_SUCCESS) {
+        srs_error("http: initialize ts encoder failed. ret=%d", ret);
+        return ret;
+    }
+    
+    SrsPithyPrint* pprint = SrsPithyPrint::create_http_stream_cache();
+    SrsAutoFree(SrsPithyPrint, pprint);
+    
+    SrsMessageArray msgs(SRS_PERF_MW_MSGS);
+    
+    update_mw();
+    srs_info("http: start ts remux mw_sleep=%d, mw_msgs=%d, realtime=%d", mw_sleep, mw_msgs, realtime);
+    
+    while (nb_viewers > 0 && !pthread->interrupted()) {
+        pprint->elapse();
+        
+#ifdef SRS_PERF_QUEUE_COND_WAIT
+        // wait for message to incoming.
+        consumer->wait(mw_msgs, mw_sleep, SRS_CONSTS_RTMP_PULSE_TIMEOUT_US);
+#endif
+        
+        // get messages from consumer.
+        // each msg in msgs.msgs is owned by consumer, which is released when dump next time.
+        int count = 0;
+        if ((ret = consumer->dump_packets(&msgs, count)) != ERROR_SUCCESS) {
+            srs_error("http: get messages from ts consumer failed. ret=%d", ret);
+            return ret;
+        }
+        
+        if (count <= 0) {
+#ifndef SRS_PERF_QUEUE_COND_WAIT
+            st_usleep(SRS_CONSTS_RTMP_PULSE_TIMEOUT_US);
+#endif
+            continue;
+        }
+        
+        if (pprint->can_print()) {
+            srs_trace("-> "SRS_CONSTS_LOG_HTTP_STREAM_CACHE" http: ts remux %d msgs, viewers=%d, chunks=%d, age=%d, min=%d, mw=%d", 
+                count, nb_viewers, (int)chunks.size(), pprint->age(), mw_msgs, mw_sleep);
+        }
+        
+        for (int i = 0; i < count && ret == ERROR_SUCCESS; i++) {
+            ret = write_message(msgs.msgs[i]);
+        }
+        
+        if (ret != ERROR_SUCCESS) {
+            srs_error("http: ts remux messages failed. ret=%d", ret);
+            return ret;
+        }
+        
+        // publish the packets of this batch to viewers.
+        flush_chunk();
+    }
+    
+    return ret;
+}
+
+int SrsTsStreamCache::write_message(SrsSharedPtrMessage* msg)
+{
+    if (msg->is_audio()) {
+        // for pure audio stream, each chunk starts with PAT/PMT.
+        if (!has_video && writer->tellg() == 0) {
+            enc->reset_pat_pmt();
+            writing_key = true;
+        }
+        return enc->write_audio(msg->timestamp, msg->payload, msg->size);
+    }
+    
+    if (msg->is_video()) {
+        has_video = true;
+        
+        // the keyframe starts a new chunk with PAT/PMT,
+        // so the viewer can decode from any key chunk.
+        if (SrsFlvCodec::video_is_keyframe(msg->payload, msg->size)
+            && !SrsFlvCodec::video_is_sequence_header(msg->payload, msg->size)
+        ) {
+            flush_chunk();
+            enc->reset_pat_pmt();
+            writing_key = true;
+        }
+        return enc->write_video(msg->timestamp, msg->payload, msg->size);
+    }
+    
+    // ignore the metadata for ts.
+    return ERROR_SUCCESS;
+}
+
+void SrsTsStreamCache::flush_chunk()
+{
+    bool is_key = writing_key;
+    writing_key = false;
+    
+    SrsSharedPtrMessage* packets = writer->detach();
+    if (!packets) {
+        return;
+    }
+    
+    int64_t sequence = next_sequence++;
+    chunks.push_back(new SrsTsChunk(sequence, is_key, packets));
+    
+    if (is_key) {
+        prev_key_sequence = last_key_sequence;
+        last_key_sequence = sequence;
+    }
+    
+    // remove the chunks before the previous keyframe, keep some chunks for slow viewers,
+    // and never keep too many chunks when the gop is too large.
+    while ((int)chunks.size() > SRS_TS_CHUNKS_MIN) {
+        SrsTsChunk* chunk = chunks.front();
+        
+        bool expired = chunk->sequence < prev_key_sequence;
+        bool overflow = (int)chunks.size() > SRS_TS_CHUNKS_MAX
+            && (last_key_sequence < 0 || chunk->sequence < last_key_sequence);
+        if (!expired && !overflow) {
+            break;
+        }
+        
+        srs_freep(chunk);
+        chunks.erase(chunks.begin());
+    }
+    
+    st_cond_broadcast(wait_chunks);
+}
+
+void SrsTsStreamCache::clear_chunks()
+{
+    std::vector<SrsTsChunk*>::iterator it;
+    for (it = chunks.begin(); it != chunks.end(); ++it) {
+        SrsTsChunk* chunk = *it;
+        srs_freep(chunk);
+    }
+    chunks.clear();
+    
+    last_key_sequence = -1;
+    prev_key_sequence = -1;
+    
+    // skip a sequence, so the viewers of the cleared chunks restart from keyframe.
+    next_sequence++;
+}
+
 ISrsStreamEncoder::ISrsStreamEncoder()
 {
 }
@@ -439,11 +872,16 @@ int SrsStreamWriter::writev(iovec* iov, int iovcnt, ssize_t* pnwrite)
     return writer->writev(iov, iovcnt, pnwrite);
 }
 
-SrsLiveStream::SrsLiveStream(SrsSource* s, SrsRequest* r, SrsStreamCache* c)
+SrsLiveStream::SrsLiveStream(SrsSource* s, SrsRequest* r, SrsStreamCache* c, SrsTsStreamCache* tc)
 {
     source = s;
     cache = c;
+    ts_cache = tc;
     req = r->copy();
+    
+    realtime = false;
+    mw_sleep = SRS_PERF_MW_SLEEP;
+    mw_msgs = 0;
 }
 
 SrsLiveStream::~SrsLiveStream()
@@ -473,6 +911,10 @@ int SrsLiveStream::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
         enc = new SrsMp3StreamEncoder();
     } else if (srs_string_ends_with(entry->pattern, ".ts")) {
         w->header()->set_content_type("video/MP2T");
+        // all viewers share the ts remux of source.
+        if (ts_cache) {
+            return serve_ts_chunks(w);
+        }
         enc = new SrsTsStreamEncoder();
     } else {
         ret = ERROR_HTTP_LIVE_STREAM_EXT;
@@ -514,12 +956,24 @@ int SrsLiveStream::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
     SrsFastFlvStreamEncoder* ffe = dynamic_cast<SrsFastFlvStreamEncoder*>(enc);
 #endif
 
+    // setup the mw config, wait for messages then send in a time like rtmp play.
+    // @see https://github.com/ossrs/srs/issues/251
+    update_mw();
+    srs_info("http: start stream mw_sleep=%d, mw_msgs=%d, realtime=%d", mw_sleep, mw_msgs, realtime);
+
     // TODO: free and erase the disabled entry after all related connections is closed.
     while (entry->enabled) {
         pprint->elapse();
 
+#ifdef SRS_PERF_QUEUE_COND_WAIT
+        // wait for message to incoming.
+        // @remark there is no recv thread to wakeup the consumer,
+        //       so use the timeout to check whether the entry is disabled.
+        consumer->wait(mw_msgs, mw_sleep, SRS_CONSTS_RTMP_PULSE_TIMEOUT_US);
+#endif
+
         // get messages from consumer.
-        // each msg in msgs.msgs must be free, for the SrsMessageArray never free them.
+        // each msg in msgs.msgs is owned by consumer, which is released when dump next time.
         int count = 0;
         if ((ret = consumer->dump_packets(&msgs, count)) != ERROR_SUCCESS) {
             srs_error("http: get messages from consumer failed. ret=%d", ret);
@@ -527,9 +981,13 @@ int SrsLiveStream::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
         }
         
         if (count <= 0) {
+#ifndef SRS_PERF_QUEUE_COND_WAIT
             srs_info("http: sleep %dms for no msg", SRS_CONSTS_RTMP_PULSE_TIMEOUT_US);
             // directly use sleep, donot use consumer wait.
             st_usleep(SRS_CONSTS_RTMP_PULSE_TIMEOUT_US);
+#else
+            srs_verbose("http: mw wait %dms and got nothing.", mw_sleep);
+#endif
             
             // ignore when nothing got.
             continue;
@@ -537,7 +995,7 @@ int SrsLiveStream::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
 
         if (pprint->can_print()) {
             srs_info("-> "SRS_CONSTS_LOG_HTTP_STREAM" http: got %d msgs, age=%d, min=%d, mw=%d", 
-                count, pprint->age(), SRS_PERF_MW_MIN_MSGS, SRS_CONSTS_RTMP_PULSE_TIMEOUT_US / 1000);
+                count, pprint->age(), mw_msgs, mw_sleep);
         }
         
         // sendout all messages.
@@ -550,12 +1008,6 @@ int SrsLiveStream::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
 #else
         ret = streaming_send_messages(enc, msgs.msgs, count);
 #endif
-    
-        // free the messages.
-        for (int i = 0; i < count; i++) {
-            SrsSharedPtrMessage* msg = msgs.msgs[i];
-            srs_freep(msg);
-        }
         
         // check send error code.
         if (ret != ERROR_SUCCESS) {
@@ -569,6 +1021,38 @@ int SrsLiveStream::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
     return ret;
 }
 
+int SrsLiveStream::on_reload_vhost_http_remux_updated(string vhost)
+{
+    return on_reload_vhost_mw(vhost);
+}
+
+int SrsLiveStream::on_reload_vhost_mw(string vhost)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (req->vhost != vhost) {
+        return ret;
+    }
+    
+    // the viewers apply the mw config in the next wait.
+    update_mw();
+    srs_trace("http: reload stream mw_sleep=%d, mw_msgs=%d, realtime=%d", mw_sleep, mw_msgs, realtime);
+    
+    return ret;
+}
+
+int SrsLiveStream::on_reload_vhost_realtime(string vhost)
+{
+    return on_reload_vhost_mw(vhost);
+}
+
+void SrsLiveStream::update_mw()
+{
+    realtime = _srs_config->get_realtime_enabled(req->vhost);
+    mw_sleep = _srs_config->get_vhost_http_remux_mw_sleep_ms(req->vhost);
+    mw_msgs = _srs_config->get_vhost_http_remux_mw_msgs(req->vhost, realtime);
+}
+
 int SrsLiveStream::streaming_send_messages(ISrsStreamEncoder* enc, SrsSharedPtrMessage** msgs, int nb_msgs)
 {
     int ret = ERROR_SUCCESS;
@@ -592,6 +1076,80 @@ int SrsLiveStream::streaming_send_messages(ISrsStreamEncoder* enc, SrsSharedPtrM
     return ret;
 }
 
+int SrsLiveStream::serve_ts_chunks(ISrsHttpResponseWriter* w)
+{
+    // the shared remux only works when there are viewers.
+    ts_cache->attach();
+    int ret = streaming_ts_chunks(w);
+    ts_cache->detach();
+    
+    return ret;
+}
+
+int SrsLiveStream::streaming_ts_chunks(ISrsHttpResponseWriter* w)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsPithyPrint* pprint = SrsPithyPrint::create_http_stream();
+    SrsAutoFree(SrsPithyPrint, pprint);
+    
+    SrsMessageArray msgs(SRS_PERF_MW_MSGS);
+    
+    iovec* iovs = new iovec[SRS_PERF_MW_MSGS];
+    SrsAutoFreeA(iovec, iovs);
+    
+    // start from the last keyframe.
+    int64_t cursor = -1;
+    
+    // TODO: free and erase the disabled entry after all related connections is closed.
+    while (entry->enabled) {
+        pprint->elapse();
+        
+        // wait for chunks, use timeout to check whether the entry is disabled.
+        ts_cache->wait(cursor, SRS_CONSTS_RTMP_PULSE_TIMEOUT_US);
+        
+        // each msg in msgs.msgs must be free, for the SrsMessageArray never free them.
+        int count = 0;
+        if ((ret = ts_cache->dump_chunks(cursor, &msgs, count)) != ERROR_SUCCESS) {
+            srs_error("http: get chunks from ts cache failed. ret=%d", ret);
+            return ret;
+        }
+        
+        if (count <= 0) {
+            continue;
+        }
+        
+        if (pprint->can_print()) {
+            srs_info("-> "SRS_CONSTS_LOG_HTTP_STREAM" http: got %d ts chunks, cursor=%"PRId64", age=%d", 
+                count, cursor, pprint->age());
+        }
+        
+        // sendout all chunks in a writev.
+        for (int i = 0; i < count; i++) {
+            SrsSharedPtrMessage* msg = msgs.msgs[i];
+            iovs[i].iov_base = msg->payload;
+            iovs[i].iov_len = msg->size;
+        }
+        ret = w->writev(iovs, count, NULL);
+        
+        // free the messages.
+        for (int i = 0; i < count; i++) {
+            SrsSharedPtrMessage* msg = msgs.msgs[i];
+            srs_freep(msg);
+        }
+        
+        // check send error code.
+        if (ret != ERROR_SUCCESS) {
+            if (!srs_is_client_gracefully_close(ret)) {
+                srs_error("http: send ts chunks to client failed. ret=%d", ret);
+            }
+            return ret;
+        }
+    }
+    
+    return ret;
+}
+
 SrsLiveEntry::SrsLiveEntry(std::string m, bool h)
 {
     mount = m;
@@ -599,6 +1157,7 @@ SrsLiveEntry::SrsLiveEntry(std::string m, bool h)
     
     stream = NULL;
     cache = NULL;
+    ts_cache = NULL;
 
     req = NULL;
     source = NULL;
@@ -673,14 +1232,17 @@ int SrsHlsM3u8Stream::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
 
 SrsHlsTsStream::SrsHlsTsStream()
 {
+    ts = NULL;
 }
 
 SrsHlsTsStream::~SrsHlsTsStream()
 {
+    srs_freep(ts);
 }
 
-void SrsHlsTsStream::set_ts(std::string v)
+void SrsHlsTsStream::set_ts(SrsHlsSharedBuffer* v)
 {
+    srs_freep(ts);
     ts = v;
 }
 
@@ -688,12 +1250,21 @@ int SrsHlsTsStream::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
 {
     int ret = ERROR_SUCCESS;
     
-    std::string data = ts;
+    // share the blocks, for the ts maybe removed when sending.
+    SrsHlsSharedBuffer* data = ts? ts->copy() : new SrsHlsSharedBuffer();
+    SrsAutoFree(SrsHlsSharedBuffer, data);
     
-    w->header()->set_content_length((int)data.length());
+    w->header()->set_content_length(data->length());
     w->header()->set_content_type("video/MP2T");
-
-    if ((ret = w->write((char*)data.data(), (int)data.length())) != ERROR_SUCCESS) {
+    
+    // each viewer writev its own iovs, for the writev maybe yield.
+    iovec* iovs = new iovec[srs_max(1, data->size())];
+    SrsAutoFreeA(iovec, iovs);
+    data->dump(iovs);
+    
+    // write header to send all blocks by writev with content length.
+    w->write_header(SRS_CONSTS_HTTP_OK);
+    if ((ret = w->writev(iovs, data->size(), NULL)) != ERROR_SUCCESS) {
         if (!srs_is_client_gracefully_close(ret)) {
             srs_error("send ts failed. ret=%d", ret);
         }
@@ -804,7 +1375,10 @@ int SrsHttpStreamServer::http_mount(SrsSource* s, SrsRequest* r)
         entry = new SrsLiveEntry(mount, tmpl->hstrs);
     
         entry->cache = new SrsStreamCache(s, r);
-        entry->stream = new SrsLiveStream(s, r, entry->cache);
+        if (entry->is_ts()) {
+            entry->ts_cache = new SrsTsStreamCache(s, r);
+        }
+        entry->stream = new SrsLiveStream(s, r, entry->cache, entry->ts_cache);
 
         // TODO: FIXME: maybe refine the logic of http remux service.
         // if user push streams followed:
@@ -833,9 +1407,21 @@ int SrsHttpStreamServer::http_mount(SrsSource* s, SrsRequest* r)
             srs_error("http: start stream cache failed. ret=%d", ret);
             return ret;
         }
+        
+        // start the shared ts remux thread.
+        if (entry->ts_cache && (ret = entry->ts_cache->start()) != ERROR_SUCCESS) {
+            srs_error("http: start ts stream cache failed. ret=%d", ret);
+            return ret;
+        }
         srs_trace("http: mount flv stream for vhost=%s, mount=%s", sid.c_str(), mount.c_str());
     } else {
         entry = sflvs[sid];
+        
+        // restart the shared ts remux, which is stopped when unmount.
+        if (entry->ts_cache && (ret = entry->ts_cache->start()) != ERROR_SUCCESS) {
+            srs_error("http: restart ts stream cache failed. ret=%d", ret);
+            return ret;
+        }
     }
 
     if (entry->stream) {
@@ -857,6 +1443,11 @@ void SrsHttpStreamServer::http_unmount(SrsSource* s, SrsRequest* r)
 
     SrsLiveEntry* entry = sflvs[sid];
     entry->stream->entry->enabled = false;
+    
+    // free the chunks of shared ts remux, never keep the stale stream.
+    if (entry->ts_cache) {
+        entry->ts_cache->stop();
+    }
 }
 
 int SrsHttpStreamServer::on_reload_vhost_added(string vhost)
@@ -928,6 +1519,11 @@ int SrsHttpStreamServer::on_reload_vhost_http_remux_updated(string vhost)
         // when start play this http flv stream.
     }
 
+    // apply the mw config to the streams, which keep serving the viewers.
+    if ((ret = notify_vhost_streams(vhost, &ISrsReloadHandler::on_reload_vhost_http_remux_updated)) != ERROR_SUCCESS) {
+        return ret;
+    }
+
     srs_trace("vhost %s http_remux reload success", vhost.c_str());
 
     return ret;
@@ -1015,7 +1611,7 @@ int SrsHttpStreamServer::hls_update_m3u8(SrsRequest* r, string m3u8)
     return ret;
 }
 
-int SrsHttpStreamServer::hls_update_ts(SrsRequest* r, string uri, string ts)
+int SrsHttpStreamServer::hls_update_ts(SrsRequest* r, string uri, SrsHlsSharedBuffer* ts)
 {
     int ret = ERROR_SUCCESS;
     
@@ -1052,7 +1648,7 @@ int SrsHttpStreamServer::hls_update_ts(SrsRequest* r, string uri, string ts)
     // update the ts stream.
     SrsHlsTsStream* hts = dynamic_cast<SrsHlsTsStream*>(entry->streams[mount]);
     if (hts) {
-        hts->set_ts(ts);
+        hts->set_ts(ts->copy());
     }
     srs_trace("hls update ts ok, mount=%s", mount.c_str());
 
@@ -1084,7 +1680,7 @@ int SrsHttpStreamServer::hls_remove_ts(SrsRequest* r, string uri)
     // update the ts stream.
     SrsHlsTsStream* hts = dynamic_cast<SrsHlsTsStream*>(entry->streams[mount]);
     if (hts) {
-        hts->set_ts("");
+        hts->set_ts(NULL);
         // TODO: FIXME: unmount and remove the http handler.
     }
     srs_trace("hls remove ts ok, mount=%s", mount.c_str());
@@ -1117,6 +1713,16 @@ int SrsHttpStreamServer::on_reload_vhost_hls(string vhost)
     return ret;
 }
 
+int SrsHttpStreamServer::on_reload_vhost_mw(string vhost)
+{
+    return notify_vhost_streams(vhost, &ISrsReloadHandler::on_reload_vhost_mw);
+}
+
+int SrsHttpStreamServer::on_reload_vhost_realtime(string vhost)
+{
+    return notify_vhost_streams(vhost, &ISrsReloadHandler::on_reload_vhost_realtime);
+}
+
 int SrsHttpStreamServer::hijack(ISrsHttpMessage* request, ISrsHttpHandler** ph)
 {
     int ret = ERROR_SUCCESS;
@@ -1148,15 +1754,7 @@ int SrsHttpStreamServer::hijack(ISrsHttpMessage* request, ISrsHttpHandler** ph)
             return ret;
         }
         
-        // hstrs not enabled, ignore.
-        // for origin, the http stream will be mount already when publish,
-        //      so it must never enter this line for stream already mounted.
-        // for edge, the http stream is trigger by hstrs and mount by it,
-        //      so we only hijack when only edge and hstrs is on.
         entry = it->second;
-        if (!entry->hstrs) {
-            return ret;
-        }
 
         // check entry and request extension.
         if (entry->is_flv()) {
@@ -1189,6 +1787,17 @@ int SrsHttpStreamServer::hijack(ISrsHttpMessage* request, ISrsHttpHandler** ph)
     SrsAutoFree(SrsRequest, r);
 
     std::string sid = r->get_stream_url();
+    
+    // hstrs not enabled, ignore.
+    // for origin, the http stream will be mount already when publish,
+    //      so it must never enter this line for stream already mounted.
+    // for edge, the http stream is trigger by hstrs and mount by it,
+    //      so we only hijack when only edge and hstrs is on.
+    // for workers, the stream published to other worker is relayed like edge.
+    if (!entry->hstrs && _srs_workers->find_publisher(sid) < 0) {
+        return ret;
+    }
+    
     // check whether the http remux is enabled,
     // for example, user disable the http flv then reload.
     if (sflvs.find(sid) != sflvs.end()) {
@@ -1330,5 +1939,28 @@ string SrsHttpStreamServer::hls_mount_generate(SrsRequest* r, string uri, string
     return mount;
 }
 
+int SrsHttpStreamServer::notify_vhost_streams(string vhost, int (ISrsReloadHandler::*notify)(string))
+{
+    int ret = ERROR_SUCCESS;
+    
+    // the stream and ts remux ignore the event of other vhosts.
+    std::map<std::string, SrsLiveEntry*>::iterator it;
+    for (it = sflvs.begin(); it != sflvs.end(); ++it) {
+        SrsLiveEntry* entry = it->second;
+        
+        if (entry->stream && (ret = (entry->stream->*notify)(vhost)) != ERROR_SUCCESS) {
+            srs_error("http: vhost %s notify stream %s failed. ret=%d", vhost.c_str(), it->first.c_str(), ret);
+            return ret;
+        }
+        
+        if (entry->ts_cache && (ret = (entry->ts_cache->*notify)(vhost)) != ERROR_SUCCESS) {
+            srs_error("http: vhost %s notify ts remux %s failed. ret=%d", vhost.c_str(), it->first.c_str(), ret);
+            return ret;
+        }
+    }
+    
+    return ret;
+}
+
 #endif
 
@@ -34,6 +34,10 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #ifdef SRS_AUTO_HTTP_SERVER
 
+class SrsSimpleBuffer;
+class SrsMessageArray;
+class SrsHlsSharedBuffer;
+
 /**
 * for the srs http stream cache, 
 * for example, the audio stream cache to make android(weixin) happy.
@@ -59,6 +63,133 @@ public:
     virtual int cycle();
 };
 
+/**
+* the chunk of shared ts stream, a batch of 188 bytes ts packets.
+* the key chunk starts with PAT/PMT and a keyframe, viewer can start from it.
+*/
+class SrsTsChunk
+{
+public:
+    // the sequence of chunk, increase one by one.
+    int64_t sequence;
+    // whether the chunk starts with PAT/PMT and keyframe.
+    bool is_key;
+    // the ts packets, shared by all viewers.
+    SrsSharedPtrMessage* packets;
+public:
+    SrsTsChunk(int64_t seq, bool key, SrsSharedPtrMessage* msg);
+    virtual ~SrsTsChunk();
+};
+
+/**
+* write ts packets to the current chunk in memory.
+* @remark the block is handed over to the shared message when detach,
+*       so the chunk is never copied, and shared by refcount.
+*/
+class SrsTsChunkWriter : public SrsFileWriter
+{
+private:
+    // the block in writing, alloc from memory pool.
+    char* block;
+    int nb_block;
+    // the size of block, grow when full,
+    // and the next block use the size of last chunk.
+    int block_size;
+public:
+    SrsTsChunkWriter();
+    virtual ~SrsTsChunkWriter();
+public:
+    virtual int open(std::string file);
+    virtual void close();
+public:
+    virtual bool is_open();
+    virtual int64_t tellg();
+public:
+    virtual int write(void* buf, size_t count, ssize_t* pnwrite);
+public:
+    /**
+    * detach the written ts packets to a shared message, then reset the writer.
+    * @return the shared ts packets, NULL when nothing written.
+    */
+    virtual SrsSharedPtrMessage* detach();
+};
+
+/**
+* the shared ts remux of a source for http ts stream,
+* remux the rtmp stream to ts chunks once for all viewers,
+* which consume the refcounted chunks by a cursor.
+* @remark the remux only works when there are viewers.
+*/
+class SrsTsStreamCache : public ISrsReusableThread2Handler, virtual public ISrsReloadHandler
+{
+private:
+    SrsSource* source;
+    SrsRequest* req;
+    SrsReusableThread2* pthread;
+protected:
+    // the mw config of http remux, updated when reload.
+    bool realtime;
+    int mw_sleep;
+    int mw_msgs;
+protected:
+    int nb_viewers;
+    // the chunks from the last two keyframes.
+    std::vector<SrsTsChunk*> chunks;
+    int64_t next_sequence;
+    int64_t last_key_sequence;
+    int64_t prev_key_sequence;
+    // the viewers wait on this cond for new chunks.
+    st_cond_t wait_chunks;
+protected:
+    SrsTsEncoder* enc;
+    SrsTsChunkWriter* writer;
+    // whether the chunk in writer starts with PAT/PMT and keyframe.
+    bool writing_key;
+    bool has_video;
+public:
+    SrsTsStreamCache(SrsSource* s, SrsRequest* r);
+    virtual ~SrsTsStreamCache();
+public:
+    virtual int start();
+    /**
+    * stop the remux and free the chunks when unmount,
+    * the viewers start from the keyframe when mount again.
+    */
+    virtual void stop();
+    /**
+    * the viewer attach to cache before consume chunks, detach when quit.
+    */
+    virtual void attach();
+    virtual void detach();
+    /**
+    * wait for chunks after cursor.
+    * @param cursor the sequence of next chunk to consume, -1 to start from keyframe.
+    * @param timeout the max time in us to wait.
+    */
+    virtual void wait(int64_t cursor, int64_t timeout);
+    /**
+    * dump the chunks after cursor to msgs, user must free the msgs.
+    * @param cursor the sequence of next chunk to consume, -1 to start from keyframe.
+    *       the cursor jump to the last keyframe when the viewer is too slow.
+    * @param count the count of dumped msgs.
+    */
+    virtual int dump_chunks(int64_t& cursor, SrsMessageArray* msgs, int& count);
+// interface ISrsReusableThread2Handler.
+public:
+    virtual int cycle();
+// interface ISrsReloadHandler, notified by SrsHttpStreamServer.
+public:
+    virtual int on_reload_vhost_http_remux_updated(std::string vhost);
+    virtual int on_reload_vhost_mw(std::string vhost);
+    virtual int on_reload_vhost_realtime(std::string vhost);
+protected:
+    virtual void update_mw();
+    virtual int do_cycle(SrsConsumer* consumer);
+    virtual int write_message(SrsSharedPtrMessage* msg);
+    virtual void flush_chunk();
+    virtual void clear_chunks();
+};
+
 /**
 * the stream encoder in some codec, for example, flv or aac.
 */
@@ -218,19 +349,37 @@ public:
 * the flv live stream supports access rtmp in flv over http.
 * srs will remux rtmp to flv streaming.
 */
-class SrsLiveStream : public ISrsHttpHandler
+class SrsLiveStream : public ISrsHttpHandler, virtual public ISrsReloadHandler
 {
 private:
     SrsRequest* req;
     SrsSource* source;
     SrsStreamCache* cache;
+    SrsTsStreamCache* ts_cache;
+protected:
+    // the mw config of http remux, shared by all viewers and updated when reload.
+    bool realtime;
+    int mw_sleep;
+    int mw_msgs;
 public:
-    SrsLiveStream(SrsSource* s, SrsRequest* r, SrsStreamCache* c);
+    SrsLiveStream(SrsSource* s, SrsRequest* r, SrsStreamCache* c, SrsTsStreamCache* tc);
     virtual ~SrsLiveStream();
 public:
     virtual int serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+// interface ISrsReloadHandler, notified by SrsHttpStreamServer.
+public:
+    virtual int on_reload_vhost_http_remux_updated(std::string vhost);
+    virtual int on_reload_vhost_mw(std::string vhost);
+    virtual int on_reload_vhost_realtime(std::string vhost);
+protected:
+    virtual void update_mw();
 private:
     virtual int streaming_send_messages(ISrsStreamEncoder* enc, SrsSharedPtrMessage** msgs, int nb_msgs);
+    /**
+    * serve the ts stream from the shared ts remux.
+    */
+    virtual int serve_ts_chunks(ISrsHttpResponseWriter* w);
+    virtual int streaming_ts_chunks(ISrsHttpResponseWriter* w);
 };
 
 /**
@@ -255,6 +404,8 @@ public:
     
     SrsLiveStream* stream;
     SrsStreamCache* cache;
+    // the shared ts remux, only for ts stream.
+    SrsTsStreamCache* ts_cache;
     
     SrsLiveEntry(std::string m, bool h);
     void reset_hstrs(bool h);
@@ -287,12 +438,15 @@ public:
 class SrsHlsTsStream : public ISrsHttpHandler
 {
 private:
-    std::string ts;
+    SrsHlsSharedBuffer* ts;
 public:
     SrsHlsTsStream();
     virtual ~SrsHlsTsStream();
 public:
-    virtual void set_ts(std::string v);
+    /**
+    * set the ts to serve, the stream own the ts, NULL to remove it.
+    */
+    virtual void set_ts(SrsHlsSharedBuffer* v);
 public:
     virtual int serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
 };
@@ -349,7 +503,7 @@ public:
 public:
     virtual int mount_hls(SrsRequest* r);
     virtual int hls_update_m3u8(SrsRequest* r, std::string m3u8);
-    virtual int hls_update_ts(SrsRequest* r, std::string uri, std::string ts);
+    virtual int hls_update_ts(SrsRequest* r, std::string uri, SrsHlsSharedBuffer* ts);
     virtual int hls_remove_ts(SrsRequest* r, std::string uri);
     virtual void unmount_hls(SrsRequest* r);
 // interface ISrsReloadHandler.
@@ -357,6 +511,8 @@ public:
     virtual int on_reload_vhost_added(std::string vhost);
     virtual int on_reload_vhost_http_remux_updated(std::string vhost);
     virtual int on_reload_vhost_hls(std::string vhost);
+    virtual int on_reload_vhost_mw(std::string vhost);
+    virtual int on_reload_vhost_realtime(std::string vhost);
 // interface ISrsHttpMatchHijacker
 public:
     virtual int hijack(ISrsHttpMessage* request, ISrsHttpHandler** ph);
@@ -365,6 +521,10 @@ private:
     virtual int initialize_flv_entry(std::string vhost);
     virtual int initialize_hls_streaming();
     virtual std::string hls_mount_generate(SrsRequest* r, std::string uri, std::string tmpl);
+    /**
+    * notify the streams and ts remux of vhost to apply the mw config.
+    */
+    virtual int notify_vhost_streams(std::string vhost, int (ISrsReloadHandler::*notify)(std::string));
 };
 
 #endif
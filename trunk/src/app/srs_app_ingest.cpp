@@ -35,6 +35,7 @@ using namespace std;
 #include <srs_app_pithy_print.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_app_utility.hpp>
+#include <srs_app_ingest_hls.hpp>
 
 // when error, ingester sleep for a while and retry.
 // ingest never sleep a long time, for we must start the stream ASAP.
@@ -166,6 +167,11 @@ int SrsIngester::parse_engines(SrsConfDirective* vhost, SrsConfDirective* ingest
         return ret;
     }
     
+    // the hls is ingested in process, without ffmpeg.
+    if (srs_config_ingest_is_hls(_srs_config->get_ingest_input_type(ingest))) {
+        return parse_hls(vhost, ingest);
+    }
+    
     std::string ffmpeg_bin = _srs_config->get_ingest_ffmpeg(ingest);
     if (ffmpeg_bin.empty()) {
         ret = ERROR_ENCODER_PARSE;
@@ -222,6 +228,62 @@ int SrsIngester::parse_engines(SrsConfDirective* vhost, SrsConfDirective* ingest
     return ret;
 }
 
+int SrsIngester::parse_hls(SrsConfDirective* vhost, SrsConfDirective* ingest)
+{
+    int ret = ERROR_SUCCESS;
+    
+#ifdef SRS_AUTO_HTTP_CORE
+    std::string input_url = _srs_config->get_ingest_input_url(ingest);
+    if (input_url.empty()) {
+        ret = ERROR_ENCODER_NO_INPUT;
+        srs_trace("empty intput url, ingest=%s. ret=%d", ingest->arg0().c_str(), ret);
+        return ret;
+    }
+    
+    std::string port;
+    if (true) {
+        std::vector<std::string> ip_ports = _srs_config->get_listens();
+        srs_assert(ip_ports.size() > 0);
+        
+        std::string ep = ip_ports[0];
+        std::string ip;
+        srs_parse_endpoint(ep, ip, port);
+    }
+    
+    // the engine is only used for the output, never transcode.
+    std::vector<SrsConfDirective*> engines = _srs_config->get_transcode_engines(ingest);
+    SrsConfDirective* engine = engines.empty()? NULL : engines.at(0);
+    
+    std::string output = _srs_config->get_engine_output(engine);
+    output = srs_string_replace(output, "[vhost]", vhost->arg0());
+    output = srs_string_replace(output, "[port]", port);
+    if (output.empty()) {
+        ret = ERROR_ENCODER_NO_OUTPUT;
+        srs_trace("empty output url, ingest=%s. ret=%d", ingest->arg0().c_str(), ret);
+        return ret;
+    }
+    
+    int prefetch = _srs_config->get_ingest_hls_prefetch(ingest);
+    int jitter = _srs_config->get_ingest_hls_jitter(ingest);
+    
+    SrsIngestHls* puller = new SrsIngestHls();
+    if ((ret = puller->initialize(vhost->arg0(), ingest->arg0(), input_url, output, prefetch, jitter)) != ERROR_SUCCESS) {
+        srs_freep(puller);
+        return ret;
+    }
+    
+    pullers.push_back(puller);
+    
+    srs_trace("parse success, hls ingest=%s, vhost=%s", 
+        ingest->arg0().c_str(), vhost->arg0().c_str());
+#else
+    ret = ERROR_ENCODER_INPUT_TYPE;
+    srs_error("hls ingest requires http core, ingest=%s. ret=%d", ingest->arg0().c_str(), ret);
+#endif
+    
+    return ret;
+}
+
 void SrsIngester::dispose()
 {
     // first, use fast stop to notice all FFMPEG to quit gracefully.
@@ -249,6 +311,18 @@ int SrsIngester::cycle()
 {
     int ret = ERROR_SUCCESS;
     
+#ifdef SRS_AUTO_HTTP_CORE
+    // start all hls ingesters, which retry by themselves.
+    std::vector<SrsIngestHls*>::iterator hit;
+    for (hit = pullers.begin(); hit != pullers.end(); ++hit) {
+        SrsIngestHls* puller = *hit;
+        if ((ret = puller->start()) != ERROR_SUCCESS) {
+            srs_error("ingest hls start failed. ret=%d", ret);
+            return ret;
+        }
+    }
+#endif
+    
     std::vector<SrsIngesterFFMPEG*>::iterator it;
     for (it = ingesters.begin(); it != ingesters.end(); ++it) {
         SrsIngesterFFMPEG* ingester = *it;
@@ -286,6 +360,8 @@ void SrsIngester::clear_engines()
     }
 
     ingesters.clear();
+    
+    remove_pullers("", "");
 }
 
 int SrsIngester::parse()
@@ -446,6 +522,30 @@ void SrsIngester::show_ingest_log_message()
     }
 }
 
+void SrsIngester::remove_pullers(string vhost, string ingest_id)
+{
+#ifdef SRS_AUTO_HTTP_CORE
+    std::vector<SrsIngestHls*>::iterator it;
+    
+    for (it = pullers.begin(); it != pullers.end();) {
+        SrsIngestHls* puller = *it;
+        
+        // empty vhost to remove all, empty id to remove all of vhost.
+        if ((!vhost.empty() && !puller->equals(vhost)) || (!ingest_id.empty() && !puller->equals(vhost, ingest_id))) {
+            ++it;
+            continue;
+        }
+        
+        // stop the ingester and unpublish the source.
+        puller->stop();
+        srs_trace("stop hls ingester %s", puller->uri().c_str());
+        
+        srs_freep(puller);
+        it = pullers.erase(it);
+    }
+#endif
+}
+
 int SrsIngester::on_reload_vhost_added(string vhost)
 {
     int ret = ERROR_SUCCESS;
@@ -484,6 +584,8 @@ int SrsIngester::on_reload_vhost_removed(string vhost)
         // remove the item from ingesters.
         it = ingesters.erase(it);
     }
+    
+    remove_pullers(vhost, "");
 
     return ret;
 }
@@ -513,6 +615,8 @@ int SrsIngester::on_reload_ingest_removed(string vhost, string ingest_id)
         it = ingesters.erase(it);
     }
     
+    remove_pullers(vhost, ingest_id);
+    
     return ret;
 }
 
@@ -39,6 +39,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 class SrsFFMPEG;
 class SrsConfDirective;
 class SrsPithyPrint;
+class SrsIngestHls;
 
 /**
 * ingester ffmpeg object.
@@ -78,6 +79,8 @@ class SrsIngester : public ISrsReusableThreadHandler, public ISrsReloadHandler
 {
 private:
     std::vector<SrsIngesterFFMPEG*> ingesters;
+    // the hls ingesters pull and feed the source in process.
+    std::vector<SrsIngestHls*> pullers;
 private:
     SrsReusableThread* pthread;
     SrsPithyPrint* pprint;
@@ -98,8 +101,10 @@ private:
     virtual int parse();
     virtual int parse_ingesters(SrsConfDirective* vhost);
     virtual int parse_engines(SrsConfDirective* vhost, SrsConfDirective* ingest);
+    virtual int parse_hls(SrsConfDirective* vhost, SrsConfDirective* ingest);
     virtual int initialize_ffmpeg(SrsFFMPEG* ffmpeg, SrsConfDirective* vhost, SrsConfDirective* ingest, SrsConfDirective* engine);
     virtual void show_ingest_log_message();
+    virtual void remove_pullers(std::string vhost, std::string ingest_id);
 // interface ISrsReloadHandler.
 public:
     virtual int on_reload_vhost_removed(std::string vhost);
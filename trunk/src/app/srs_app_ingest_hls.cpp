@@ -0,0 +1,853 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <srs_app_ingest_hls.hpp>
+
+#if defined(SRS_AUTO_INGEST) && defined(SRS_AUTO_HTTP_CORE)
+
+#include <stdlib.h>
+#include <sstream>
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_stream.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_rtmp_stack.hpp>
+#include <srs_rtmp_utility.hpp>
+#include <srs_raw_avc.hpp>
+#include <srs_http_stack.hpp>
+#include <srs_app_http_conn.hpp>
+#include <srs_app_http_client.hpp>
+#include <srs_app_publisher.hpp>
+#include <srs_app_pithy_print.hpp>
+#include <srs_app_utility.hpp>
+#include <srs_app_config.hpp>
+
+// when error, the ingester sleep for a while and retry.
+#define SRS_INGEST_HLS_RETRY_US (int64_t)(3*1000*1000LL)
+
+// the timeout to fetch the playlist or segment.
+#define SRS_INGEST_HLS_TIMEOUT_US (int64_t)(30*1000*1000LL)
+
+// the max time to wait for the prefetchers or the playlist.
+#define SRS_INGEST_HLS_WAIT_MS 1000
+
+// the min interval to refresh the playlist.
+#define SRS_INGEST_HLS_MIN_REFRESH_MS 500
+
+// the max consecutive failures to refresh the playlist, unpublish when exceed.
+#define SRS_INGEST_HLS_MAX_FAILURES 3
+
+string srs_ingest_hls_resolve(string base, string url)
+{
+    if (srs_string_is_http(url)) {
+        return url;
+    }
+    
+    // the absolute path, use the server of playlist.
+    if (srs_string_starts_with(url, "/")) {
+        SrsHttpUri uri;
+        if (uri.initialize(base) != ERROR_SUCCESS) {
+            return url;
+        }
+        
+        std::stringstream ss;
+        ss << uri.get_schema() << "://" << uri.get_host() << ":" << uri.get_port() << url;
+        return ss.str();
+    }
+    
+    // the relative path, ignore the query of playlist.
+    size_t pos = string::npos;
+    if ((pos = base.find("?")) != string::npos) {
+        base = base.substr(0, pos);
+    }
+    return srs_path_dirname(base) + "/" + url;
+}
+
+/**
+* get the body of url by the keep-alive http client of pool.
+*/
+static int srs_ingest_hls_get(string url, string& body)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsHttpUri uri;
+    if ((ret = uri.initialize(url)) != ERROR_SUCCESS) {
+        srs_error("ingest hls: invalid url=%s. ret=%d", url.c_str(), ret);
+        return ret;
+    }
+    
+    string path = uri.get_path();
+    if (strlen(uri.get_query()) > 0) {
+        path += "?";
+        path += uri.get_query();
+    }
+    
+    SrsHttpClient* http = NULL;
+    if ((ret = _srs_http_client_pool->acquire(uri.get_host(), uri.get_port(), SRS_INGEST_HLS_TIMEOUT_US, &http)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // retry once for the keep-alive connection maybe closed by server.
+    bool reused = http->is_connected();
+    
+    ISrsHttpMessage* msg = NULL;
+    if ((ret = http->get(path, "", &msg)) != ERROR_SUCCESS && reused && http->can_retry()) {
+        srs_warn("ingest hls: get by keep-alive connection failed, retry. url=%s, ret=%d", url.c_str(), ret);
+        ret = http->get(path, "", &msg);
+    }
+    
+    int code = 0;
+    if (ret == ERROR_SUCCESS) {
+        code = msg->status_code();
+        ret = msg->body_read_all(body);
+    }
+    
+    // release the connection once the response is read.
+    bool reusable = (ret == ERROR_SUCCESS && msg->is_keep_alive());
+    srs_freep(msg);
+    _srs_http_client_pool->release(http, reusable);
+    
+    if (ret != ERROR_SUCCESS) {
+        srs_error("ingest hls: get %s failed. ret=%d", url.c_str(), ret);
+        return ret;
+    }
+    
+    if (code != SRS_CONSTS_HTTP_OK) {
+        ret = ERROR_HTTP_STATUS_INVALID;
+        srs_error("ingest hls: get %s invalid status=%d. ret=%d", url.c_str(), code, ret);
+        return ret;
+    }
+    
+    return ret;
+}
+
+SrsIngestHlsSegment::SrsIngestHlsSegment()
+{
+    seq = 0;
+    duration = 0;
+    state = SrsIngestHlsSegmentPending;
+}
+
+SrsIngestHlsSegment::~SrsIngestHlsSegment()
+{
+}
+
+SrsIngestHlsFetcher::SrsIngestHlsFetcher(SrsIngestHls* h)
+{
+    hls = h;
+    pthread = new SrsReusableThread2("hls-fetch", this, SRS_INGEST_HLS_RETRY_US);
+}
+
+SrsIngestHlsFetcher::~SrsIngestHlsFetcher()
+{
+    srs_freep(pthread);
+}
+
+int SrsIngestHlsFetcher::start()
+{
+    return pthread->start();
+}
+
+void SrsIngestHlsFetcher::stop()
+{
+    pthread->stop();
+}
+
+int SrsIngestHlsFetcher::cycle()
+{
+    int ret = ERROR_SUCCESS;
+    
+    while (!pthread->interrupted()) {
+        if ((ret = hls->fetch_segment()) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    return ret;
+}
+
+SrsIngestHls::SrsIngestHls()
+{
+    prefetch = jitter = 0;
+    starttime = 0;
+    
+    pthread = new SrsReusableThread2("ingest-hls", this, SRS_INGEST_HLS_RETRY_US);
+    pending = NULL;
+    fetched = NULL;
+    pprint = NULL;
+    
+    last_seq = -1;
+    next_refresh = 0;
+    deadline = 0;
+    nb_segments = nb_drops = nb_bytes = 0;
+    nb_failures = 0;
+    expire = 0;
+    publish_normal_timeout = 0;
+    
+    req = NULL;
+    publisher = NULL;
+    stream = new SrsStream();
+    context = NULL;
+    
+    muxer = new SrsTsRtmpMuxer(this);
+}
+
+SrsIngestHls::~SrsIngestHls()
+{
+    stop();
+    
+    srs_freep(pthread);
+    srs_freep(pprint);
+    srs_freep(req);
+    srs_freep(stream);
+    srs_freep(muxer);
+    
+    if (pending) {
+        st_cond_destroy(pending);
+    }
+    if (fetched) {
+        st_cond_destroy(fetched);
+    }
+}
+
+int SrsIngestHls::initialize(string v, string i, string in, string out, int pf, int jt)
+{
+    int ret = ERROR_SUCCESS;
+    
+    vhost = v;
+    id = i;
+    input = in;
+    output = out;
+    prefetch = srs_max(1, pf);
+    jitter = srs_max(prefetch, jt);
+    starttime = srs_get_system_time_ms();
+    
+    // parse the output to request.
+    srs_freep(req);
+    req = new SrsRequest();
+    
+    size_t pos = string::npos;
+    string uri = req->tcUrl = output;
+    if ((pos = uri.rfind("/")) != string::npos) {
+        req->stream = uri.substr(pos + 1);
+        req->tcUrl = uri = uri.substr(0, pos);
+    }
+    srs_discovery_tc_url(req->tcUrl, req->schema, req->host, req->vhost, req->app, req->port, req->param);
+    
+    // we feed the source directly, so the output must be local.
+    if (!SrsLocalPublisher::is_local(req)) {
+        ret = ERROR_INGEST_HLS_NOT_LOCAL;
+        srs_error("ingest hls: output must be local server, output=%s. ret=%d", output.c_str(), ret);
+        return ret;
+    }
+    
+    return ret;
+}
+
+string SrsIngestHls::uri()
+{
+    return vhost + "/" + id;
+}
+
+int SrsIngestHls::alive()
+{
+    return (int)(srs_get_system_time_ms() - starttime);
+}
+
+bool SrsIngestHls::equals(string v)
+{
+    return vhost == v;
+}
+
+bool SrsIngestHls::equals(string v, string i)
+{
+    return vhost == v && id == i;
+}
+
+int SrsIngestHls::start()
+{
+    int ret = ERROR_SUCCESS;
+    
+    // the cond is not available before st initialized.
+    if (!pending) {
+        pending = st_cond_new();
+    }
+    if (!fetched) {
+        fetched = st_cond_new();
+    }
+    // the pithy print depends on config.
+    if (!pprint) {
+        pprint = SrsPithyPrint::create_ingester();
+    }
+    
+    // the fetchers only start once, the ingester restart itself when error.
+    if (fetchers.empty()) {
+        for (int i = 0; i < prefetch; i++) {
+            SrsIngestHlsFetcher* fetcher = new SrsIngestHlsFetcher(this);
+            fetchers.push_back(fetcher);
+            
+            if ((ret = fetcher->start()) != ERROR_SUCCESS) {
+                return ret;
+            }
+        }
+        srs_trace("ingest hls %s start, input=%s, output=%s, prefetch=%d, jitter=%d",
+            uri().c_str(), input.c_str(), output.c_str(), prefetch, jitter);
+    }
+    
+    return pthread->start();
+}
+
+void SrsIngestHls::stop()
+{
+    // stop the fetchers first, which use the segments.
+    std::vector<SrsIngestHlsFetcher*>::iterator it;
+    for (it = fetchers.begin(); it != fetchers.end(); ++it) {
+        SrsIngestHlsFetcher* fetcher = *it;
+        fetcher->stop();
+        srs_freep(fetcher);
+    }
+    fetchers.clear();
+    
+    pthread->stop();
+    
+    unpublish();
+    clear_segments();
+    
+    m3u8 = "";
+    last_seq = -1;
+    next_refresh = 0;
+    deadline = 0;
+    nb_failures = 0;
+}
+
+int SrsIngestHls::cycle()
+{
+    int ret = ERROR_SUCCESS;
+    
+    while (!pthread->interrupted()) {
+        int64_t now = srs_update_system_time_ms();
+        
+        if (now >= next_refresh) {
+            if ((ret = refresh()) != ERROR_SUCCESS) {
+                nb_failures++;
+                check_stall();
+                return ret;
+            }
+            nb_failures = 0;
+        }
+        
+        if ((ret = consume()) != ERROR_SUCCESS) {
+            return ret;
+        }
+        check_stall();
+        
+        pprint->elapse();
+        if (pprint->can_print()) {
+            srs_trace("-> "SRS_CONSTS_LOG_INGESTER" hls %s time=%"PRId64", alive=%ds, segments=%"PRId64", drops=%"PRId64", buffer=%d, %"PRId64"KB",
+                uri().c_str(), pprint->age(), alive() / 1000, nb_segments, nb_drops, (int)segments.size(), nb_bytes / 1024);
+        }
+        
+        // wait for the segment fetched, or the time to deliver or refresh.
+        now = srs_get_system_time_ms();
+        int64_t wait = next_refresh - now;
+        if (!segments.empty() && segments.front()->state == SrsIngestHlsSegmentReady) {
+            wait = srs_min(wait, deadline - now);
+        }
+        wait = srs_max(10, srs_min(SRS_INGEST_HLS_WAIT_MS, wait));
+        st_cond_timedwait(fetched, wait * 1000);
+    }
+    
+    return ret;
+}
+
+void SrsIngestHls::on_thread_stop()
+{
+    // the source is unpublished when stop, keep publishing when error to retry,
+    // util the upstream stalls, @see check_stall().
+}
+
+int SrsIngestHls::on_ts_message(SrsTsMessage* msg)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // when not audio/video, or not adts/annexb format, donot support.
+    if (msg->stream_number() != 0) {
+        ret = ERROR_STREAM_CASTER_TS_ES;
+        srs_error("ingest hls: unsupported stream format, sid=%#x(%s-%d). ret=%d",
+            msg->sid, msg->is_audio()? "A":msg->is_video()? "V":"N", msg->stream_number(), ret);
+        return ret;
+    }
+    
+    // check supported codec
+    if (msg->channel->stream != SrsTsStreamVideoH264 && msg->channel->stream != SrsTsStreamAudioAAC) {
+        ret = ERROR_STREAM_CASTER_TS_CODEC;
+        srs_error("ingest hls: unsupported stream codec=%d. ret=%d", msg->channel->stream, ret);
+        return ret;
+    }
+    
+    // the msg of ts context is reused, detach it to sort by dts.
+    queue.insert(std::make_pair(msg->dts, msg->detach()));
+    
+    return ret;
+}
+
+int SrsIngestHls::publish()
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (publisher) {
+        return ret;
+    }
+    
+    // the segments are delivered in burst, check the timeout by ingester.
+    publish_normal_timeout = _srs_config->get_publish_normal_timeout(req->vhost);
+    publisher = new SrsLocalPublisher(false);
+    if ((ret = publisher->publish(req, SRS_CONSTS_LOCALHOST)) != ERROR_SUCCESS) {
+        srs_error("ingest hls: publish %s failed. ret=%d", output.c_str(), ret);
+        srs_freep(publisher);
+        return ret;
+    }
+    
+    // the sequence header must be sent again for the new source.
+    srs_freep(context);
+    context = new SrsTsContext();
+    muxer->reset();
+    
+    return ret;
+}
+
+void SrsIngestHls::unpublish()
+{
+    srs_freep(publisher);
+    srs_freep(context);
+    
+    std::multimap<int64_t, SrsTsMessage*>::iterator it;
+    for (it = queue.begin(); it != queue.end(); ++it) {
+        SrsTsMessage* msg = it->second;
+        srs_freep(msg);
+    }
+    queue.clear();
+}
+
+void SrsIngestHls::check_stall()
+{
+    if (!publisher) {
+        return;
+    }
+    
+    if (nb_failures >= SRS_INGEST_HLS_MAX_FAILURES) {
+        srs_warn("ingest hls %s unpublish for playlist failed %d times, republish when resumed",
+            uri().c_str(), nb_failures);
+    } else if (srs_get_system_time_ms() > expire) {
+        srs_warn("ingest hls %s unpublish for no segment in time, expire=%"PRId64", republish when resumed",
+            uri().c_str(), expire);
+    } else {
+        return;
+    }
+    
+    unpublish();
+    
+    // deliver immediately when resumed.
+    deadline = 0;
+}
+
+int SrsIngestHls::refresh()
+{
+    int ret = ERROR_SUCCESS;
+    
+    // the variant playlist, refresh the first media playlist in it.
+    bool is_variant = true;
+    for (int i = 0; i < 2 && is_variant; i++) {
+        string url = m3u8.empty()? input : m3u8;
+        
+        string body;
+        if ((ret = srs_ingest_hls_get(url, body)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        
+        if ((ret = parse_m3u8(url, body, is_variant)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    if (is_variant) {
+        ret = ERROR_INGEST_HLS_PLAYLIST;
+        srs_error("ingest hls: nested variant playlist, url=%s. ret=%d", m3u8.c_str(), ret);
+        return ret;
+    }
+    
+    return ret;
+}
+
+int SrsIngestHls::parse_m3u8(string url, string body, bool& is_variant)
+{
+    int ret = ERROR_SUCCESS;
+    
+    is_variant = false;
+    
+    double td = 0;
+    int64_t sequence = 0;
+    std::vector<std::pair<double, string> > entries;
+    
+    double duration = -1;
+    while (!body.empty()) {
+        size_t pos = string::npos;
+        
+        string line;
+        if ((pos = body.find("\n")) != string::npos) {
+            line = body.substr(0, pos);
+            body = body.substr(pos + 1);
+        } else {
+            line = body;
+            body = "";
+        }
+        
+        line = srs_string_replace(line, "\r", "");
+        line = srs_string_replace(line, " ", "");
+        if (line.empty()) {
+            continue;
+        }
+        
+        // #EXT-X-TARGETDURATION:12
+        if (srs_string_starts_with(line, "#EXT-X-TARGETDURATION:")) {
+            td = ::atof(line.substr(string("#EXT-X-TARGETDURATION:").length()).c_str());
+            continue;
+        }
+        
+        // #EXT-X-MEDIA-SEQUENCE:100
+        if (srs_string_starts_with(line, "#EXT-X-MEDIA-SEQUENCE:")) {
+            sequence = ::atoll(line.substr(string("#EXT-X-MEDIA-SEQUENCE:").length()).c_str());
+            continue;
+        }
+        
+        // #EXT-X-STREAM-INF:PROGRAM-ID=1,BANDWIDTH=73207,CODECS="mp4a.40.2"
+        // the url of media playlist follows.
+        if (srs_string_starts_with(line, "#EXT-X-STREAM-INF:")) {
+            is_variant = true;
+            continue;
+        }
+        
+        // #EXTINF:11.401,
+        if (srs_string_starts_with(line, "#EXTINF:")) {
+            line = line.substr(string("#EXTINF:").length());
+            if ((pos = line.find(",")) != string::npos) {
+                line = line.substr(0, pos);
+            }
+            duration = ::atof(line.c_str());
+            continue;
+        }
+        
+        // ignore other tags.
+        if (srs_string_starts_with(line, "#")) {
+            continue;
+        }
+        
+        // the url of media playlist, use the first one.
+        if (is_variant) {
+            m3u8 = srs_ingest_hls_resolve(url, line);
+            srs_trace("ingest hls %s use media playlist %s", uri().c_str(), m3u8.c_str());
+            return ret;
+        }
+        
+        // the url of segment.
+        if (duration >= 0) {
+            entries.push_back(std::make_pair(duration, srs_ingest_hls_resolve(url, line)));
+            duration = -1;
+        }
+    }
+    
+    if (is_variant) {
+        ret = ERROR_INGEST_HLS_PLAYLIST;
+        srs_error("ingest hls: no media playlist in variant, url=%s. ret=%d", url.c_str(), ret);
+        return ret;
+    }
+    
+    // refresh after the target duration when changed, or half of it, @see hls-m3u8-draft-pantos-http-live-streaming-12.pdf, page 30.
+    int64_t interval = (int64_t)(td * 1000);
+    
+    if (entries.empty()) {
+        srs_warn("ingest hls: ignore empty playlist, url=%s", url.c_str());
+        next_refresh = srs_get_system_time_ms() + srs_max(SRS_INGEST_HLS_MIN_REFRESH_MS, interval / 2);
+        return ret;
+    }
+    
+    // the fresh start or the stream restarted, start from the last segment.
+    int64_t last = sequence + (int64_t)entries.size() - 1;
+    if (last_seq < 0 || last < last_seq) {
+        if (last_seq >= 0) {
+            srs_warn("ingest hls: %s sequence reset from %"PRId64" to %"PRId64, uri().c_str(), last_seq, last);
+        }
+        last_seq = last - 1;
+    }
+    
+    int nb_added = 0;
+    for (int i = 0; i < (int)entries.size(); i++) {
+        int64_t seq = sequence + i;
+        if (seq <= last_seq) {
+            continue;
+        }
+        
+        SrsIngestHlsSegment* segment = new SrsIngestHlsSegment();
+        segment->seq = seq;
+        segment->duration = entries[i].first;
+        segment->url = entries[i].second;
+        segments.push_back(segment);
+        nb_added++;
+        
+        srs_info("ingest hls %s got segment seq=%"PRId64", duration=%.2f, url=%s",
+            uri().c_str(), seq, segment->duration, segment->url.c_str());
+    }
+    last_seq = last;
+    
+    // notify the prefetchers.
+    if (nb_added > 0) {
+        shrink();
+        // the cond is created when started.
+        if (pending) {
+            st_cond_broadcast(pending);
+        }
+    } else {
+        interval /= 2;
+    }
+    next_refresh = srs_get_system_time_ms() + srs_max(SRS_INGEST_HLS_MIN_REFRESH_MS, interval);
+    
+    return ret;
+}
+
+void SrsIngestHls::shrink()
+{
+    while ((int)segments.size() > jitter) {
+        SrsIngestHlsSegment* segment = segments.front();
+        
+        // wait for the fetching segment.
+        if (segment->state == SrsIngestHlsSegmentFetching) {
+            break;
+        }
+        
+        srs_warn("ingest hls %s drop segment seq=%"PRId64" for jitter buffer full, segments=%d, jitter=%d",
+            uri().c_str(), segment->seq, (int)segments.size(), jitter);
+        
+        segments.pop_front();
+        srs_freep(segment);
+        nb_drops++;
+    }
+}
+
+int SrsIngestHls::consume()
+{
+    int ret = ERROR_SUCCESS;
+    
+    while (!segments.empty()) {
+        SrsIngestHlsSegment* segment = segments.front();
+        
+        // deliver in order of sequence, wait for the head.
+        if (segment->state == SrsIngestHlsSegmentPending || segment->state == SrsIngestHlsSegmentFetching) {
+            break;
+        }
+        
+        // deliver in time of the duration of previous segment.
+        int64_t now = srs_get_system_time_ms();
+        if (segment->state == SrsIngestHlsSegmentReady && now < deadline) {
+            break;
+        }
+        
+        // publish when the first segment, or resumed from stall.
+        if (segment->state == SrsIngestHlsSegmentReady && (ret = publish()) != ERROR_SUCCESS) {
+            return ret;
+        }
+        
+        segments.pop_front();
+        SrsAutoFree(SrsIngestHlsSegment, segment);
+        
+        if (segment->state == SrsIngestHlsSegmentFailed) {
+            nb_drops++;
+            continue;
+        }
+        
+        deadline = srs_max(deadline, now) + (int64_t)(segment->duration * 1000);
+        nb_segments++;
+        nb_bytes += (int64_t)segment->body.length();
+        
+        // the next segment should be delivered before the deadline, same to rtmp publisher,
+        // unpublish when no segment for publish_normal_timeout after the deadline.
+        expire = deadline + publish_normal_timeout;
+        
+        if ((ret = deliver(segment)) != ERROR_SUCCESS) {
+            srs_error("ingest hls: deliver segment seq=%"PRId64" failed, url=%s. ret=%d",
+                segment->seq, segment->url.c_str(), ret);
+            return ret;
+        }
+    }
+    
+    return ret;
+}
+
+int SrsIngestHls::fetch_segment()
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsIngestHlsSegment* segment = NULL;
+    
+    std::deque<SrsIngestHlsSegment*>::iterator it;
+    for (it = segments.begin(); it != segments.end(); ++it) {
+        if ((*it)->state == SrsIngestHlsSegmentPending) {
+            segment = *it;
+            break;
+        }
+    }
+    
+    // wait for the playlist to refresh.
+    if (!segment) {
+        st_cond_timedwait(pending, SRS_INGEST_HLS_WAIT_MS * 1000);
+        return ret;
+    }
+    
+    // @remark the segment is never freed when fetching, @see shrink() and stop().
+    segment->state = SrsIngestHlsSegmentFetching;
+    
+    string body;
+    if ((ret = srs_ingest_hls_get(segment->url, body)) != ERROR_SUCCESS) {
+        srs_warn("ingest hls %s drop segment seq=%"PRId64" for fetch failed, url=%s. ret=%d",
+            uri().c_str(), segment->seq, segment->url.c_str(), ret);
+        segment->state = SrsIngestHlsSegmentFailed;
+    } else {
+        segment->body.swap(body);
+        segment->state = SrsIngestHlsSegmentReady;
+    }
+    
+    // notify the ingester to deliver it.
+    st_cond_signal(fetched);
+    
+    return ERROR_SUCCESS;
+}
+
+void SrsIngestHls::clear_segments()
+{
+    std::deque<SrsIngestHlsSegment*>::iterator it;
+    for (it = segments.begin(); it != segments.end(); ++it) {
+        SrsIngestHlsSegment* segment = *it;
+        srs_freep(segment);
+    }
+    segments.clear();
+}
+
+int SrsIngestHls::deliver(SrsIngestHlsSegment* segment)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_info("ingest hls %s deliver segment seq=%"PRId64", duration=%.2f, size=%d",
+        uri().c_str(), segment->seq, segment->duration, (int)segment->body.length());
+    
+    // decode each ts packet, the context keeps the pes across segments.
+    char* body = (char*)segment->body.data();
+    int nb_packets = (int)segment->body.length() / SRS_TS_PACKET_SIZE;
+    for (int i = 0; i < nb_packets; i++) {
+        if ((ret = stream->initialize(body + i * SRS_TS_PACKET_SIZE, SRS_TS_PACKET_SIZE)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        if ((ret = context->decode(stream, this)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    return parse_message_queue(false);
+}
+
+int SrsIngestHls::parse_message_queue(bool flush)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // always wait 2+ videos, to left one video in the queue,
+    // for the audio of the last video maybe in the next segment.
+    int nb_videos = 0;
+    bool cpa = context->is_pure_audio();
+    if (!cpa && !flush) {
+        std::multimap<int64_t, SrsTsMessage*>::iterator it;
+        for (it = queue.begin(); it != queue.end(); ++it) {
+            SrsTsMessage* msg = it->second;
+            if (msg->channel->stream == SrsTsStreamVideoH264) {
+                nb_videos++;
+            }
+        }
+        if (nb_videos <= 1) {
+            return ret;
+        }
+    }
+    
+    while (!queue.empty() && (flush || (cpa && queue.size() > 1) || nb_videos > 1)) {
+        std::multimap<int64_t, SrsTsMessage*>::iterator it = queue.begin();
+        
+        SrsTsMessage* msg = it->second;
+        SrsAutoFree(SrsTsMessage, msg);
+        if (msg->channel->stream == SrsTsStreamVideoH264) {
+            nb_videos--;
+        }
+        queue.erase(it);
+        
+        // the dts of next msg to calc the duration of audio.
+        int64_t next_dts = queue.empty()? msg->dts : queue.begin()->second->dts;
+        
+        SrsStream avs;
+        if ((ret = avs.initialize(msg->payload->bytes(), msg->payload->length())) != ERROR_SUCCESS) {
+            srs_error("ingest hls: initialize av stream failed. ret=%d", ret);
+            return ret;
+        }
+        
+        if (msg->channel->stream == SrsTsStreamVideoH264) {
+            if ((ret = muxer->on_ts_video(msg, &avs)) != ERROR_SUCCESS) {
+                return ret;
+            }
+        }
+        if (msg->channel->stream == SrsTsStreamAudioAAC) {
+            if ((ret = muxer->on_ts_audio(msg, &avs, next_dts)) != ERROR_SUCCESS) {
+                return ret;
+            }
+        }
+    }
+    
+    return ret;
+}
+
+int SrsIngestHls::on_rtmp_packet(char type, u_int32_t timestamp, char* data, int size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsSharedPtrMessage* msg = NULL;
+    if ((ret = srs_rtmp_create_msg(type, timestamp, data, size, 0, &msg)) != ERROR_SUCCESS) {
+        srs_error("ingest hls: create shared ptr msg failed. ret=%d", ret);
+        return ret;
+    }
+    srs_assert(msg);
+    
+    // feed the source directly.
+    ret = publisher->on_message(msg);
+    srs_freep(msg);
+    
+    return ret;
+}
+
+#endif
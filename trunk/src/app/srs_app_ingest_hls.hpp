@@ -0,0 +1,226 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef SRS_APP_INGEST_HLS_HPP
+#define SRS_APP_INGEST_HLS_HPP
+
+/*
+#include <srs_app_ingest_hls.hpp>
+*/
+#include <srs_core.hpp>
+
+#if defined(SRS_AUTO_INGEST) && defined(SRS_AUTO_HTTP_CORE)
+
+#include <string>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include <srs_app_st.hpp>
+#include <srs_app_thread.hpp>
+#include <srs_kernel_ts.hpp>
+#include <srs_raw_avc.hpp>
+
+class SrsStream;
+class SrsRequest;
+class SrsPithyPrint;
+class SrsLocalPublisher;
+class SrsIngestHls;
+
+/**
+* resolve the url of segment or sub playlist, which maybe relative to the playlist.
+* @param base the url of playlist.
+* @param url the absolute url, the absolute path or the relative path.
+*/
+extern std::string srs_ingest_hls_resolve(std::string base, std::string url);
+
+/**
+* the state of hls segment in the jitter buffer.
+*/
+enum SrsIngestHlsSegmentState
+{
+    // wait for prefetcher to fetch it.
+    SrsIngestHlsSegmentPending = 0,
+    // some prefetcher is fetching it.
+    SrsIngestHlsSegmentFetching,
+    // the body is ready to deliver.
+    SrsIngestHlsSegmentReady,
+    // fetch failed, drop it.
+    SrsIngestHlsSegmentFailed,
+};
+
+/**
+* the ts segment of the hls playlist.
+*/
+class SrsIngestHlsSegment
+{
+public:
+    // the media sequence number of segment.
+    int64_t seq;
+    double duration;
+    // the absolute url of segment.
+    std::string url;
+    std::string body;
+    SrsIngestHlsSegmentState state;
+public:
+    SrsIngestHlsSegment();
+    virtual ~SrsIngestHlsSegment();
+};
+
+/**
+* the prefetcher to download the pending segments of hls ingester,
+* each ingester starts some prefetchers to fetch segments concurrently.
+*/
+class SrsIngestHlsFetcher : public ISrsReusableThread2Handler
+{
+private:
+    SrsIngestHls* hls;
+    SrsReusableThread2* pthread;
+public:
+    SrsIngestHlsFetcher(SrsIngestHls* h);
+    virtual ~SrsIngestHlsFetcher();
+public:
+    virtual int start();
+    virtual void stop();
+// interface ISrsReusableThread2Handler
+public:
+    virtual int cycle();
+};
+
+/**
+* ingest the hls live stream in process, that is, pull the m3u8 and ts
+* by the keep-alive http clients, demux the ts and feed the source directly,
+* without the ffmpeg or the srs_ingest_hls process and the loopback rtmp.
+* the upcoming segments are prefetched concurrently, and delivered to source
+* in time of their duration from a bounded jitter buffer.
+*/
+class SrsIngestHls : public ISrsReusableThread2Handler, public ISrsTsHandler, public ISrsTsRtmpHandler
+{
+    friend class SrsIngestHlsFetcher;
+protected:
+    std::string vhost;
+    std::string id;
+    // the input m3u8 url, and the media playlist url when input is variant.
+    std::string input;
+    std::string m3u8;
+    std::string output;
+    // the max segments to fetch concurrently.
+    int prefetch;
+    // the max segments in jitter buffer, drop the oldest when exceed.
+    int jitter;
+    int64_t starttime;
+protected:
+    SrsReusableThread2* pthread;
+    std::vector<SrsIngestHlsFetcher*> fetchers;
+    // signal the fetchers when got pending segment.
+    st_cond_t pending;
+    // signal the ingester when segment fetched.
+    st_cond_t fetched;
+    SrsPithyPrint* pprint;
+protected:
+    // the segments in order of sequence, not delivered yet.
+    std::deque<SrsIngestHlsSegment*> segments;
+    // the sequence of the last segment in playlist, -1 for fresh.
+    int64_t last_seq;
+    // the time in ms to refresh the playlist.
+    int64_t next_refresh;
+    // the time in ms to deliver the next segment.
+    int64_t deadline;
+    // the statistic of segments.
+    int64_t nb_segments;
+    int64_t nb_drops;
+    int64_t nb_bytes;
+    // the consecutive failures to refresh the playlist.
+    int nb_failures;
+    // the time in ms to unpublish when no segment delivered.
+    int64_t expire;
+    int publish_normal_timeout;
+protected:
+    SrsRequest* req;
+    SrsLocalPublisher* publisher;
+    SrsStream* stream;
+    SrsTsContext* context;
+    // the ts messages of segment, sort by dts.
+    std::multimap<int64_t, SrsTsMessage*> queue;
+private:
+    // mux the ts messages to flv packets.
+    SrsTsRtmpMuxer* muxer;
+public:
+    SrsIngestHls();
+    virtual ~SrsIngestHls();
+public:
+    /**
+    * initialize the ingester.
+    * @param v the vhost of ingest.
+    * @param i the id of ingest.
+    * @param in the input m3u8 url.
+    * @param out the output rtmp url, must be the local server.
+    */
+    virtual int initialize(std::string v, std::string i, std::string in, std::string out, int pf, int jt);
+    // the ingest uri, [vhost]/[ingest id]
+    virtual std::string uri();
+    // the alive in ms.
+    virtual int alive();
+    virtual bool equals(std::string v, std::string i);
+    virtual bool equals(std::string v);
+public:
+    /**
+    * start the ingester and prefetchers, ignore when started.
+    */
+    virtual int start();
+    virtual void stop();
+// interface ISrsReusableThread2Handler
+public:
+    virtual int cycle();
+    virtual void on_thread_stop();
+// interface ISrsTsHandler
+public:
+    virtual int on_ts_message(SrsTsMessage* msg);
+// interface ISrsTsRtmpHandler
+public:
+    virtual int on_rtmp_packet(char type, u_int32_t timestamp, char* data, int size);
+protected:
+    // publish to the source of local server, when the first segment to deliver.
+    virtual int publish();
+    virtual void unpublish();
+    // unpublish when the upstream stalls, for the viewers and other publishers,
+    // that is, the playlist failed for some times or no segment delivered in time.
+    virtual void check_stall();
+    // refresh the playlist and append the new segments.
+    virtual int refresh();
+    virtual int parse_m3u8(std::string url, std::string body, bool& is_variant);
+    // drop the oldest segments when exceed the jitter buffer.
+    virtual void shrink();
+    // deliver the ready segments in time.
+    virtual int consume();
+    // for prefetcher to fetch the pending segment.
+    virtual int fetch_segment();
+    virtual void clear_segments();
+    virtual int deliver(SrsIngestHlsSegment* segment);
+private:
+    virtual int parse_message_queue(bool flush);
+};
+
+#endif
+
+#endif
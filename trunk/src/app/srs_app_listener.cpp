@@ -30,12 +30,16 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <string.h>
 using namespace std;
 
 #include <srs_kernel_log.hpp>
 #include <srs_kernel_error.hpp>
+#include <srs_kernel_utility.hpp>
 #include <srs_app_server.hpp>
 #include <srs_app_utility.hpp>
+#include <srs_app_worker.hpp>
+#include <srs_app_pithy_print.hpp>
 
 // set the max packet size.
 #define SRS_UDP_MAX_PACKET_SIZE 65535
@@ -46,6 +50,17 @@ using namespace std;
 // nginx also set to 512
 #define SERVER_LISTEN_BACKLOG 512
 
+SrsUdpPacket::SrsUdpPacket()
+{
+    memset(&from, 0, sizeof(sockaddr_in));
+    buf = NULL;
+    nb_buf = 0;
+}
+
+SrsUdpPacket::~SrsUdpPacket()
+{
+}
+
 ISrsUdpHandler::ISrsUdpHandler()
 {
 }
@@ -59,6 +74,20 @@ int ISrsUdpHandler::on_stfd_change(st_netfd_t /*fd*/)
     return ERROR_SUCCESS;
 }
 
+int ISrsUdpHandler::on_udp_packets(SrsUdpPacket* pkts, int nb_pkts)
+{
+    int ret = ERROR_SUCCESS;
+    
+    for (int i = 0; i < nb_pkts; i++) {
+        SrsUdpPacket* pkt = &pkts[i];
+        if ((ret = on_udp_packet(&pkt->from, pkt->buf, pkt->nb_buf)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    return ret;
+}
+
 ISrsTcpHandler::ISrsTcpHandler()
 {
 }
@@ -67,17 +96,39 @@ ISrsTcpHandler::~ISrsTcpHandler()
 {
 }
 
-SrsUdpListener::SrsUdpListener(ISrsUdpHandler* h, string i, int p)
+SrsUdpListener::SrsUdpListener(ISrsUdpHandler* h, string i, int p, int rb)
 {
     handler = h;
     ip = i;
     port = p;
+    recv_buffer = rb;
 
     _fd = -1;
     _stfd = NULL;
 
-    nb_buf = SRS_UDP_MAX_PACKET_SIZE;
+    nb_pkts = 0;
+#if defined(SRS_PERF_UDP_RECVMMSG) && !defined(SRS_OSX)
+    // recv in batch, each packet in a slot of buffer.
+    nb_slot = SRS_PERF_UDP_RECV_SLOT;
+    pkts = new SrsUdpPacket[SRS_PERF_UDP_RECV_BATCH];
+    nb_buf = nb_slot * SRS_PERF_UDP_RECV_BATCH;
+    buf = new char[nb_buf];
+    
+    msgs = new struct mmsghdr[SRS_PERF_UDP_RECV_BATCH];
+    iovs = new struct iovec[SRS_PERF_UDP_RECV_BATCH];
+    nb_control = CMSG_SPACE(sizeof(u_int32_t));
+    controls = new char[nb_control * SRS_PERF_UDP_RECV_BATCH];
+#else
+    nb_slot = SRS_UDP_MAX_PACKET_SIZE;
+    pkts = new SrsUdpPacket[1];
+    nb_buf = nb_slot;
     buf = new char[nb_buf];
+#endif
+
+    pprint = SrsPithyPrint::create_caster();
+    nb_packets = nb_recvs = 0;
+    nb_truncated = nb_drops = 0;
+    last_drops = 0;
 
     pthread = new SrsReusableThread("udp", this);
 }
@@ -95,6 +146,13 @@ SrsUdpListener::~SrsUdpListener()
     close(_fd);
 
     srs_freepa(buf);
+    srs_freepa(pkts);
+#if defined(SRS_PERF_UDP_RECVMMSG) && !defined(SRS_OSX)
+    srs_freepa(msgs);
+    srs_freepa(iovs);
+    srs_freepa(controls);
+#endif
+    srs_freep(pprint);
 }
 
 int SrsUdpListener::fd()
@@ -137,6 +195,8 @@ int SrsUdpListener::listen()
     }
     srs_verbose("bind socket success. ep=%s:%d, fd=%d", ip.c_str(), port, _fd);
     
+    set_recv_buffer();
+    
     if ((_stfd = st_netfd_open_socket(_fd)) == NULL){
         ret = ERROR_ST_OPEN_SOCKET;
         srs_error("st_netfd_open_socket open socket failed. ep=%s:%d, ret=%d", ip.c_str(), port, ret);
@@ -157,17 +217,17 @@ int SrsUdpListener::cycle()
 {
     int ret = ERROR_SUCCESS;
 
-    // TODO: FIXME: support ipv6, @see man 7 ipv6
-    sockaddr_in from;
-    int nb_from = sizeof(sockaddr_in);
-    int nread = 0;
-
-    if ((nread = st_recvfrom(_stfd, buf, nb_buf, (sockaddr*)&from, &nb_from, ST_UTIME_NO_TIMEOUT)) <= 0) {
-        srs_warn("ignore recv udp packet failed, nread=%d", nread);
+    if ((ret = recv_packets()) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    print_stat();
+    
+    if (nb_pkts <= 0) {
         return ret;
     }
     
-    if ((ret = handler->on_udp_packet(&from, buf, nread)) != ERROR_SUCCESS) {
+    if ((ret = handler->on_udp_packets(pkts, nb_pkts)) != ERROR_SUCCESS) {
         srs_warn("handle udp packet failed. ret=%d", ret);
         return ret;
     }
@@ -179,6 +239,144 @@ int SrsUdpListener::cycle()
     return ret;
 }
 
+#if defined(SRS_PERF_UDP_RECVMMSG) && !defined(SRS_OSX)
+int SrsUdpListener::recv_packets()
+{
+    int ret = ERROR_SUCCESS;
+    
+    nb_pkts = 0;
+    
+    // wait for the socket to be readable in st,
+    // then recv all datagrams in the kernel in a syscall.
+    if (st_netfd_poll(_stfd, POLLIN, ST_UTIME_NO_TIMEOUT) != 0) {
+        srs_warn("ignore poll udp socket failed, errno=%d", errno);
+        return ret;
+    }
+    
+    for (int i = 0; i < SRS_PERF_UDP_RECV_BATCH; i++) {
+        iovs[i].iov_base = buf + i * nb_slot;
+        iovs[i].iov_len = nb_slot;
+        
+        // the kernel update the namelen and controllen, reset for each recv.
+        msghdr* hdr = &msgs[i].msg_hdr;
+        hdr->msg_name = &pkts[i].from;
+        hdr->msg_namelen = sizeof(sockaddr_in);
+        hdr->msg_iov = &iovs[i];
+        hdr->msg_iovlen = 1;
+        hdr->msg_control = controls + i * nb_control;
+        hdr->msg_controllen = nb_control;
+        hdr->msg_flags = 0;
+        msgs[i].msg_len = 0;
+    }
+    
+    int nb_msgs = recvmmsg(_fd, msgs, SRS_PERF_UDP_RECV_BATCH, MSG_DONTWAIT, NULL);
+    if (nb_msgs <= 0) {
+        // the other thread maybe read it, or interrupted.
+        if (nb_msgs < 0 && errno != EAGAIN && errno != EINTR) {
+            srs_warn("ignore recv udp packets failed, errno=%d", errno);
+        }
+        return ret;
+    }
+    nb_recvs++;
+    
+    for (int i = 0; i < nb_msgs; i++) {
+        msghdr* hdr = &msgs[i].msg_hdr;
+        
+#ifdef SO_RXQ_OVFL
+        // the drops is the total datagrams dropped by socket, @see man 7 socket
+        for (cmsghdr* cmsg = CMSG_FIRSTHDR(hdr); cmsg; cmsg = CMSG_NXTHDR(hdr, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+                u_int32_t drops = 0;
+                memcpy(&drops, CMSG_DATA(cmsg), sizeof(u_int32_t));
+                nb_drops += (u_int32_t)(drops - last_drops);
+                last_drops = drops;
+            }
+        }
+#endif
+        
+        // drop the truncated datagram, which is larger than slot.
+        if ((hdr->msg_flags & MSG_TRUNC) != 0) {
+            nb_truncated++;
+            srs_warn("udp: drop truncated packet, slot=%dB", nb_slot);
+            continue;
+        }
+        
+        SrsUdpPacket* pkt = &pkts[nb_pkts++];
+        // the from is recv to pkts[i], move it to the packet.
+        if (pkt != &pkts[i]) {
+            pkt->from = pkts[i].from;
+        }
+        pkt->buf = (char*)iovs[i].iov_base;
+        pkt->nb_buf = (int)msgs[i].msg_len;
+    }
+    nb_packets += nb_pkts;
+    
+    return ret;
+}
+#else
+int SrsUdpListener::recv_packets()
+{
+    int ret = ERROR_SUCCESS;
+    
+    nb_pkts = 0;
+    
+    // TODO: FIXME: support ipv6, @see man 7 ipv6
+    SrsUdpPacket* pkt = &pkts[0];
+    int nb_from = sizeof(sockaddr_in);
+    int nread = 0;
+
+    if ((nread = st_recvfrom(_stfd, buf, nb_buf, (sockaddr*)&pkt->from, &nb_from, ST_UTIME_NO_TIMEOUT)) <= 0) {
+        srs_warn("ignore recv udp packet failed, nread=%d", nread);
+        return ret;
+    }
+    nb_recvs++;
+    
+    pkt->buf = buf;
+    pkt->nb_buf = nread;
+    nb_pkts = 1;
+    nb_packets++;
+    
+    return ret;
+}
+#endif
+
+void SrsUdpListener::set_recv_buffer()
+{
+    if (recv_buffer > 0) {
+        if (setsockopt(_fd, SOL_SOCKET, SO_RCVBUF, &recv_buffer, sizeof(int)) == -1) {
+            srs_warn("ignore set udp SO_RCVBUF=%d failed. ep=%s:%d", recv_buffer, ip.c_str(), port);
+        }
+    }
+    
+    // the actual size maybe limited by net.core.rmem_max.
+    int actual = 0;
+    socklen_t nb_actual = sizeof(int);
+    getsockopt(_fd, SOL_SOCKET, SO_RCVBUF, &actual, &nb_actual);
+    
+#ifdef SO_RXQ_OVFL
+    // recv the drops of socket in control message.
+    int enable = 1;
+    if (setsockopt(_fd, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(int)) == -1) {
+        srs_warn("ignore set udp SO_RXQ_OVFL failed. ep=%s:%d", ip.c_str(), port);
+    }
+#endif
+    
+    srs_trace("udp listen at %s:%d, SO_RCVBUF=%d/%d, batch=%d, slot=%d", 
+        ip.c_str(), port, actual, recv_buffer, nb_buf / nb_slot, nb_slot);
+}
+
+void SrsUdpListener::print_stat()
+{
+    pprint->elapse();
+    
+    if (!pprint->can_print()) {
+        return;
+    }
+    
+    srs_trace("udp: %s:%d recv %"PRId64" packets in %"PRId64" syscalls, drop=%"PRId64", truncated=%"PRId64, 
+        ip.c_str(), port, nb_packets, nb_recvs, nb_drops, nb_truncated);
+}
+
 SrsTcpListener::SrsTcpListener(ISrsTcpHandler* h, string i, int p)
 {
     handler = h;
@@ -228,6 +426,18 @@ int SrsTcpListener::listen()
     }
     srs_verbose("setsockopt reuse-addr success. port=%d, fd=%d", port, _fd);
     
+#ifdef SO_REUSEPORT
+    // the workers accept clients on the same port.
+    if (_srs_workers->enabled()) {
+        if (setsockopt(_fd, SOL_SOCKET, SO_REUSEPORT, &reuse_socket, sizeof(int)) == -1) {
+            ret = ERROR_SOCKET_SETREUSE;
+            srs_error("setsockopt reuse-port error. port=%d, ret=%d", port, ret);
+            return ret;
+        }
+        srs_verbose("setsockopt reuse-port success. port=%d, fd=%d", port, _fd);
+    }
+#endif
+    
     sockaddr_in addr;
     addr.sin_family = AF_INET;
     addr.sin_port = htons(port);
@@ -31,11 +31,30 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <srs_core.hpp>
 
 #include <string>
+#include <sys/socket.h>
+#include <netinet/in.h>
 
 #include <srs_app_st.hpp>
 #include <srs_app_thread.hpp>
+#include <srs_core_performance.hpp>
 
-struct sockaddr_in;
+class SrsPithyPrint;
+
+/**
+* the udp packet received by listener.
+*/
+class SrsUdpPacket
+{
+public:
+    // the udp packet from address.
+    sockaddr_in from;
+    // the udp packet bytes, shared memory of listener.
+    char* buf;
+    int nb_buf;
+public:
+    SrsUdpPacket();
+    virtual ~SrsUdpPacket();
+};
 
 /**
 * the udp packet handler.
@@ -62,6 +81,13 @@ public:
     * @remark user should never use the buf, for it's a shared memory bytes.
     */
     virtual int on_udp_packet(sockaddr_in* from, char* buf, int nb_buf) = 0;
+    /**
+    * when udp listener got a batch of udp packets, in the order of received.
+    * @param pkts, the packets, user should copy the buf if need to use.
+    * @param nb_pkts, the number of packets, always positive.
+    * @remark the default implements call on_udp_packet for each packet.
+    */
+    virtual int on_udp_packets(SrsUdpPacket* pkts, int nb_pkts);
 };
 
 /**
@@ -81,6 +107,8 @@ public:
 
 /**
 * bind udp port, start thread to recv packet and handler it.
+* the datagrams are received in batch by recvmmsg when available,
+* @see SRS_PERF_UDP_RECVMMSG
 */
 class SrsUdpListener : public ISrsReusableThreadHandler
 {
@@ -89,14 +117,40 @@ private:
     st_netfd_t _stfd;
     SrsReusableThread* pthread;
 private:
+    // the buffer of all packets, each packet use a slot of buffer.
     char* buf;
     int nb_buf;
+    int nb_slot;
+    SrsUdpPacket* pkts;
+    int nb_pkts;
+#if defined(SRS_PERF_UDP_RECVMMSG) && !defined(SRS_OSX)
+    // the msgs for recvmmsg, with the control buffer for drops.
+    struct mmsghdr* msgs;
+    struct iovec* iovs;
+    char* controls;
+    int nb_control;
+#endif
 private:
     ISrsUdpHandler* handler;
     std::string ip;
     int port;
+    // the SO_RCVBUF to set, 0 to use system default.
+    int recv_buffer;
+private:
+    // the stat of recv, to print.
+    SrsPithyPrint* pprint;
+    int64_t nb_packets;
+    int64_t nb_recvs;
+    int64_t nb_truncated;
+    // the datagrams dropped by kernel for the recv buffer is full,
+    // @see SO_RXQ_OVFL of linux.
+    int64_t nb_drops;
+    u_int32_t last_drops;
 public:
-    SrsUdpListener(ISrsUdpHandler* h, std::string i, int p);
+    /**
+    * @param rb, the recv buffer(SO_RCVBUF) of socket, 0 to use system default.
+    */
+    SrsUdpListener(ISrsUdpHandler* h, std::string i, int p, int rb);
     virtual ~SrsUdpListener();
 public:
     virtual int fd();
@@ -106,6 +160,11 @@ public:
 // interface ISrsReusableThreadHandler.
 public:
     virtual int cycle();
+private:
+    // recv a batch of packets, set the nb_pkts to 0 when nothing.
+    virtual int recv_packets();
+    virtual void set_recv_buffer();
+    virtual void print_stat();
 };
 
 /**
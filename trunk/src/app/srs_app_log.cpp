@@ -34,6 +34,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <srs_kernel_error.hpp>
 #include <srs_app_utility.hpp>
 #include <srs_kernel_utility.hpp>
+#include <srs_app_async_io.hpp>
 
 SrsThreadContext::SrsThreadContext()
 {
@@ -250,7 +251,7 @@ int SrsFastLog::on_reload_log_tank()
     }
 
     if (fd > 0) {
-        ::close(fd);
+        close_log_file();
     }
     open_log_file();
     
@@ -283,7 +284,7 @@ int SrsFastLog::on_reload_log_file()
     }
 
     if (fd > 0) {
-        ::close(fd);
+        close_log_file();
     }
     open_log_file();
     
@@ -383,9 +384,31 @@ void SrsFastLog::write_log(int& fd, char *str_log, int size, int level)
     }
     
     // write log to file.
-    if (fd > 0) {
-        ::write(fd, str_log, size);
+    if (fd <= 0) {
+        return;
+    }
+    
+    // merge the logs to write in io thread, for the disk maybe slow,
+    // while the error is written in time.
+    if (_srs_async_io->enabled()) {
+        _srs_async_io->append(fd, str_log, size, level >= SrsLogLevel::Error);
+        return;
+    }
+    
+    ::write(fd, str_log, size);
+}
+
+void SrsFastLog::close_log_file()
+{
+    // close in io thread after the pending logs written.
+    if (_srs_async_io->enabled()) {
+        _srs_async_io->submit(new SrsAsyncIOJob(SrsAsyncIOClose, fd, NULL));
+        fd = -1;
+        return;
     }
+    
+    ::close(fd);
+    fd = -1;
 }
 
 void SrsFastLog::open_log_file()
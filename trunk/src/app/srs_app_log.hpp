@@ -95,6 +95,7 @@ private:
     virtual bool generate_header(bool error, const char* tag, int context_id, const char* level_name, int* header_size);
     virtual void write_log(int& fd, char* str_log, int size, int level);
     virtual void open_log_file();
+    virtual void close_log_file();
 };
 
 #endif
@@ -48,6 +48,7 @@ using namespace std;
 #include <srs_app_utility.hpp>
 #include <srs_rtmp_amf0.hpp>
 #include <srs_raw_avc.hpp>
+#include <srs_app_publisher.hpp>
 #include <srs_app_pithy_print.hpp>
 
 SrsMpegtsQueue::SrsMpegtsQueue()
@@ -136,12 +137,9 @@ SrsMpegtsOverUdp::SrsMpegtsOverUdp(SrsConfDirective* c)
     client = NULL;
     stfd = NULL;
     stream_id = 0;
+    publisher = NULL;
     
-    avc = new SrsRawH264Stream();
-    aac = new SrsRawAacStream();
-    h264_sps_changed = false;
-    h264_pps_changed = false;
-    h264_sps_pps_sent = false;
+    muxer = new SrsTsRtmpMuxer(this);
     queue = new SrsMpegtsQueue();
     pprint = SrsPithyPrint::create_caster();
 }
@@ -153,8 +151,7 @@ SrsMpegtsOverUdp::~SrsMpegtsOverUdp()
     srs_freep(buffer);
     srs_freep(stream);
     srs_freep(context);
-    srs_freep(avc);
-    srs_freep(aac);
+    srs_freep(muxer);
     srs_freep(queue);
     srs_freep(pprint);
 }
@@ -173,9 +170,28 @@ int SrsMpegtsOverUdp::on_udp_packet(sockaddr_in* from, char* buf, int nb_buf)
     return on_udp_bytes(peer_ip, peer_port, buf, nb_buf);
 }
 
+int SrsMpegtsOverUdp::on_udp_packets(SrsUdpPacket* pkts, int nb_pkts)
+{
+    // append all datagrams, then parse the ts packets in a time.
+    for (int i = 0; i < nb_pkts; i++) {
+        buffer->append(pkts[i].buf, pkts[i].nb_buf);
+    }
+    
+    SrsUdpPacket* last = &pkts[nb_pkts - 1];
+    std::string peer_ip = inet_ntoa(last->from.sin_addr);
+    int peer_port = ntohs(last->from.sin_port);
+    
+    srs_info("udp: got %s:%d %d packets %d/%d bytes",
+        peer_ip.c_str(), peer_port, nb_pkts, last->nb_buf, buffer->length());
+    
+    return on_udp_bytes(peer_ip, peer_port, last->buf, last->nb_buf);
+}
+
 int SrsMpegtsOverUdp::on_udp_bytes(string host, int port, char* buf, int nb_buf)
 {
     int ret = ERROR_SUCCESS;
+    
+    peer_ip = host;
 
     // collect nMB data to parse in a time.
     // TODO: FIXME: comment the following for release.
@@ -316,6 +332,11 @@ int SrsMpegtsOverUdp::on_ts_message(SrsTsMessage* msg)
         return ret;
     }
 
+    // ensure rtmp connected.
+    if ((ret = connect()) != ERROR_SUCCESS) {
+        return ret;
+    }
+
     // parse the stream.
     SrsStream avs;
     if ((ret = avs.initialize(msg->payload->bytes(), msg->payload->length())) != ERROR_SUCCESS) {
@@ -325,243 +346,19 @@ int SrsMpegtsOverUdp::on_ts_message(SrsTsMessage* msg)
 
     // publish audio or video.
     if (msg->channel->stream == SrsTsStreamVideoH264) {
-        return on_ts_video(msg, &avs);
+        return muxer->on_ts_video(msg, &avs);
     }
     if (msg->channel->stream == SrsTsStreamAudioAAC) {
-        return on_ts_audio(msg, &avs);
+        // no next message for the realtime stream, all frames of pes use the same dts,
+        // the queue will correct the timestamp of them.
+        return muxer->on_ts_audio(msg, &avs, msg->dts);
     }
 
     // TODO: FIXME: implements it.
     return ret;
 }
 
-int SrsMpegtsOverUdp::on_ts_video(SrsTsMessage* msg, SrsStream* avs)
-{
-    int ret = ERROR_SUCCESS;
-
-    // ensure rtmp connected.
-    if ((ret = connect()) != ERROR_SUCCESS) {
-        return ret;
-    }
-
-    // ts tbn to flv tbn.
-    u_int32_t dts = msg->dts / 90; 
-    u_int32_t pts = msg->dts / 90;
-    
-    // send each frame.
-    while (!avs->empty()) {
-        char* frame = NULL;
-        int frame_size = 0;
-        bool is_end = false;
-        if ((ret = avc->annexb_demux(avs, &frame, &frame_size, &is_end)) != ERROR_SUCCESS) {
-            return ret;
-        }
-        
-        // 5bits, 7.3.1 NAL unit syntax,
-        // H.264-AVC-ISO_IEC_14496-10.pdf, page 44.
-        //  7: SPS, 8: PPS, 5: I Frame, 1: P Frame
-        SrsAvcNaluType nal_unit_type = (SrsAvcNaluType)(frame[0] & 0x1f);
-        
-        // ignore the nalu type sps(7), pps(8), aud(9)
-        if (nal_unit_type == SrsAvcNaluTypeAccessUnitDelimiter) {
-            continue;
-        }
-
-        // for sps
-        if (avc->is_sps(frame, frame_size)) {
-            std::string sps;
-            if ((ret = avc->sps_demux(frame, frame_size, sps)) != ERROR_SUCCESS) {
-                return ret;
-            }
-        
-            if (h264_sps == sps) {
-                continue;
-            }
-            h264_sps_changed = true;
-            h264_sps = sps;
-        
-            if ((ret = write_h264_sps_pps(dts, pts)) != ERROR_SUCCESS) {
-                return ret;
-            }
-            continue;
-        }
-
-        // for pps
-        if (avc->is_pps(frame, frame_size)) {
-            std::string pps;
-            if ((ret = avc->pps_demux(frame, frame_size, pps)) != ERROR_SUCCESS) {
-                return ret;
-            }
-        
-            if (h264_pps == pps) {
-                continue;
-            }
-            h264_pps_changed = true;
-            h264_pps = pps;
-        
-            if ((ret = write_h264_sps_pps(dts, pts)) != ERROR_SUCCESS) {
-                return ret;
-            }
-            continue;
-        }
-        
-        // ibp frame.
-        // TODO: FIXME: we should group all frames to a rtmp/flv message from one ts message.
-        srs_info("mpegts: demux avc ibp frame size=%d, dts=%d", ibpframe_size, dts);
-        if ((ret = write_h264_ipb_frame(frame, frame_size, dts, pts)) != ERROR_SUCCESS) {
-            return ret;
-        }
-    }
-    
-    return ret;
-}
-
-int SrsMpegtsOverUdp::write_h264_sps_pps(u_int32_t dts, u_int32_t pts)
-{
-    int ret = ERROR_SUCCESS;
-    
-    // TODO: FIMXE: there exists bug, see following comments.
-    // when sps or pps changed, update the sequence header,
-    // for the pps maybe not changed while sps changed.
-    // so, we must check when each video ts message frame parsed.
-    if (!h264_sps_changed || !h264_pps_changed) {
-        return ret;
-    }
-    
-    // h264 raw to h264 packet.
-    std::string sh;
-    if ((ret = avc->mux_sequence_header(h264_sps, h264_pps, dts, pts, sh)) != ERROR_SUCCESS) {
-        return ret;
-    }
-    
-    // h264 packet to flv packet.
-    int8_t frame_type = SrsCodecVideoAVCFrameKeyFrame;
-    int8_t avc_packet_type = SrsCodecVideoAVCTypeSequenceHeader;
-    char* flv = NULL;
-    int nb_flv = 0;
-    if ((ret = avc->mux_avc2flv(sh, frame_type, avc_packet_type, dts, pts, &flv, &nb_flv)) != ERROR_SUCCESS) {
-        return ret;
-    }
-    
-    // the timestamp in rtmp message header is dts.
-    u_int32_t timestamp = dts;
-    if ((ret = rtmp_write_packet(SrsCodecFlvTagVideo, timestamp, flv, nb_flv)) != ERROR_SUCCESS) {
-        return ret;
-    }
-    
-    // reset sps and pps.
-    h264_sps_changed = false;
-    h264_pps_changed = false;
-    h264_sps_pps_sent = true;
-
-    return ret;
-}
-
-int SrsMpegtsOverUdp::write_h264_ipb_frame(char* frame, int frame_size, u_int32_t dts, u_int32_t pts) 
-{
-    int ret = ERROR_SUCCESS;
-    
-    // when sps or pps not sent, ignore the packet.
-    // @see https://github.com/ossrs/srs/issues/203
-    if (!h264_sps_pps_sent) {
-        return ERROR_H264_DROP_BEFORE_SPS_PPS;
-    }
-    
-    // 5bits, 7.3.1 NAL unit syntax,
-    // H.264-AVC-ISO_IEC_14496-10.pdf, page 44.
-    //  7: SPS, 8: PPS, 5: I Frame, 1: P Frame
-    SrsAvcNaluType nal_unit_type = (SrsAvcNaluType)(frame[0] & 0x1f);
-    
-    // for IDR frame, the frame is keyframe.
-    SrsCodecVideoAVCFrame frame_type = SrsCodecVideoAVCFrameInterFrame;
-    if (nal_unit_type == SrsAvcNaluTypeIDR) {
-        frame_type = SrsCodecVideoAVCFrameKeyFrame;
-    }
-
-    std::string ibp;
-    if ((ret = avc->mux_sei_ipb_frame(frame, frame_size, ibp)) != ERROR_SUCCESS) {
-        return ret;
-    }
-    
-    int8_t avc_packet_type = SrsCodecVideoAVCTypeNALU;
-    char* flv = NULL;
-    int nb_flv = 0;
-    if ((ret = avc->mux_avc2flv(ibp, frame_type, avc_packet_type, dts, pts, &flv, &nb_flv)) != ERROR_SUCCESS) {
-        return ret;
-    }
-    
-    // the timestamp in rtmp message header is dts.
-    u_int32_t timestamp = dts;
-    return rtmp_write_packet(SrsCodecFlvTagVideo, timestamp, flv, nb_flv);
-}
-
-int SrsMpegtsOverUdp::on_ts_audio(SrsTsMessage* msg, SrsStream* avs)
-{
-    int ret = ERROR_SUCCESS;
-
-    // ensure rtmp connected.
-    if ((ret = connect()) != ERROR_SUCCESS) {
-        return ret;
-    }
-
-    // ts tbn to flv tbn.
-    u_int32_t dts = msg->dts / 90;
-    
-    // send each frame.
-    while (!avs->empty()) {
-        char* frame = NULL;
-        int frame_size = 0;
-        SrsRawAacStreamCodec codec;
-        if ((ret = aac->adts_demux(avs, &frame, &frame_size, codec)) != ERROR_SUCCESS) {
-            return ret;
-        }
-    
-        // ignore invalid frame,
-        //  * atleast 1bytes for aac to decode the data.
-        if (frame_size <= 0) {
-            continue;
-        }
-        srs_info("mpegts: demux aac frame size=%d, dts=%d", frame_size, dts);
-
-        // generate sh.
-        if (aac_specific_config.empty()) {
-            std::string sh;
-            if ((ret = aac->mux_sequence_header(&codec, sh)) != ERROR_SUCCESS) {
-                return ret;
-            }
-            aac_specific_config = sh;
-
-            codec.aac_packet_type = 0;
-
-            if ((ret = write_audio_raw_frame((char*)sh.data(), (int)sh.length(), &codec, dts)) != ERROR_SUCCESS) {
-                return ret;
-            }
-        }
-
-        // audio raw data.
-        codec.aac_packet_type = 1;
-        if ((ret = write_audio_raw_frame(frame, frame_size, &codec, dts)) != ERROR_SUCCESS) {
-            return ret;
-        }
-    }
-
-    return ret;
-}
-
-int SrsMpegtsOverUdp::write_audio_raw_frame(char* frame, int frame_size, SrsRawAacStreamCodec* codec, u_int32_t dts)
-{
-    int ret = ERROR_SUCCESS;
-
-    char* data = NULL;
-    int size = 0;
-    if ((ret = aac->mux_aac2flv(frame, frame_size, codec, dts, &data, &size)) != ERROR_SUCCESS) {
-        return ret;
-    }
-    
-    return rtmp_write_packet(SrsCodecFlvTagAudio, dts, data, size);
-}
-
-int SrsMpegtsOverUdp::rtmp_write_packet(char type, u_int32_t timestamp, char* data, int size)
+int SrsMpegtsOverUdp::on_rtmp_packet(char type, u_int32_t timestamp, char* data, int size)
 {
     int ret = ERROR_SUCCESS;
     
@@ -590,6 +387,16 @@ int SrsMpegtsOverUdp::rtmp_write_packet(char type, u_int32_t timestamp, char* da
                 msg->is_audio()? "A":msg->is_video()? "V":"N", pprint->age(), msg->timestamp, msg->size);
         }
     
+        // feed the source directly for local publisher.
+        if (publisher) {
+            ret = publisher->on_message(msg);
+            srs_freep(msg);
+            if (ret != ERROR_SUCCESS) {
+                return ret;
+            }
+            continue;
+        }
+    
         // send out encoded msg.
         if ((ret = client->send_and_free_message(msg, stream_id)) != ERROR_SUCCESS) {
             return ret;
@@ -603,12 +410,22 @@ int SrsMpegtsOverUdp::connect()
 {
     int ret = ERROR_SUCCESS;
 
+    // the local publisher unpublished for idle timeout, drop it to republish,
+    // util the unpublish hooks are done, which run in the idle thread.
+    if (publisher && !publisher->is_publishing() && publisher->is_finished()) {
+        srs_warn("mpegts: local publisher unpublished, republish it.");
+        srs_freep(publisher);
+    }
+    
     // when ok, ignore.
     // TODO: FIXME: should reconnect when disconnected.
-    if (io || client) {
+    if (io || client || publisher) {
         return ret;
     }
     
+    // the sequence header must be sent again for the new source.
+    muxer->reset();
+    
     // parse uri
     if (!req) {
         req = new SrsRequest();
@@ -626,6 +443,17 @@ int SrsMpegtsOverUdp::connect()
             req->schema, req->host, req->vhost, req->app, req->port,
             req->param);
     }
+    
+    // publish to the source of local server in process.
+    if (SrsLocalPublisher::is_local(req)) {
+        publisher = new SrsLocalPublisher();
+        if ((ret = publisher->publish(req, peer_ip)) != ERROR_SUCCESS) {
+            srs_error("mpegts: publish in process failed, stream=%s. ret=%d", req->stream.c_str(), ret);
+            srs_freep(publisher);
+            return ret;
+        }
+        return ret;
+    }
 
     // connect host.
     if ((ret = srs_socket_connect(req->host, ::atoi(req->port.c_str()), ST_UTIME_NO_TIMEOUT, &stfd)) != ERROR_SUCCESS) {
@@ -715,6 +543,7 @@ int SrsMpegtsOverUdp::connect_app(string ep_server, string ep_port)
 
 void SrsMpegtsOverUdp::close()
 {
+    srs_freep(publisher);
     srs_freep(client);
     srs_freep(io);
     srs_freep(req);
@@ -43,14 +43,14 @@ class SrsSimpleBuffer;
 class SrsRtmpClient;
 class SrsStSocket;
 class SrsRequest;
-class SrsRawH264Stream;
 class SrsSharedPtrMessage;
-class SrsRawAacStream;
 struct SrsRawAacStreamCodec;
 class SrsPithyPrint;
+class SrsLocalPublisher;
 
 #include <srs_app_st.hpp>
 #include <srs_kernel_ts.hpp>
+#include <srs_raw_avc.hpp>
 #include <srs_app_listener.hpp>
 
 /**
@@ -77,30 +77,26 @@ public:
 * the mpegts over udp stream caster.
 */
 class SrsMpegtsOverUdp : virtual public ISrsTsHandler
-    , virtual public ISrsUdpHandler
+    , virtual public ISrsUdpHandler, virtual public ISrsTsRtmpHandler
 {
 private:
     SrsStream* stream;
     SrsTsContext* context;
     SrsSimpleBuffer* buffer;
     std::string output;
+    // the peer of udp, the client ip of publisher.
+    std::string peer_ip;
 private:
     SrsRequest* req;
     st_netfd_t stfd;
     SrsStSocket* io;
     SrsRtmpClient* client;
     int stream_id;
+    // publish to source in process when output to local server.
+    SrsLocalPublisher* publisher;
 private:
-    SrsRawH264Stream* avc;
-    std::string h264_sps;
-    bool h264_sps_changed;
-    std::string h264_pps;
-    bool h264_pps_changed;
-    bool h264_sps_pps_sent;
-private:
-    SrsRawAacStream* aac;
-    std::string aac_specific_config;
-private:
+    // mux the ts messages to flv packets.
+    SrsTsRtmpMuxer* muxer;
     SrsMpegtsQueue* queue;
     SrsPithyPrint* pprint;
 public:
@@ -109,21 +105,17 @@ public:
 // interface ISrsUdpHandler
 public:
     virtual int on_udp_packet(sockaddr_in* from, char* buf, int nb_buf);
+    virtual int on_udp_packets(SrsUdpPacket* pkts, int nb_pkts);
 private:
     virtual int on_udp_bytes(std::string host, int port, char* buf, int nb_buf);
 // interface ISrsTsHandler
 public:
     virtual int on_ts_message(SrsTsMessage* msg);
+// interface ISrsTsRtmpHandler
+public:
+    virtual int on_rtmp_packet(char type, u_int32_t timestamp, char* data, int size);
 private:
-    virtual int on_ts_video(SrsTsMessage* msg, SrsStream* avs);
-    virtual int write_h264_sps_pps(u_int32_t dts, u_int32_t pts);
-    virtual int write_h264_ipb_frame(char* frame, int frame_size, u_int32_t dts, u_int32_t pts);
-    virtual int on_ts_audio(SrsTsMessage* msg, SrsStream* avs);
-    virtual int write_audio_raw_frame(char* frame, int frame_size, SrsRawAacStreamCodec* codec, u_int32_t dts);
-private:
-    virtual int rtmp_write_packet(char type, u_int32_t timestamp, char* data, int size);
-private:
-    // connect to rtmp output url. 
+    // connect to rtmp output url, or publish in process for local server.
     // @remark ignore when not connected, reconnect when disconnected.
     virtual int connect();
     virtual int connect_app(std::string ep_server, std::string ep_port);
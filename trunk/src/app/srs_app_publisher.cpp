@@ -0,0 +1,478 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <srs_app_publisher.hpp>
+
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_kernel_stream.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_rtmp_stack.hpp>
+#include <srs_protocol_buffer.hpp>
+#include <srs_app_config.hpp>
+#include <srs_app_source.hpp>
+#include <srs_app_server.hpp>
+#include <srs_app_security.hpp>
+#include <srs_app_refer.hpp>
+#include <srs_app_statistic.hpp>
+#include <srs_app_http_hooks.hpp>
+#include <srs_app_utility.hpp>
+
+// the interval in us to check the idle timeout of publisher.
+#define SRS_LOCAL_PUBLISHER_CHECK_US (1000 * 1000)
+// the interval in us to wait for the idle thread to finish unpublish.
+#define SRS_LOCAL_PUBLISHER_WAIT_US (10 * 1000)
+
+SrsLocalPublisher::SrsLocalPublisher(bool idle)
+{
+    id = 0;
+    req = NULL;
+    source = NULL;
+    security = new SrsSecurity();
+    refer = new SrsRefer();
+    state = SrsLocalPublisherStateInit;
+    nb_bytes = 0;
+    nb_msgs = 0;
+    last_msg_time = 0;
+    check_idle = idle;
+    pthread = new SrsReusableThread("publish", this, SRS_LOCAL_PUBLISHER_CHECK_US);
+}
+
+SrsLocalPublisher::~SrsLocalPublisher()
+{
+    // wait for the idle thread to finish unpublish,
+    // for stop the thread will interrupt the hooks.
+    while (state == SrsLocalPublisherStateUnpublishing) {
+        st_usleep(SRS_LOCAL_PUBLISHER_WAIT_US);
+    }
+    
+    pthread->stop();
+    srs_freep(pthread);
+    
+    unpublish();
+    
+    srs_freep(req);
+    srs_freep(security);
+    srs_freep(refer);
+}
+
+bool SrsLocalPublisher::is_local(SrsRequest* r)
+{
+    // the edge proxy the publish to origin, use rtmp client.
+    if (_srs_config->get_vhost_is_edge(r->vhost)) {
+        return false;
+    }
+    
+    // the host must be the loopback or the ip of server.
+    if (r->host != SRS_CONSTS_LOCALHOST && r->host != "localhost") {
+        vector<string>& ips = srs_get_local_ipv4_ips();
+        if (std::find(ips.begin(), ips.end(), r->host) == ips.end()) {
+            return false;
+        }
+    }
+    
+    // the port must be the rtmp listen port.
+    int port = ::atoi(r->port.c_str());
+    vector<string> ip_ports = _srs_config->get_listens();
+    for (int i = 0; i < (int)ip_ports.size(); i++) {
+        string listen_ip;
+        int listen_port;
+        srs_parse_endpoint(ip_ports[i], listen_ip, listen_port);
+        
+        if (listen_port == port) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+int SrsLocalPublisher::publish(SrsRequest* r, string client_ip)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_freep(req);
+    req = r->copy();
+    req->ip = ip = client_ip;
+    id = _srs_context->get_id();
+    nb_bytes = 0;
+    nb_msgs = 0;
+    
+    if ((ret = check_vhost()) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if ((ret = security->check(SrsRtmpConnFMLEPublish, ip, req)) != ERROR_SUCCESS) {
+        srs_error("local publish security check failed. ret=%d", ret);
+        return ret;
+    }
+    
+    // find a source to serve.
+    source = SrsSource::fetch(req);
+    if (!source) {
+        if ((ret = SrsSource::create(req, _srs_server, _srs_server, &source)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    srs_assert(source != NULL);
+    
+    // update the statistic when source disconveried.
+    SrsStatistic* stat = SrsStatistic::instance();
+    if ((ret = stat->on_client(id, req, NULL, SrsRtmpConnFMLEPublish)) != ERROR_SUCCESS) {
+        srs_error("local publish stat client failed. ret=%d", ret);
+        return ret;
+    }
+    source->set_cache(_srs_config->get_gop_cache(req->vhost));
+    
+    if ((ret = refer->check(req->pageUrl, _srs_config->get_refer_publish(req->vhost))) != ERROR_SUCCESS) {
+        srs_error("local publish check publish_refer failed. ret=%d", ret);
+        return ret;
+    }
+    
+    if ((ret = http_hooks_on_publish()) != ERROR_SUCCESS) {
+        srs_error("local publish http hook on_publish failed. ret=%d", ret);
+        return ret;
+    }
+    
+    // the hooks maybe switch context, check it again.
+    if (!source->can_publish(false)) {
+        ret = ERROR_SYSTEM_STREAM_BUSY;
+        srs_warn("local publish stream %s is already publishing. ret=%d", req->get_stream_url().c_str(), ret);
+        http_hooks_on_unpublish();
+        return ret;
+    }
+    
+    // when the on_publish failed in the middle-way, the publish state changed,
+    // so we always release it when unpublish.
+    state = SrsLocalPublisherStatePublishing;
+    if ((ret = source->on_publish()) != ERROR_SUCCESS) {
+        srs_error("local publish notify publish failed. ret=%d", ret);
+        return ret;
+    }
+    
+    // start to check the idle timeout.
+    last_msg_time = srs_get_system_time_ms();
+    if (check_idle && (ret = pthread->start()) != ERROR_SUCCESS) {
+        srs_error("local publish start idle check failed. ret=%d", ret);
+        return ret;
+    }
+    
+    srs_trace("local publish %s, ip=%s, source_id=%d", req->get_stream_url().c_str(), ip.c_str(), source->source_id());
+    
+    return ret;
+}
+
+void SrsLocalPublisher::unpublish()
+{
+    // ignore when not published or unpublishing by other thread.
+    if (!req || state == SrsLocalPublisherStateUnpublishing) {
+        return;
+    }
+    
+    // the hooks maybe switch context, user should never feed or free it.
+    bool publishing = (state == SrsLocalPublisherStatePublishing);
+    state = SrsLocalPublisherStateUnpublishing;
+    
+    if (publishing) {
+        source->on_unpublish();
+        http_hooks_on_unpublish();
+        
+        srs_trace("local unpublish %s, ip=%s, bytes=%"PRId64, req->get_stream_url().c_str(), ip.c_str(), nb_bytes);
+    }
+    
+    // the on_connect maybe called even the publish failed.
+    http_hooks_on_close();
+    SrsStatistic::instance()->on_disconnect(id);
+    
+    source = NULL;
+    srs_freep(req);
+    
+    state = SrsLocalPublisherStateFinished;
+}
+
+bool SrsLocalPublisher::is_publishing()
+{
+    return state == SrsLocalPublisherStatePublishing;
+}
+
+bool SrsLocalPublisher::is_finished()
+{
+    return state == SrsLocalPublisherStateFinished;
+}
+
+int SrsLocalPublisher::on_message(SrsSharedPtrMessage* msg)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // unpublished for idle timeout, user should republish.
+    if (state != SrsLocalPublisherStatePublishing) {
+        ret = ERROR_SOCKET_TIMEOUT;
+        srs_warn("local publish ignore message for unpublished. ret=%d", ret);
+        return ret;
+    }
+    
+    nb_bytes += msg->size;
+    nb_msgs++;
+    last_msg_time = srs_get_system_time_ms();
+    
+    if (msg->is_audio()) {
+        if ((ret = source->on_audio(msg)) != ERROR_SUCCESS) {
+            srs_error("local publish process audio message failed. ret=%d", ret);
+            return ret;
+        }
+        return ret;
+    }
+    
+    if (msg->is_video()) {
+        if ((ret = source->on_video(msg)) != ERROR_SUCCESS) {
+            srs_error("local publish process video message failed. ret=%d", ret);
+            return ret;
+        }
+        return ret;
+    }
+    
+    return on_meta_data(msg);
+}
+
+int SrsLocalPublisher::cycle()
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (state != SrsLocalPublisherStatePublishing) {
+        return ret;
+    }
+    
+    // when not got msgs, wait for a larger timeout.
+    // @see https://github.com/ossrs/srs/issues/441
+    int timeout = nb_msgs? _srs_config->get_publish_normal_timeout(req->vhost)
+        : _srs_config->get_publish_1stpkt_timeout(req->vhost);
+    
+    int64_t elapsed = srs_get_system_time_ms() - last_msg_time;
+    if (elapsed < timeout) {
+        return ret;
+    }
+    
+    srs_warn("local publish %s timeout %dms, nb_msgs=%"PRId64", elapsed=%"PRId64"ms",
+        req->get_stream_url().c_str(), timeout, nb_msgs, elapsed);
+    
+    // release the source and call the hooks, same to rtmp publisher.
+    unpublish();
+    
+    return ret;
+}
+
+int SrsLocalPublisher::check_vhost()
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsConfDirective* vhost = _srs_config->get_vhost(req->vhost);
+    if (vhost == NULL) {
+        ret = ERROR_RTMP_VHOST_NOT_FOUND;
+        srs_error("local publish vhost %s not found. ret=%d", req->vhost.c_str(), ret);
+        return ret;
+    }
+    
+    if (!_srs_config->get_vhost_enabled(req->vhost)) {
+        ret = ERROR_RTMP_VHOST_NOT_FOUND;
+        srs_error("local publish vhost %s disabled. ret=%d", req->vhost.c_str(), ret);
+        return ret;
+    }
+    
+    if (req->vhost != vhost->arg0()) {
+        srs_trace("vhost change from %s to %s", req->vhost.c_str(), vhost->arg0().c_str());
+        req->vhost = vhost->arg0();
+    }
+    
+    if ((ret = refer->check(req->pageUrl, _srs_config->get_refer(req->vhost))) != ERROR_SUCCESS) {
+        srs_error("local publish check refer failed. ret=%d", ret);
+        return ret;
+    }
+    
+    if ((ret = http_hooks_on_connect()) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return ret;
+}
+
+int SrsLocalPublisher::on_meta_data(SrsSharedPtrMessage* msg)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsStream stream;
+    if ((ret = stream.initialize(msg->payload, msg->size)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // ignore the data message which is not metadata.
+    SrsOnMetaDataPacket metadata;
+    if (metadata.decode(&stream) != ERROR_SUCCESS) {
+        srs_info("local publish ignore AMF0 data message.");
+        return ret;
+    }
+    
+    // the source use the header and size of message,
+    // and encode the metadata to payload again.
+    SrsCommonMessage common;
+    common.header.initialize_amf0_script(msg->size, msg->stream_id);
+    common.header.timestamp = msg->timestamp;
+    common.size = msg->size;
+    
+    if ((ret = source->on_meta_data(&common, &metadata)) != ERROR_SUCCESS) {
+        srs_error("local publish process onMetaData message failed. ret=%d", ret);
+        return ret;
+    }
+    
+    return ret;
+}
+
+int SrsLocalPublisher::http_hooks_on_connect()
+{
+    int ret = ERROR_SUCCESS;
+    
+#ifdef SRS_AUTO_HTTP_CALLBACK
+    if (!_srs_config->get_vhost_http_hooks_enabled(req->vhost)) {
+        return ret;
+    }
+    
+    // the http hooks will cause context switch,
+    // so we must copy all hooks for the on_connect may freed.
+    vector<string> hooks;
+    
+    if (true) {
+        SrsConfDirective* conf = _srs_config->get_vhost_on_connect(req->vhost);
+        
+        if (!conf) {
+            srs_info("ignore the empty http callback: on_connect");
+            return ret;
+        }
+        
+        hooks = conf->args;
+    }
+    
+    for (int i = 0; i < (int)hooks.size(); i++) {
+        std::string url = hooks.at(i);
+        if ((ret = SrsHttpHooks::on_connect(url, req)) != ERROR_SUCCESS) {
+            srs_error("hook client on_connect failed. url=%s, ret=%d", url.c_str(), ret);
+            return ret;
+        }
+    }
+#endif
+    
+    return ret;
+}
+
+void SrsLocalPublisher::http_hooks_on_close()
+{
+#ifdef SRS_AUTO_HTTP_CALLBACK
+    if (!_srs_config->get_vhost_http_hooks_enabled(req->vhost)) {
+        return;
+    }
+    
+    vector<string> hooks;
+    
+    if (true) {
+        SrsConfDirective* conf = _srs_config->get_vhost_on_close(req->vhost);
+        
+        if (!conf) {
+            srs_info("ignore the empty http callback: on_close");
+            return;
+        }
+        
+        hooks = conf->args;
+    }
+    
+    for (int i = 0; i < (int)hooks.size(); i++) {
+        std::string url = hooks.at(i);
+        SrsHttpHooks::on_close(url, req, 0, nb_bytes);
+    }
+#endif
+}
+
+int SrsLocalPublisher::http_hooks_on_publish()
+{
+    int ret = ERROR_SUCCESS;
+    
+#ifdef SRS_AUTO_HTTP_CALLBACK
+    if (!_srs_config->get_vhost_http_hooks_enabled(req->vhost)) {
+        return ret;
+    }
+    
+    vector<string> hooks;
+    
+    if (true) {
+        SrsConfDirective* conf = _srs_config->get_vhost_on_publish(req->vhost);
+        
+        if (!conf) {
+            srs_info("ignore the empty http callback: on_publish");
+            return ret;
+        }
+        
+        hooks = conf->args;
+    }
+    
+    for (int i = 0; i < (int)hooks.size(); i++) {
+        std::string url = hooks.at(i);
+        if ((ret = SrsHttpHooks::on_publish(url, req)) != ERROR_SUCCESS) {
+            srs_error("hook client on_publish failed. url=%s, ret=%d", url.c_str(), ret);
+            return ret;
+        }
+    }
+#endif
+    
+    return ret;
+}
+
+void SrsLocalPublisher::http_hooks_on_unpublish()
+{
+#ifdef SRS_AUTO_HTTP_CALLBACK
+    if (!_srs_config->get_vhost_http_hooks_enabled(req->vhost)) {
+        return;
+    }
+    
+    vector<string> hooks;
+    
+    if (true) {
+        SrsConfDirective* conf = _srs_config->get_vhost_on_unpublish(req->vhost);
+        
+        if (!conf) {
+            srs_info("ignore the empty http callback: on_unpublish");
+            return;
+        }
+        
+        hooks = conf->args;
+    }
+    
+    for (int i = 0; i < (int)hooks.size(); i++) {
+        std::string url = hooks.at(i);
+        SrsHttpHooks::on_unpublish(url, req);
+    }
+#endif
+}
+
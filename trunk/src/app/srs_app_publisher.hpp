@@ -0,0 +1,147 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef SRS_APP_PUBLISHER_HPP
+#define SRS_APP_PUBLISHER_HPP
+
+/*
+#include <srs_app_publisher.hpp>
+*/
+#include <srs_core.hpp>
+
+#include <string>
+
+#include <srs_app_thread.hpp>
+
+class SrsRequest;
+class SrsSource;
+class SrsSecurity;
+class SrsRefer;
+class SrsSharedPtrMessage;
+
+/**
+* the state of local publisher.
+*/
+enum SrsLocalPublisherState
+{
+    SrsLocalPublisherStateInit = 0,
+    // the source is acquired, feed the messages to it.
+    SrsLocalPublisherStatePublishing,
+    // releasing the source and calling the hooks, which maybe switch context.
+    SrsLocalPublisherStateUnpublishing,
+    // unpublished, user can free the publisher.
+    SrsLocalPublisherStateFinished
+};
+
+/**
+* the publisher in process, for the stream casters to publish to source directly,
+* without the loopback rtmp client, which chunk, send, parse and copy each frame again.
+* the publisher does the same security, refer, http hooks and stat as rtmp publisher.
+* @remark only for the output url to local rtmp server and vhost is not edge,
+*       user should use the rtmp client for other urls, @see is_local().
+* @remark the publisher unpublish when idle timeout, same to rtmp publisher,
+*       user should check is_publishing() and republish by a new publisher,
+*       and free the old one when is_finished(), for the unpublish hooks run
+*       in the idle thread, which is interrupted when free the publisher.
+*/
+class SrsLocalPublisher : public ISrsReusableThreadHandler
+{
+protected:
+    // the id of publisher in stat, the context id of caster.
+    int id;
+    // the ip of client, the peer of caster.
+    std::string ip;
+    SrsRequest* req;
+    SrsSource* source;
+    SrsSecurity* security;
+    SrsRefer* refer;
+    // the state of publisher, @see SrsLocalPublisherState.
+    SrsLocalPublisherState state;
+    // the bytes fed to source, for on_close hooks.
+    int64_t nb_bytes;
+    // the thread to check the idle timeout.
+    SrsReusableThread* pthread;
+    // the messages fed to source, and the time in ms of last message.
+    int64_t nb_msgs;
+    int64_t last_msg_time;
+    // whether unpublish when idle timeout.
+    bool check_idle;
+public:
+    /**
+    * @param idle whether unpublish when idle timeout, the user which feeds in burst,
+    *       for instance, the hls ingester, should check the timeout itself.
+    */
+    SrsLocalPublisher(bool idle = true);
+    virtual ~SrsLocalPublisher();
+public:
+    /**
+    * whether the request can be published in process,
+    * that is, the host is local, the port is the rtmp listen port,
+    * and the vhost is not edge.
+    */
+    static bool is_local(SrsRequest* r);
+public:
+    /**
+    * start to publish the stream, check the vhost, security and refer,
+    * call the on_publish http hooks, then acquire the source.
+    * @param r the request to publish, copied by publisher.
+    * @param client_ip the ip of client, for security and stat.
+    * @remark user must call unpublish() when publish failed or done.
+    */
+    virtual int publish(SrsRequest* r, std::string client_ip);
+    /**
+    * stop publish, release the source and call the on_unpublish and on_close http hooks.
+    * @remark ignore when not published.
+    */
+    virtual void unpublish();
+    /**
+    * whether the stream is publishing, false when unpublished for idle timeout.
+    */
+    virtual bool is_publishing();
+    /**
+    * whether the unpublish is done, false when the hooks are running.
+    */
+    virtual bool is_finished();
+    /**
+    * feed the audio, video or metadata message to source,
+    * @remark user must free the msg, source copy it when need to keep it.
+    * @return ERROR_SOCKET_TIMEOUT when unpublished for idle timeout.
+    */
+    virtual int on_message(SrsSharedPtrMessage* msg);
+// interface ISrsReusableThreadHandler
+public:
+    /**
+    * unpublish when no message for publish_normal_timeout,
+    * or publish_1stpkt_timeout before the first message.
+    */
+    virtual int cycle();
+protected:
+    virtual int check_vhost();
+    virtual int on_meta_data(SrsSharedPtrMessage* msg);
+    virtual int http_hooks_on_connect();
+    virtual void http_hooks_on_close();
+    virtual int http_hooks_on_publish();
+    virtual void http_hooks_on_unpublish();
+};
+
+#endif
@@ -74,7 +74,7 @@ using namespace std;
 // when edge timeout, retry next.
 #define SRS_EDGE_TOKEN_TRAVERSE_TIMEOUT_US (int64_t)(3*1000*1000LL)
 
-SrsRtmpConn::SrsRtmpConn(SrsServer* svr, st_netfd_t c)
+SrsRtmpConn::SrsRtmpConn(SrsServer* svr, st_netfd_t c, bool is_relay)
     : SrsConnection(svr, c)
 {
     server = svr;
@@ -95,16 +95,16 @@ SrsRtmpConn::SrsRtmpConn(SrsServer* svr, st_netfd_t c)
     realtime = SRS_PERF_MIN_LATENCY_ENABLED;
     send_min_interval = 0;
     tcp_nodelay = false;
+    relay = is_relay;
+    index_handle = -1;
 
     external_shell = _srs_config->get_external_shell();
-
-    _srs_config->subscribe(this);
+    
+    // the reload of vhost is notified by server, from the vhost index of connections.
 }
 
 SrsRtmpConn::~SrsRtmpConn()
 {
-    _srs_config->unsubscribe(this);
-    
     srs_freep(req);
     srs_freep(res);
     srs_freep(rtmp);
@@ -125,6 +125,11 @@ void SrsRtmpConn::dispose()
     }
 }
 
+int SrsRtmpConn::get_recv_buffer_size()
+{
+    return rtmp->get_recv_buffer_size();
+}
+
 // TODO: return detail message when error for client.
 int SrsRtmpConn::do_cycle()
 {
@@ -505,8 +510,9 @@ int SrsRtmpConn::stream_service_cycle()
     srs_assert(source != NULL);
     
     // update the statistic when source disconveried.
+    // the relay is stat by the worker of players.
     SrsStatistic* stat = SrsStatistic::instance();
-    if ((ret = stat->on_client(_srs_context->get_id(), req, this, type)) != ERROR_SUCCESS) {
+    if (!relay && (ret = stat->on_client(_srs_context->get_id(), req, this, type)) != ERROR_SUCCESS) {
         srs_error("stat client failed. ret=%d", ret);
         return ret;
     }
@@ -592,6 +598,9 @@ int SrsRtmpConn::check_vhost()
         req->vhost = vhost->arg0();
     }
     
+    // the vhost is identified, to notify the reload of vhost.
+    server->on_conn_vhost(this, req->vhost);
+    
     if ((ret = refer->check(req->pageUrl, _srs_config->get_refer(req->vhost))) != ERROR_SUCCESS) {
         srs_error("check refer failed. ret=%d", ret);
         return ret;
@@ -733,7 +742,7 @@ int SrsRtmpConn::do_playing(SrsSource* source, SrsConsumer* consumer, SrsQueueRe
 #endif
         
         // get messages from consumer.
-        // each msg in msgs.msgs must be free, for the SrsMessageArray never free them.
+        // each msg in msgs.msgs is owned by consumer, which is released when dump next time.
         // @remark when enable send_min_interval, only fetch one message a time.
         int count = (send_min_interval > 0)? 1 : 0;
         if ((ret = consumer->dump_packets(&msgs, count)) != ERROR_SUCCESS) {
@@ -783,7 +792,7 @@ int SrsRtmpConn::do_playing(SrsSource* source, SrsConsumer* consumer, SrsQueueRe
                 SrsSharedPtrMessage* msg = msgs.msgs[i];
                 
                 // foreach msg, collect the duration.
-                // @remark: never use msg when sent it, for the protocol sdk will free it.
+                // @remark: never use msg when dump next time, for the consumer will release it.
                 if (starttime < 0 || starttime > msg->timestamp) {
                     starttime = msg->timestamp;
                 }
@@ -792,9 +801,9 @@ int SrsRtmpConn::do_playing(SrsSource* source, SrsConsumer* consumer, SrsQueueRe
             }
         }
         
-        // sendout messages, all messages are freed by send_and_free_messages().
+        // sendout messages, all messages are owned and released by consumer.
         // no need to assert msg, for the rtmp will assert it.
-        if (count > 0 && (ret = rtmp->send_and_free_messages(msgs.msgs, count, res->stream_id)) != ERROR_SUCCESS) {
+        if (count > 0 && (ret = rtmp->send_messages(msgs.msgs, count, res->stream_id)) != ERROR_SUCCESS) {
             if (!srs_is_client_gracefully_close(ret)) {
                 srs_error("send messages to client failed. ret=%d", ret);
             }
@@ -1344,6 +1353,11 @@ int SrsRtmpConn::http_hooks_on_connect()
     int ret = ERROR_SUCCESS;
     
 #ifdef SRS_AUTO_HTTP_CALLBACK
+    // the hooks of relay is done by the worker of players.
+    if (relay) {
+        return ret;
+    }
+    
     if (!_srs_config->get_vhost_http_hooks_enabled(req->vhost)) {
         return ret;
     }
@@ -1379,6 +1393,11 @@ int SrsRtmpConn::http_hooks_on_connect()
 void SrsRtmpConn::http_hooks_on_close()
 {
 #ifdef SRS_AUTO_HTTP_CALLBACK
+    // the hooks of relay is done by the worker of players.
+    if (relay) {
+        return;
+    }
+    
     if (!_srs_config->get_vhost_http_hooks_enabled(req->vhost)) {
         return;
     }
@@ -1478,6 +1497,11 @@ int SrsRtmpConn::http_hooks_on_play()
     int ret = ERROR_SUCCESS;
     
 #ifdef SRS_AUTO_HTTP_CALLBACK
+    // the hooks of relay is done by the worker of players.
+    if (relay) {
+        return ret;
+    }
+    
     if (!_srs_config->get_vhost_http_hooks_enabled(req->vhost)) {
         return ret;
     }
@@ -1513,6 +1537,11 @@ int SrsRtmpConn::http_hooks_on_play()
 void SrsRtmpConn::http_hooks_on_stop()
 {
 #ifdef SRS_AUTO_HTTP_CALLBACK
+    // the hooks of relay is done by the worker of players.
+    if (relay) {
+        return;
+    }
+    
     if (!_srs_config->get_vhost_http_hooks_enabled(req->vhost)) {
         return;
     }
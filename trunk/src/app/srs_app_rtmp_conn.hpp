@@ -62,6 +62,8 @@ class SrsRtmpConn : public virtual SrsConnection, public virtual ISrsReloadHandl
 {
     // for the thread to directly access any field of connection.
     friend class SrsPublishRecvThread;
+    // for the server to index the connection by vhost.
+    friend class SrsServer;
 private:
     SrsServer* server;
     SrsRequest* req;
@@ -94,11 +96,18 @@ private:
     // whether enable the tcp_nodelay.
     bool tcp_nodelay;
     std::string external_shell;
+    // whether the client is the relay of other worker, which plays for its players,
+    // so ignore the hooks and stat, which are done by the worker of players.
+    bool relay;
+    // the vhost and position of connection in the vhost index of server.
+    std::string index_vhost;
+    int index_handle;
 public:
-    SrsRtmpConn(SrsServer* svr, st_netfd_t c);
+    SrsRtmpConn(SrsServer* svr, st_netfd_t c, bool is_relay);
     virtual ~SrsRtmpConn();
 public:
     virtual void dispose();
+    virtual int get_recv_buffer_size();
 protected:
     virtual int do_cycle();
 // interface ISrsReloadHandler
@@ -42,16 +42,17 @@ using namespace std;
 #include <srs_raw_avc.hpp>
 #include <srs_kernel_codec.hpp>
 #include <srs_app_pithy_print.hpp>
+#include <srs_app_publisher.hpp>
 
 #ifdef SRS_AUTO_STREAM_CASTER
 
-SrsRtpConn::SrsRtpConn(SrsRtspConn* r, int p, int sid)
+SrsRtpConn::SrsRtpConn(SrsRtspConn* r, int p, int sid, int rb)
 {
     rtsp = r;
     _port = p;
     stream_id = sid;
     // TODO: support listen at <[ip:]port>
-    listener = new SrsUdpListener(this, "0.0.0.0", p);
+    listener = new SrsUdpListener(this, "0.0.0.0", p, rb);
     cache = new SrsRtpPacket();
     pprint = SrsPithyPrint::create_caster();
 }
@@ -197,6 +198,7 @@ SrsRtspConn::SrsRtspConn(SrsRtspCaster* c, st_netfd_t fd, std::string o)
     req = NULL;
     io = NULL;
     client = NULL;
+    publisher = NULL;
     stream_id = 0;
     vjitter = new SrsRtspJitter();
     ajitter = new SrsRtspJitter();
@@ -218,6 +220,7 @@ SrsRtspConn::~SrsRtspConn()
     srs_freep(skt);
     srs_freep(rtsp);
     
+    srs_freep(publisher);
     srs_freep(client);
     srs_freep(io);
     srs_freep(req);
@@ -310,10 +313,10 @@ int SrsRtspConn::do_cycle()
             SrsRtpConn* rtp = NULL;
             if (req->stream_id == video_id) {
                 srs_freep(video_rtp);
-                rtp = video_rtp = new SrsRtpConn(this, lpm, video_id);
+                rtp = video_rtp = new SrsRtpConn(this, lpm, video_id, caster->rtp_recv_buffer());
             } else {
                 srs_freep(audio_rtp);
-                rtp = audio_rtp = new SrsRtpConn(this, lpm, audio_id);
+                rtp = audio_rtp = new SrsRtpConn(this, lpm, audio_id, caster->rtp_recv_buffer());
             }
             if ((ret = rtp->listen()) != ERROR_SUCCESS) {
                 srs_error("rtsp: rtp listen at port=%d failed. ret=%d", lpm, ret);
@@ -630,6 +633,13 @@ int SrsRtspConn::rtmp_write_packet(char type, u_int32_t timestamp, char* data, i
         return ret;
     }
     srs_assert(msg);
+    
+    // feed the source directly for local publisher.
+    if (publisher) {
+        ret = publisher->on_message(msg);
+        srs_freep(msg);
+        return ret;
+    }
 
     // send out encoded msg.
     if ((ret = client->send_and_free_message(msg, stream_id)) != ERROR_SUCCESS) {
@@ -644,8 +654,15 @@ int SrsRtspConn::connect()
 {
     int ret = ERROR_SUCCESS;
 
+    // the local publisher unpublished for idle timeout, drop it to republish,
+    // util the unpublish hooks are done, which run in the idle thread.
+    if (publisher && !publisher->is_publishing() && publisher->is_finished()) {
+        srs_warn("rtsp: local publisher unpublished, republish it.");
+        srs_freep(publisher);
+    }
+    
     // when ok, ignore.
-    if (io || client) {
+    if (io || client || publisher) {
         return ret;
     }
     
@@ -674,6 +691,17 @@ int SrsRtspConn::connect()
             req->schema, req->host, req->vhost, req->app, req->port,
             req->param);
     }
+    
+    // publish to the source of local server in process.
+    if (SrsLocalPublisher::is_local(req)) {
+        publisher = new SrsLocalPublisher();
+        if ((ret = publisher->publish(req, srs_get_peer_ip(st_netfd_fileno(stfd)))) != ERROR_SUCCESS) {
+            srs_error("rtsp: publish in process failed, stream=%s. ret=%d", req->stream.c_str(), ret);
+            srs_freep(publisher);
+            return ret;
+        }
+        return write_sequence_header();
+    }
 
     // connect host.
     if ((ret = srs_socket_connect(req->host, ::atoi(req->port.c_str()), ST_UTIME_NO_TIMEOUT, &stfd)) != ERROR_SUCCESS) {
@@ -767,6 +795,7 @@ SrsRtspCaster::SrsRtspCaster(SrsConfDirective* c)
     output = _srs_config->get_stream_caster_output(c);
     local_port_min = _srs_config->get_stream_caster_rtp_port_min(c);
     local_port_max = _srs_config->get_stream_caster_rtp_port_max(c);
+    recv_buffer = _srs_config->get_stream_caster_recv_buffer(c);
 }
 
 SrsRtspCaster::~SrsRtspCaster()
@@ -806,6 +835,11 @@ void SrsRtspCaster::free_port(int lpmin, int lpmax)
     srs_trace("rtsp: free rtp port=%d-%d", lpmin, lpmax);
 }
 
+int SrsRtspCaster::rtp_recv_buffer()
+{
+    return recv_buffer;
+}
+
 int SrsRtspCaster::on_tcp_client(st_netfd_t stfd)
 {
     int ret = ERROR_SUCCESS;
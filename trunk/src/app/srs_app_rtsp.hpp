@@ -56,6 +56,7 @@ class SrsSharedPtrMessage;
 class SrsCodecSample;
 class SrsSimpleBuffer;
 class SrsPithyPrint;
+class SrsLocalPublisher;
 
 /**
 * a rtp connection which transport a stream.
@@ -70,7 +71,7 @@ private:
     int stream_id;
     int _port;
 public:
-    SrsRtpConn(SrsRtspConn* r, int p, int sid);
+    SrsRtpConn(SrsRtspConn* r, int p, int sid, int rb);
     virtual ~SrsRtpConn();
 public:
     virtual int port();
@@ -141,6 +142,8 @@ private:
     SrsRequest* req;
     SrsStSocket* io;
     SrsRtmpClient* client;
+    // publish to source in process when output to local server.
+    SrsLocalPublisher* publisher;
     SrsRtspJitter* vjitter;
     SrsRtspJitter* ajitter;
     int stream_id;
@@ -178,7 +181,7 @@ private:
     virtual int write_audio_raw_frame(char* frame, int frame_size, SrsRawAacStreamCodec* codec, u_int32_t dts);
     virtual int rtmp_write_packet(char type, u_int32_t timestamp, char* data, int size);
 private:
-    // connect to rtmp output url. 
+    // connect to rtmp output url, or publish in process for local server.
     // @remark ignore when not connected, reconnect when disconnected.
     virtual int connect();
     virtual int connect_app(std::string ep_server, std::string ep_port);
@@ -193,6 +196,8 @@ private:
     std::string output;
     int local_port_min;
     int local_port_max;
+    // the SO_RCVBUF of rtp socket.
+    int recv_buffer;
     // key: port, value: whether used.
     std::map<int, bool> used_ports;
 private:
@@ -210,6 +215,10 @@ public:
     * free the alloced rtp port.
     */
     virtual void free_port(int lpmin, int lpmax);
+    /**
+    * the recv buffer of rtp socket, 0 to use system default.
+    */
+    virtual int rtp_recv_buffer();
 // interface ISrsTcpHandler
 public:
     virtual int on_tcp_client(st_netfd_t stfd);
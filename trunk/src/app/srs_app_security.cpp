@@ -25,6 +25,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include <srs_kernel_error.hpp>
 #include <srs_app_config.hpp>
+#include <srs_kernel_cidr.hpp>
 
 using namespace std;
 
@@ -48,112 +49,57 @@ int SrsSecurity::check(SrsRtmpConnType type, string ip, SrsRequest* req)
     // default to deny all when security enabled.
     ret = ERROR_SYSTEM_SECURITY;
     
-    // rules to apply
-    SrsConfDirective* rules = _srs_config->get_security_rules(req->vhost);
-    if (!rules) {
-        return ret;
-    }
+    // parse the ip once for all rules,
+    // the invalid ip only match the rule all.
+    u_int8_t buf[SRS_CIDR_ADDRESS_SIZE];
+    u_int8_t* addr = SrsCidrTrie::parse(ip, buf)? buf : NULL;
     
     // allow if matches allow strategy.
-    if (allow_check(rules, type, ip) == ERROR_SYSTEM_SECURITY_ALLOW) {
+    if (allow_check(_srs_config->get_security_allow(req->vhost), type, addr) == ERROR_SYSTEM_SECURITY_ALLOW) {
         ret = ERROR_SUCCESS;
     }
     
     // deny if matches deny strategy.
-    if (deny_check(rules, type, ip) == ERROR_SYSTEM_SECURITY_DENY) {
+    if (deny_check(_srs_config->get_security_deny(req->vhost), type, addr) == ERROR_SYSTEM_SECURITY_DENY) {
         ret = ERROR_SYSTEM_SECURITY_DENY;
     }
     
     return ret;
 }
 
-int SrsSecurity::allow_check(SrsConfDirective* rules, SrsRtmpConnType type, std::string ip)
+int SrsSecurity::allow_check(SrsCidrTrie* rules, SrsRtmpConnType type, u_int8_t* addr)
 {
     int ret = ERROR_SUCCESS;
     
-    for (int i = 0; i < (int)rules->directives.size(); i++) {
-        SrsConfDirective* rule = rules->at(i);
-        
-        if (rule->name != "allow") {
-            continue;
-        }
-
-        switch (type) {
-            case SrsRtmpConnPlay:
-                if (rule->arg0() != "play") {
-                    break;
-                }
-                if (rule->arg1() == "all" || rule->arg1() == ip) {
-                    ret = ERROR_SYSTEM_SECURITY_ALLOW;
-                    break;
-                }
-                break;
-            case SrsRtmpConnFMLEPublish:
-            case SrsRtmpConnFlashPublish:
-                if (rule->arg0() != "publish") {
-                    break;
-                }
-                if (rule->arg1() == "all" || rule->arg1() == ip) {
-                    ret = ERROR_SYSTEM_SECURITY_ALLOW;
-                    break;
-                }
-                break;
-            case SrsRtmpConnUnknown:
-            default:
-                break;
-        }
-        
-        // when matched, donot search more.
-        if (ret == ERROR_SYSTEM_SECURITY_ALLOW) {
-            break;
-        }
+    if ((rules->match(addr) & type_mask(type)) != 0) {
+        ret = ERROR_SYSTEM_SECURITY_ALLOW;
     }
     
     return ret;
 }
 
-int SrsSecurity::deny_check(SrsConfDirective* rules, SrsRtmpConnType type, std::string ip)
+int SrsSecurity::deny_check(SrsCidrTrie* rules, SrsRtmpConnType type, u_int8_t* addr)
 {
     int ret = ERROR_SUCCESS;
     
-    for (int i = 0; i < (int)rules->directives.size(); i++) {
-        SrsConfDirective* rule = rules->at(i);
-        
-        if (rule->name != "deny") {
-            continue;
-        }
-
-        switch (type) {
-            case SrsRtmpConnPlay:
-                if (rule->arg0() != "play") {
-                    break;
-                }
-                if (rule->arg1() == "all" || rule->arg1() == ip) {
-                    ret = ERROR_SYSTEM_SECURITY_DENY;
-                    break;
-                }
-                break;
-            case SrsRtmpConnFMLEPublish:
-            case SrsRtmpConnFlashPublish:
-                if (rule->arg0() != "publish") {
-                    break;
-                }
-                if (rule->arg1() == "all" || rule->arg1() == ip) {
-                    ret = ERROR_SYSTEM_SECURITY_DENY;
-                    break;
-                }
-                break;
-            case SrsRtmpConnUnknown:
-            default:
-                break;
-        }
-        
-        // when matched, donot search more.
-        if (ret == ERROR_SYSTEM_SECURITY_DENY) {
-            break;
-        }
+    if ((rules->match(addr) & type_mask(type)) != 0) {
+        ret = ERROR_SYSTEM_SECURITY_DENY;
     }
     
     return ret;
 }
 
+int SrsSecurity::type_mask(SrsRtmpConnType type)
+{
+    switch (type) {
+        case SrsRtmpConnPlay:
+            return SRS_SECURITY_PLAY;
+        case SrsRtmpConnFMLEPublish:
+        case SrsRtmpConnFlashPublish:
+            return SRS_SECURITY_PUBLISH;
+        case SrsRtmpConnUnknown:
+        default:
+            return 0;
+    }
+}
+
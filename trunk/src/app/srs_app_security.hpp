@@ -34,10 +34,12 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include <srs_rtmp_stack.hpp>
 
-class SrsConfDirective;
+class SrsCidrTrie;
 
 /**
 * the security apply on vhost.
+* the rules are compiled to cidr trie by config, rebuilt when reload,
+* so the check is O(prefix length), never depends on the number of rules.
 * @see https://github.com/ossrs/srs/issues/211
 */
 class SrsSecurity
@@ -56,14 +58,20 @@ public:
 private:
     /**
     * security check the allow,
+    * @param addr the address of client parsed by trie, NULL for invalid ip.
     * @return, if allowed, ERROR_SYSTEM_SECURITY_ALLOW.
     */
-    virtual int allow_check(SrsConfDirective* rules, SrsRtmpConnType type, std::string ip);
+    virtual int allow_check(SrsCidrTrie* rules, SrsRtmpConnType type, u_int8_t* addr);
     /**
     * security check the deny,
+    * @param addr the address of client parsed by trie, NULL for invalid ip.
     * @return, if denied, ERROR_SYSTEM_SECURITY_DENY.
     */
-    virtual int deny_check(SrsConfDirective* rules, SrsRtmpConnType type, std::string ip);
+    virtual int deny_check(SrsCidrTrie* rules, SrsRtmpConnType type, u_int8_t* addr);
+    /**
+    * get the mask of rules for the client type.
+    */
+    virtual int type_mask(SrsRtmpConnType type);
 };
 
 #endif
@@ -48,6 +48,11 @@ using namespace std;
 #include <srs_app_statistic.hpp>
 #include <srs_app_caster_flv.hpp>
 #include <srs_core_mem_watch.hpp>
+#include <srs_core_performance.hpp>
+#include <srs_app_async_io.hpp>
+#include <srs_app_timer.hpp>
+#include <srs_app_worker.hpp>
+#include <srs_rtmp_handshake.hpp>
 
 // signal defines.
 #define SIGNAL_RELOAD SIGHUP
@@ -303,6 +308,7 @@ SrsUdpStreamListener::SrsUdpStreamListener(SrsServer* svr, SrsListenerType t, IS
 {
     listener = NULL;
     caster = c;
+    recv_buffer = 0;
 }
 
 SrsUdpStreamListener::~SrsUdpStreamListener()
@@ -322,7 +328,7 @@ int SrsUdpStreamListener::listen(string i, int p)
     port = p;
 
     srs_freep(listener);
-    listener = new SrsUdpListener(caster, ip, port);
+    listener = new SrsUdpListener(caster, ip, port, recv_buffer);
 
     if ((ret = listener->listen()) != ERROR_SUCCESS) {
         srs_error("udp caster listen failed. ret=%d", ret);
@@ -353,6 +359,7 @@ SrsUdpCasterListener::SrsUdpCasterListener(SrsServer* svr, SrsListenerType t, Sr
     if (type == SrsListenerMpegTsOverUdp) {
         caster = new SrsMpegtsOverUdp(c);
     }
+    recv_buffer = _srs_config->get_stream_caster_recv_buffer(c);
 }
 
 SrsUdpCasterListener::~SrsUdpCasterListener()
@@ -489,6 +496,7 @@ SrsServer::SrsServer()
     signal_manager = NULL;
     
     handler = NULL;
+    kbps_timer = new SrsTimerEntry(this);
     
     // donot new object in constructor,
     // for some global instance is not ready now,
@@ -534,6 +542,8 @@ void SrsServer::destroy()
     srs_freep(ingester);
 #endif
     
+    srs_freep(kbps_timer);
+    
     if (pid_fd > 0) {
         ::close(pid_fd);
         pid_fd = -1;
@@ -560,6 +570,9 @@ void SrsServer::dispose()
     SrsSource::dispose_all();
     
     // @remark don't dispose all connections, for too slow.
+    
+    // write the left logs and files, then write in place.
+    _srs_async_io->dispose();
 
 #ifdef SRS_AUTO_MEM_WATCH
     srs_memory_report();
@@ -623,6 +636,30 @@ int SrsServer::initialize_st()
         return ret;
     }
     
+    // start the io threads after daemon forked.
+    if ((ret = _srs_async_io->initialize(SRS_PERF_ASYNC_IO_THREADS)) != ERROR_SUCCESS) {
+        srs_error("init async io failed. ret=%d", ret);
+        return ret;
+    }
+    
+    // start the timer thread, all timers of server are driven by it.
+    if ((ret = _srs_timer->initialize(SRS_PERF_TIMER_TICK_MS)) != ERROR_SUCCESS) {
+        srs_error("init timer failed. ret=%d", ret);
+        return ret;
+    }
+    
+#ifdef SRS_AUTO_STAT
+    if (_srs_timer->enabled()) {
+        _srs_timer->add(kbps_timer, SRS_SYS_CYCLE_INTERVAL * SRS_SYS_NETWORK_RTMP_SERVER_RESOLUTION_TIMES);
+    }
+#endif
+    
+    // start the thread to precompute the keys of complex handshake.
+    if ((ret = SrsHandshakeKeyPool::instance()->start(SRS_PERF_HANDSHAKE_KEYS)) != ERROR_SUCCESS) {
+        srs_error("init handshake key pool failed. ret=%d", ret);
+        return ret;
+    }
+    
     // @remark, st alloc segment use mmap, which only support 32757 threads,
     // if need to support more, for instance, 100k threads, define the macro MALLOC_STACK.
     // TODO: FIXME: maybe can use "sysctl vm.max_map_count" to refine.
@@ -655,6 +692,11 @@ int SrsServer::acquire_pid_file()
         return ret;
     }
     
+    // the master holds the pid file for workers.
+    if (_srs_workers->is_worker()) {
+        return ret;
+    }
+    
     std::string pid_file = _srs_config->get_pid_file();
     
     // -rw-r--r-- 
@@ -747,6 +789,10 @@ int SrsServer::listen()
         return ret;
     }
     
+    if ((ret = listen_relay()) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
     return ret;
 }
 
@@ -804,6 +850,18 @@ int SrsServer::http_handle()
     if ((ret = http_api_mux->handle("/api/v1/clients/", new SrsGoApiClients())) != ERROR_SUCCESS) {
         return ret;
     }
+    if ((ret = http_api_mux->handle("/api/v1/workers", new SrsGoApiWorkers())) != ERROR_SUCCESS) {
+        return ret;
+    }
+    if ((ret = http_api_mux->handle("/api/v1/pools", new SrsGoApiPools())) != ERROR_SUCCESS) {
+        return ret;
+    }
+    if ((ret = http_api_mux->handle("/api/v1/hooks", new SrsGoApiHooks())) != ERROR_SUCCESS) {
+        return ret;
+    }
+    if ((ret = http_api_mux->handle("/api/v1/handshakes", new SrsGoApiHandshakes())) != ERROR_SUCCESS) {
+        return ret;
+    }
     
     // test the request info.
     if ((ret = http_api_mux->handle("/api/v1/tests/requests", new SrsGoApiRequests())) != ERROR_SUCCESS) {
@@ -840,6 +898,11 @@ int SrsServer::ingest()
     int ret = ERROR_SUCCESS;
     
 #ifdef SRS_AUTO_INGEST
+    // only the primary worker ingests the streams.
+    if (!_srs_workers->is_primary()) {
+        return ret;
+    }
+    
     if ((ret = ingester->start()) != ERROR_SUCCESS) {
         srs_error("start ingest streams failed. ret=%d", ret);
         return ret;
@@ -875,15 +938,26 @@ int SrsServer::cycle()
 
 void SrsServer::remove(SrsConnection* conn)
 {
-    std::vector<SrsConnection*>::iterator it = std::find(conns.begin(), conns.end(), conn);
+    int handle = conn->manager_handle();
     
     // removed by destroy, ignore.
-    if (it == conns.end()) {
+    if (handle < 0 || handle >= (int)conns.size() || conns[handle] != conn) {
         srs_warn("server moved connection, ignore.");
         return;
     }
     
-    conns.erase(it);
+    // move the last connection to the slot, to remove in O(1),
+    // for the order of connections is not required.
+    SrsConnection* last = conns.back();
+    conns[handle] = last;
+    last->set_manager_handle(handle);
+    conns.pop_back();
+    conn->set_manager_handle(-1);
+    
+    SrsRtmpConn* rtmp = dynamic_cast<SrsRtmpConn*>(conn);
+    if (rtmp) {
+        unindex_conn(rtmp);
+    }
     
     srs_info("conn removed. conns=%d", (int)conns.size());
     
@@ -941,6 +1015,9 @@ int SrsServer::do_cycle()
     max = srs_max(max, SRS_SYS_NETWORK_RTMP_SERVER_RESOLUTION_TIMES);
 #endif
     
+    // sleep by the timer wheel.
+    SrsTimerCond sleeper;
+    
     // the deamon thread, update the time cache
     while (true) {
         if(handler && (ret = handler->on_cycle((int)conns.size())) != ERROR_SUCCESS){
@@ -956,7 +1033,7 @@ int SrsServer::do_cycle()
         temp_max = srs_max(temp_max, heartbeat_max_resolution);
         
         for (int i = 0; i < temp_max; i++) {
-            st_usleep(SRS_SYS_CYCLE_INTERVAL * 1000);
+            sleeper.wait(SRS_SYS_CYCLE_INTERVAL * 1000);
             
             // gracefully quit for SIGINT or SIGTERM.
             if (signal_gracefully_quit) {
@@ -1024,12 +1101,13 @@ int SrsServer::do_cycle()
                 srs_info("update network devices info.");
                 srs_update_network_devices();
             }
-            if ((i % SRS_SYS_NETWORK_RTMP_SERVER_RESOLUTION_TIMES) == 0) {
+            // resample by timer when enabled, @see on_timer().
+            if (!_srs_timer->enabled() && (i % SRS_SYS_NETWORK_RTMP_SERVER_RESOLUTION_TIMES) == 0) {
                 srs_info("update network server kbps info.");
                 resample_kbps();
             }
     #ifdef SRS_AUTO_HTTP_CORE
-            if (_srs_config->get_heartbeat_enabled()) {
+            if (_srs_config->get_heartbeat_enabled() && _srs_workers->is_primary()) {
                 if ((i % heartbeat_max_resolution) == 0) {
                     srs_info("do http heartbeat, for internal server to report.");
                     http_heartbeat->heartbeat();
@@ -1078,7 +1156,7 @@ int SrsServer::listen_http_api()
     
 #ifdef SRS_AUTO_HTTP_API
     close_listeners(SrsListenerHttpApi);
-    if (_srs_config->get_http_api_enabled()) {
+    if (_srs_config->get_http_api_enabled() && _srs_workers->is_primary()) {
         SrsListener* listener = new SrsStreamListener(this, SrsListenerHttpApi);
         listeners.push_back(listener);
         
@@ -1104,7 +1182,7 @@ int SrsServer::listen_http_stream()
     
 #ifdef SRS_AUTO_HTTP_SERVER
     close_listeners(SrsListenerHttpStream);
-    if (_srs_config->get_http_stream_enabled()) {
+    if (_srs_config->get_http_stream_enabled() && _srs_workers->is_primary()) {
         SrsListener* listener = new SrsStreamListener(this, SrsListenerHttpStream);
         listeners.push_back(listener);
         
@@ -1131,6 +1209,11 @@ int SrsServer::listen_stream_caster()
 #ifdef SRS_AUTO_STREAM_CASTER
     close_listeners(SrsListenerMpegTsOverUdp);
     
+    // only the primary worker serves the stream casters.
+    if (!_srs_workers->is_primary()) {
+        return ret;
+    }
+    
     std::vector<SrsConfDirective*>::iterator it;
     std::vector<SrsConfDirective*> stream_casters = _srs_config->get_stream_casters();
 
@@ -1176,6 +1259,29 @@ int SrsServer::listen_stream_caster()
     return ret;
 }
 
+int SrsServer::listen_relay()
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (!_srs_workers->is_worker()) {
+        return ret;
+    }
+    
+    close_listeners(SrsListenerRtmpRelay);
+    
+    // each worker listens at loopback for other workers to relay streams.
+    SrsListener* listener = new SrsStreamListener(this, SrsListenerRtmpRelay);
+    listeners.push_back(listener);
+    
+    int port = _srs_workers->relay_port(_srs_workers->index());
+    if ((ret = listener->listen("127.0.0.1", port)) != ERROR_SUCCESS) {
+        srs_error("RTMP relay listen at 127.0.0.1:%d failed. ret=%d", port, ret);
+        return ret;
+    }
+    
+    return ret;
+}
+
 void SrsServer::close_listeners(SrsListenerType type)
 {
     std::vector<SrsListener*>::iterator it;
@@ -1196,14 +1302,11 @@ void SrsServer::resample_kbps()
 {
     SrsStatistic* stat = SrsStatistic::instance();
     
-    // collect delta from all clients.
-    for (std::vector<SrsConnection*>::iterator it = conns.begin(); it != conns.end(); ++it) {
-        SrsConnection* conn = *it;
-        
-        // add delta of connection to server kbps.,
-        // for next sample() of server kbps can get the stat.
-        stat->kbps_add_delta(conn);
-    }
+    // collect delta from all clients, by the index of stat,
+    // for only the clients in stat are sampled.
+    // add delta of connection to server kbps.,
+    // for next sample() of server kbps can get the stat.
+    stat->kbps_add_delta();
     
     // TODO: FXME: support all other connections.
 
@@ -1211,6 +1314,101 @@ void SrsServer::resample_kbps()
     SrsKbps* kbps = stat->kbps_sample();
     
     srs_update_rtmp_server((int)conns.size(), kbps);
+    
+    // update the snapshot for the primary worker to aggregate.
+    if (_srs_workers->is_worker()) {
+        std::stringstream streams;
+        std::stringstream clients;
+        stat->dumps_streams(streams);
+        stat->dumps_clients(clients, 0, 10);
+        
+        SrsNetworkRtmpServer* nrs = srs_get_network_rtmp_server();
+        _srs_workers->update_stats(streams.str(), clients.str(), nrs->rbytes, nrs->sbytes, nrs->nb_conn_srs);
+    }
+}
+
+int SrsServer::notify_vhost_conns(string vhost, int (ISrsReloadHandler::*notify)(string))
+{
+    int ret = ERROR_SUCCESS;
+    
+    // copy the connections, for the index maybe changed when notify.
+    std::vector<SrsRtmpConn*> clients;
+    if (vhost_conns.find(vhost) != vhost_conns.end()) {
+        clients = vhost_conns[vhost];
+    }
+    if (vhost_conns.find("") != vhost_conns.end()) {
+        std::vector<SrsRtmpConn*>& pending = vhost_conns[""];
+        clients.insert(clients.end(), pending.begin(), pending.end());
+    }
+    
+    std::vector<SrsRtmpConn*>::iterator it;
+    for (it = clients.begin(); it != clients.end(); ++it) {
+        SrsRtmpConn* conn = *it;
+        
+        if ((ret = (conn->*notify)(vhost)) != ERROR_SUCCESS) {
+            srs_error("vhost %s notify client %d failed. ret=%d", vhost.c_str(), conn->srs_id(), ret);
+            return ret;
+        }
+    }
+    
+    return ret;
+}
+
+void SrsServer::index_conn(SrsRtmpConn* conn, string vhost)
+{
+    std::vector<SrsRtmpConn*>& vconns = vhost_conns[vhost];
+    
+    conn->index_vhost = vhost;
+    conn->index_handle = (int)vconns.size();
+    vconns.push_back(conn);
+}
+
+void SrsServer::unindex_conn(SrsRtmpConn* conn)
+{
+    std::map<std::string, std::vector<SrsRtmpConn*> >::iterator it = vhost_conns.find(conn->index_vhost);
+    if (it == vhost_conns.end()) {
+        srs_warn("server unindexed connection, ignore.");
+        return;
+    }
+    
+    int handle = conn->index_handle;
+    std::vector<SrsRtmpConn*>& vconns = it->second;
+    
+    if (handle < 0 || handle >= (int)vconns.size() || vconns[handle] != conn) {
+        srs_warn("server unindexed connection, ignore.");
+        return;
+    }
+    
+    // move the last connection to the slot, to remove in O(1).
+    SrsRtmpConn* last = vconns.back();
+    vconns[handle] = last;
+    last->index_handle = handle;
+    vconns.pop_back();
+    conn->index_handle = -1;
+    
+    if (vconns.empty()) {
+        vhost_conns.erase(it);
+    }
+}
+
+void SrsServer::on_conn_vhost(SrsRtmpConn* conn, string vhost)
+{
+    if (conn->index_vhost == vhost) {
+        return;
+    }
+    
+    unindex_conn(conn);
+    index_conn(conn, vhost);
+}
+
+void SrsServer::on_timer(SrsTimerEntry* entry)
+{
+    srs_assert(entry == kbps_timer);
+    
+    srs_info("update network server kbps info by timer.");
+    resample_kbps();
+    
+    _srs_timer->add(kbps_timer, SRS_SYS_CYCLE_INTERVAL * SRS_SYS_NETWORK_RTMP_SERVER_RESOLUTION_TIMES);
 }
 
 int SrsServer::accept_client(SrsListenerType type, st_netfd_t client_stfd)
@@ -1249,8 +1447,13 @@ int SrsServer::accept_client(SrsListenerType type, st_netfd_t client_stfd)
     }
     
     SrsConnection* conn = NULL;
-    if (type == SrsListenerRtmpStream) {
-        conn = new SrsRtmpConn(this, client_stfd);
+    if (type == SrsListenerRtmpStream || type == SrsListenerRtmpRelay) {
+        SrsRtmpConn* rtmp = new SrsRtmpConn(this, client_stfd, type == SrsListenerRtmpRelay);
+        
+        // index the connection before its vhost is identified,
+        // to notify the reload when handshake or connect app.
+        index_conn(rtmp, "");
+        conn = rtmp;
     } else if (type == SrsListenerHttpApi) {
 #ifdef SRS_AUTO_HTTP_API
         conn = new SrsHttpApi(this, client_stfd, http_api_mux);
@@ -1273,6 +1476,7 @@ int SrsServer::accept_client(SrsListenerType type, st_netfd_t client_stfd)
     srs_assert(conn);
     
     // directly enqueue, the cycle thread will remove the client.
+    conn->set_manager_handle((int)conns.size());
     conns.push_back(conn);
     srs_verbose("add conn to vector.");
     
@@ -1321,10 +1525,15 @@ int SrsServer::on_reload_vhost_added(std::string vhost)
     return ret;
 }
 
-int SrsServer::on_reload_vhost_removed(std::string /*vhost*/)
+int SrsServer::on_reload_vhost_removed(std::string vhost)
 {
     int ret = ERROR_SUCCESS;
     
+    // disconnect the clients of vhost.
+    if ((ret = notify_vhost_conns(vhost, &ISrsReloadHandler::on_reload_vhost_removed)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
 #ifdef SRS_AUTO_HTTP_SERVER
     // TODO: FIXME: should handle the event in SrsHttpStaticServer
     if ((ret = on_reload_vhost_http_updated()) != ERROR_SUCCESS) {
@@ -1335,6 +1544,36 @@ int SrsServer::on_reload_vhost_removed(std::string /*vhost*/)
     return ret;
 }
 
+int SrsServer::on_reload_vhost_mw(std::string vhost)
+{
+    return notify_vhost_conns(vhost, &ISrsReloadHandler::on_reload_vhost_mw);
+}
+
+int SrsServer::on_reload_vhost_smi(std::string vhost)
+{
+    return notify_vhost_conns(vhost, &ISrsReloadHandler::on_reload_vhost_smi);
+}
+
+int SrsServer::on_reload_vhost_tcp_nodelay(std::string vhost)
+{
+    return notify_vhost_conns(vhost, &ISrsReloadHandler::on_reload_vhost_tcp_nodelay);
+}
+
+int SrsServer::on_reload_vhost_realtime(std::string vhost)
+{
+    return notify_vhost_conns(vhost, &ISrsReloadHandler::on_reload_vhost_realtime);
+}
+
+int SrsServer::on_reload_vhost_p1stpt(std::string vhost)
+{
+    return notify_vhost_conns(vhost, &ISrsReloadHandler::on_reload_vhost_p1stpt);
+}
+
+int SrsServer::on_reload_vhost_pnt(std::string vhost)
+{
+    return notify_vhost_conns(vhost, &ISrsReloadHandler::on_reload_vhost_pnt);
+}
+
 int SrsServer::on_reload_http_api_enabled()
 {
     int ret = ERROR_SUCCESS;
@@ -1444,7 +1683,7 @@ int SrsServer::on_update_m3u8(SrsRequest* r, string m3u8)
     return ret;
 }
 
-int SrsServer::on_update_ts(SrsRequest* r, string uri, string ts)
+int SrsServer::on_update_ts(SrsRequest* r, string uri, SrsHlsSharedBuffer* ts)
 {
     int ret = ERROR_SUCCESS;
     
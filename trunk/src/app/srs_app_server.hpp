@@ -31,6 +31,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <srs_core.hpp>
 
 #include <vector>
+#include <map>
 #include <string>
 
 #include <srs_app_st.hpp>
@@ -39,6 +40,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <srs_app_hls.hpp>
 #include <srs_app_listener.hpp>
 #include <srs_app_conn.hpp>
+#include <srs_kernel_timer.hpp>
 
 class SrsServer;
 class SrsConnection;
@@ -54,6 +56,7 @@ class SrsUdpListener;
 class SrsTcpListener;
 #ifdef SRS_AUTO_STREAM_CASTER
 class SrsAppCasterFlv;
+class SrsRtmpConn;
 #endif
 
 // listener type for server to identify the connection,
@@ -72,6 +75,8 @@ enum SrsListenerType
     SrsListenerRtsp             = 4,
     // TCP stream, FLV stream over HTTP.
     SrsListenerFlv              = 5,
+    // RTMP client, relay stream between workers.
+    SrsListenerRtmpRelay        = 6,
 };
 
 /**
@@ -156,6 +161,8 @@ class SrsUdpStreamListener : public SrsListener
 protected:
     SrsUdpListener* listener;
     ISrsUdpHandler* caster;
+    // the SO_RCVBUF of socket, 0 to use system default.
+    int recv_buffer;
 public:
     SrsUdpStreamListener(SrsServer* svr, SrsListenerType t, ISrsUdpHandler* c);
     virtual ~SrsUdpStreamListener();
@@ -231,7 +238,7 @@ public:
 */
 class SrsServer : virtual public ISrsReloadHandler
     , virtual public ISrsSourceHandler, virtual public ISrsHlsHandler
-    , virtual public IConnectionManager
+    , virtual public IConnectionManager, virtual public ISrsTimerHandler
 {
 private:
 #ifdef SRS_AUTO_HTTP_API
@@ -260,6 +267,13 @@ private:
     */
     std::vector<SrsConnection*> conns;
     /**
+    * the rtmp connections indexed by vhost, to notify the reload of vhost
+    * without scan all connections. the connection is indexed to the empty
+    * vhost when accepted, and moved to its vhost when vhost is identified.
+    * @remark the connection keeps its position in the vector, to remove in O(1).
+    */
+    std::map<std::string, std::vector<SrsRtmpConn*> > vhost_conns;
+    /**
     * all listners, listener manager.
     */
     std::vector<SrsListener*> listeners;
@@ -277,6 +291,11 @@ private:
     bool signal_reload;
     bool signal_gmc_stop;
     bool signal_gracefully_quit;
+    /**
+    * the timer to resample the server kbps, in time even when cycle blocked,
+    * for instance, the http heartbeat.
+    */
+    SrsTimerEntry* kbps_timer;
 public:
     SrsServer();
     virtual ~SrsServer();
@@ -342,6 +361,7 @@ private:
     virtual int listen_http_api();
     virtual int listen_http_stream();
     virtual int listen_stream_caster();
+    virtual int listen_relay();
     /**
     * close the listeners for specified type, 
     * remove the listen object from manager.
@@ -351,8 +371,24 @@ private:
     * resample the server kbs.
     */
     virtual void resample_kbps();
+    /**
+    * notify the rtmp connections of vhost to reload, which are fetched from
+    * the vhost index of connections, so the connections never subscribe the
+    * config and the reload never scan all connections.
+    * @remark the connections whose vhost is not identified are also notified.
+    */
+    virtual int notify_vhost_conns(std::string vhost, int (ISrsReloadHandler::*notify)(std::string));
+    /**
+    * add or remove the rtmp connection to the vhost index.
+    */
+    virtual void index_conn(SrsRtmpConn* conn, std::string vhost);
+    virtual void unindex_conn(SrsRtmpConn* conn);
 // internal only
 public:
+    /**
+    * when the vhost of rtmp connection is identified, move it to the vhost index.
+    */
+    virtual void on_conn_vhost(SrsRtmpConn* conn, std::string vhost);
     /**
     * when listener got a fd, notice server to accept it.
     * @param type, the client type, used to create concrete connection, 
@@ -366,6 +402,12 @@ public:
     virtual int on_reload_pid();
     virtual int on_reload_vhost_added(std::string vhost);
     virtual int on_reload_vhost_removed(std::string vhost);
+    virtual int on_reload_vhost_mw(std::string vhost);
+    virtual int on_reload_vhost_smi(std::string vhost);
+    virtual int on_reload_vhost_tcp_nodelay(std::string vhost);
+    virtual int on_reload_vhost_realtime(std::string vhost);
+    virtual int on_reload_vhost_p1stpt(std::string vhost);
+    virtual int on_reload_vhost_pnt(std::string vhost);
     virtual int on_reload_http_api_enabled();
     virtual int on_reload_http_api_disabled();
     virtual int on_reload_http_stream_enabled();
@@ -379,10 +421,16 @@ public:
 public:
     virtual int on_hls_publish(SrsRequest* r);
     virtual int on_update_m3u8(SrsRequest* r, std::string m3u8);
-    virtual int on_update_ts(SrsRequest* r, std::string uri, std::string ts);
+    virtual int on_update_ts(SrsRequest* r, std::string uri, SrsHlsSharedBuffer* ts);
     virtual int on_remove_ts(SrsRequest* r, std::string uri);
     virtual int on_hls_unpublish(SrsRequest* r);
+// interface ISrsTimerHandler
+public:
+    virtual void on_timer(SrsTimerEntry* entry);
 };
 
+// the global server, for the publisher in process to create source.
+extern SrsServer* _srs_server;
+
 #endif
 
@@ -46,6 +46,8 @@ using namespace std;
 #include <srs_app_statistic.hpp>
 #include <srs_core_autofree.hpp>
 #include <srs_rtmp_utility.hpp>
+#include <srs_app_worker.hpp>
+#include <srs_app_timer.hpp>
 
 #define CONST_MAX_JITTER_MS         250
 #define CONST_MAX_JITTER_MS_NEG         -250
@@ -410,6 +412,207 @@ void SrsMessageQueue::clear()
     av_start_time = av_end_time = -1;
 }
 
+SrsMessageRing::SrsMessageRing()
+{
+    queue_size_ms = 0;
+    av_start_time = av_end_time = -1;
+    
+    capacity = SRS_PERF_QUEUE_RING_SIZE;
+    msgs = new SrsSharedPtrMessage[capacity];
+    head = tail = 0;
+    keyframe = -1;
+    
+    video_sh = new SrsSharedPtrMessage();
+    audio_sh = new SrsSharedPtrMessage();
+    video_sh_seq = audio_sh_seq = -1;
+    
+    sending = NULL;
+    nb_sending = max_sending = 0;
+}
+
+SrsMessageRing::~SrsMessageRing()
+{
+    clear();
+    
+    srs_freepa(msgs);
+    srs_freepa(sending);
+    srs_freep(video_sh);
+    srs_freep(audio_sh);
+}
+
+int SrsMessageRing::size()
+{
+    return (int)(tail - head);
+}
+
+int SrsMessageRing::duration()
+{
+    return (int)(av_end_time - av_start_time);
+}
+
+void SrsMessageRing::set_queue_size(double queue_size)
+{
+    queue_size_ms = (int)(queue_size * 1000);
+}
+
+int SrsMessageRing::enqueue(SrsSharedPtrMessage* msg, bool* is_overflow)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (tail - head >= capacity) {
+        grow();
+    }
+    
+    // move the msg into the ring, the slot is always empty.
+    SrsSharedPtrMessage* slot = &msgs[tail % capacity];
+    slot->swap(msg);
+    
+    if (slot->is_av()) {
+        if (av_start_time == -1) {
+            av_start_time = slot->timestamp;
+        }
+        
+        av_end_time = slot->timestamp;
+    }
+    
+    // remember the sequence header and keyframe to shrink.
+    if (slot->is_video()) {
+        if (SrsFlvCodec::video_is_sequence_header(slot->payload, slot->size)) {
+            video_sh->share(slot);
+            video_sh_seq = tail;
+        } else if (SrsFlvCodec::video_is_keyframe(slot->payload, slot->size)) {
+            keyframe = tail;
+        }
+    } else if (slot->is_audio() && SrsFlvCodec::audio_is_sequence_header(slot->payload, slot->size)) {
+        audio_sh->share(slot);
+        audio_sh_seq = tail;
+    }
+    
+    tail++;
+    
+    while (av_end_time - av_start_time > queue_size_ms) {
+        // notice the caller queue already overflow and shrinked.
+        if (is_overflow) {
+            *is_overflow = true;
+        }
+        
+        shrink();
+    }
+    
+    return ret;
+}
+
+int SrsMessageRing::dump_packets(int max_count, SrsSharedPtrMessage** pmsgs, int& count)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // the messages of last dump are sent, release them.
+    for (int i = 0; i < nb_sending; i++) {
+        sending[i].release();
+    }
+    nb_sending = 0;
+    
+    int nb_msgs = (int)(tail - head);
+    if (nb_msgs <= 0) {
+        return ret;
+    }
+    
+    srs_assert(max_count > 0);
+    count = srs_min(max_count, nb_msgs);
+    
+    if (max_sending < count) {
+        srs_freepa(sending);
+        max_sending = max_count;
+        sending = new SrsSharedPtrMessage[max_sending];
+    }
+    
+    // move the messages out of ring, for the ring is writen when sending.
+    for (int i = 0; i < count; i++) {
+        sending[i].swap(&msgs[head % capacity]);
+        pmsgs[i] = &sending[i];
+        head++;
+    }
+    nb_sending = count;
+    
+    av_start_time = sending[count - 1].timestamp;
+    
+    return ret;
+}
+
+void SrsMessageRing::shrink()
+{
+    int msgs_size = size();
+    
+    // drop the messages before the last keyframe, or drop all when keyframe
+    // is the first or not in ring, or the messages from keyframe still overflow,
+    // for the resent sequence header before keyframe never shrink the duration.
+    int64_t start = head;
+    int64_t pos = tail;
+    if (keyframe > head && keyframe < tail && av_end_time - msgs[keyframe % capacity].timestamp <= queue_size_ms) {
+        pos = keyframe;
+    }
+    
+    for (; head < pos; head++) {
+        msgs[head % capacity].release();
+    }
+    
+    // update av_start_time
+    av_start_time = (head < tail)? msgs[head % capacity].timestamp : av_end_time;
+    
+    // resend the dropped sequence header before the first message,
+    // the slots are empty for the sequence header is dropped.
+    if (audio_sh_seq >= start && audio_sh_seq < pos) {
+        head--;
+        msgs[head % capacity].share(audio_sh);
+        msgs[head % capacity].timestamp = av_start_time;
+        audio_sh_seq = head;
+    }
+    if (video_sh_seq >= start && video_sh_seq < pos) {
+        head--;
+        msgs[head % capacity].share(video_sh);
+        msgs[head % capacity].timestamp = av_start_time;
+        video_sh_seq = head;
+    }
+    
+    srs_trace("shrink the cache queue, size=%d, removed=%d, max=%.2f", 
+        size(), msgs_size - size(), queue_size_ms / 1000.0);
+}
+
+void SrsMessageRing::grow()
+{
+    int size = capacity * 2;
+    SrsSharedPtrMessage* buf = new SrsSharedPtrMessage[size];
+    for (int64_t seq = head; seq < tail; seq++) {
+        buf[seq % size].swap(&msgs[seq % capacity]);
+    }
+    srs_warn("message ring incrase %d=>%d", capacity, size);
+    
+    // use new ring.
+    srs_freepa(msgs);
+    msgs = buf;
+    capacity = size;
+}
+
+void SrsMessageRing::clear()
+{
+    for (; head < tail; head++) {
+        msgs[head % capacity].release();
+    }
+    head = tail = 0;
+    keyframe = -1;
+    
+    for (int i = 0; i < nb_sending; i++) {
+        sending[i].release();
+    }
+    nb_sending = 0;
+    
+    video_sh->release();
+    audio_sh->release();
+    video_sh_seq = audio_sh_seq = -1;
+    
+    av_start_time = av_end_time = -1;
+}
+
 ISrsWakable::ISrsWakable()
 {
 }
@@ -422,33 +625,45 @@ SrsConsumer::SrsConsumer(SrsSource* s, SrsConnection* c)
 {
     source = s;
     conn = c;
+    handle = -1;
     paused = false;
     jitter = new SrsRtmpJitter();
-    queue = new SrsMessageQueue();
+    queue = new SrsMessageRing();
+    cursor = source->ring->end();
+    queue_size_ms = 0;
     should_update_source_id = false;
     
 #ifdef SRS_PERF_QUEUE_COND_WAIT
-    mw_wait = st_cond_new();
+    mw_wait = new SrsTimerCond();
     mw_min_msgs = 0;
     mw_duration = 0;
     mw_waiting = false;
+    mw_wakeup_time = 0;
+    mw_wakeup_seq = 0;
 #endif
 }
 
 SrsConsumer::~SrsConsumer()
 {
+#ifdef SRS_PERF_QUEUE_COND_WAIT
+    if (mw_waiting) {
+        source->ring->unwait(this, mw_wakeup_time, mw_wakeup_seq);
+    }
+#endif
+
     source->on_consumer_destroy(this);
     srs_freep(jitter);
     srs_freep(queue);
     
 #ifdef SRS_PERF_QUEUE_COND_WAIT
-    st_cond_destroy(mw_wait);
+    srs_freep(mw_wait);
 #endif
 }
 
 void SrsConsumer::set_queue_size(double queue_size)
 {
     queue->set_queue_size(queue_size);
+    queue_size_ms = (int)(queue_size * 1000);
 }
 
 void SrsConsumer::update_source_id()
@@ -456,6 +671,16 @@ void SrsConsumer::update_source_id()
     should_update_source_id = true;
 }
 
+int64_t SrsConsumer::get_cursor()
+{
+    return cursor;
+}
+
+void SrsConsumer::seek(int64_t seq)
+{
+    cursor = seq;
+}
+
 int SrsConsumer::get_time()
 {
     return jitter->get_time();
@@ -465,22 +690,26 @@ int SrsConsumer::enqueue(SrsSharedPtrMessage* shared_msg, bool atc, SrsRtmpJitte
 {
     int ret = ERROR_SUCCESS;
     
-    SrsSharedPtrMessage* msg = shared_msg->copy();
+    // share the payload and correct the timestamp on stack,
+    // then move it into the ring, never alloc message for each consumer.
+    SrsSharedPtrMessage msg;
+    msg.share(shared_msg);
 
     if (!atc) {
-        if ((ret = jitter->correct(msg, ag)) != ERROR_SUCCESS) {
-            srs_freep(msg);
+        if ((ret = jitter->correct(&msg, ag)) != ERROR_SUCCESS) {
             return ret;
         }
     }
     
-    if ((ret = queue->enqueue(msg, NULL)) != ERROR_SUCCESS) {
+    srs_verbose("enqueue msg, time=%"PRId64", size=%d", msg.timestamp, msg.size);
+    
+    if ((ret = queue->enqueue(&msg, NULL)) != ERROR_SUCCESS) {
         return ret;
     }
     
 #ifdef SRS_PERF_QUEUE_COND_WAIT
-    srs_verbose("enqueue msg, time=%"PRId64", size=%d, duration=%d, waiting=%d, min_msg=%d", 
-        msg->timestamp, msg->size, queue->duration(), mw_waiting, mw_min_msgs);
+    srs_verbose("enqueue msg, duration=%d, waiting=%d, min_msg=%d", 
+        queue->duration(), mw_waiting, mw_min_msgs);
         
     // fire the mw when msgs is enough.
     if (mw_waiting) {
@@ -489,8 +718,7 @@ int SrsConsumer::enqueue(SrsSharedPtrMessage* shared_msg, bool atc, SrsRtmpJitte
         
         // when duration ok, signal to flush.
         if (match_min_msgs && duration_ms > mw_duration) {
-            st_cond_signal(mw_wait);
-            mw_waiting = false;
+            wakeup();
         }
     }
 #endif
@@ -521,6 +749,11 @@ int SrsConsumer::dump_packets(SrsMessageArray* msgs, int& count)
     if (paused) {
         return ret;
     }
+    
+    // fetch msgs from source.
+    if ((ret = fetch(max)) != ERROR_SUCCESS) {
+        return ret;
+    }
 
     // pump msgs from queue.
     if ((ret = queue->dump_packets(max, msgs->msgs, count)) != ERROR_SUCCESS) {
@@ -530,8 +763,55 @@ int SrsConsumer::dump_packets(SrsMessageArray* msgs, int& count)
     return ret;
 }
 
+int SrsConsumer::fetch(int max_count)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsSourceRing* ring = source->ring;
+    bool atc = source->atc;
+    SrsRtmpJitterAlgorithm ag = source->jitter_algorithm;
+    
+    // when the messages are removed from ring, or lag too much,
+    // drop the messages and skip to the last keyframe.
+    if (cursor < ring->begin() || ring->duration(cursor) > queue_size_ms) {
+        int64_t keyframe = ring->last_keyframe();
+        int64_t pos = (keyframe > cursor)? keyframe : ring->end();
+        
+        srs_trace("shrink the cache queue, size=%d, removed=%d, max=%.2f", 
+            (int)(ring->end() - pos), (int)(pos - cursor), queue_size_ms / 1000.0);
+        cursor = pos;
+        
+        // the sequence headers maybe dropped, resend them.
+        if (source->cache_sh_audio && (ret = enqueue(source->cache_sh_audio, atc, ag)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        if (source->cache_sh_video && (ret = enqueue(source->cache_sh_video, atc, ag)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    while (queue->size() < max_count && cursor < ring->end()) {
+        // share the payload and correct the timestamp on stack,
+        // then move it into the queue, never alloc message for each consumer.
+        SrsSharedPtrMessage msg;
+        msg.share(ring->at(cursor++));
+        
+        if (!atc) {
+            if ((ret = jitter->correct(&msg, ag)) != ERROR_SUCCESS) {
+                return ret;
+            }
+        }
+        
+        if ((ret = queue->enqueue(&msg, NULL)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    return ret;
+}
+
 #ifdef SRS_PERF_QUEUE_COND_WAIT
-void SrsConsumer::wait(int nb_msgs, int duration)
+void SrsConsumer::wait(int nb_msgs, int duration, int64_t timeout)
 {
     if (paused) {
         st_usleep(SRS_CONSTS_RTMP_PULSE_TIMEOUT_US);
@@ -540,20 +820,40 @@ void SrsConsumer::wait(int nb_msgs, int duration)
 
     mw_min_msgs = nb_msgs;
     mw_duration = duration;
+    
+    // the messages are removed from ring, fetch to skip them.
+    SrsSourceRing* ring = source->ring;
+    if (cursor < ring->begin()) {
+        return;
+    }
 
-    int duration_ms = queue->duration();
-    bool match_min_msgs = queue->size() > mw_min_msgs;
+    // the msgs in queue and ring to fetch.
+    int duration_ms = srs_max(queue->duration(), ring->duration(cursor));
+    bool match_min_msgs = queue->size() + (int)(ring->end() - cursor) > mw_min_msgs;
     
     // when duration ok, signal to flush.
     if (match_min_msgs && duration_ms > mw_duration) {
         return;
     }
     
-    // the enqueue will notify this cond.
+    // the enqueue and ring will notify this cond,
+    // the ring wakeup when the count of messages in queue and ring over the min msgs.
     mw_waiting = true;
+    mw_wakeup_seq = cursor + mw_min_msgs - queue->size() + 1;
+    mw_wakeup_time = ring->wait(this, cursor, mw_duration, mw_wakeup_seq);
     
     // use cond block wait for high performance mode.
-    st_cond_wait(mw_wait);
+    if (timeout < 0) {
+        mw_wait->wait(-1);
+        return;
+    }
+    
+    // when timeout, the enqueue never signal the cond.
+    mw_wait->wait(timeout);
+    if (mw_waiting) {
+        ring->unwait(this, mw_wakeup_time, mw_wakeup_seq);
+        mw_waiting = false;
+    }
 }
 #endif
 
@@ -571,35 +871,254 @@ void SrsConsumer::wakeup()
 {
 #ifdef SRS_PERF_QUEUE_COND_WAIT
     if (mw_waiting) {
-        st_cond_signal(mw_wait);
+        source->ring->unwait(this, mw_wakeup_time, mw_wakeup_seq);
+        mw_wait->signal();
         mw_waiting = false;
     }
 #endif
 }
 
-SrsGopCache::SrsGopCache()
+SrsSourceRing::SrsSourceRing()
 {
+    capacity = SRS_PERF_SOURCE_RING_SIZE;
+    msgs = new SrsSharedPtrMessage[capacity];
+    times = new int64_t[capacity];
+    head = tail = 0;
+    
+    last_pkt_time = -1;
+    time = 0;
+    queue_size_ms = SRS_PERF_PLAY_QUEUE * 1000;
+    
     cached_video_count = 0;
     enable_gop_cache = true;
     audio_after_last_video_count = 0;
+    gop_start = -1;
 }
 
-SrsGopCache::~SrsGopCache()
+SrsSourceRing::~SrsSourceRing()
 {
-    clear();
+    dispose();
+    
+    srs_freepa(msgs);
+    srs_freepa(times);
 }
 
-void SrsGopCache::dispose()
+void SrsSourceRing::dispose()
 {
+    for (; head < tail; head++) {
+        msgs[head % capacity].release();
+    }
+    keyframes.clear();
+    
     clear();
 }
 
-void SrsGopCache::set(bool enabled)
+void SrsSourceRing::set_queue_size(double queue_size)
+{
+    queue_size_ms = (int)(queue_size * 1000);
+}
+
+int64_t SrsSourceRing::begin()
+{
+    return head;
+}
+
+int64_t SrsSourceRing::end()
+{
+    return tail;
+}
+
+bool SrsSourceRing::full()
+{
+    return tail - head >= capacity;
+}
+
+SrsSharedPtrMessage* SrsSourceRing::at(int64_t seq)
+{
+    srs_assert(seq >= head && seq < tail);
+    return &msgs[seq % capacity];
+}
+
+int SrsSourceRing::duration(int64_t seq)
+{
+    if (seq >= tail) {
+        return 0;
+    }
+    
+    seq = srs_max(seq, head);
+    return (int)(time - times[seq % capacity]);
+}
+
+int64_t SrsSourceRing::last_keyframe()
+{
+    if (keyframes.empty()) {
+        return -1;
+    }
+    return keyframes.back();
+}
+
+int SrsSourceRing::append(SrsSharedPtrMessage* shared_msg)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (full()) {
+        grow();
+    }
+    
+    SrsSharedPtrMessage* msg = &msgs[tail % capacity];
+    msg->share(shared_msg);
+    
+    // sum the valid delta of timestamp, ignore the jitter.
+    if (msg->is_av()) {
+        int64_t delta = msg->timestamp - last_pkt_time;
+        if (last_pkt_time >= 0 && delta > 0 && delta <= CONST_MAX_JITTER_MS) {
+            time += delta;
+        }
+        last_pkt_time = msg->timestamp;
+    }
+    times[tail % capacity] = time;
+    
+    // index the gop by keyframe.
+    if (msg->is_video() && SrsFlvCodec::video_is_keyframe(msg->payload, msg->size)
+        && !SrsFlvCodec::video_is_sequence_header(msg->payload, msg->size)
+    ) {
+        keyframes.push_back(tail);
+    }
+    
+    tail++;
+    
+    // wakeup the consumers which got the messages in duration,
+    // or wait for the count of messages.
+    while (!waiters.empty()) {
+        std::multimap<int64_t, std::pair<SrsConsumer*, int64_t> >::iterator it = waiters.begin();
+        if (it->first >= time) {
+            break;
+        }
+        
+        SrsConsumer* consumer = it->second.first;
+        int64_t wakeup_seq = it->second.second;
+        waiters.erase(it);
+        
+        if (wakeup_seq > tail) {
+            seq_waiters.insert(std::make_pair(wakeup_seq, consumer));
+            continue;
+        }
+        consumer->wakeup();
+    }
+    
+    // wakeup the consumers which got enough messages.
+    while (!seq_waiters.empty()) {
+        std::multimap<int64_t, SrsConsumer*>::iterator it = seq_waiters.begin();
+        if (it->first > tail) {
+            break;
+        }
+        
+        SrsConsumer* consumer = it->second;
+        seq_waiters.erase(it);
+        consumer->wakeup();
+    }
+    
+    return ret;
+}
+
+void SrsSourceRing::shrink(int64_t cursor)
+{
+    // the consumers drop the messages out of the queue duration,
+    // so never keep them for the slow consumers.
+    int64_t pos = head;
+    while (pos < tail && time - times[pos % capacity] > queue_size_ms) {
+        pos++;
+    }
+    pos = srs_max(pos, cursor);
+    
+    // always keep the cached gop for new consumers.
+    pos = srs_min(pos, (gop_start >= 0)? gop_start : tail);
+    
+    for (; head < pos; head++) {
+        msgs[head % capacity].release();
+    }
+    
+    while (!keyframes.empty() && keyframes.front() < head) {
+        keyframes.pop_front();
+    }
+}
+
+int64_t SrsSourceRing::wait(SrsConsumer* consumer, int64_t cursor, int duration, int64_t wakeup_seq)
+{
+    int64_t start = (cursor < tail)? times[srs_max(cursor, head) % capacity] : time;
+    int64_t wakeup_time = start + duration;
+    
+    waiters.insert(std::make_pair(wakeup_time, std::make_pair(consumer, wakeup_seq)));
+    
+    return wakeup_time;
+}
+
+void SrsSourceRing::unwait(SrsConsumer* consumer, int64_t wakeup_time, int64_t wakeup_seq)
+{
+    if (true) {
+        std::multimap<int64_t, std::pair<SrsConsumer*, int64_t> >::iterator it = waiters.lower_bound(wakeup_time);
+        for (; it != waiters.end() && it->first == wakeup_time; ++it) {
+            if (it->second.first == consumer) {
+                waiters.erase(it);
+                return;
+            }
+        }
+    }
+    
+    // the consumer maybe moved to wait for the count of messages.
+    if (true) {
+        std::multimap<int64_t, SrsConsumer*>::iterator it = seq_waiters.lower_bound(wakeup_seq);
+        for (; it != seq_waiters.end() && it->first == wakeup_seq; ++it) {
+            if (it->second == consumer) {
+                seq_waiters.erase(it);
+                return;
+            }
+        }
+    }
+}
+
+void SrsSourceRing::wakeup()
+{
+    while (!waiters.empty()) {
+        std::multimap<int64_t, std::pair<SrsConsumer*, int64_t> >::iterator it = waiters.begin();
+        SrsConsumer* consumer = it->second.first;
+        waiters.erase(it);
+        consumer->wakeup();
+    }
+    
+    while (!seq_waiters.empty()) {
+        std::multimap<int64_t, SrsConsumer*>::iterator it = seq_waiters.begin();
+        SrsConsumer* consumer = it->second;
+        seq_waiters.erase(it);
+        consumer->wakeup();
+    }
+}
+
+void SrsSourceRing::grow()
+{
+    int size = capacity * 2;
+    SrsSharedPtrMessage* buf = new SrsSharedPtrMessage[size];
+    int64_t* buf_times = new int64_t[size];
+    for (int64_t seq = head; seq < tail; seq++) {
+        buf[seq % size].swap(&msgs[seq % capacity]);
+        buf_times[seq % size] = times[seq % capacity];
+    }
+    srs_trace("source ring incrase %d=>%d", capacity, size);
+    
+    // use new ring.
+    srs_freepa(msgs);
+    srs_freepa(times);
+    msgs = buf;
+    times = buf_times;
+    capacity = size;
+}
+
+void SrsSourceRing::set(bool enabled)
 {
     enable_gop_cache = enabled;
     
     if (!enabled) {
-        srs_info("disable gop cache, clear %d packets.", (int)gop_cache.size());
+        srs_info("disable gop cache, clear %d packets.", (int)(tail - gop()));
         clear();
         return;
     }
@@ -607,7 +1126,7 @@ void SrsGopCache::set(bool enabled)
     srs_info("enable gop cache");
 }
 
-int SrsGopCache::cache(SrsSharedPtrMessage* shared_msg)
+int SrsSourceRing::cache(SrsSharedPtrMessage* shared_msg)
 {
     int ret = ERROR_SUCCESS;
     
@@ -652,7 +1171,7 @@ int SrsGopCache::cache(SrsSharedPtrMessage* shared_msg)
     // clear gop cache when got key frame
     if (msg->is_video() && SrsFlvCodec::video_is_keyframe(msg->payload, msg->size)) {
         srs_info("clear gop cache when got keyframe. vcount=%d, count=%d",
-            cached_video_count, (int)gop_cache.size());
+            cached_video_count, (int)(tail - gop()));
             
         clear();
         
@@ -660,60 +1179,45 @@ int SrsGopCache::cache(SrsSharedPtrMessage* shared_msg)
         cached_video_count = 1;
     }
     
-    // cache the frame.
-    gop_cache.push_back(msg->copy());
+    // cache the frame, which is the last message of ring.
+    if (gop_start < 0) {
+        gop_start = tail - 1;
+    }
     
     return ret;
 }
 
-void SrsGopCache::clear()
+void SrsSourceRing::clear()
 {
-    std::vector<SrsSharedPtrMessage*>::iterator it;
-    for (it = gop_cache.begin(); it != gop_cache.end(); ++it) {
-        SrsSharedPtrMessage* msg = *it;
-        srs_freep(msg);
-    }
-    gop_cache.clear();
+    gop_start = -1;
 
     cached_video_count = 0;
     audio_after_last_video_count = 0;
 }
-    
-int SrsGopCache::dump(SrsConsumer* consumer, bool atc, SrsRtmpJitterAlgorithm jitter_algorithm)
+
+int64_t SrsSourceRing::gop()
 {
-    int ret = ERROR_SUCCESS;
-    
-    std::vector<SrsSharedPtrMessage*>::iterator it;
-    for (it = gop_cache.begin(); it != gop_cache.end(); ++it) {
-        SrsSharedPtrMessage* msg = *it;
-        if ((ret = consumer->enqueue(msg, atc, jitter_algorithm)) != ERROR_SUCCESS) {
-            srs_error("dispatch cached gop failed. ret=%d", ret);
-            return ret;
-        }
-    }
-    srs_trace("dispatch cached gop success. count=%d, duration=%d", (int)gop_cache.size(), consumer->get_time());
-    
-    return ret;
+    return (gop_start >= 0)? gop_start : tail;
 }
 
-bool SrsGopCache::empty()
+bool SrsSourceRing::empty()
 {
-    return gop_cache.empty();
+    return gop_start < 0 || gop_start >= tail;
 }
 
-int64_t SrsGopCache::start_time()
+int64_t SrsSourceRing::start_time()
 {
     if (empty()) {
         return 0;
     }
     
-    SrsSharedPtrMessage* msg = gop_cache[0];
+    SrsSharedPtrMessage* msg = at(gop_start);
     srs_assert(msg);
     
     return msg->timestamp;
 }
 
-bool SrsGopCache::pure_audio()
+bool SrsSourceRing::pure_audio()
 {
     return cached_video_count == 0;
 }
@@ -743,6 +1247,14 @@ int SrsSource::create(SrsRequest* r, ISrsSourceHandler* h, ISrsHlsHandler* hh, S
         srs_freep(source);
         return ret;
     }
+    
+    // the initialize maybe switch to other coroutines to start threads,
+    // for instance, the players of relay stream, which maybe create the source.
+    if (pool.find(stream_url) != pool.end()) {
+        srs_freep(source);
+        *pps = pool[stream_url];
+        return ret;
+    }
         
     pool[stream_url] = source;
     srs_info("create new source for url=%s, vhost=%s", stream_url.c_str(), vhost.c_str());
@@ -916,11 +1428,12 @@ SrsSource::SrsSource()
     cache_metadata = cache_sh_video = cache_sh_audio = NULL;
     
     _can_publish = true;
+    relay_from = -1;
     _source_id = -1;
     
     play_edge = new SrsPlayEdge();
     publish_edge = new SrsPublishEdge();
-    gop_cache = new SrsGopCache();
+    ring = new SrsSourceRing();
     aggregate_stream = new SrsStream();
     
     is_monotonically_increase = false;
@@ -954,7 +1467,7 @@ SrsSource::~SrsSource()
     
     srs_freep(play_edge);
     srs_freep(publish_edge);
-    srs_freep(gop_cache);
+    srs_freep(ring);
     srs_freep(aggregate_stream);
     
 #ifdef SRS_AUTO_HLS
@@ -984,8 +1497,10 @@ void SrsSource::dispose()
     srs_freep(cache_sh_video);
     srs_freep(cache_sh_audio);
     
-    // cleanup the gop cache.
-    gop_cache->dispose();
+    // cleanup the ring and gop cache,
+    // the messages are disposed, the waiting consumers must quit.
+    ring->dispose();
+    ring->wakeup();
 }
 
 int SrsSource::cycle()
@@ -1034,6 +1549,7 @@ int SrsSource::initialize(SrsRequest* r, ISrsSourceHandler* h, ISrsHlsHandler* h
     
     double queue_size = _srs_config->get_queue_length(_req->vhost);
     publish_edge->set_queue_size(queue_size);
+    ring->set_queue_size(queue_size);
     
     jitter_algorithm = (SrsRtmpJitterAlgorithm)_srs_config->get_time_jitter(_req->vhost);
     mix_correct = _srs_config->get_mix_correct(_req->vhost);
@@ -1055,7 +1571,8 @@ int SrsSource::on_reload_vhost_atc(string vhost)
     srs_warn("vhost %s atc changed to %d, connected client may corrupt.", 
         vhost.c_str(), enabled_atc);
     
-    gop_cache->clear();
+    ring->clear();
+    ring->wakeup();
     
     return ret;
 }
@@ -1088,6 +1605,7 @@ int SrsSource::on_reload_vhost_queue_length(string vhost)
     }
 
     double queue_size = _srs_config->get_queue_length(_req->vhost);
+    ring->set_queue_size(queue_size);
     
     if (true) {
         std::vector<SrsConsumer*>::iterator it;
@@ -1155,7 +1673,7 @@ int SrsSource::on_reload_vhost_forward(string vhost)
 {
     int ret = ERROR_SUCCESS;
     
-    if (_req->vhost != vhost) {
+    if (_req->vhost != vhost || relay_from >= 0) {
         return ret;
     }
 
@@ -1175,7 +1693,7 @@ int SrsSource::on_reload_vhost_hls(string vhost)
 {
     int ret = ERROR_SUCCESS;
     
-    if (_req->vhost != vhost) {
+    if (_req->vhost != vhost || relay_from >= 0) {
         return ret;
     }
     
@@ -1195,7 +1713,7 @@ int SrsSource::on_reload_vhost_hds(string vhost)
 {
     int ret = ERROR_SUCCESS;
 
-    if (_req->vhost != vhost) {
+    if (_req->vhost != vhost || relay_from >= 0) {
         return ret;
     }
 
@@ -1215,7 +1733,7 @@ int SrsSource::on_reload_vhost_dvr(string vhost)
 {
     int ret = ERROR_SUCCESS;
     
-    if (_req->vhost != vhost) {
+    if (_req->vhost != vhost || relay_from >= 0) {
         return ret;
     }
     
@@ -1244,7 +1762,7 @@ int SrsSource::on_reload_vhost_transcode(string vhost)
 {
     int ret = ERROR_SUCCESS;
     
-    if (_req->vhost != vhost) {
+    if (_req->vhost != vhost || relay_from >= 0) {
         return ret;
     }
     
@@ -1377,6 +1895,14 @@ bool SrsSource::can_publish(bool is_edge)
     if (is_edge) {
         return publish_edge->can_publish();
     }
+    
+    // the stream is published to other worker.
+    if (_can_publish) {
+        int worker = _srs_workers->find_publisher(_req->get_stream_url());
+        if (worker >= 0 && worker != _srs_workers->index()) {
+            return false;
+        }
+    }
 
     return _can_publish;
 }
@@ -1446,7 +1972,7 @@ int SrsSource::on_meta_data(SrsCommonMessage* msg, SrsOnMetaDataPacket* metadata
     char* payload = NULL;
     if ((ret = metadata->encode(size, payload)) != ERROR_SUCCESS) {
         srs_error("encode metadata error. ret=%d", ret);
-        srs_freep(payload);
+        srs_pool_freepa(payload);
         return ret;
     }
     srs_verbose("encode metadata success.");
@@ -1477,13 +2003,9 @@ int SrsSource::on_meta_data(SrsCommonMessage* msg, SrsOnMetaDataPacket* metadata
     
     // copy to all consumer
     if (!drop_for_reduce) {
-        std::vector<SrsConsumer*>::iterator it;
-        for (it = consumers.begin(); it != consumers.end(); ++it) {
-            SrsConsumer* consumer = *it;
-            if ((ret = consumer->enqueue(cache_metadata, atc, jitter_algorithm)) != ERROR_SUCCESS) {
-                srs_error("dispatch the metadata failed. ret=%d", ret);
-                return ret;
-            }
+        if ((ret = dispatch(cache_metadata)) != ERROR_SUCCESS) {
+            srs_error("dispatch the metadata failed. ret=%d", ret);
+            return ret;
         }
     }
     
@@ -1506,15 +2028,6 @@ int SrsSource::on_audio(SrsCommonMessage* shared_audio)
 {
     int ret = ERROR_SUCCESS;
     
-    // monotically increase detect.
-    if (!mix_correct && is_monotonically_increase) {
-        if (last_packet_time > 0 && shared_audio->header.timestamp < last_packet_time) {
-            is_monotonically_increase = false;
-            srs_warn("AUDIO: stream not monotonically increase, please open mix_correct.");
-        }
-    }
-    last_packet_time = shared_audio->header.timestamp;
-    
     // convert shared_audio to msg, user should not use shared_audio again.
     // the payload is transfer to msg, and set to NULL in shared_audio.
     SrsSharedPtrMessage msg;
@@ -1522,15 +2035,32 @@ int SrsSource::on_audio(SrsCommonMessage* shared_audio)
         srs_error("initialize the audio failed. ret=%d", ret);
         return ret;
     }
-    srs_info("Audio dts=%"PRId64", size=%d", msg.timestamp, msg.size);
+    
+    return on_audio(&msg);
+}
+
+int SrsSource::on_audio(SrsSharedPtrMessage* msg)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // monotically increase detect.
+    if (!mix_correct && is_monotonically_increase) {
+        if (last_packet_time > 0 && msg->timestamp < last_packet_time) {
+            is_monotonically_increase = false;
+            srs_warn("AUDIO: stream not monotonically increase, please open mix_correct.");
+        }
+    }
+    last_packet_time = msg->timestamp;
+    
+    srs_info("Audio dts=%"PRId64", size=%d", msg->timestamp, msg->size);
     
     // directly process the audio message.
     if (!mix_correct) {
-        return on_audio_imp(&msg);
+        return on_audio_imp(msg);
     }
     
     // insert msg to the queue.
-    mix_queue->push(msg.copy());
+    mix_queue->push(msg->copy());
     
     // fetch someone from mix queue.
     SrsSharedPtrMessage* m = mix_queue->pop();
@@ -1665,12 +2195,9 @@ int SrsSource::on_audio_imp(SrsSharedPtrMessage* msg)
     
     // copy to all consumer
     if (!drop_for_reduce) {
-        for (int i = 0; i < (int)consumers.size(); i++) {
-            SrsConsumer* consumer = consumers.at(i);
-            if ((ret = consumer->enqueue(msg, atc, jitter_algorithm)) != ERROR_SUCCESS) {
-                srs_error("dispatch the audio failed. ret=%d", ret);
-                return ret;
-            }
+        if ((ret = dispatch(msg)) != ERROR_SUCCESS) {
+            srs_error("dispatch the audio failed. ret=%d", ret);
+            return ret;
         }
         srs_info("dispatch audio success.");
     }
@@ -1701,7 +2228,7 @@ int SrsSource::on_audio_imp(SrsSharedPtrMessage* msg)
     }
     
     // cache the last gop packets
-    if ((ret = gop_cache->cache(msg)) != ERROR_SUCCESS) {
+    if ((ret = ring->cache(msg)) != ERROR_SUCCESS) {
         srs_error("shrink gop cache failed. ret=%d", ret);
         return ret;
     }
@@ -1724,43 +2251,51 @@ int SrsSource::on_video(SrsCommonMessage* shared_video)
 {
     int ret = ERROR_SUCCESS;
     
+    // convert shared_video to msg, user should not use shared_video again.
+    // the payload is transfer to msg, and set to NULL in shared_video.
+    SrsSharedPtrMessage msg;
+    if ((ret = msg.create(shared_video)) != ERROR_SUCCESS) {
+        srs_error("initialize the video failed. ret=%d", ret);
+        return ret;
+    }
+    
+    return on_video(&msg);
+}
+
+int SrsSource::on_video(SrsSharedPtrMessage* msg)
+{
+    int ret = ERROR_SUCCESS;
+    
     // monotically increase detect.
     if (!mix_correct && is_monotonically_increase) {
-        if (last_packet_time > 0 && shared_video->header.timestamp < last_packet_time) {
+        if (last_packet_time > 0 && msg->timestamp < last_packet_time) {
             is_monotonically_increase = false;
             srs_warn("VIDEO: stream not monotonically increase, please open mix_correct.");
         }
     }
-    last_packet_time = shared_video->header.timestamp;
+    last_packet_time = msg->timestamp;
     
     // drop any unknown header video.
     // @see https://github.com/ossrs/srs/issues/421
-    if (!SrsFlvCodec::video_is_acceptable(shared_video->payload, shared_video->size)) {
+    if (!SrsFlvCodec::video_is_acceptable(msg->payload, msg->size)) {
         char b0 = 0x00;
-        if (shared_video->size > 0) {
-            b0 = shared_video->payload[0];
+        if (msg->size > 0) {
+            b0 = msg->payload[0];
         }
         
-        srs_warn("drop unknown header video, size=%d, bytes[0]=%#x", shared_video->size, b0);
+        srs_warn("drop unknown header video, size=%d, bytes[0]=%#x", msg->size, b0);
         return ret;
     }
     
-    // convert shared_video to msg, user should not use shared_video again.
-    // the payload is transfer to msg, and set to NULL in shared_video.
-    SrsSharedPtrMessage msg;
-    if ((ret = msg.create(shared_video)) != ERROR_SUCCESS) {
-        srs_error("initialize the video failed. ret=%d", ret);
-        return ret;
-    }
-    srs_info("Video dts=%"PRId64", size=%d", msg.timestamp, msg.size);
+    srs_info("Video dts=%"PRId64", size=%d", msg->timestamp, msg->size);
     
     // directly process the audio message.
     if (!mix_correct) {
-        return on_video_imp(&msg);
+        return on_video_imp(msg);
     }
     
     // insert msg to the queue.
-    mix_queue->push(msg.copy());
+    mix_queue->push(msg->copy());
     
     // fetch someone from mix queue.
     SrsSharedPtrMessage* m = mix_queue->pop();
@@ -1881,12 +2416,9 @@ int SrsSource::on_video_imp(SrsSharedPtrMessage* msg)
     
     // copy to all consumer
     if (!drop_for_reduce) {
-        for (int i = 0; i < (int)consumers.size(); i++) {
-            SrsConsumer* consumer = consumers.at(i);
-            if ((ret = consumer->enqueue(msg, atc, jitter_algorithm)) != ERROR_SUCCESS) {
-                srs_error("dispatch the video failed. ret=%d", ret);
-                return ret;
-            }
+        if ((ret = dispatch(msg)) != ERROR_SUCCESS) {
+            srs_error("dispatch the video failed. ret=%d", ret);
+            return ret;
         }
         srs_info("dispatch video success.");
     }
@@ -1909,7 +2441,7 @@ int SrsSource::on_video_imp(SrsSharedPtrMessage* msg)
     }
 
     // cache the last gop packets
-    if ((ret = gop_cache->cache(msg)) != ERROR_SUCCESS) {
+    if ((ret = ring->cache(msg)) != ERROR_SUCCESS) {
         srs_error("gop cache msg failed. ret=%d", ret);
         return ret;
     }
@@ -1928,6 +2460,33 @@ int SrsSource::on_video_imp(SrsSharedPtrMessage* msg)
     return ret;
 }
 
+int SrsSource::dispatch(SrsSharedPtrMessage* msg)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // shrink the ring when got keyframe, for each gop,
+    // or the ring is full of messages, for the pure audio stream.
+    bool is_keyframe = msg->is_video() && SrsFlvCodec::video_is_keyframe(msg->payload, msg->size);
+    if (is_keyframe || ring->full()) {
+        int64_t cursor = ring->end();
+        
+        std::vector<SrsConsumer*>::iterator it;
+        for (it = consumers.begin(); it != consumers.end(); ++it) {
+            SrsConsumer* consumer = *it;
+            cursor = srs_min(cursor, consumer->get_cursor());
+        }
+        
+        ring->shrink(cursor);
+    }
+    
+    // all consumers fetch the message from ring.
+    if ((ret = ring->append(msg)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return ret;
+}
+
 int SrsSource::on_aggregate(SrsCommonMessage* msg)
 {
     int ret = ERROR_SUCCESS;
@@ -2009,8 +2568,8 @@ int SrsSource::on_aggregate(SrsCommonMessage* msg)
         o.header.perfer_cid = msg->header.perfer_cid;
 
         if (data_size > 0) {
+            o.create_payload(data_size);
             o.size = data_size;
-            o.payload = new char[o.size];
             stream->read_bytes(o.payload, o.size);
         }
         
@@ -2056,6 +2615,27 @@ int SrsSource::on_publish()
     is_monotonically_increase = true;
     last_packet_time = 0;
     
+    // the relay stream only notify the handler to serve the players.
+    if (relay_from >= 0) {
+        srs_assert(handler);
+        if ((ret = handler->on_publish(this, _req)) != ERROR_SUCCESS) {
+            srs_error("handle on publish relay failed. ret=%d", ret);
+            return ret;
+        }
+        SrsStatistic* stat = SrsStatistic::instance();
+        stat->on_stream_publish(_req, _source_id);
+        
+        srs_trace("relay stream %s from worker %d", _req->get_stream_url().c_str(), relay_from);
+        return ret;
+    }
+    
+    // register the stream for other workers to relay.
+    if (!_srs_config->get_vhost_is_edge(_req->vhost)) {
+        if ((ret = _srs_workers->on_publish(_req->get_stream_url())) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
     // create forwarders
     if ((ret = create_forwarders()) != ERROR_SUCCESS) {
         srs_error("create forwarders failed. ret=%d", ret);
@@ -2107,6 +2687,9 @@ int SrsSource::on_publish()
 
 void SrsSource::on_unpublish()
 {
+    // unregister the stream published to current worker.
+    _srs_workers->on_unpublish(_req->get_stream_url());
+    
     // destroy all forwarders
     destroy_forwarders();
 
@@ -2129,7 +2712,10 @@ void SrsSource::on_unpublish()
     // only clear the gop cache,
     // donot clear the sequence header, for it maybe not changed,
     // when drop dup sequence header, drop the metadata also.
-    gop_cache->clear();
+    ring->clear();
+    
+    // wakeup the consumers wait on ring, which never got messages.
+    ring->wakeup();
     
     srs_info("clear cache/metadata when unpublish.");
     srs_trace("cleanup when unpublish");
@@ -2149,21 +2735,22 @@ int SrsSource::create_consumer(SrsConnection* conn, SrsConsumer*& consumer, bool
     int ret = ERROR_SUCCESS;
     
     consumer = new SrsConsumer(this, conn);
+    consumer->handle = (int)consumers.size();
     consumers.push_back(consumer);
     
     double queue_size = _srs_config->get_queue_length(_req->vhost);
     consumer->set_queue_size(queue_size);
     
     // if atc, update the sequence header to gop cache time.
-    if (atc && !gop_cache->empty()) {
+    if (atc && !ring->empty()) {
         if (cache_metadata) {
-            cache_metadata->timestamp = gop_cache->start_time();
+            cache_metadata->timestamp = ring->start_time();
         }
         if (cache_sh_video) {
-            cache_sh_video->timestamp = gop_cache->start_time();
+            cache_sh_video->timestamp = ring->start_time();
         }
         if (cache_sh_audio) {
-            cache_sh_audio->timestamp = gop_cache->start_time();
+            cache_sh_audio->timestamp = ring->start_time();
         }
     }
     
@@ -2189,9 +2776,10 @@ int SrsSource::create_consumer(SrsConnection* conn, SrsConsumer*& consumer, bool
     }
     srs_info("dispatch video sequence header success");
     
-    // copy gop cache to client.
-    if (dg && (ret = gop_cache->dump(consumer, atc, jitter_algorithm)) != ERROR_SUCCESS) {
-        return ret;
+    // start from the gop cache, the consumer fetch it from ring.
+    if (dg && !ring->empty()) {
+        consumer->seek(ring->gop());
+        srs_trace("dispatch cached gop success. count=%d", (int)(ring->end() - ring->gop()));
     }
     
     // print status.
@@ -2208,6 +2796,18 @@ int SrsSource::create_consumer(SrsConnection* conn, SrsConsumer*& consumer, bool
             srs_error("notice edge start play stream failed. ret=%d", ret);
             return ret;
         }
+    } else if (_can_publish || relay_from >= 0) {
+        // relay the stream published to other worker by the edge ingester.
+        if (relay_from < 0) {
+            int worker = _srs_workers->find_publisher(_req->get_stream_url());
+            if (worker != _srs_workers->index()) {
+                relay_from = worker;
+            }
+        }
+        if (relay_from >= 0 && (ret = play_edge->on_client_play()) != ERROR_SUCCESS) {
+            srs_error("notice relay start play stream failed. ret=%d", ret);
+            return ret;
+        }
     }
     
     return ret;
@@ -2215,21 +2815,26 @@ int SrsSource::create_consumer(SrsConnection* conn, SrsConsumer*& consumer, bool
 
 void SrsSource::on_consumer_destroy(SrsConsumer* consumer)
 {
-    std::vector<SrsConsumer*>::iterator it;
-    it = std::find(consumers.begin(), consumers.end(), consumer);
-    if (it != consumers.end()) {
-        consumers.erase(it);
+    // move the last consumer to the slot, the order of consumers is not required.
+    int handle = consumer->handle;
+    if (handle >= 0 && handle < (int)consumers.size() && consumers[handle] == consumer) {
+        SrsConsumer* last = consumers.back();
+        consumers[handle] = last;
+        last->handle = handle;
+        consumers.pop_back();
+        consumer->handle = -1;
     }
     srs_info("handle consumer destroy success.");
     
     if (consumers.empty()) {
         play_edge->on_all_client_stop();
+        relay_from = -1;
     }
 }
 
 void SrsSource::set_cache(bool enabled)
 {
-    gop_cache->set(enabled);
+    ring->set(enabled);
 }
 
 SrsRtmpJitterAlgorithm SrsSource::jitter()
@@ -2252,6 +2857,19 @@ void SrsSource::on_edge_proxy_unpublish()
     publish_edge->on_proxy_unpublish();
 }
 
+int SrsSource::relay_worker()
+{
+    // the stream maybe republished to another worker.
+    if (relay_from >= 0) {
+        int worker = _srs_workers->find_publisher(_req->get_stream_url());
+        if (worker >= 0 && worker != _srs_workers->index()) {
+            relay_from = worker;
+        }
+    }
+    
+    return relay_from;
+}
+
 int SrsSource::create_forwarders()
 {
     int ret = ERROR_SUCCESS;
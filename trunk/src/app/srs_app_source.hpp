@@ -31,6 +31,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <srs_core.hpp>
 
 #include <map>
+#include <deque>
 #include <vector>
 #include <string>
 
@@ -39,6 +40,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <srs_core_performance.hpp>
 
 class SrsConsumer;
+class SrsTimerCond;
 class SrsPlayEdge;
 class SrsPublishEdge;
 class SrsSource;
@@ -198,6 +200,84 @@ public:
     virtual void clear();
 };
 
+/**
+* the message ring for the consumer(client),
+* which shares the payload of source message and stores the corrected timestamp
+* in the message object of ring, so never alloc message when enqueue.
+* we limit the size in seconds, drop the messages before the last keyframe if full.
+*/
+class SrsMessageRing
+{
+private:
+    int64_t av_start_time;
+    int64_t av_end_time;
+    int queue_size_ms;
+    // the message objects, the message of sequence seq is msgs[seq % capacity].
+    SrsSharedPtrMessage* msgs;
+    int capacity;
+    // the sequence of the first message and the next message.
+    int64_t head;
+    int64_t tail;
+    // the sequence of the last video keyframe, -1 when no keyframe.
+    int64_t keyframe;
+    // the last sequence headers, resend when dropped by shrink.
+    SrsSharedPtrMessage* video_sh;
+    int64_t video_sh_seq;
+    SrsSharedPtrMessage* audio_sh;
+    int64_t audio_sh_seq;
+    // the messages dumped to send, released when dump next time.
+    SrsSharedPtrMessage* sending;
+    int nb_sending;
+    int max_sending;
+public:
+    SrsMessageRing();
+    virtual ~SrsMessageRing();
+public:
+    /**
+    * get the size of queue.
+    */
+    virtual int size();
+    /**
+    * get the duration of queue.
+    */
+    virtual int duration();
+    /**
+    * set the queue size
+    * @param queue_size the queue size in seconds.
+    */
+    virtual void set_queue_size(double queue_size);
+public:
+    /**
+    * enqueue the message, the timestamp always monotonically.
+    * @param msg, the msg to enqueue, which is swapped into the ring and empty after enqueue.
+    * @param is_overflow, whether overflow and shrinked. NULL to ignore.
+    */
+    virtual int enqueue(SrsSharedPtrMessage* msg, bool* is_overflow = NULL);
+    /**
+     * get packets in consumer queue.
+     * @pmsgs SrsSharedPtrMessage*[], used to store the msgs, user must alloc it.
+     * @count the count in array, output param.
+     * @max_count the max count to dequeue, must be positive.
+     * @remark the msgs is owned by ring and valid util next dump, user must never free it.
+     */
+    virtual int dump_packets(int max_count, SrsSharedPtrMessage** pmsgs, int& count);
+private:
+    /**
+    * remove the messages before the last keyframe from the front.
+    * if no keyframe found, clear it.
+    */
+    virtual void shrink();
+    /**
+    * double the capacity when ring is full.
+    */
+    virtual void grow();
+public:
+    /**
+     * clear all messages in queue.
+     */
+    virtual void clear();
+};
+
 /**
  * the wakable used for some object
  * which is waiting on cond.
@@ -221,10 +301,18 @@ public:
 */
 class SrsConsumer : public ISrsWakable
 {
+    friend class SrsSource;
 private:
     SrsRtmpJitter* jitter;
     SrsSource* source;
-    SrsMessageQueue* queue;
+    // the index in the consumers of source, to remove in O(1).
+    int handle;
+    // the messages enqueue to consumer, and fetched from source by cursor.
+    SrsMessageRing* queue;
+    // the sequence of the next message to fetch from the ring of source.
+    int64_t cursor;
+    // the max duration in ms to lag behind source, skip to keyframe when overflow.
+    int queue_size_ms;
     // the owner connection for debug, maybe NULL.
     SrsConnection* conn;
     bool paused;
@@ -233,10 +321,13 @@ private:
 #ifdef SRS_PERF_QUEUE_COND_WAIT
     // the cond wait for mw.
     // @see https://github.com/ossrs/srs/issues/251
-    st_cond_t mw_wait;
+    SrsTimerCond* mw_wait;
     bool mw_waiting;
     int mw_min_msgs;
     int mw_duration;
+    // the time and the sequence of ring to wakeup by the ring of source.
+    int64_t mw_wakeup_time;
+    int64_t mw_wakeup_seq;
 #endif
 public:
     SrsConsumer(SrsSource* s, SrsConnection* c);
@@ -250,6 +341,14 @@ public:
     * when source id changed, notice client to print.
     */
     virtual void update_source_id();
+    /**
+    * the sequence of the next message to fetch from the ring of source.
+    */
+    virtual int64_t get_cursor();
+    /**
+    * start to fetch messages from the sequence of the ring of source.
+    */
+    virtual void seek(int64_t seq);
 public:
     /**
     * get current client time, the last packet time.
@@ -267,15 +366,27 @@ public:
      * @param msgs the msgs array to dump packets to send.
      * @param count the count in array, intput and output param.
      * @remark user can specifies the count to get specified msgs; 0 to get all if possible.
+     * @remark the msgs is owned by consumer and valid util next dump, user must never free it.
      */
     virtual int dump_packets(SrsMessageArray* msgs, int& count);
+private:
+    /**
+     * fetch the messages from the ring of source by cursor to queue,
+     * correct the timestamp of each message by the jitter of consumer.
+     * @param max_count the max count of messages in queue.
+     */
+    virtual int fetch(int max_count);
+public:
 #ifdef SRS_PERF_QUEUE_COND_WAIT
     /**
     * wait for messages incomming, atleast nb_msgs and in duration.
     * @param nb_msgs the messages count to wait.
     * @param duration the messgae duration to wait.
+    * @param timeout the max time in us to wait, -1 to wait util messages enough.
+    * @remark the http stream has no recv thread to wakeup the consumer,
+    *       so it must wait with timeout to check whether the stream is unmounted.
     */
-    virtual void wait(int nb_msgs, int duration);
+    virtual void wait(int nb_msgs, int duration, int64_t timeout = -1);
 #endif
     /**
     * when client send the pause message.
@@ -292,12 +403,38 @@ public:
 };
 
 /**
-* cache a gop of video/audio data,
+* the append-only ring of the shared messages of source, indexed by gop,
+* all consumers read the messages by cursor, so the source never copy
+* message to each consumer, and the new consumer starts from the cached gop.
+* the ring also cache a gop of video/audio data,
 * delivery at the connect of flash player,
 * to enable it to fast startup.
 */
-class SrsGopCache
+class SrsSourceRing
 {
+private:
+    // the message of sequence seq is msgs[seq % capacity],
+    // and the monotonic time of message is times[seq % capacity].
+    SrsSharedPtrMessage* msgs;
+    int64_t* times;
+    int capacity;
+    // the sequence of the first message and the next message.
+    int64_t head;
+    int64_t tail;
+    // the sequences of the video keyframes in ring, the index of gops.
+    std::deque<int64_t> keyframes;
+    // the monotonic time of ring in ms, which is the sum of valid timestamp delta,
+    // to calc the duration of messages even if the timestamp of stream jitter.
+    int64_t last_pkt_time;
+    int64_t time;
+    // the max duration in ms of the messages which consumers read.
+    int queue_size_ms;
+    // the consumers wait for messages, sort by the time to wakeup,
+    // the value is the consumer and the sequence of ring to wakeup.
+    std::multimap<int64_t, std::pair<SrsConsumer*, int64_t> > waiters;
+    // the consumers got the duration but wait for the count of messages,
+    // sort by the sequence of ring to wakeup.
+    std::multimap<int64_t, SrsConsumer*> seq_waiters;
 private:
     /**
     * if disabled the gop cache,
@@ -323,17 +460,81 @@ private:
     */
     int audio_after_last_video_count;
     /**
-    * cached gop.
+    * the sequence of the first message of cached gop, -1 when not cached.
     */
-    std::vector<SrsSharedPtrMessage*> gop_cache;
+    int64_t gop_start;
 public:
-    SrsGopCache();
-    virtual ~SrsGopCache();
+    SrsSourceRing();
+    virtual ~SrsSourceRing();
 public:
     /**
      * cleanup when system quit.
      */
     virtual void dispose();
+    /**
+    * set the queue size, the ring keeps the messages in duration for consumers.
+    * @param queue_size the queue size in seconds.
+    */
+    virtual void set_queue_size(double queue_size);
+// the messages for consumers.
+public:
+    /**
+    * the sequence of the first message, and the next message to append.
+    */
+    virtual int64_t begin();
+    virtual int64_t end();
+    /**
+    * whether the ring is full, user should shrink it before append.
+    */
+    virtual bool full();
+    /**
+    * get the message of sequence, user must copy or share it to use.
+    * @remark user must ensure the seq in [begin, end).
+    */
+    virtual SrsSharedPtrMessage* at(int64_t seq);
+    /**
+    * get the duration in ms from the message of sequence to the last message.
+    * @remark the seq should in [begin, end], 0 for the end.
+    */
+    virtual int duration(int64_t seq);
+    /**
+    * get the sequence of the last video keyframe, -1 if no keyframe.
+    */
+    virtual int64_t last_keyframe();
+    /**
+    * append the message to ring, share the payload and never copy it,
+    * and wakeup the consumers which wait for it.
+    * @param shared_msg, directly ptr, copy it if need to save it.
+    */
+    virtual int append(SrsSharedPtrMessage* shared_msg);
+    /**
+    * remove the messages before cursor from the front,
+    * the messages in queue duration and cached gop are kept.
+    * @param cursor the min cursor of consumers, which read from it.
+    */
+    virtual void shrink(int64_t cursor);
+    /**
+    * the consumer wait for messages, wakeup when the messages in duration,
+    * and the end of ring reach the sequence.
+    * @param duration the duration in ms from the message of cursor.
+    * @param wakeup_seq the sequence of ring to wakeup, that is, the count of messages.
+    * @return the time to wakeup, user use it to unwait.
+    */
+    virtual int64_t wait(SrsConsumer* consumer, int64_t cursor, int duration, int64_t wakeup_seq);
+    /**
+    * remove the consumer from the waiting list.
+    * @param wakeup_time the time to wakeup returned by wait.
+    * @param wakeup_seq the sequence to wakeup passed to wait.
+    */
+    virtual void unwait(SrsConsumer* consumer, int64_t wakeup_time, int64_t wakeup_seq);
+    /**
+    * wakeup all waiting consumers, for example, when unpublish.
+    */
+    virtual void wakeup();
+private:
+    virtual void grow();
+// the gop cache.
+public:
     /**
     * to enable or disable the gop cache.
     */
@@ -342,7 +543,7 @@ public:
     * only for h264 codec
     * 1. cache the gop when got h264 video packet.
     * 2. clear gop when got keyframe.
-    * @param shared_msg, directly ptr, copy it if need to save it.
+    * @param shared_msg, the last message appended to ring.
     */
     virtual int cache(SrsSharedPtrMessage* shared_msg);
     /**
@@ -350,9 +551,10 @@ public:
     */
     virtual void clear();
     /**
-    * dump the cached gop to consumer.
+    * get the sequence of cached gop for consumer to start from,
+    * the end of ring when gop not cached.
     */
-    virtual int dump(SrsConsumer* consumer, bool atc, SrsRtmpJitterAlgorithm jitter_algorithm);
+    virtual int64_t gop();
     /**
     * used for atc to get the time of gop cache,
     * the atc will adjust the sequence header timestamp to gop cache.
@@ -414,6 +616,7 @@ public:
 */
 class SrsSource : public ISrsReloadHandler
 {
+    friend class SrsConsumer;
 private:
     static std::map<std::string, SrsSource*> pool;
 public:
@@ -444,7 +647,7 @@ public:
     * for gmc to analysis mem leaks.
     */
     static void destroy();
-private:
+protected:
     // source id,
     // for publish, it's the publish client id.
     // for edge, it's the edge ingest id.
@@ -481,8 +684,8 @@ private:
     // edge control service
     SrsPlayEdge* play_edge;
     SrsPublishEdge* publish_edge;
-    // gop cache for client fast startup.
-    SrsGopCache* gop_cache;
+    // the ring of messages for consumers, and gop cache for client fast startup.
+    SrsSourceRing* ring;
     // to forward stream to other servers
     std::vector<SrsForwarder*> forwarders;
     // for aggregate message
@@ -495,13 +698,19 @@ private:
     */
     bool _can_publish;
     /**
+    * the worker which the stream is relayed from, -1 when not relay.
+    * the relay stream only serves the players of current worker,
+    * the owner worker delivers it to hls, dvr, forwarders and hooks.
+    */
+    int relay_from;
+    /**
     * atc whether atc(use absolute time and donot adjust time),
     * directly use msg time and donot adjust if atc is true,
     * otherwise, adjust msg time to start from 0 to make flash happy.
     */
     // TODO: FIXME: to support reload atc.
     bool atc;
-private:
+protected:
     SrsSharedPtrMessage* cache_metadata;
     // the cached video sequence header.
     SrsSharedPtrMessage* cache_sh_video;
@@ -549,12 +758,27 @@ public:
     virtual int on_meta_data(SrsCommonMessage* msg, SrsOnMetaDataPacket* metadata);
 public:
     virtual int on_audio(SrsCommonMessage* audio);
+    /**
+    * process the shared audio, for the publisher in process.
+    * @remark the msg is copied when source need to keep it.
+    */
+    virtual int on_audio(SrsSharedPtrMessage* audio);
 private:
     virtual int on_audio_imp(SrsSharedPtrMessage* audio);
 public:
     virtual int on_video(SrsCommonMessage* video);
+    /**
+    * process the shared video, for the publisher in process.
+    * @remark the msg is copied when source need to keep it.
+    */
+    virtual int on_video(SrsSharedPtrMessage* video);
 private:
     virtual int on_video_imp(SrsSharedPtrMessage* video);
+    /**
+    * append the message to the ring for all consumers to fetch,
+    * shrink the ring to the min cursor of consumers for each gop.
+    */
+    virtual int dispatch(SrsSharedPtrMessage* msg);
 public:
     virtual int on_aggregate(SrsCommonMessage* msg);
     /**
@@ -588,6 +812,8 @@ public:
     virtual int on_edge_proxy_publish(SrsCommonMessage* msg);
     // for edge, proxy stop publish
     virtual void on_edge_proxy_unpublish();
+    // for workers, the worker to relay the stream from, -1 when not relay.
+    virtual int relay_worker();
 private:
     virtual int create_forwarders();
     virtual void destroy_forwarders();
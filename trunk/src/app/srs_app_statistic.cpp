@@ -28,11 +28,13 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 using namespace std;
 
 #include <srs_rtmp_stack.hpp>
+#include <srs_rtmp_utility.hpp>
 #include <srs_protocol_json.hpp>
 #include <srs_protocol_kbps.hpp>
 #include <srs_app_conn.hpp>
 #include <srs_app_config.hpp>
 #include <srs_kernel_utility.hpp>
+#include <srs_app_worker.hpp>
 
 int64_t srs_gvid = getpid();
 
@@ -95,6 +97,7 @@ SrsStatisticStream::SrsStatisticStream()
     vhost = NULL;
     active = false;
     connection_cid = -1;
+    clients = NULL;
     
     has_video = false;
     vcodec = SrsCodecVideoReserved;
@@ -124,6 +127,7 @@ int SrsStatisticStream::dumps(stringstream& ss)
     
     ss << SRS_JOBJECT_START
             << SRS_JFIELD_ORG("id", id) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("worker", _srs_workers->index()) << SRS_JFIELD_CONT
             << SRS_JFIELD_STR("name", stream) << SRS_JFIELD_CONT
             << SRS_JFIELD_ORG("vhost", vhost->id) << SRS_JFIELD_CONT
             << SRS_JFIELD_STR("app", app) << SRS_JFIELD_CONT
@@ -192,6 +196,7 @@ SrsStatisticClient::SrsStatisticClient()
     req = NULL;
     type = SrsRtmpConnUnknown;
     create = srs_get_system_time_ms();
+    prev = next = NULL;
 }
 
 SrsStatisticClient::~SrsStatisticClient()
@@ -204,6 +209,7 @@ int SrsStatisticClient::dumps(stringstream& ss)
     
     ss << SRS_JOBJECT_START
             << SRS_JFIELD_ORG("id", id) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("worker", _srs_workers->index()) << SRS_JFIELD_CONT
             << SRS_JFIELD_ORG("vhost", stream->vhost->id) << SRS_JFIELD_CONT
             << SRS_JFIELD_ORG("stream", stream->id) << SRS_JFIELD_CONT
             << SRS_JFIELD_STR("ip", req->ip) << SRS_JFIELD_CONT
@@ -213,6 +219,7 @@ int SrsStatisticClient::dumps(stringstream& ss)
             << SRS_JFIELD_STR("url", req->get_stream_url()) << SRS_JFIELD_CONT
             << SRS_JFIELD_STR("type", srs_client_type_string(type)) << SRS_JFIELD_CONT
             << SRS_JFIELD_BOOL("publish", srs_client_type_is_publish(type)) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("recv_buffer", (conn? conn->get_recv_buffer_size() : 0)) << SRS_JFIELD_CONT
             << SRS_JFIELD_ORG("alive", srs_get_system_time_ms() - create)
         << SRS_JOBJECT_END;
     
@@ -357,6 +364,13 @@ int SrsStatistic::on_client(int id, SrsRequest* req, SrsConnection* conn, SrsRtm
         client->id = id;
         client->stream = stream;
         clients[id] = client;
+        
+        // link to the clients of stream.
+        client->next = stream->clients;
+        if (stream->clients) {
+            stream->clients->prev = client;
+        }
+        stream->clients = client;
     } else {
         client = clients[id];
     }
@@ -382,6 +396,16 @@ void SrsStatistic::on_disconnect(int id)
     SrsStatisticStream* stream = client->stream;
     SrsStatisticVhost* vhost = stream->vhost;
     
+    // unlink from the clients of stream.
+    if (client->prev) {
+        client->prev->next = client->next;
+    } else {
+        stream->clients = client->next;
+    }
+    if (client->next) {
+        client->next->prev = client->prev;
+    }
+    
     srs_freep(client);
     clients.erase(it);
     
@@ -397,18 +421,35 @@ void SrsStatistic::kbps_add_delta(SrsConnection* conn)
     }
     
     SrsStatisticClient* client = clients[id];
-    
-    // resample the kbps to collect the delta.
-    conn->resample();
-    
-    // add delta of connection to kbps.
-    // for next sample() of server kbps can get the stat.
-    kbps->add_delta(conn);
-    client->stream->kbps->add_delta(conn);
-    client->stream->vhost->kbps->add_delta(conn);
-    
-    // cleanup the delta.
-    conn->cleanup();
+    add_delta(client);
+}
+
+void SrsStatistic::kbps_add_delta()
+{
+    // walk the index of vhosts and streams, add the delta of clients to stream,
+    // then stream to vhost and vhost to server, so each client only adds once.
+    std::map<int64_t, SrsStatisticVhost*>::iterator it;
+    for (it = vhosts.begin(); it != vhosts.end(); ++it) {
+        SrsStatisticVhost* vhost = it->second;
+        
+        std::vector<SrsStatisticStream*>::iterator st;
+        for (st = vhost->streams.begin(); st != vhost->streams.end(); ++st) {
+            SrsStatisticStream* stream = *st;
+            
+            for (SrsStatisticClient* client = stream->clients; client; client = client->next) {
+                // ignore the client without connection.
+                if (client->conn) {
+                    add_delta(client);
+                }
+            }
+            
+            vhost->kbps->add_delta(stream->kbps);
+            stream->kbps->cleanup();
+        }
+        
+        kbps->add_delta(vhost->kbps);
+        vhost->kbps->cleanup();
+    }
 }
 
 SrsKbps* SrsStatistic::kbps_sample()
@@ -437,6 +478,29 @@ int64_t SrsStatistic::server_id()
     return _server_id;
 }
 
+void SrsStatistic::fetch_clients(string vhost, vector<SrsConnection*>& conns)
+{
+    std::map<std::string, SrsStatisticVhost*>::iterator it;
+    if ((it = rvhosts.find(vhost)) == rvhosts.end()) {
+        return;
+    }
+    
+    std::vector<SrsStatisticStream*>& streams = it->second->streams;
+    for (int i = 0; i < (int)streams.size(); i++) {
+        fetch_clients(streams[i], conns);
+    }
+}
+
+void SrsStatistic::fetch_clients(string vhost, string app, string stream, vector<SrsConnection*>& conns)
+{
+    std::map<std::string, SrsStatisticStream*>::iterator it;
+    if ((it = rstreams.find(srs_generate_stream_url(vhost, app, stream))) == rstreams.end()) {
+        return;
+    }
+    
+    fetch_clients(it->second, conns);
+}
+
 int SrsStatistic::dumps_vhosts(stringstream& ss)
 {
     int ret = ERROR_SUCCESS;
@@ -541,6 +605,7 @@ SrsStatisticStream* SrsStatistic::create_stream(SrsStatisticVhost* vhost, SrsReq
         stream->url = url;
         rstreams[url] = stream;
         streams[stream->id] = stream;
+        vhost->streams.push_back(stream);
         return stream;
     }
     
@@ -549,3 +614,27 @@ SrsStatisticStream* SrsStatistic::create_stream(SrsStatisticVhost* vhost, SrsReq
     return stream;
 }
 
+void SrsStatistic::add_delta(SrsStatisticClient* client)
+{
+    SrsConnection* conn = client->conn;
+    
+    // resample the kbps to collect the delta.
+    conn->resample();
+    
+    // add delta of connection to stream kbps,
+    // which is added to vhost and server by kbps_add_delta().
+    client->stream->kbps->add_delta(conn);
+    
+    // cleanup the delta.
+    conn->cleanup();
+}
+
+void SrsStatistic::fetch_clients(SrsStatisticStream* stream, vector<SrsConnection*>& conns)
+{
+    for (SrsStatisticClient* client = stream->clients; client; client = client->next) {
+        if (client->conn) {
+            conns.push_back(client->conn);
+        }
+    }
+}
+
@@ -32,6 +32,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include <srs_kernel_codec.hpp>
 #include <srs_rtmp_stack.hpp>
@@ -39,6 +40,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 class SrsKbps;
 class SrsRequest;
 class SrsConnection;
+struct SrsStatisticStream;
+struct SrsStatisticClient;
 
 struct SrsStatisticVhost
 {
@@ -47,6 +50,10 @@ public:
     std::string vhost;
     int nb_streams;
     int nb_clients;
+    /**
+    * the streams of vhost, to fetch the clients of vhost.
+    */
+    std::vector<SrsStatisticStream*> streams;
 public:
     /**
     * vhost total kbps.
@@ -70,6 +77,10 @@ public:
     bool active;
     int connection_cid;
     int nb_clients;
+    /**
+    * the head of the intrusive list of clients of stream.
+    */
+    SrsStatisticClient* clients;
 public:
     /**
     * stream total kbps.
@@ -119,6 +130,11 @@ public:
     SrsRtmpConnType type;
     int id;
     int64_t create;
+    /**
+    * the intrusive list of clients of stream, to add and remove in O(1).
+    */
+    SrsStatisticClient* prev;
+    SrsStatisticClient* next;
 public:
     SrsStatisticClient();
     virtual ~SrsStatisticClient();
@@ -205,6 +221,11 @@ public:
     // TODO: FIXME: the add delta must use IKbpsDelta interface instead.
     virtual void kbps_add_delta(SrsConnection* conn);
     /**
+    * add delta bytes of all clients, without scan all connections,
+    * by the index of vhosts and streams.
+    */
+    virtual void kbps_add_delta();
+    /**
     * calc the result for all kbps.
     * @return the server kbps.
     */
@@ -216,6 +237,13 @@ public:
     */
     virtual int64_t server_id();
     /**
+    * fetch the connections of vhost or stream, from the clients index of
+    * vhost and stream, without scan all connections.
+    * @remark the client without connection is ignored, for example, the local publisher.
+    */
+    virtual void fetch_clients(std::string vhost, std::vector<SrsConnection*>& conns);
+    virtual void fetch_clients(std::string vhost, std::string app, std::string stream, std::vector<SrsConnection*>& conns);
+    /**
     * dumps the vhosts to sstream in json.
     */
     virtual int dumps_vhosts(std::stringstream& ss);
@@ -232,6 +260,8 @@ public:
 private:
     virtual SrsStatisticVhost* create_vhost(SrsRequest* req);
     virtual SrsStatisticStream* create_stream(SrsStatisticVhost* vhost, SrsRequest* req);
+    virtual void add_delta(SrsStatisticClient* client);
+    virtual void fetch_clients(SrsStatisticStream* stream, std::vector<SrsConnection*>& conns);
 };
 
 #endif
@@ -25,6 +25,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include <srs_kernel_error.hpp>
 #include <srs_kernel_log.hpp>
+#include <srs_app_timer.hpp>
 
 namespace internal {
     ISrsThreadHandler::ISrsThreadHandler()
@@ -60,6 +61,7 @@ namespace internal {
         _name = name;
         handler = thread_handler;
         cycle_interval_us = interval_us;
+        sleeper = NULL;
         
         tid = NULL;
         loop = false;
@@ -78,6 +80,7 @@ namespace internal {
     SrsThread::~SrsThread()
     {
         stop();
+        srs_freep(sleeper);
     }
     
     int SrsThread::cid()
@@ -225,7 +228,10 @@ namespace internal {
             // to improve performance, donot sleep when interval is zero.
             // @see: https://github.com/ossrs/srs/issues/237
             if (cycle_interval_us != 0) {
-                st_usleep(cycle_interval_us);
+                if (!sleeper) {
+                    sleeper = new SrsTimerCond();
+                }
+                sleeper->wait(cycle_interval_us);
             }
         }
         
@@ -31,6 +31,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include <srs_app_st.hpp>
 
+class SrsTimerCond;
+
 // the internal classes, user should never use it.
 // user should use the public classes at the bellow:
 // @see SrsEndlessThread, SrsOneCycleThread, SrsReusableThread
@@ -104,6 +106,8 @@ namespace internal {
     private:
         ISrsThreadHandler* handler;
         int64_t cycle_interval_us;
+        // sleep by timer wheel when interval not zero.
+        SrsTimerCond* sleeper;
     public:
         /**
          * initialize the thread.
@@ -0,0 +1,214 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <srs_app_timer.hpp>
+
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_utility.hpp>
+
+// the max time in ms the timer thread sleeps.
+#define SRS_TIMER_MAX_SLEEP_MS 1000
+// the interval in ms to report the lag of timers.
+#define SRS_TIMER_REPORT_MS (60 * 1000)
+
+SrsTimer* _srs_timer = new SrsTimer();
+
+SrsTimer::SrsTimer()
+{
+    tick = 0;
+    wheel = NULL;
+    pthread = new SrsEndlessThread("timer", this);
+    cond = NULL;
+    wakeup = 0;
+    last = delta = 0;
+    report = 0;
+}
+
+SrsTimer::~SrsTimer()
+{
+    srs_freep(pthread);
+    srs_freep(wheel);
+    
+    if (cond) {
+        st_cond_destroy(cond);
+    }
+}
+
+int SrsTimer::initialize(int tick_ms)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (tick_ms <= 0) {
+        srs_trace("timer wheel disabled, sleep by st.");
+        return ret;
+    }
+    
+    tick = tick_ms;
+    cond = st_cond_new();
+    wheel = new SrsTimerWheel(tick, now());
+    report = now() + SRS_TIMER_REPORT_MS;
+    
+    if ((ret = pthread->start()) != ERROR_SUCCESS) {
+        srs_freep(wheel);
+        srs_error("start timer st thread failed. ret=%d", ret);
+        return ret;
+    }
+    srs_trace("timer wheel started, tick=%dms", tick);
+    
+    return ret;
+}
+
+bool SrsTimer::enabled()
+{
+    return wheel != NULL;
+}
+
+int64_t SrsTimer::resolution_us()
+{
+    return tick * 1000;
+}
+
+int64_t SrsTimer::now()
+{
+    int64_t t = srs_update_system_time_ms() + delta;
+    
+    // the timers never expire when time go back, so keep it monotonic.
+    if (t < last) {
+        delta += last - t;
+        t = last;
+    }
+    last = t;
+    
+    return t;
+}
+
+void SrsTimer::add(SrsTimerEntry* entry, int64_t timeout_ms)
+{
+    srs_assert(wheel);
+    
+    int64_t expire = now() + timeout_ms;
+    wheel->add(entry, expire);
+    
+    // wakeup the timer thread to sleep less.
+    if (expire < wakeup) {
+        wakeup = expire;
+        st_cond_signal(cond);
+    }
+}
+
+void SrsTimer::remove(SrsTimerEntry* entry)
+{
+    if (wheel) {
+        wheel->remove(entry);
+    }
+}
+
+int SrsTimer::cycle()
+{
+    int ret = ERROR_SUCCESS;
+    
+    int64_t t = now();
+    wheel->advance(t);
+    
+    if (t >= report) {
+        report = t + SRS_TIMER_REPORT_MS;
+        srs_trace("timer: timers=%d, fired=%"PRId64", lag avg=%"PRId64"ms, max=%"PRId64"ms",
+            wheel->size(), wheel->fired(), wheel->lag_avg(), wheel->lag_max());
+        wheel->reset_stat();
+    }
+    
+    // sleep util the next tick of timers.
+    int64_t next = wheel->next_ms();
+    int64_t timeout = SRS_TIMER_MAX_SLEEP_MS;
+    if (next >= 0) {
+        timeout = srs_max(1, srs_min(timeout, next - t));
+    }
+    wakeup = t + timeout;
+    
+    st_cond_timedwait(cond, timeout * 1000);
+    
+    return ret;
+}
+
+SrsTimerCond::SrsTimerCond()
+{
+    cond = NULL;
+    timer = new SrsTimerEntry(this);
+    timeout = false;
+}
+
+SrsTimerCond::~SrsTimerCond()
+{
+    _srs_timer->remove(timer);
+    srs_freep(timer);
+    
+    if (cond) {
+        st_cond_destroy(cond);
+    }
+}
+
+int SrsTimerCond::wait(int64_t timeout_us)
+{
+    // create the cond when wait, for some never wait.
+    if (!cond) {
+        cond = st_cond_new();
+    }
+    
+    if (timeout_us < 0) {
+        return st_cond_wait(cond);
+    }
+    
+    // the short timeout or timer disabled, wait by st.
+    if (!_srs_timer->enabled() || timeout_us < _srs_timer->resolution_us()) {
+        return st_cond_timedwait(cond, timeout_us);
+    }
+    
+    timeout = false;
+    _srs_timer->add(timer, timeout_us / 1000);
+    
+    // the timer signal the cond when timeout.
+    int r0 = st_cond_wait(cond);
+    _srs_timer->remove(timer);
+    
+    if (r0 != 0 || timeout) {
+        return -1;
+    }
+    return 0;
+}
+
+void SrsTimerCond::signal()
+{
+    if (cond) {
+        st_cond_signal(cond);
+    }
+}
+
+void SrsTimerCond::on_timer(SrsTimerEntry* /*entry*/)
+{
+    timeout = true;
+    st_cond_signal(cond);
+}
+
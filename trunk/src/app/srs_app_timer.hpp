@@ -0,0 +1,124 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef SRS_APP_TIMER_HPP
+#define SRS_APP_TIMER_HPP
+
+/*
+#include <srs_app_timer.hpp>
+*/
+#include <srs_core.hpp>
+
+#include <srs_app_st.hpp>
+#include <srs_app_thread.hpp>
+#include <srs_kernel_timer.hpp>
+
+/**
+ * the timer service, all timers of server are in a hierarchical wheel,
+ * driven by a st thread which sleeps util the next tick of timers,
+ * then fires the expired timers in batch, so the st threads which sleep
+ * or wait for timeout never in the sleep queue of st.
+ * @remark the timer handler runs in the timer thread, must never block.
+ * @remark when service not started, user should fallback to st sleep.
+ */
+class SrsTimer : public ISrsEndlessThreadHandler
+{
+private:
+    int tick;
+    SrsTimerWheel* wheel;
+    SrsEndlessThread* pthread;
+    // to wakeup the thread, when add timer before the wakeup time.
+    st_cond_t cond;
+    int64_t wakeup;
+    // the monotonic time, never go back when system time jumps.
+    int64_t last;
+    int64_t delta;
+    // the time to report the statistic.
+    int64_t report;
+public:
+    SrsTimer();
+    virtual ~SrsTimer();
+public:
+    /**
+     * start the timer thread, must be called after st initialized.
+     * @param tick_ms the resolution of timers, 0 to disable.
+     */
+    virtual int initialize(int tick_ms);
+    /**
+     * whether the timer thread is running.
+     */
+    virtual bool enabled();
+    /**
+     * the resolution in us, the shorter timeout should wait by st.
+     */
+    virtual int64_t resolution_us();
+    /**
+     * the monotonic time in ms of timers.
+     */
+    virtual int64_t now();
+    /**
+     * add the timer to fire after timeout in ms, modify it when pending.
+     */
+    virtual void add(SrsTimerEntry* entry, int64_t timeout_ms);
+    /**
+     * remove the timer, ignore when not pending.
+     */
+    virtual void remove(SrsTimerEntry* entry);
+// interface ISrsEndlessThreadHandler.
+public:
+    virtual int cycle();
+};
+
+extern SrsTimer* _srs_timer;
+
+/**
+ * the st cond which timed wait by the timer service, for example,
+ * the sleep of st thread, or the consumer wait for messages util timeout.
+ * @remark fallback to st timed wait when timer service not started.
+ */
+class SrsTimerCond : public ISrsTimerHandler
+{
+private:
+    st_cond_t cond;
+    SrsTimerEntry* timer;
+    bool timeout;
+public:
+    SrsTimerCond();
+    virtual ~SrsTimerCond();
+public:
+    /**
+     * wait util signaled or timeout.
+     * @param timeout_us the timeout in us, -1 to wait without timeout.
+     * @return 0 when signaled, otherwise -1 when timeout or interrupted.
+     */
+    virtual int wait(int64_t timeout_us);
+    /**
+     * signal the thread which waits.
+     */
+    virtual void signal();
+// interface ISrsTimerHandler
+public:
+    virtual void on_timer(SrsTimerEntry* entry);
+};
+
+#endif
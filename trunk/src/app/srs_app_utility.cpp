@@ -47,6 +47,8 @@ using namespace std;
 #include <srs_protocol_json.hpp>
 #include <srs_kernel_stream.hpp>
 #include <srs_kernel_utility.hpp>
+#include <srs_app_dns.hpp>
+#include <srs_app_worker.hpp>
 
 // the longest time to wait for a process to quit.
 #define SRS_PROCESS_QUIT_TIMEOUT_MS 1000
@@ -75,13 +77,14 @@ int srs_socket_connect(string server, int port, int64_t timeout, st_netfd_t* pst
     }
     
     // connect to server.
-    std::string ip = srs_dns_resolve(server);
-    srs_trace("dns resolve for %s result %s", server.c_str(), ip.c_str());
-    if (ip.empty()) {
+    // resolve over st, never block the other connections.
+    std::string ip;
+    if ((ret = _srs_dns->resolve(server, ip, timeout)) != ERROR_SUCCESS || ip.empty()) {
         ret = ERROR_SYSTEM_IP_INVALID;
-        srs_error("dns resolve server error, ip empty. ret=%d", ret);
+        srs_error("dns resolve server %s error, ip empty. ret=%d", server.c_str(), ret);
         goto failed;
     }
+    srs_info("dns resolve for %s result %s", server.c_str(), ip.c_str());
     
     addr.sin_family = AF_INET;
     addr.sin_port = htons(port);
@@ -1482,6 +1485,12 @@ void srs_api_dump_summaries(std::stringstream& ss)
         ns_bytes += o.sbytes;
     }
     
+    // the srs network bytes and connections of all workers.
+    int64_t srs_recv_bytes = nrs->rbytes;
+    int64_t srs_send_bytes = nrs->sbytes;
+    int nb_conn_srs = nrs->nb_conn_srs;
+    _srs_workers->aggregate_server(srs_recv_bytes, srs_send_bytes, nb_conn_srs);
+    
     // all data is ok?
     bool ok = (r->ok && u->ok && s->ok && c->ok 
         && d->ok && m->ok && p->ok && nrs->ok);
@@ -1528,13 +1537,13 @@ void srs_api_dump_summaries(std::stringstream& ss)
                 << SRS_JFIELD_ORG("net_sendi_bytes", nsi_bytes) << SRS_JFIELD_CONT
                 // srs network bytes stat.
                 << SRS_JFIELD_ORG("srs_sample_time", nrs->sample_time) << SRS_JFIELD_CONT
-                << SRS_JFIELD_ORG("srs_recv_bytes", nrs->rbytes) << SRS_JFIELD_CONT
-                << SRS_JFIELD_ORG("srs_send_bytes", nrs->sbytes) << SRS_JFIELD_CONT
+                << SRS_JFIELD_ORG("srs_recv_bytes", srs_recv_bytes) << SRS_JFIELD_CONT
+                << SRS_JFIELD_ORG("srs_send_bytes", srs_send_bytes) << SRS_JFIELD_CONT
                 << SRS_JFIELD_ORG("conn_sys", nrs->nb_conn_sys) << SRS_JFIELD_CONT
                 << SRS_JFIELD_ORG("conn_sys_et", nrs->nb_conn_sys_et) << SRS_JFIELD_CONT
                 << SRS_JFIELD_ORG("conn_sys_tw", nrs->nb_conn_sys_tw) << SRS_JFIELD_CONT
                 << SRS_JFIELD_ORG("conn_sys_udp", nrs->nb_conn_sys_udp) << SRS_JFIELD_CONT
-                << SRS_JFIELD_ORG("conn_srs", nrs->nb_conn_srs)
+                << SRS_JFIELD_ORG("conn_srs", nb_conn_srs)
             << SRS_JOBJECT_END
         << SRS_JOBJECT_END
         << SRS_JOBJECT_END;
@@ -0,0 +1,605 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <srs_app_worker.hpp>
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <sched.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_protocol_json.hpp>
+#include <srs_app_config.hpp>
+
+SrsWorkers* _srs_workers = new SrsWorkers();
+
+// the state of stream slot in shared table.
+#define SRS_WORKER_STREAM_FREE 0
+#define SRS_WORKER_STREAM_LOCKED 1
+#define SRS_WORKER_STREAM_USED 2
+
+// the max times to read the snapshot, when the worker is writing it.
+#define SRS_WORKER_STATS_RETRY 10
+
+// the interval in us to restart the dead worker,
+// to avoid busy loop when worker crash at startup.
+#define SRS_WORKER_RESTART_INTERVAL (1 * 1000 * 1000)
+
+// the last signal received by master.
+static volatile sig_atomic_t _srs_workers_signo = 0;
+
+static void srs_workers_on_signal(int signo)
+{
+    _srs_workers_signo = signo;
+}
+
+SrsWorkers::SrsWorkers()
+{
+    nb_workers = 0;
+    _index = -1;
+    table = NULL;
+    stats = NULL;
+}
+
+SrsWorkers::~SrsWorkers()
+{
+    // the table is shared by processes, the system will unmap it when exit.
+}
+
+int SrsWorkers::initialize(int nb)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (nb <= 1) {
+        return ret;
+    }
+    
+    if (nb > SRS_WORKER_MAX) {
+        ret = ERROR_SYSTEM_CONFIG_INVALID;
+        srs_error("workers %d exceed the max %d. ret=%d", nb, SRS_WORKER_MAX, ret);
+        return ret;
+    }
+    
+    void* p = mmap(NULL, sizeof(SrsWorkerTable), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        ret = ERROR_SYSTEM_WORKER_MMAP;
+        srs_error("map workers table %d bytes failed. ret=%d", (int)sizeof(SrsWorkerTable), ret);
+        return ret;
+    }
+    
+    // the anonymous map is filled with zero, that is all slots are free.
+    table = (SrsWorkerTable*)p;
+    
+    // the pages of snapshot are allocated when worker writes it.
+    int size = nb * (int)sizeof(SrsWorkerStats);
+    if ((p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED) {
+        ret = ERROR_SYSTEM_WORKER_MMAP;
+        srs_error("map workers stats %d bytes failed. ret=%d", size, ret);
+        return ret;
+    }
+    stats = (SrsWorkerStats*)p;
+    nb_workers = nb;
+    
+    srs_trace("workers initialized, workers=%d, relay=127.0.0.1:%d, table=%dB, stats=%dB",
+        nb_workers, relay_port(0), (int)sizeof(SrsWorkerTable), size);
+    
+    return ret;
+}
+
+bool SrsWorkers::enabled()
+{
+    return nb_workers > 1;
+}
+
+bool SrsWorkers::is_worker()
+{
+    return enabled() && _index >= 0;
+}
+
+bool SrsWorkers::is_primary()
+{
+    return !enabled() || _index == 0;
+}
+
+int SrsWorkers::index()
+{
+    return _index;
+}
+
+int SrsWorkers::relay_port(int worker)
+{
+    return _srs_config->get_worker_relay_port() + worker;
+}
+
+int SrsWorkers::cycle()
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(enabled());
+    
+    // the master only waits for the signals to forward.
+    int signals[] = {SIGHUP, SIGINT, SIGUSR2, SIGTERM};
+    for (int i = 0; i < (int)(sizeof(signals) / sizeof(int)); i++) {
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = srs_workers_on_signal;
+        sigemptyset(&sa.sa_mask);
+        // never restart the waitpid, to process the signal.
+        sa.sa_flags = 0;
+        sigaction(signals[i], &sa, NULL);
+    }
+    
+    for (int i = 0; i < nb_workers; i++) {
+        bool is_child = false;
+        if ((ret = spawn(i, is_child)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        if (is_child) {
+            return ret;
+        }
+    }
+    
+    while (true) {
+        int status = 0;
+        int pid = (int)waitpid(-1, &status, 0);
+        
+        int signo = _srs_workers_signo;
+        _srs_workers_signo = 0;
+        
+        // the reload signal, forward to workers to reload.
+        if (signo == SIGHUP) {
+            srs_trace("master forward reload to workers.");
+            kill_workers(SIGHUP);
+        } else if (signo != 0) {
+            srs_trace("master forward quit signal %d to workers.", signo);
+            kill_workers(signo);
+            
+            while (waitpid(-1, &status, 0) > 0 || errno == EINTR) {
+            }
+            srs_trace("master terminated");
+            exit(0);
+        }
+        
+        if (pid <= 0) {
+            continue;
+        }
+        
+        int worker = -1;
+        for (int i = 0; i < nb_workers; i++) {
+            if (table->pids[i] == pid) {
+                worker = i;
+                break;
+            }
+        }
+        if (worker < 0) {
+            continue;
+        }
+        
+        srs_warn("worker %d pid=%d terminated, status=%d, restart it.", worker, pid, status);
+        table->pids[worker] = 0;
+        clear(worker);
+        
+        usleep(SRS_WORKER_RESTART_INTERVAL);
+        
+        bool is_child = false;
+        if ((ret = spawn(worker, is_child)) != ERROR_SUCCESS) {
+            srs_error("restart worker %d failed. ret=%d", worker, ret);
+            continue;
+        }
+        if (is_child) {
+            return ret;
+        }
+    }
+    
+    return ret;
+}
+
+int SrsWorkers::on_publish(string url)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (!is_worker()) {
+        return ret;
+    }
+    
+    if ((int)url.length() >= SRS_WORKER_STREAM_URL) {
+        ret = ERROR_SYSTEM_WORKER_STREAMS;
+        srs_error("worker stream url %s too long, max is %d. ret=%d", url.c_str(), SRS_WORKER_STREAM_URL, ret);
+        return ret;
+    }
+    
+    // the check and claim must be atomic, or two workers publish the same stream,
+    // for the can_publish check is before the on_publish hooks, which yield.
+    lock();
+    
+    SrsWorkerStream* free = NULL;
+    for (int i = 0; i < SRS_WORKER_MAX_STREAMS; i++) {
+        SrsWorkerStream* stream = &table->streams[i];
+        
+        if (stream->state == SRS_WORKER_STREAM_FREE) {
+            if (!free) {
+                free = stream;
+            }
+            continue;
+        }
+        
+        if (stream->state != SRS_WORKER_STREAM_USED || url != stream->url) {
+            continue;
+        }
+        
+        int worker = stream->worker;
+        unlock();
+        
+        if (worker == _index) {
+            srs_warn("worker %d stream %s already registered at slot %d", _index, url.c_str(), i);
+            return ret;
+        }
+        
+        ret = ERROR_SYSTEM_STREAM_BUSY;
+        srs_error("worker %d stream %s busy, published to worker %d. ret=%d", _index, url.c_str(), worker, ret);
+        return ret;
+    }
+    
+    if (!free) {
+        unlock();
+        ret = ERROR_SYSTEM_WORKER_STREAMS;
+        srs_error("worker streams exceed the max %d, url=%s. ret=%d", SRS_WORKER_MAX_STREAMS, url.c_str(), ret);
+        return ret;
+    }
+    
+    // lock the free slot, the find_publisher never read it util used.
+    free->state = SRS_WORKER_STREAM_LOCKED;
+    free->worker = _index;
+    memcpy(free->url, url.data(), url.length());
+    free->url[url.length()] = 0;
+    
+    // the url must be written before the slot is used.
+    __sync_synchronize();
+    free->state = SRS_WORKER_STREAM_USED;
+    
+    unlock();
+    
+    srs_trace("worker %d register stream %s at slot %d", _index, url.c_str(), (int)(free - table->streams));
+    return ret;
+}
+
+void SrsWorkers::on_unpublish(string url)
+{
+    if (!is_worker()) {
+        return;
+    }
+    
+    for (int i = 0; i < SRS_WORKER_MAX_STREAMS; i++) {
+        SrsWorkerStream* stream = &table->streams[i];
+        
+        if (stream->state != SRS_WORKER_STREAM_USED || stream->worker != _index) {
+            continue;
+        }
+        if (url != stream->url) {
+            continue;
+        }
+        
+        stream->state = SRS_WORKER_STREAM_FREE;
+        srs_trace("worker %d unregister stream %s at slot %d", _index, url.c_str(), i);
+        return;
+    }
+}
+
+int SrsWorkers::find_publisher(string url)
+{
+    if (!is_worker()) {
+        return -1;
+    }
+    
+    for (int i = 0; i < SRS_WORKER_MAX_STREAMS; i++) {
+        SrsWorkerStream* stream = &table->streams[i];
+        
+        if (stream->state != SRS_WORKER_STREAM_USED) {
+            continue;
+        }
+        
+        // read the url after the slot is used.
+        __sync_synchronize();
+        if (url == stream->url) {
+            return stream->worker;
+        }
+    }
+    
+    return -1;
+}
+
+int SrsWorkers::dumps(stringstream& ss)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // the single process is the master itself.
+    int master = is_worker()? (int)getppid() : (int)getpid();
+    
+    ss << SRS_JOBJECT_START
+        << SRS_JFIELD_ORG("master", master) << SRS_JFIELD_CONT
+        << SRS_JFIELD_ORG("self", _index) << SRS_JFIELD_CONT
+        << SRS_JFIELD_ORG("workers", SRS_JARRAY_START);
+    
+    for (int i = 0; table && i < nb_workers; i++) {
+        if (i > 0) {
+            ss << SRS_JFIELD_CONT;
+        }
+        ss << SRS_JOBJECT_START
+            << SRS_JFIELD_ORG("index", i) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("pid", table->pids[i]) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("relay_port", relay_port(i)) << SRS_JFIELD_CONT
+            << SRS_JFIELD_BOOL("primary", i == 0)
+            << SRS_JOBJECT_END;
+    }
+    
+    ss << SRS_JARRAY_END << SRS_JFIELD_CONT
+        << SRS_JFIELD_ORG("streams", SRS_JARRAY_START);
+    
+    bool first = true;
+    for (int i = 0; table && i < SRS_WORKER_MAX_STREAMS; i++) {
+        SrsWorkerStream* stream = &table->streams[i];
+        if (stream->state != SRS_WORKER_STREAM_USED) {
+            continue;
+        }
+        
+        if (!first) {
+            ss << SRS_JFIELD_CONT;
+        }
+        first = false;
+        
+        ss << SRS_JOBJECT_START
+            << SRS_JFIELD_STR("url", stream->url) << SRS_JFIELD_CONT
+            << SRS_JFIELD_ORG("worker", stream->worker)
+            << SRS_JOBJECT_END;
+    }
+    
+    ss << SRS_JARRAY_END
+        << SRS_JOBJECT_END;
+    
+    return ret;
+}
+
+void SrsWorkers::update_stats(string streams, string clients, int64_t rbytes, int64_t sbytes, int nb_conn_srs)
+{
+    if (!is_worker()) {
+        return;
+    }
+    
+    if ((int)streams.length() >= SRS_WORKER_STATS_SIZE) {
+        srs_warn("worker %d streams %dB exceed the max %d, ignore.", _index, (int)streams.length(), SRS_WORKER_STATS_SIZE);
+        streams = "[]";
+    }
+    if ((int)clients.length() >= SRS_WORKER_STATS_SIZE) {
+        srs_warn("worker %d clients %dB exceed the max %d, ignore.", _index, (int)clients.length(), SRS_WORKER_STATS_SIZE);
+        clients = "[]";
+    }
+    
+    SrsWorkerStats* o = &stats[_index];
+    
+    // the odd seq tells the reader that the snapshot is writing.
+    o->seq++;
+    __sync_synchronize();
+    
+    o->rbytes = rbytes;
+    o->sbytes = sbytes;
+    o->nb_conn_srs = nb_conn_srs;
+    memcpy(o->streams, streams.c_str(), streams.length() + 1);
+    memcpy(o->clients, clients.c_str(), clients.length() + 1);
+    
+    __sync_synchronize();
+    o->seq++;
+}
+
+string SrsWorkers::aggregate_streams(string local)
+{
+    return aggregate(local, true);
+}
+
+string SrsWorkers::aggregate_clients(string local)
+{
+    return aggregate(local, false);
+}
+
+string SrsWorkers::aggregate(string local, bool is_streams)
+{
+    if (!is_worker()) {
+        return local;
+    }
+    
+    // join the elements of json arrays, without the [].
+    std::string elems = local.substr(1, local.length() - 2);
+    
+    SrsWorkerStats* snapshot = new SrsWorkerStats();
+    for (int i = 0; i < nb_workers; i++) {
+        if (i == _index || !read_stats(i, snapshot, true)) {
+            continue;
+        }
+        
+        std::string arr = is_streams? snapshot->streams : snapshot->clients;
+        if (arr.length() <= 2) {
+            continue;
+        }
+        
+        if (!elems.empty()) {
+            elems += SRS_JFIELD_CONT;
+        }
+        elems += arr.substr(1, arr.length() - 2);
+    }
+    srs_freep(snapshot);
+    
+    return SRS_JARRAY_START + elems + SRS_JARRAY_END;
+}
+
+void SrsWorkers::aggregate_server(int64_t& rbytes, int64_t& sbytes, int& nb_conn_srs)
+{
+    if (!is_worker()) {
+        return;
+    }
+    
+    SrsWorkerStats* snapshot = new SrsWorkerStats();
+    for (int i = 0; i < nb_workers; i++) {
+        if (i == _index || !read_stats(i, snapshot, false)) {
+            continue;
+        }
+        
+        rbytes += snapshot->rbytes;
+        sbytes += snapshot->sbytes;
+        nb_conn_srs += snapshot->nb_conn_srs;
+    }
+    srs_freep(snapshot);
+}
+
+bool SrsWorkers::read_stats(int worker, SrsWorkerStats* snapshot, bool json)
+{
+    if (table->pids[worker] <= 0) {
+        return false;
+    }
+    
+    SrsWorkerStats* o = &stats[worker];
+    
+    // the worker never yield when writing, so retry for it's writing in another cpu.
+    for (int i = 0; i < SRS_WORKER_STATS_RETRY; i++) {
+        int seq = o->seq;
+        if (seq == 0) {
+            return false;
+        }
+        if (seq & 0x01) {
+            sched_yield();
+            continue;
+        }
+        __sync_synchronize();
+        
+        snapshot->rbytes = o->rbytes;
+        snapshot->sbytes = o->sbytes;
+        snapshot->nb_conn_srs = o->nb_conn_srs;
+        if (json) {
+            memcpy(snapshot->streams, o->streams, SRS_WORKER_STATS_SIZE);
+            memcpy(snapshot->clients, o->clients, SRS_WORKER_STATS_SIZE);
+            snapshot->streams[SRS_WORKER_STATS_SIZE - 1] = 0;
+            snapshot->clients[SRS_WORKER_STATS_SIZE - 1] = 0;
+        }
+        
+        __sync_synchronize();
+        if (seq == o->seq) {
+            return true;
+        }
+    }
+    
+    srs_warn("worker %d stats is writing, ignore it.", worker);
+    return false;
+}
+
+int SrsWorkers::spawn(int worker, bool& is_child)
+{
+    int ret = ERROR_SUCCESS;
+    
+    is_child = false;
+    
+    int pid = fork();
+    if (pid < 0) {
+        ret = ERROR_SYSTEM_WORKER_FORK;
+        srs_error("fork worker %d failed. ret=%d", worker, ret);
+        return ret;
+    }
+    
+    // master.
+    if (pid > 0) {
+        table->pids[worker] = pid;
+        srs_trace("master fork worker %d, pid=%d", worker, pid);
+        return ret;
+    }
+    
+    // worker.
+    is_child = true;
+    _index = worker;
+    table->pids[worker] = (int)getpid();
+    
+    // the worker use the signal manager of server.
+    int signals[] = {SIGHUP, SIGINT, SIGUSR2, SIGTERM};
+    for (int i = 0; i < (int)(sizeof(signals) / sizeof(int)); i++) {
+        signal(signals[i], SIG_DFL);
+    }
+    
+#ifdef PR_SET_PDEATHSIG
+    // quit when master is killed.
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+#endif
+    
+    srs_trace("worker %d started, pid=%d, master=%d", worker, (int)getpid(), (int)getppid());
+    
+    return ret;
+}
+
+void SrsWorkers::clear(int worker)
+{
+    for (int i = 0; i < SRS_WORKER_MAX_STREAMS; i++) {
+        SrsWorkerStream* stream = &table->streams[i];
+        
+        if (stream->state == SRS_WORKER_STREAM_USED && stream->worker == worker) {
+            srs_warn("master clear stream %s of worker %d", stream->url, worker);
+            stream->state = SRS_WORKER_STREAM_FREE;
+        }
+    }
+    
+    // the restarted worker writes a new snapshot.
+    stats[worker].seq = 0;
+    
+    // release the lock when worker dies in it.
+    if (__sync_bool_compare_and_swap(&table->lock, worker + 1, 0)) {
+        srs_warn("master release the lock of worker %d", worker);
+    }
+}
+
+void SrsWorkers::lock()
+{
+    while (!__sync_bool_compare_and_swap(&table->lock, 0, _index + 1)) {
+        sched_yield();
+    }
+}
+
+void SrsWorkers::unlock()
+{
+    __sync_lock_release(&table->lock);
+}
+
+void SrsWorkers::kill_workers(int signo)
+{
+    for (int i = 0; i < nb_workers; i++) {
+        int pid = table->pids[i];
+        if (pid > 0) {
+            ::kill(pid, signo);
+        }
+    }
+}
+
@@ -0,0 +1,218 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef SRS_APP_WORKER_HPP
+#define SRS_APP_WORKER_HPP
+
+/*
+#include <srs_app_worker.hpp>
+*/
+#include <srs_core.hpp>
+
+#include <string>
+#include <sstream>
+
+// the max number of workers.
+#define SRS_WORKER_MAX 64
+// the max number of streams published to all workers.
+#define SRS_WORKER_MAX_STREAMS 4096
+// the max length of stream url, vhost/app/stream.
+#define SRS_WORKER_STREAM_URL 256
+// the max size of json snapshot of streams or clients of each worker.
+#define SRS_WORKER_STATS_SIZE 65536
+
+/**
+ * the stream published to a worker, in the table shared by all workers.
+ */
+struct SrsWorkerStream
+{
+    // the state of slot, free, locked to write or used.
+    volatile int state;
+    // the index of worker which the stream is published to.
+    int worker;
+    // the stream url, vhost/app/stream.
+    char url[SRS_WORKER_STREAM_URL];
+};
+
+/**
+ * the table shared by master and all workers,
+ * mapped anonymous before fork, so never use pointer in it.
+ */
+struct SrsWorkerTable
+{
+    // the spin lock to claim the stream, the index+1 of worker which holds it.
+    // @remark the holder never yield in the lock, and master releases it when holder dies.
+    volatile int lock;
+    // the pid of workers, 0 when not running.
+    volatile int pids[SRS_WORKER_MAX];
+    // the streams published to workers.
+    SrsWorkerStream streams[SRS_WORKER_MAX_STREAMS];
+};
+
+/**
+ * the stats snapshot of a worker, written by the worker and read by
+ * the primary to aggregate the http api of all workers.
+ */
+struct SrsWorkerStats
+{
+    // the sequence of snapshot, odd when the worker is writing it.
+    volatile int seq;
+    // the server bytes and connections, @see SrsNetworkRtmpServer.
+    int64_t rbytes;
+    int64_t sbytes;
+    int nb_conn_srs;
+    // the json array of streams and clients.
+    char streams[SRS_WORKER_STATS_SIZE];
+    char clients[SRS_WORKER_STATS_SIZE];
+};
+
+/**
+ * the multiple processes mode, the master forks N workers and supervises them,
+ * each worker runs a st loop and accepts the rtmp clients on the listen ports
+ * shared by SO_REUSEPORT, to use more cores for rtmp fan-out.
+ * the publish registers the stream to the shared table, then the player landing
+ * on another worker is relayed by the edge ingester from the owner worker, which
+ * listens at 127.0.0.1:(relay_port+index).
+ * @remark only the primary worker, the first one, serves the http api, http server,
+ *       ingesters and stream casters, and aggregates the workers in http api,
+ *       from the stats snapshot which each worker updates when resample kbps.
+ * @remark the master forwards the reload and quit signals to workers.
+ */
+class SrsWorkers
+{
+private:
+    int nb_workers;
+    // the index of current worker, -1 for master or single process.
+    int _index;
+    // the table shared by all workers.
+    SrsWorkerTable* table;
+    // the stats snapshot of all workers, shared by all workers.
+    SrsWorkerStats* stats;
+public:
+    SrsWorkers();
+    virtual ~SrsWorkers();
+public:
+    /**
+     * initialize the workers, map the shared table when multiple workers.
+     * @param nb the number of workers, 0 or 1 for single process.
+     */
+    virtual int initialize(int nb);
+    /**
+     * whether run in multiple processes.
+     */
+    virtual bool enabled();
+    /**
+     * whether current process is a worker of multiple processes.
+     */
+    virtual bool is_worker();
+    /**
+     * whether current process serves the http and ingesters,
+     * the single process or the first worker.
+     */
+    virtual bool is_primary();
+    /**
+     * the index of current worker.
+     */
+    virtual int index();
+    /**
+     * the relay port of the specified worker.
+     */
+    virtual int relay_port(int worker);
+    /**
+     * fork the workers and supervise them in master, never return in master.
+     * @remark return in the forked worker, which continues to serve.
+     */
+    virtual int cycle();
+public:
+    /**
+     * register the stream published to current worker,
+     * the check and claim of url is atomic for all workers.
+     * @return ERROR_SYSTEM_STREAM_BUSY when published to other worker.
+     */
+    virtual int on_publish(std::string url);
+    /**
+     * unregister the stream published to current worker.
+     */
+    virtual void on_unpublish(std::string url);
+    /**
+     * find the worker which the stream is published to.
+     * @return the index of worker, -1 when not found.
+     */
+    virtual int find_publisher(std::string url);
+    /**
+     * dumps the workers and streams to sstream in json.
+     */
+    virtual int dumps(std::stringstream& ss);
+public:
+    /**
+     * update the stats snapshot of current worker.
+     * @param streams the json array of streams.
+     * @param clients the json array of clients.
+     */
+    virtual void update_stats(std::string streams, std::string clients, int64_t rbytes, int64_t sbytes, int nb_conn_srs);
+    /**
+     * aggregate the json array of streams or clients of all workers.
+     * @param local the json array of current worker, which is newer than snapshot.
+     * @return the json array of all workers.
+     */
+    virtual std::string aggregate_streams(std::string local);
+    virtual std::string aggregate_clients(std::string local);
+private:
+    virtual std::string aggregate(std::string local, bool is_streams);
+public:
+    /**
+     * add the server bytes and connections of other workers.
+     */
+    virtual void aggregate_server(int64_t& rbytes, int64_t& sbytes, int& nb_conn_srs);
+private:
+    /**
+     * read the snapshot of worker consistently.
+     * @return false when the worker is not running or always writing.
+     */
+    virtual bool read_stats(int worker, SrsWorkerStats* snapshot, bool json);
+
+    /**
+     * fork the specified worker.
+     * @param is_child output whether current process is the forked worker.
+     */
+    virtual int spawn(int worker, bool& is_child);
+    /**
+     * clear the streams of dead worker.
+     */
+    virtual void clear(int worker);
+    /**
+     * lock and unlock the table, to claim stream.
+     */
+    virtual void lock();
+    virtual void unlock();
+    /**
+     * send the signal to all workers.
+     */
+    virtual void kill_workers(int signo);
+};
+
+// the global workers.
+extern SrsWorkers* _srs_workers;
+
+#endif
+
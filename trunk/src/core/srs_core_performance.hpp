@@ -188,5 +188,148 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #undef SRS_PERF_FAST_FLV_ENCODER
 #define SRS_PERF_FAST_FLV_ENCODER
 
+/**
+ * how many chunk headers to cache in each shared ptr message, [0, N].
+ * the c0 and c3 chunk headers of a message are generated once by the first
+ * connection which send it, then all connections which send the message
+ * with the same timestamp and stream id writev the same header bytes.
+ * @remark the players which join in the same gop share the same timestamp
+ *       for the full jitter algorithm, so each slot serves a group of players.
+ * @remark 0 to disable the shared chunk header cache.
+ */
+#define SRS_PERF_CHUNK_HEADER_CACHE 4
+
+/**
+ * define the following macro to enable the fast ts encoder,
+ * which encode the ts packets without allocation and write in batch.
+ * @remark the batch is about 47KB for 256 packets of 188 bytes.
+ */
+#undef SRS_PERF_FAST_TS_ENCODER
+#define SRS_PERF_FAST_TS_ENCODER
+#define SRS_PERF_TS_BATCH_PACKETS 256
+
+/**
+ * define the following macro to enable the fast ts decoder,
+ * which parse the ts packets in place and reuse the pes message of each pid,
+ * for the mpegts over udp caster and the hls ingester.
+ */
+#undef SRS_PERF_FAST_TS_DECODER
+#define SRS_PERF_FAST_TS_DECODER
+
+/**
+ * the number of io threads to write the hls, dvr and log files,
+ * for the blocking disk io never stall the connections on st.
+ * @remark 0 to write files in st thread.
+ */
+#define SRS_PERF_ASYNC_IO_THREADS 2
+// the bytes to merge then write to file in a time.
+#define SRS_PERF_ASYNC_IO_CHUNK 65536
+// the max bytes to write of a file, the writer wait when exceed.
+#define SRS_PERF_ASYNC_IO_MAX_PENDING (16 * 1024 * 1024)
+// the max bytes queued in an io thread, when exceed,
+// the logs are dropped while the file writer wait for its jobs.
+#define SRS_PERF_ASYNC_IO_MAX_QUEUE (64 * 1024 * 1024)
+// the bytes of logs to merge then write in a time,
+// and the max time in ms the logs are merged.
+#define SRS_PERF_ASYNC_IO_LOG_BATCH 16384
+#define SRS_PERF_ASYNC_IO_LOG_FLUSH_MS 100
+
+/**
+ * whether read the large chunk payload to message directly from socket,
+ * when the bytes in recv buffer is not enough, to avoid copying it twice.
+ * @remark only read directly when the left bytes exceed the min size,
+ *       while the small chunks are always read together by the buffer.
+ */
+#undef SRS_PERF_ZERO_COPY_RECV
+#define SRS_PERF_ZERO_COPY_RECV
+#define SRS_PERF_ZERO_COPY_RECV_MIN 8192
+
+/**
+ * the initial capacity of the message ring of consumer,
+ * the ring shares the payload of source message and stores the corrected timestamp,
+ * so there is no allocation for each consumer when enqueue a message.
+ * @remark the ring doubles its capacity when full, for the queue is limited in seconds.
+ */
+#define SRS_PERF_QUEUE_RING_SIZE 128
+
+/**
+ * the initial capacity of the message ring of source,
+ * all consumers fetch messages from the ring by cursor,
+ * which keeps the cached gop and the messages not fetched in queue length.
+ * @remark the ring doubles its capacity when full.
+ */
+#define SRS_PERF_SOURCE_RING_SIZE 1024
+
+/**
+ * whether alloc the rtmp messages and the audio/video payloads from memory pool,
+ * the blocks are carved from aligned slabs in size classes of power of 2,
+ * from the min size to the max size, larger payload always alloc from heap.
+ * @remark the slab size must be power of 2 and not smaller than the max size.
+ * @remark the slabs are never freed, the max resident of pool is max slabs * slab size.
+ * @see SrsMemoryPool
+ */
+#undef SRS_PERF_MEMORY_POOL
+#define SRS_PERF_MEMORY_POOL
+#define SRS_PERF_POOL_MIN_SIZE 32
+#define SRS_PERF_POOL_MAX_SIZE 65536
+#define SRS_PERF_POOL_SLAB_SIZE 1048576
+#define SRS_PERF_POOL_MAX_SLABS 256
+
+/**
+ * the max number of precomputed keys for server complex handshake,
+ * a thread generates the dh keypairs in background, for the DH_generate_key
+ * costs about 1ms and blocks all connections on st.
+ * @remark 0 to generate the key in st when handshake.
+ * @remark only for ssl enabled, @see SrsHandshakeKeyPool
+ */
+#define SRS_PERF_HANDSHAKE_KEYS 64
+
+/**
+ * whether recv the udp datagrams in batch by recvmmsg, for the mpegts over udp
+ * and the rtp of rtsp caster, where a 20Mbps stream in 7 ts packets per datagram
+ * costs thousands of recvfrom per second.
+ * @remark only for linux, the osx always recv datagram one by one.
+ */
+#undef SRS_PERF_UDP_RECVMMSG
+#define SRS_PERF_UDP_RECVMMSG
+// the max datagrams to recv in a syscall.
+#define SRS_PERF_UDP_RECV_BATCH 32
+// the max bytes of datagram in batch, the larger one is truncated and dropped.
+#define SRS_PERF_UDP_RECV_SLOT 9216
+
+/**
+ * whether find the annexb start code of h.264 by simd, 16 or 32 bytes a step,
+ * for the annexb publishers of rtmp, rtsp and mpegts over udp, where the scan of
+ * the start code dominates the cpu when demux the frames.
+ * @remark use sse2 for x86, avx2 when build with -mavx2, otherwise the scalar
+ *       which skips 3 bytes a step when possible.
+ * @see srs_avc_find_annexb
+ */
+#undef SRS_PERF_SIMD_ANNEXB
+#define SRS_PERF_SIMD_ANNEXB
+
+/**
+ * the recv buffer of connection starts from the min size and doubles when
+ * the read fills the free space, to the max size of mr or 128KB by default,
+ * while halves when idle, that is, continuous small reads.
+ * @remark the play client only sends small messages, so its buffer keeps the min size,
+ *       that is about 80MB for 20k players, while 2.5GB for the fixed 128KB buffer.
+ * @remark the buffer is alloc from memory pool, the block larger than the max size
+ *       of pool is alloc from heap.
+ * @see SrsFastBuffer
+ */
+#define SRS_PERF_RECV_BUFFER_MIN 4096
+// the continuous reads smaller than quarter of buffer to shrink it.
+#define SRS_PERF_RECV_BUFFER_IDLE_READS 64
+
+/**
+ * the tick in ms of the timer wheel, which drives the sleep of st threads,
+ * the timeout wait of consumers and the periodic tasks of server in a st thread,
+ * so the tens of thousands of waiting st threads are never in the sleep queue of st.
+ * @remark 0 to disable the timer wheel, to sleep and wait by st.
+ * @see SrsTimer
+ */
+#define SRS_PERF_TIMER_TICK_MS 10
+
 #endif
 
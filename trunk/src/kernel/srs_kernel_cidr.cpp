@@ -0,0 +1,242 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <srs_kernel_cidr.hpp>
+
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_file.hpp>
+#include <srs_core_autofree.hpp>
+
+SrsCidrTrie::SrsCidrTrie()
+{
+    nb_prefixes = 0;
+    clear();
+}
+
+SrsCidrTrie::~SrsCidrTrie()
+{
+}
+
+bool SrsCidrTrie::parse(string ip, u_int8_t* addr)
+{
+    memset(addr, 0, SRS_CIDR_ADDRESS_SIZE);
+    
+    if (ip.find(":") != string::npos) {
+        return inet_pton(AF_INET6, ip.c_str(), addr) == 1;
+    }
+    
+    // map the ipv4 to ::ffff:a.b.c.d
+    addr[10] = addr[11] = 0xff;
+    return inet_pton(AF_INET, ip.c_str(), addr + 12) == 1;
+}
+
+int SrsCidrTrie::add(string cidr, int mask)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // the prefix 0, match all address.
+    if (cidr == "all") {
+        nodes[0].mask |= mask;
+        nb_prefixes++;
+        return ret;
+    }
+    
+    string ip = cidr;
+    string length;
+    
+    size_t pos = string::npos;
+    if ((pos = cidr.find("/")) != string::npos) {
+        ip = cidr.substr(0, pos);
+        length = cidr.substr(pos + 1);
+    }
+    
+    u_int8_t addr[SRS_CIDR_ADDRESS_SIZE];
+    if (!parse(ip, addr)) {
+        ret = ERROR_SYSTEM_CIDR_INVALID;
+        return ret;
+    }
+    
+    bool is_ipv6 = ip.find(":") != string::npos;
+    int max_prefix = is_ipv6? 128 : 32;
+    
+    int prefix = max_prefix;
+    if (pos != string::npos) {
+        if (length.empty() || length.length() > 3 || length.find_first_not_of("0123456789") != string::npos) {
+            ret = ERROR_SYSTEM_CIDR_INVALID;
+            return ret;
+        }
+        
+        prefix = ::atoi(length.c_str());
+        if (prefix > max_prefix) {
+            ret = ERROR_SYSTEM_CIDR_INVALID;
+            return ret;
+        }
+    }
+    
+    // the ipv4 is in the last 32 bits of mapped address.
+    if (!is_ipv6) {
+        prefix += 96;
+    }
+    
+    return insert(addr, prefix, mask);
+}
+
+int SrsCidrTrie::load(string file, int mask, int* pnb_prefixes)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsFileReader reader;
+    if ((ret = reader.open(file)) != ERROR_SUCCESS) {
+        srs_error("cidr open file %s failed. ret=%d", file.c_str(), ret);
+        return ret;
+    }
+    
+    int64_t filesize = reader.filesize();
+    char* buf = new char[filesize + 1];
+    SrsAutoFreeA(char, buf);
+    
+    ssize_t nread = 0;
+    if (filesize > 0 && (ret = reader.read(buf, filesize, &nread)) != ERROR_SUCCESS) {
+        srs_error("cidr read file %s failed. ret=%d", file.c_str(), ret);
+        return ret;
+    }
+    buf[nread] = 0;
+    
+    int nb_loaded = 0;
+    int nb_line = 0;
+    
+    char* p = buf;
+    while (p < buf + nread) {
+        char* line = p;
+        while (p < buf + nread && *p != '\n') {
+            p++;
+        }
+        *p++ = 0;
+        nb_line++;
+        
+        // ignore the comments.
+        char* comment = strchr(line, '#');
+        if (comment) {
+            *comment = 0;
+        }
+        
+        // trim the spaces and \r of windows.
+        string cidr = line;
+        size_t start = cidr.find_first_not_of(" \t\r");
+        if (start == string::npos) {
+            continue;
+        }
+        cidr = cidr.substr(start, cidr.find_last_not_of(" \t\r") - start + 1);
+        
+        if (add(cidr, mask) != ERROR_SUCCESS) {
+            srs_warn("cidr ignore invalid %s of %s:%d", cidr.c_str(), file.c_str(), nb_line);
+            continue;
+        }
+        nb_loaded++;
+    }
+    
+    if (pnb_prefixes) {
+        *pnb_prefixes = nb_loaded;
+    }
+    srs_trace("cidr load %d prefixes from %s, nodes=%d", nb_loaded, file.c_str(), (int)nodes.size());
+    
+    return ret;
+}
+
+void SrsCidrTrie::clear()
+{
+    nodes.clear();
+    nb_prefixes = 0;
+    
+    SrsCidrNode root;
+    memset(&root, 0, sizeof(SrsCidrNode));
+    nodes.push_back(root);
+}
+
+int SrsCidrTrie::size()
+{
+    return nb_prefixes;
+}
+
+int SrsCidrTrie::match(string ip)
+{
+    u_int8_t addr[SRS_CIDR_ADDRESS_SIZE];
+    if (!parse(ip, addr)) {
+        return match(NULL);
+    }
+    
+    return match(addr);
+}
+
+int SrsCidrTrie::match(u_int8_t* addr)
+{
+    int mask = nodes[0].mask;
+    
+    // the invalid address only match the prefix 0.
+    if (!addr) {
+        return mask;
+    }
+    
+    int index = 0;
+    for (int i = 0; i < SRS_CIDR_ADDRESS_SIZE * 8; i++) {
+        int bit = (addr[i / 8] >> (7 - i % 8)) & 0x01;
+        
+        if ((index = nodes[index].children[bit]) == 0) {
+            break;
+        }
+        mask |= nodes[index].mask;
+    }
+    
+    return mask;
+}
+
+int SrsCidrTrie::insert(u_int8_t* addr, int prefix, int mask)
+{
+    int ret = ERROR_SUCCESS;
+    
+    int index = 0;
+    for (int i = 0; i < prefix; i++) {
+        int bit = (addr[i / 8] >> (7 - i % 8)) & 0x01;
+        
+        // the nodes maybe realloc, never keep the reference of node.
+        if (nodes[index].children[bit] == 0) {
+            SrsCidrNode node;
+            memset(&node, 0, sizeof(SrsCidrNode));
+            nodes.push_back(node);
+            nodes[index].children[bit] = (int)nodes.size() - 1;
+        }
+        index = nodes[index].children[bit];
+    }
+    
+    nodes[index].mask |= mask;
+    nb_prefixes++;
+    
+    return ret;
+}
+
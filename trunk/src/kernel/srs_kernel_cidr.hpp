@@ -0,0 +1,111 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef SRS_KERNEL_CIDR_HPP
+#define SRS_KERNEL_CIDR_HPP
+
+/*
+#include <srs_kernel_cidr.hpp>
+*/
+
+#include <srs_core.hpp>
+
+#include <string>
+#include <vector>
+
+// the bytes of address in trie, the ipv4 is mapped to ipv6 as ::ffff:a.b.c.d
+#define SRS_CIDR_ADDRESS_SIZE 16
+
+/**
+* the node of cidr trie, each node is a bit of address.
+*/
+struct SrsCidrNode
+{
+    // the index of child node for bit 0 and 1, 0 for no child.
+    int children[2];
+    // the mask of the prefixes end at this node.
+    int mask;
+};
+
+/**
+* the binary prefix trie for ipv4 and ipv6 cidr, for example,
+*       10.0.0.0/8, 192.168.1.10, 2001:db8::/32, ::1
+* each prefix is tagged by a mask, for instance, the types of client,
+* so the match return the union mask of all prefixes which contain the address,
+* walks at most the length of prefix, never depends on the number of prefixes.
+* @remark the ipv4 is mapped to ipv6, so the ipv4 prefix n is the ipv6 prefix 96+n.
+* @remark the "all" is the prefix 0, which matches any address, even invalid.
+*/
+class SrsCidrTrie
+{
+private:
+    // the nodes of trie, the first is the root.
+    std::vector<SrsCidrNode> nodes;
+    // the number of prefixes added.
+    int nb_prefixes;
+public:
+    SrsCidrTrie();
+    virtual ~SrsCidrTrie();
+public:
+    /**
+    * parse the ipv4 or ipv6 address to the 16 bytes of trie.
+    * @return true if ok; otherwise, false for invalid address.
+    */
+    static bool parse(std::string ip, u_int8_t* addr);
+public:
+    /**
+    * add the prefix, "all", ip or cidr, tag it by mask.
+    * @return ERROR_SYSTEM_CIDR_INVALID when invalid, user should log it.
+    */
+    virtual int add(std::string cidr, int mask);
+    /**
+    * load the prefixes from file, a prefix per line,
+    * the empty line and the comment start with # are ignored.
+    * @param pnb_prefixes the number of prefixes loaded, NULL to ignore.
+    * @remark the invalid line is ignored with warning.
+    */
+    virtual int load(std::string file, int mask, int* pnb_prefixes);
+    /**
+    * remove all prefixes.
+    */
+    virtual void clear();
+    /**
+    * get the number of prefixes added.
+    */
+    virtual int size();
+public:
+    /**
+    * match the address, @return the union mask of all prefixes contain it.
+    * @remark for the invalid address, only match the prefix "all".
+    */
+    virtual int match(std::string ip);
+    /**
+    * match the address parsed by parse(), NULL for the invalid address.
+    */
+    virtual int match(u_int8_t* addr);
+private:
+    virtual int insert(u_int8_t* addr, int prefix, int mask);
+};
+
+#endif
+
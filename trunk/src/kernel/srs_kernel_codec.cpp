@@ -1145,13 +1145,7 @@ int SrsAvcAacCodec::avc_demux_annexb_format(SrsStream* stream, SrsCodecSample* s
         char* p = stream->data() + stream->pos();
         
         // get the last matched NALU
-        while (!stream->empty()) {
-            if (srs_avc_startswith_annexb(stream, NULL)) {
-                break;
-            }
-            
-            stream->skip(1);
-        }
+        stream->skip(srs_avc_find_annexb(p, stream->size() - stream->pos(), NULL));
         
         char* pp = stream->data() + stream->pos();
         
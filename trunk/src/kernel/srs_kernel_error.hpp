@@ -98,6 +98,15 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define ERROR_SYSTEM_DIR_EXISTS             1056
 #define ERROR_SYSTEM_CREATE_DIR             1057
 #define ERROR_SYSTEM_KILL                   1058
+#define ERROR_SYSTEM_CREATE_THREAD          1060
+#define ERROR_SYSTEM_WORKER_MMAP            1061
+#define ERROR_SYSTEM_WORKER_FORK            1062
+#define ERROR_SYSTEM_WORKER_STREAMS         1063
+#define ERROR_SYSTEM_POOL_ALLOC_SLAB        1064
+#define ERROR_SYSTEM_POOL_EXCEED_SLABS      1065
+#define ERROR_SYSTEM_DNS_RESOLVE            1066
+#define ERROR_SYSTEM_CIDR_INVALID           1067
+#define ERROR_SYSTEM_DNS_MISMATCH           1068
 
 ///////////////////////////////////////////////////////
 // RTMP protocol error.
@@ -267,6 +276,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define ERROR_AVC_NALU_UEV                  4027
 #define ERROR_AAC_BYTES_INVALID             4028
 #define ERROR_HTTP_REQUEST_EOF              4029
+#define ERROR_HTTP_CLIENT_POOL_BUSY         4031
+#define ERROR_INGEST_HLS_PLAYLIST           4032
+#define ERROR_INGEST_HLS_NOT_LOCAL          4033
 
 ///////////////////////////////////////////////////////
 // HTTP API error.
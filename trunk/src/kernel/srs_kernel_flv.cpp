@@ -30,6 +30,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include <fcntl.h>
 #include <sstream>
+#include <algorithm>
 using namespace std;
 
 #include <srs_kernel_log.hpp>
@@ -163,14 +164,14 @@ SrsCommonMessage::~SrsCommonMessage()
 #ifdef SRS_AUTO_MEM_WATCH
     srs_memory_unwatch(payload);
 #endif
-    srs_freepa(payload);
+    srs_pool_freepa(payload);
 }
 
 void SrsCommonMessage::create_payload(int size)
 {
-    srs_freepa(payload);
+    srs_pool_freepa(payload);
     
-    payload = new char[size];
+    payload = srs_pool_alloc(size);
     srs_verbose("create payload for RTMP message. size=%d", size);
     
 #ifdef SRS_AUTO_MEM_WATCH
@@ -183,6 +184,10 @@ SrsSharedPtrMessage::SrsSharedPtrPayload::SrsSharedPtrPayload()
     payload = NULL;
     size = 0;
     shared_count = 0;
+#if SRS_PERF_CHUNK_HEADER_CACHE > 0
+    headers = NULL;
+    nb_headers = 0;
+#endif
 }
 
 SrsSharedPtrMessage::SrsSharedPtrPayload::~SrsSharedPtrPayload()
@@ -190,23 +195,24 @@ SrsSharedPtrMessage::SrsSharedPtrPayload::~SrsSharedPtrPayload()
 #ifdef SRS_AUTO_MEM_WATCH
     srs_memory_unwatch(payload);
 #endif
-    srs_freepa(payload);
+    srs_pool_freepa(payload);
+#if SRS_PERF_CHUNK_HEADER_CACHE > 0
+    srs_freepa(headers);
+#endif
 }
 
 SrsSharedPtrMessage::SrsSharedPtrMessage()
 {
     ptr = NULL;
+    payload = NULL;
+    size = 0;
+    timestamp = 0;
+    stream_id = 0;
 }
 
 SrsSharedPtrMessage::~SrsSharedPtrMessage()
 {
-    if (ptr) {
-        if (ptr->shared_count == 0) {
-            srs_freep(ptr);
-        } else {
-            ptr->shared_count--;
-        }
-    }
+    release();
 }
 
 int SrsSharedPtrMessage::create(SrsCommonMessage* msg)
@@ -313,21 +319,94 @@ int SrsSharedPtrMessage::chunk_header(char* cache, int nb_cache, bool c0)
     }
 }
 
+SrsSharedChunkHeader* SrsSharedPtrMessage::shared_chunk_header()
+{
+#if SRS_PERF_CHUNK_HEADER_CACHE > 0
+    srs_assert(ptr);
+    
+    // find the cached header for the timestamp and stream id.
+    for (int i = 0; i < ptr->nb_headers; i++) {
+        SrsSharedChunkHeader* h = &ptr->headers[i];
+        if (h->timestamp == timestamp && h->stream_id == stream_id) {
+            return h;
+        }
+    }
+    
+    // cache full, the header used by other connections never changed.
+    if (ptr->nb_headers >= SRS_PERF_CHUNK_HEADER_CACHE) {
+        return NULL;
+    }
+    
+    if (!ptr->headers) {
+        ptr->headers = new SrsSharedChunkHeader[SRS_PERF_CHUNK_HEADER_CACHE];
+    }
+    
+    // generate the header once, for all connections to send.
+    SrsSharedChunkHeader* h = &ptr->headers[ptr->nb_headers];
+    h->timestamp = timestamp;
+    h->stream_id = stream_id;
+    h->nb_c0 = chunk_header(h->c0, SRS_CONSTS_RTMP_MAX_FMT0_HEADER_SIZE, true);
+    h->nb_c3 = chunk_header(h->c3, SRS_CONSTS_RTMP_MAX_FMT3_HEADER_SIZE, false);
+    srs_assert(h->nb_c0 > 0 && h->nb_c3 > 0);
+    ptr->nb_headers++;
+    
+    return h;
+#else
+    return NULL;
+#endif
+}
+
 SrsSharedPtrMessage* SrsSharedPtrMessage::copy()
 {
     srs_assert(ptr);
     
     SrsSharedPtrMessage* copy = new SrsSharedPtrMessage();
+    copy->share(this);
     
-    copy->ptr = ptr;
-    ptr->shared_count++;
+    return copy;
+}
+
+void SrsSharedPtrMessage::share(SrsSharedPtrMessage* msg)
+{
+    srs_assert(msg->ptr);
+    
+    // increase the count first and keep the ptr, for msg maybe this,
+    // whose ptr is reset by release.
+    SrsSharedPtrPayload* p = msg->ptr;
+    p->shared_count++;
+    release();
+    
+    ptr = p;
+    timestamp = msg->timestamp;
+    stream_id = msg->stream_id;
+    payload = ptr->payload;
+    size = ptr->size;
+}
+
+void SrsSharedPtrMessage::swap(SrsSharedPtrMessage* msg)
+{
+    std::swap(ptr, msg->ptr);
+    std::swap(timestamp, msg->timestamp);
+    std::swap(stream_id, msg->stream_id);
+    std::swap(payload, msg->payload);
+    std::swap(size, msg->size);
+}
+
+void SrsSharedPtrMessage::release()
+{
+    if (!ptr) {
+        return;
+    }
     
-    copy->timestamp = timestamp;
-    copy->stream_id = stream_id;
-    copy->payload = ptr->payload;
-    copy->size = ptr->size;
+    if (ptr->shared_count == 0) {
+        srs_freep(ptr);
+    } else {
+        ptr->shared_count--;
+    }
     
-    return copy;
+    ptr = NULL;
+    payload = NULL;
+    size = 0;
 }
 
 SrsFlvEncoder::SrsFlvEncoder()
@@ -765,20 +844,11 @@ int SrsFlvDecoder::read_tag_header(char* ptype, int32_t* pdata_size, u_int32_t*
     *ptype = (th[0] & 0x1F);
     
     // DataSize UI24
-    char* pp = (char*)pdata_size;
-    pp[3] = 0;
-    pp[2] = th[1];
-    pp[1] = th[2];
-    pp[0] = th[3];
+    *pdata_size = (int32_t)srs_be_load24(th + 1);
     
     // Timestamp UI24
-    pp = (char*)ptime;
-    pp[2] = th[4];
-    pp[1] = th[5];
-    pp[0] = th[6];
-    
     // TimestampExtended UI8
-    pp[3] = th[7];
+    *ptime = srs_be_load24(th + 4) | ((u_int32_t)(u_int8_t)th[7] << 24);
 
     return ret;
 }
@@ -31,6 +31,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include <string>
 
+#include <srs_kernel_consts.hpp>
+#include <srs_kernel_pool.hpp>
+
 // for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <sys/uio.h>
@@ -263,6 +266,8 @@ public:
  */
 class SrsCommonMessage
 {
+    // the message is alloc from pool for each packet.
+    SRS_DECLARE_POOL_OBJECT()
     // 4.1. Message Header
 public:
     SrsMessageHeader header;
@@ -287,6 +292,7 @@ public:
 public:
     /**
      * alloc the payload to specified size of bytes.
+     * @remark the payload is alloc from pool, free it by srs_pool_freepa.
      */
     virtual void create_payload(int size);
 };
@@ -317,6 +323,29 @@ struct SrsSharedMessageHeader
     int perfer_cid;
 };
 
+/**
+ * the chunk headers of shared ptr message, cached in the shared payload,
+ * for all connections which send the message to use the same header bytes.
+ * @remark the header never changed once generated, for the iovs of other
+ *       connections maybe still refer to it when writev blocked.
+ */
+struct SrsSharedChunkHeader
+{
+    /**
+     * the key of cache, the timestamp and stream id of message.
+     */
+    int64_t timestamp;
+    int32_t stream_id;
+    /**
+     * the c0 header for the first chunk of message,
+     * and the c3 header for all other chunks.
+     */
+    int nb_c0;
+    char c0[SRS_CONSTS_RTMP_MAX_FMT0_HEADER_SIZE];
+    int nb_c3;
+    char c3[SRS_CONSTS_RTMP_MAX_FMT3_HEADER_SIZE];
+};
+
 /**
  * shared ptr message.
  * for audio/video/data message that need less memory copy.
@@ -328,6 +357,8 @@ struct SrsSharedMessageHeader
  */
 class SrsSharedPtrMessage
 {
+    // the message is alloc from pool for each packet and each copy.
+    SRS_DECLARE_POOL_OBJECT()
     // 4.1. Message Header
 public:
     // the header can shared, only set the timestamp and stream id.
@@ -364,6 +395,7 @@ public:
 private:
     class SrsSharedPtrPayload
     {
+        SRS_DECLARE_POOL_OBJECT()
     public:
         // shared message header.
         // @see https://github.com/ossrs/srs/issues/251
@@ -374,6 +406,11 @@ private:
         int size;
         // the reference count
         int shared_count;
+#if SRS_PERF_CHUNK_HEADER_CACHE > 0
+        // the cached chunk headers, alloc when first send.
+        SrsSharedChunkHeader* headers;
+        int nb_headers;
+#endif
     public:
         SrsSharedPtrPayload();
         virtual ~SrsSharedPtrPayload();
@@ -420,12 +457,35 @@ public:
      * @return the size of header.
      */
     virtual int chunk_header(char* cache, int nb_cache, bool c0);
+    /**
+     * get the chunk headers shared by all connections,
+     * generate and cache it when send the timestamp and stream id for the first time.
+     * @return the cached headers, NULL when cache is full of other timestamps,
+     *       user should generate the header by chunk_header() in this case.
+     * @remark user must check() the stream id before use the shared header.
+     */
+    virtual SrsSharedChunkHeader* shared_chunk_header();
 public:
     /**
      * copy current shared ptr message, use ref-count.
      * @remark, assert object is created.
      */
     virtual SrsSharedPtrMessage* copy();
+    /**
+     * share the payload of msg, use ref-count, and copy the timestamp and stream id,
+     * for the message object in array to reuse without alloc a new message.
+     * @remark the previous payload of this message is released.
+     */
+    virtual void share(SrsSharedPtrMessage* msg);
+    /**
+     * swap the payload, timestamp and stream id with msg,
+     * the ref-count of payload never change.
+     */
+    virtual void swap(SrsSharedPtrMessage* msg);
+    /**
+     * release the shared payload, the message is empty and can be reused.
+     */
+    virtual void release();
 };
 
 /**
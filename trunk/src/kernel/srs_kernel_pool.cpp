@@ -0,0 +1,199 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <srs_kernel_pool.hpp>
+
+#include <stdlib.h>
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+
+SrsPoolClass::SrsPoolClass()
+{
+    size = 0;
+    free_list = NULL;
+    nb_free = 0;
+    nb_used = 0;
+    nb_slabs = 0;
+    hits = 0;
+    misses = 0;
+}
+
+SrsPoolClass::~SrsPoolClass()
+{
+}
+
+SrsMemoryPool* SrsMemoryPool::_instance = NULL;
+
+SrsMemoryPool::SrsMemoryPool()
+{
+    enabled = false;
+    nb_heap_allocs = 0;
+    
+    nb_classes = 0;
+    for (int size = SRS_PERF_POOL_MIN_SIZE; size <= SRS_PERF_POOL_MAX_SIZE; size *= 2) {
+        nb_classes++;
+    }
+    
+    classes = new SrsPoolClass[nb_classes];
+    for (int i = 0; i < nb_classes; i++) {
+        classes[i].size = SRS_PERF_POOL_MIN_SIZE << i;
+    }
+}
+
+SrsMemoryPool::~SrsMemoryPool()
+{
+    // the blocks maybe still used by the global objects,
+    // so never free the slabs, the pool lives as long as the process.
+    srs_freepa(classes);
+}
+
+SrsMemoryPool* SrsMemoryPool::instance()
+{
+    if (!_instance) {
+        _instance = new SrsMemoryPool();
+    }
+    return _instance;
+}
+
+void SrsMemoryPool::set_enabled(bool v)
+{
+    enabled = v;
+}
+
+bool SrsMemoryPool::is_enabled()
+{
+    return enabled;
+}
+
+char* SrsMemoryPool::alloc(int size)
+{
+#ifdef SRS_PERF_MEMORY_POOL
+    SrsPoolClass* c = NULL;
+    if (enabled && (c = find_class(size)) != NULL) {
+        if (c->free_list) {
+            c->hits++;
+        } else {
+            c->misses++;
+            if (carve(c) != ERROR_SUCCESS) {
+                nb_heap_allocs++;
+                return new char[size];
+            }
+        }
+        
+        char* p = c->free_list;
+        c->free_list = *(char**)p;
+        c->nb_free--;
+        c->nb_used++;
+        return p;
+    }
+#endif
+    
+    nb_heap_allocs++;
+    return new char[size];
+}
+
+void SrsMemoryPool::free(char* p)
+{
+    if (!p) {
+        return;
+    }
+    
+    // the slab is aligned to its size, so mask the address to find it.
+    char* base = (char*)((uintptr_t)p & ~((uintptr_t)SRS_PERF_POOL_SLAB_SIZE - 1));
+    std::map<char*, SrsPoolClass*>::iterator it = slabs.find(base);
+    if (it == slabs.end()) {
+        delete[] p;
+        return;
+    }
+    
+    SrsPoolClass* c = it->second;
+    *(char**)p = c->free_list;
+    c->free_list = p;
+    c->nb_free++;
+    c->nb_used--;
+}
+
+int SrsMemoryPool::size()
+{
+    return nb_classes;
+}
+
+SrsPoolClass* SrsMemoryPool::at(int index)
+{
+    srs_assert(index >= 0 && index < nb_classes);
+    return &classes[index];
+}
+
+int64_t SrsMemoryPool::resident()
+{
+    return (int64_t)slabs.size() * SRS_PERF_POOL_SLAB_SIZE;
+}
+
+int64_t SrsMemoryPool::heap_allocs()
+{
+    return nb_heap_allocs;
+}
+
+SrsPoolClass* SrsMemoryPool::find_class(int size)
+{
+    for (int i = 0; i < nb_classes; i++) {
+        if (size <= classes[i].size) {
+            return &classes[i];
+        }
+    }
+    return NULL;
+}
+
+int SrsMemoryPool::carve(SrsPoolClass* c)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if ((int)slabs.size() >= SRS_PERF_POOL_MAX_SLABS) {
+        return ERROR_SYSTEM_POOL_EXCEED_SLABS;
+    }
+    
+    void* slab = NULL;
+    if (posix_memalign(&slab, SRS_PERF_POOL_SLAB_SIZE, SRS_PERF_POOL_SLAB_SIZE) != 0) {
+        ret = ERROR_SYSTEM_POOL_ALLOC_SLAB;
+        srs_error("alloc slab for pool failed, size=%d. ret=%d", c->size, ret);
+        return ret;
+    }
+    
+    // link all blocks to free list, the first block at the head.
+    char* p = (char*)slab;
+    int nb_blocks = SRS_PERF_POOL_SLAB_SIZE / c->size;
+    for (int i = nb_blocks - 1; i >= 0; i--) {
+        char* block = p + i * c->size;
+        *(char**)block = c->free_list;
+        c->free_list = block;
+    }
+    c->nb_free += nb_blocks;
+    c->nb_slabs++;
+    
+    slabs[p] = c;
+    srs_info("pool carve slab for size=%d, blocks=%d, slabs=%d", c->size, nb_blocks, (int)slabs.size());
+    
+    return ret;
+}
+
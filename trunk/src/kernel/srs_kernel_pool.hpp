@@ -0,0 +1,148 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef SRS_KERNEL_POOL_HPP
+#define SRS_KERNEL_POOL_HPP
+
+/*
+#include <srs_kernel_pool.hpp>
+*/
+
+#include <srs_core.hpp>
+
+#include <map>
+
+#include <srs_core_performance.hpp>
+
+/**
+* the size class of memory pool,
+* all blocks in the class are the same size, and linked in the free list
+* by the first pointer of block when not used.
+*/
+class SrsPoolClass
+{
+public:
+    // the bytes of each block.
+    int size;
+    // the free blocks, link to next free block.
+    char* free_list;
+    // the number of blocks in free list.
+    int nb_free;
+    // the number of blocks allocated and not freed.
+    int nb_used;
+    // the number of slabs carved for this class.
+    int nb_slabs;
+    // the alloc which got the block from free list.
+    int64_t hits;
+    // the alloc which must carve a new slab or alloc from heap.
+    int64_t misses;
+public:
+    SrsPoolClass();
+    virtual ~SrsPoolClass();
+};
+
+/**
+* the memory pool for the rtmp messages and the audio/video payloads,
+* for the server to avoid malloc/free for each packet of each connection.
+* the blocks are carved from aligned slabs by size class, so the free of block
+* find its slab by address mask, and the bytes not from pool are freed by delete[],
+* that is, the pool can free the bytes allocated by new char[] or the pool.
+* @remark the pool is only used in st thread, it's not thread safe.
+* @remark the slabs are never freed, the resident memory is the high water of pool,
+*       and it's limited by SRS_PERF_POOL_MAX_SLABS, alloc from heap when exceed.
+* @remark the pool is disabled by default, for the librtmp detach the payload
+*       to user which free it by delete[], so only the server enable it.
+*/
+class SrsMemoryPool
+{
+private:
+    static SrsMemoryPool* _instance;
+    SrsMemoryPool();
+public:
+    virtual ~SrsMemoryPool();
+    static SrsMemoryPool* instance();
+private:
+    bool enabled;
+    // the size classes, in power of 2.
+    SrsPoolClass* classes;
+    int nb_classes;
+    // the slab base address to size class.
+    std::map<char*, SrsPoolClass*> slabs;
+    // the alloc not from pool, for size exceed the max class or slabs exceed max.
+    int64_t nb_heap_allocs;
+public:
+    /**
+    * enable or disable the pool, the alloc use heap when disabled,
+    * while the free always return the block to pool if it's from pool.
+    */
+    virtual void set_enabled(bool v);
+    virtual bool is_enabled();
+    /**
+    * alloc size of bytes, from pool when enabled.
+    * @remark the bytes must be freed by free(), never delete[] it.
+    */
+    virtual char* alloc(int size);
+    /**
+    * free the bytes allocated by alloc() or new char[].
+    * @remark ignore when p is NULL.
+    */
+    virtual void free(char* p);
+public:
+    /**
+    * get the size classes, for statistic.
+    */
+    virtual int size();
+    virtual SrsPoolClass* at(int index);
+    /**
+    * the total bytes of slabs, the resident memory of pool.
+    */
+    virtual int64_t resident();
+    virtual int64_t heap_allocs();
+private:
+    virtual SrsPoolClass* find_class(int size);
+    virtual int carve(SrsPoolClass* c);
+};
+
+/**
+* alloc or free bytes by pool.
+* @remark the srs_pool_freepa set p to NULL.
+*/
+#define srs_pool_alloc(size) \
+    SrsMemoryPool::instance()->alloc(size)
+#define srs_pool_freepa(p) \
+    if (p) { \
+        SrsMemoryPool::instance()->free((char*)p); \
+        p = NULL; \
+    } \
+    (void)0
+
+/**
+* declare the operator new and delete of class, to alloc object from pool.
+*/
+#define SRS_DECLARE_POOL_OBJECT() \
+    public: \
+        static void* operator new(size_t size) { return srs_pool_alloc((int)size); } \
+        static void operator delete(void* p) { SrsMemoryPool::instance()->free((char*)p); }
+
+#endif
+
@@ -31,12 +31,76 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <srs_core.hpp>
 
 #include <sys/types.h>
+#include <string.h>
 #include <string>
 
+/**
+* load the big-endian integer from bytes, and store to bytes.
+* @remark the compiler merge the bytes to a load and bswap, so it's
+*       the bulk load, and never depends on the endian of host.
+*/
+inline u_int16_t srs_be_load16(const char* b)
+{
+    const u_int8_t* p = (const u_int8_t*)b;
+    return (u_int16_t)((p[0] << 8) | p[1]);
+}
+inline u_int32_t srs_be_load24(const char* b)
+{
+    const u_int8_t* p = (const u_int8_t*)b;
+    return ((u_int32_t)p[0] << 16) | ((u_int32_t)p[1] << 8) | (u_int32_t)p[2];
+}
+inline u_int32_t srs_be_load32(const char* b)
+{
+    const u_int8_t* p = (const u_int8_t*)b;
+    return ((u_int32_t)p[0] << 24) | ((u_int32_t)p[1] << 16) | ((u_int32_t)p[2] << 8) | (u_int32_t)p[3];
+}
+inline u_int64_t srs_be_load48(const char* b)
+{
+    return ((u_int64_t)srs_be_load16(b) << 32) | (u_int64_t)srs_be_load32(b + 2);
+}
+inline u_int64_t srs_be_load64(const char* b)
+{
+    return ((u_int64_t)srs_be_load32(b) << 32) | (u_int64_t)srs_be_load32(b + 4);
+}
+inline void srs_be_store16(char* b, u_int16_t v)
+{
+    u_int8_t* p = (u_int8_t*)b;
+    p[0] = (u_int8_t)(v >> 8);
+    p[1] = (u_int8_t)v;
+}
+inline void srs_be_store24(char* b, u_int32_t v)
+{
+    u_int8_t* p = (u_int8_t*)b;
+    p[0] = (u_int8_t)(v >> 16);
+    p[1] = (u_int8_t)(v >> 8);
+    p[2] = (u_int8_t)v;
+}
+inline void srs_be_store32(char* b, u_int32_t v)
+{
+    u_int8_t* p = (u_int8_t*)b;
+    p[0] = (u_int8_t)(v >> 24);
+    p[1] = (u_int8_t)(v >> 16);
+    p[2] = (u_int8_t)(v >> 8);
+    p[3] = (u_int8_t)v;
+}
+inline void srs_be_store48(char* b, u_int64_t v)
+{
+    srs_be_store16(b, (u_int16_t)(v >> 32));
+    srs_be_store32(b + 2, (u_int32_t)v);
+}
+inline void srs_be_store64(char* b, u_int64_t v)
+{
+    srs_be_store32(b, (u_int32_t)(v >> 32));
+    srs_be_store32(b + 4, (u_int32_t)v);
+}
+
 /**
 * bytes utility, used to:
 * convert basic types to bytes,
 * build basic types from bytes.
+* @remark the stream is not virtual and inline the read and write,
+*       for it's used for each field of amf0, flv, ts and aac,
+*       so never inherit from it.
 */
 class SrsStream
 {
@@ -49,7 +113,7 @@ private:
     int nb_bytes;
 public:
     SrsStream();
-    virtual ~SrsStream();
+    ~SrsStream();
 public:
     /**
     * initialize the stream from bytes.
@@ -59,34 +123,38 @@ public:
     * @remark, return error when bytes NULL.
     * @remark, return error when size is not positive.
     */
-    virtual int initialize(char* b, int nb);
+    int initialize(char* b, int nb);
 // get the status of stream
 public:
     /**
     * get data of stream, set by initialize.
     * current bytes = data() + pos()
     */
-    virtual char* data();
+    char* data() { return bytes; }
     /**
     * the total stream size, set by initialize.
     * left bytes = size() - pos().
     */
-    virtual int size();
+    int size() { return nb_bytes; }
     /**
     * tell the current pos.
     */
-    virtual int pos();
+    int pos() { return (int)(p - bytes); }
     /**
     * whether stream is empty.
     * if empty, user should never read or write.
     */
-    virtual bool empty();
+    bool empty() { return !bytes || (p >= bytes + nb_bytes); }
     /**
     * whether required size is ok.
     * @return true if stream can read/write specified required_size bytes.
     * @remark assert required_size positive.
     */
-    virtual bool require(int required_size);
+    bool require(int required_size)
+    {
+        srs_assert(required_size >= 0);
+        return required_size <= nb_bytes - (p - bytes);
+    }
 // to change stream.
 public:
     /**
@@ -95,65 +163,131 @@ public:
     * @remark to skip(pos()) to reset stream.
     * @remark assert initialized, the data() not NULL.
     */
-    virtual void skip(int size);
+    void skip(int size)
+    {
+        srs_assert(p);
+        p += size;
+    }
 public:
     /**
     * get 1bytes char from stream.
     */
-    virtual int8_t read_1bytes();
+    int8_t read_1bytes()
+    {
+        srs_assert(require(1));
+        return (int8_t)*p++;
+    }
     /**
     * get 2bytes int from stream.
     */
-    virtual int16_t read_2bytes();
+    int16_t read_2bytes()
+    {
+        srs_assert(require(2));
+        int16_t v = (int16_t)srs_be_load16(p);
+        p += 2;
+        return v;
+    }
     /**
     * get 3bytes int from stream.
     */
-    virtual int32_t read_3bytes();
+    int32_t read_3bytes()
+    {
+        srs_assert(require(3));
+        int32_t v = (int32_t)srs_be_load24(p);
+        p += 3;
+        return v;
+    }
     /**
     * get 4bytes int from stream.
     */
-    virtual int32_t read_4bytes();
+    int32_t read_4bytes()
+    {
+        srs_assert(require(4));
+        int32_t v = (int32_t)srs_be_load32(p);
+        p += 4;
+        return v;
+    }
     /**
     * get 8bytes int from stream.
     */
-    virtual int64_t read_8bytes();
+    int64_t read_8bytes()
+    {
+        srs_assert(require(8));
+        int64_t v = (int64_t)srs_be_load64(p);
+        p += 8;
+        return v;
+    }
     /**
     * get string from stream, length specifies by param len.
     */
-    virtual std::string read_string(int len);
+    std::string read_string(int len);
     /**
     * get bytes from stream, length specifies by param len.
     */
-    virtual void read_bytes(char* data, int size);
+    void read_bytes(char* data, int size)
+    {
+        srs_assert(require(size));
+        memcpy(data, p, size);
+        p += size;
+    }
 public:
     /**
     * write 1bytes char to stream.
     */
-    virtual void write_1bytes(int8_t value);
+    void write_1bytes(int8_t value)
+    {
+        srs_assert(require(1));
+        *p++ = value;
+    }
     /**
     * write 2bytes int to stream.
     */
-    virtual void write_2bytes(int16_t value);
+    void write_2bytes(int16_t value)
+    {
+        srs_assert(require(2));
+        srs_be_store16(p, (u_int16_t)value);
+        p += 2;
+    }
     /**
     * write 4bytes int to stream.
     */
-    virtual void write_4bytes(int32_t value);
+    void write_4bytes(int32_t value)
+    {
+        srs_assert(require(4));
+        srs_be_store32(p, (u_int32_t)value);
+        p += 4;
+    }
     /**
     * write 3bytes int to stream.
     */
-    virtual void write_3bytes(int32_t value);
+    void write_3bytes(int32_t value)
+    {
+        srs_assert(require(3));
+        srs_be_store24(p, (u_int32_t)value);
+        p += 3;
+    }
     /**
     * write 8bytes int to stream.
     */
-    virtual void write_8bytes(int64_t value);
+    void write_8bytes(int64_t value)
+    {
+        srs_assert(require(8));
+        srs_be_store64(p, (u_int64_t)value);
+        p += 8;
+    }
     /**
     * write string to stream
     */
-    virtual void write_string(std::string value);
+    void write_string(std::string value);
     /**
     * write bytes to stream
     */
-    virtual void write_bytes(const char* data, int size);
+    void write_bytes(const char* data, int size)
+    {
+        srs_assert(require(size));
+        memcpy(p, data, size);
+        p += size;
+    }
 };
 
 /**
@@ -167,11 +301,28 @@ private:
     SrsStream* stream;
 public:
     SrsBitStream();
-    virtual ~SrsBitStream();
+    ~SrsBitStream();
 public:
-    virtual int initialize(SrsStream* s);
-    virtual bool empty();
-    virtual int8_t read_bit();
+    int initialize(SrsStream* s);
+    bool empty()
+    {
+        if (cb_left) {
+            return false;
+        }
+        return stream->empty();
+    }
+    int8_t read_bit()
+    {
+        if (!cb_left) {
+            srs_assert(!stream->empty());
+            cb = stream->read_1bytes();
+            cb_left = 8;
+        }
+        
+        int8_t v = (cb >> (cb_left - 1)) & 0x01;
+        cb_left--;
+        return v;
+    }
 };
 
 #endif
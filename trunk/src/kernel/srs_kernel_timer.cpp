@@ -0,0 +1,300 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <srs_kernel_timer.hpp>
+
+#include <srs_kernel_utility.hpp>
+
+#define SRS_TIMER_ROOT_MASK (SRS_TIMER_ROOT_SIZE - 1)
+#define SRS_TIMER_LEVEL_MASK (SRS_TIMER_LEVEL_SIZE - 1)
+// the max ticks the wheel covers, the later timer is clamped and re-linked when cascade.
+#define SRS_TIMER_MAX_TICKS ((int64_t)1 << (SRS_TIMER_ROOT_BITS + SRS_TIMER_LEVELS * SRS_TIMER_LEVEL_BITS))
+
+ISrsTimerHandler::ISrsTimerHandler()
+{
+}
+
+ISrsTimerHandler::~ISrsTimerHandler()
+{
+}
+
+SrsTimerEntry::SrsTimerEntry(ISrsTimerHandler* h)
+{
+    handler = h;
+    prev = next = NULL;
+    wheel = NULL;
+    tick = expire = 0;
+}
+
+SrsTimerEntry::~SrsTimerEntry()
+{
+    if (wheel) {
+        wheel->remove(this);
+    }
+}
+
+bool SrsTimerEntry::pending()
+{
+    return wheel != NULL;
+}
+
+int64_t SrsTimerEntry::expire_ms()
+{
+    return expire;
+}
+
+SrsTimerWheel::SrsTimerWheel(int64_t tick, int64_t now_ms)
+{
+    tick_ms = srs_max(1, tick);
+    current = now_ms / tick_ms;
+    nb_timers = 0;
+    
+    // the heads point to themselves when empty.
+    slots = new SrsTimerEntry[SRS_TIMER_SLOTS];
+    for (int i = 0; i < SRS_TIMER_SLOTS; i++) {
+        slots[i].prev = slots[i].next = &slots[i];
+    }
+    expired = new SrsTimerEntry();
+    expired->prev = expired->next = expired;
+    
+    reset_stat();
+}
+
+SrsTimerWheel::~SrsTimerWheel()
+{
+    // detach the pending timers, which are owned by user.
+    for (int i = 0; i <= SRS_TIMER_SLOTS; i++) {
+        SrsTimerEntry* head = (i < SRS_TIMER_SLOTS)? &slots[i] : expired;
+        
+        SrsTimerEntry* entry = head->next;
+        while (entry != head) {
+            SrsTimerEntry* next = entry->next;
+            entry->prev = entry->next = NULL;
+            entry->wheel = NULL;
+            entry = next;
+        }
+        head->prev = head->next = head;
+    }
+    
+    srs_freepa(slots);
+    srs_freep(expired);
+}
+
+void SrsTimerWheel::add(SrsTimerEntry* entry, int64_t expire_ms)
+{
+    if (entry->wheel) {
+        entry->wheel->remove(entry);
+    }
+    
+    // round up to tick, never fire before expire.
+    entry->expire = expire_ms;
+    entry->tick = (srs_max(0, expire_ms) + tick_ms - 1) / tick_ms;
+    entry->wheel = this;
+    nb_timers++;
+    
+    link(entry);
+}
+
+void SrsTimerWheel::remove(SrsTimerEntry* entry)
+{
+    if (entry->wheel != this) {
+        return;
+    }
+    
+    list_remove(entry);
+    entry->wheel = NULL;
+    nb_timers--;
+}
+
+int SrsTimerWheel::advance(int64_t now_ms)
+{
+    int64_t target = now_ms / tick_ms;
+    
+    // no timer, skip all ticks.
+    if (nb_timers <= 0) {
+        current = srs_max(current, target + 1);
+        return 0;
+    }
+    
+    while (current <= target) {
+        int index = (int)(current & SRS_TIMER_ROOT_MASK);
+        
+        // cascade the upper levels when the first level wraps,
+        // and the upper level cascades when the lower level wraps.
+        if (!index) {
+            for (int level = 0; level < SRS_TIMER_LEVELS; level++) {
+                int i = (int)((current >> (SRS_TIMER_ROOT_BITS + level * SRS_TIMER_LEVEL_BITS)) & SRS_TIMER_LEVEL_MASK);
+                cascade(level, i);
+                if (i) {
+                    break;
+                }
+            }
+        }
+        
+        // move all timers of slot to the expired list.
+        SrsTimerEntry* head = &slots[index];
+        if (head->next != head) {
+            SrsTimerEntry* first = head->next;
+            SrsTimerEntry* last = head->prev;
+            
+            first->prev = expired->prev;
+            expired->prev->next = first;
+            last->next = expired;
+            expired->prev = last;
+            
+            head->prev = head->next = head;
+        }
+        
+        current++;
+    }
+    
+    // fire in batch, the handler may add or remove any timer.
+    int nb_fired_timers = 0;
+    while (expired->next != expired) {
+        SrsTimerEntry* entry = expired->next;
+        list_remove(entry);
+        entry->wheel = NULL;
+        nb_timers--;
+        
+        int64_t lag = srs_max(0, now_ms - entry->expire);
+        lag_sum_ms += lag;
+        lag_max_ms = srs_max(lag_max_ms, lag);
+        nb_fired++;
+        nb_fired_timers++;
+        
+        if (entry->handler) {
+            entry->handler->on_timer(entry);
+        }
+    }
+    
+    return nb_fired_timers;
+}
+
+int64_t SrsTimerWheel::next_ms()
+{
+    if (nb_timers <= 0) {
+        return -1;
+    }
+    
+    // find the first timer in the first level, util the next cascade,
+    // that is when the first level wraps, maybe the current tick.
+    int64_t t = current;
+    while ((t & SRS_TIMER_ROOT_MASK) != 0) {
+        SrsTimerEntry* head = &slots[t & SRS_TIMER_ROOT_MASK];
+        if (head->next != head) {
+            break;
+        }
+        t++;
+    }
+    
+    return t * tick_ms;
+}
+
+int SrsTimerWheel::size()
+{
+    return nb_timers;
+}
+
+int64_t SrsTimerWheel::fired()
+{
+    return nb_fired;
+}
+
+int64_t SrsTimerWheel::lag_avg()
+{
+    if (nb_fired <= 0) {
+        return 0;
+    }
+    return lag_sum_ms / nb_fired;
+}
+
+int64_t SrsTimerWheel::lag_max()
+{
+    return lag_max_ms;
+}
+
+void SrsTimerWheel::reset_stat()
+{
+    nb_fired = 0;
+    lag_sum_ms = 0;
+    lag_max_ms = 0;
+}
+
+void SrsTimerWheel::link(SrsTimerEntry* entry)
+{
+    // the expired timer fires at the next tick.
+    int64_t idx = srs_max(entry->tick, current);
+    int64_t delta = idx - current;
+    
+    // the too late timer is clamped, and re-linked when cascade.
+    if (delta >= SRS_TIMER_MAX_TICKS) {
+        delta = SRS_TIMER_MAX_TICKS - 1;
+        idx = current + delta;
+    }
+    
+    if (delta < SRS_TIMER_ROOT_SIZE) {
+        list_insert(&slots[idx & SRS_TIMER_ROOT_MASK], entry);
+        return;
+    }
+    
+    for (int level = 0; level < SRS_TIMER_LEVELS; level++) {
+        int bits = SRS_TIMER_ROOT_BITS + level * SRS_TIMER_LEVEL_BITS;
+        if (delta < ((int64_t)1 << (bits + SRS_TIMER_LEVEL_BITS))) {
+            int i = (int)((idx >> bits) & SRS_TIMER_LEVEL_MASK);
+            list_insert(&slots[SRS_TIMER_ROOT_SIZE + level * SRS_TIMER_LEVEL_SIZE + i], entry);
+            return;
+        }
+    }
+}
+
+void SrsTimerWheel::cascade(int level, int index)
+{
+    SrsTimerEntry* head = &slots[SRS_TIMER_ROOT_SIZE + level * SRS_TIMER_LEVEL_SIZE + index];
+    
+    // detach the list, then re-link each timer to the lower level.
+    SrsTimerEntry* entry = head->next;
+    head->prev->next = NULL;
+    head->prev = head->next = head;
+    
+    while (entry && entry != head) {
+        SrsTimerEntry* next = entry->next;
+        link(entry);
+        entry = next;
+    }
+}
+
+void SrsTimerWheel::list_insert(SrsTimerEntry* head, SrsTimerEntry* entry)
+{
+    entry->prev = head->prev;
+    entry->next = head;
+    head->prev->next = entry;
+    head->prev = entry;
+}
+
+void SrsTimerWheel::list_remove(SrsTimerEntry* entry)
+{
+    entry->prev->next = entry->next;
+    entry->next->prev = entry->prev;
+    entry->prev = entry->next = NULL;
+}
+
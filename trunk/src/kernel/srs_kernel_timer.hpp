@@ -0,0 +1,165 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef SRS_KERNEL_TIMER_HPP
+#define SRS_KERNEL_TIMER_HPP
+
+/*
+#include <srs_kernel_timer.hpp>
+*/
+
+#include <srs_core.hpp>
+
+// the bits of the first level of wheel, 256 ticks.
+#define SRS_TIMER_ROOT_BITS 8
+// the bits of each upper level of wheel, 64 slots.
+#define SRS_TIMER_LEVEL_BITS 6
+// the number of upper levels, the wheel covers 2^(8+6*4) ticks.
+#define SRS_TIMER_LEVELS 4
+#define SRS_TIMER_ROOT_SIZE (1 << SRS_TIMER_ROOT_BITS)
+#define SRS_TIMER_LEVEL_SIZE (1 << SRS_TIMER_LEVEL_BITS)
+#define SRS_TIMER_SLOTS (SRS_TIMER_ROOT_SIZE + SRS_TIMER_LEVELS * SRS_TIMER_LEVEL_SIZE)
+
+class SrsTimerEntry;
+class SrsTimerWheel;
+
+/**
+* the handler of timer, called when timer expired.
+* @remark the handler must never block, for the expired timers are fired in batch.
+* @remark the handler can add or remove any timer, even itself.
+*/
+class ISrsTimerHandler
+{
+public:
+    ISrsTimerHandler();
+    virtual ~ISrsTimerHandler();
+public:
+    virtual void on_timer(SrsTimerEntry* entry) = 0;
+};
+
+/**
+* the timer of wheel, owned by user, linked in the slot of wheel,
+* so the add and remove is O(1) without any allocation.
+* @remark the destructor removes the timer from wheel.
+*/
+class SrsTimerEntry
+{
+    friend class SrsTimerWheel;
+private:
+    SrsTimerEntry* prev;
+    SrsTimerEntry* next;
+    // the wheel which the timer added to, NULL when not pending.
+    SrsTimerWheel* wheel;
+    // the tick and time in ms to expire.
+    int64_t tick;
+    int64_t expire;
+public:
+    ISrsTimerHandler* handler;
+public:
+    SrsTimerEntry(ISrsTimerHandler* h = NULL);
+    virtual ~SrsTimerEntry();
+public:
+    /**
+    * whether the timer is added and not fired.
+    */
+    virtual bool pending();
+    /**
+    * the time in ms to expire.
+    */
+    virtual int64_t expire_ms();
+};
+
+/**
+* the hierarchical timer wheel, the first level is 256 ticks, while each
+* upper level is 64 slots of the ticks of its lower level, for example,
+* the timer in 256 ticks is in the first level, the timer in 256*64 ticks
+* is in the second level, and cascade to lower level when the time comes,
+* so the add, remove and expire are O(1) for any number of timers.
+* @remark the timer never fires before its expire, at most a tick later.
+* @remark the time is ms of a monotonic clock, user should never go back.
+*/
+class SrsTimerWheel
+{
+private:
+    int64_t tick_ms;
+    // the next tick to expire.
+    int64_t current;
+    // the heads of the circular lists of slots, the first level then the upper levels.
+    SrsTimerEntry* slots;
+    // the timers expired and to fire.
+    SrsTimerEntry* expired;
+    int nb_timers;
+private:
+    // the number of fired timers.
+    int64_t nb_fired;
+    // the lag in ms from expire to fire.
+    int64_t lag_sum_ms;
+    int64_t lag_max_ms;
+public:
+    /**
+    * @param tick the resolution in ms.
+    * @param now_ms the current time.
+    */
+    SrsTimerWheel(int64_t tick, int64_t now_ms);
+    virtual ~SrsTimerWheel();
+public:
+    /**
+    * add the timer to expire at time in ms, modify it when pending.
+    * @remark the timer expired is fired at the next advance.
+    */
+    virtual void add(SrsTimerEntry* entry, int64_t expire_ms);
+    /**
+    * remove the timer, ignore when not pending.
+    */
+    virtual void remove(SrsTimerEntry* entry);
+    /**
+    * advance the wheel to the time, fire all expired timers in batch.
+    * @return the number of timers fired.
+    */
+    virtual int advance(int64_t now_ms);
+    /**
+    * the time in ms when the wheel should advance, the first timer in
+    * the first level, or the next cascade of upper levels.
+    * @return -1 when no timer.
+    */
+    virtual int64_t next_ms();
+    /**
+    * the number of pending timers.
+    */
+    virtual int size();
+public:
+    /**
+    * the statistic of fired timers, the lag is from expire to fire in ms.
+    */
+    virtual int64_t fired();
+    virtual int64_t lag_avg();
+    virtual int64_t lag_max();
+    virtual void reset_stat();
+private:
+    virtual void link(SrsTimerEntry* entry);
+    virtual void cascade(int level, int index);
+    static void list_insert(SrsTimerEntry* head, SrsTimerEntry* entry);
+    static void list_remove(SrsTimerEntry* entry);
+};
+
+#endif
@@ -42,6 +42,7 @@ using namespace std;
 #include <srs_kernel_utility.hpp>
 #include <srs_kernel_stream.hpp>
 #include <srs_core_autofree.hpp>
+#include <srs_core_performance.hpp>
 
 // in ms, for HLS aac sync time.
 #define SRS_CONF_DEFAULT_AAC_SYNC 100
@@ -197,11 +198,101 @@ ISrsTsHandler::~ISrsTsHandler()
 {
 }
 
+/**
+* encode the 33bits dts or pts to 5B of bytes.
+* @see SrsTsPayloadPES::encode_33bits_dts_pts
+*/
+static char* srs_ts_encode_33bits(char* p, u_int8_t fb, int64_t v)
+{
+    int32_t val = 0;
+    
+    val = fb << 4 | (((v >> 30) & 0x07) << 1) | 1;
+    *p++ = val;
+    
+    val = (((v >> 15) & 0x7fff) << 1) | 1;
+    *p++ = (val >> 8);
+    *p++ = val;
+    
+    val = (((v) & 0x7fff) << 1) | 1;
+    *p++ = (val >> 8);
+    *p++ = val;
+    
+    return p;
+}
+
+/**
+* decode the 5B of bytes to 33bits dts or pts.
+* @see SrsTsPayloadPES::decode_33bits_dts_pts
+*/
+static int srs_ts_decode_33bits(char* p, int64_t* pv)
+{
+    int ret = ERROR_SUCCESS;
+    
+    u_int8_t* b = (u_int8_t*)p;
+    
+    // 4bits const, 3bits [32..30], 1bit marker; we only ensure the const is not 0x00.
+    if ((b[0] & 0x01) != 0x01 || ((b[0] >> 4) & 0x0f) == 0x00) {
+        ret = ERROR_STREAM_CASTER_TS_PSE;
+        srs_error("ts: demux PSE dts/pts 30-32 failed. ret=%d", ret);
+        return ret;
+    }
+    // 15bits [29..15], 1bit marker; 15bits [14..0], 1bit marker.
+    if ((b[2] & 0x01) != 0x01 || (b[4] & 0x01) != 0x01) {
+        ret = ERROR_STREAM_CASTER_TS_PSE;
+        srs_error("ts: demux PSE dts/pts 0-29 failed. ret=%d", ret);
+        return ret;
+    }
+    
+    int64_t v = ((int64_t)(b[0] >> 1) & 0x07) << 30;
+    v |= (int64_t)(((b[1] << 8) | b[2]) >> 1) << 15;
+    v |= ((b[3] << 8) | b[4]) >> 1;
+    *pv = v;
+    
+    return ret;
+}
+
+/**
+* reset the reused msg of channel for the next PES,
+* keep the capacity of payload to avoid allocation.
+*/
+static void srs_ts_reset_message(SrsTsMessage* msg)
+{
+    msg->dts = msg->pts = 0;
+    msg->sid = (SrsTsPESStreamId)0x00;
+    msg->continuity_counter = 0;
+    msg->PES_packet_length = 0;
+    msg->is_discontinuity = false;
+    msg->start_pts = 0;
+    msg->write_pcr = false;
+    
+    // the handler may detach the payload.
+    if (!msg->payload) {
+        msg->payload = new SrsSimpleBuffer();
+    } else {
+        msg->payload->erase(msg->payload->length());
+    }
+}
+
 SrsTsContext::SrsTsContext()
 {
     pure_audio = false;
     vcodec = SrsCodecVideoReserved;
     acodec = SrsCodecAudioReserved1;
+    
+#ifdef SRS_PERF_FAST_TS_ENCODER
+    fast_encoder = true;
+#else
+    fast_encoder = false;
+#endif
+    batch = NULL;
+    nb_batch = 0;
+    
+#ifdef SRS_PERF_FAST_TS_DECODER
+    fast_decoder = true;
+#else
+    fast_decoder = false;
+#endif
+    packet = new SrsTsPacket(this);
 }
 
 SrsTsContext::~SrsTsContext()
@@ -212,6 +303,9 @@ SrsTsContext::~SrsTsContext()
         srs_freep(channel);
     }
     pids.clear();
+    
+    srs_freepa(batch);
+    srs_freep(packet);
 }
 
 bool SrsTsContext::is_pure_audio()
@@ -264,6 +358,19 @@ void SrsTsContext::set(int pid, SrsTsPidApply apply_pid, SrsTsStream stream)
 }
 
 int SrsTsContext::decode(SrsStream* stream, ISrsTsHandler* handler)
+{
+    if (fast_decoder) {
+        return decode_fast(stream, handler);
+    }
+    return decode_packet(stream, handler);
+}
+
+void SrsTsContext::set_fast_decoder(bool v)
+{
+    fast_decoder = v;
+}
+
+int SrsTsContext::decode_packet(SrsStream* stream, ISrsTsHandler* handler)
 {
     int ret = ERROR_SUCCESS;
 
@@ -293,6 +400,266 @@ int SrsTsContext::decode(SrsStream* stream, ISrsTsHandler* handler)
     return ret;
 }
 
+int SrsTsContext::decode_fast(SrsStream* stream, ISrsTsHandler* handler)
+{
+    int ret = ERROR_SUCCESS;
+    
+    while (stream->size() - stream->pos() >= SRS_TS_PACKET_SIZE) {
+        char* p = stream->data() + stream->pos();
+        char* end = p + SRS_TS_PACKET_SIZE;
+        
+        u_int8_t* b = (u_int8_t*)p;
+        if (b[0] != 0x47) {
+            ret = ERROR_STREAM_CASTER_TS_SYNC_BYTE;
+            srs_error("ts: sync_bytes must be 0x47, actual=%#x. ret=%d", b[0], ret);
+            return ret;
+        }
+        
+        int pid = ((b[1] << 8) | b[2]) & 0x1FFF;
+        SrsTsChannel* channel = NULL;
+        if (pid != SrsTsPidPAT) {
+            channel = get(pid);
+        }
+        
+        // the PAT/PMT and unknown pids, use the packet object decoder.
+        if (!channel || (channel->apply != SrsTsPidApplyVideo && channel->apply != SrsTsPidApplyAudio)) {
+            SrsStream s;
+            if ((ret = s.initialize(p, SRS_TS_PACKET_SIZE)) != ERROR_SUCCESS) {
+                return ret;
+            }
+            if ((ret = decode_packet(&s, handler)) != ERROR_SUCCESS) {
+                return ret;
+            }
+            stream->skip(SRS_TS_PACKET_SIZE);
+            continue;
+        }
+        stream->skip(SRS_TS_PACKET_SIZE);
+        
+        packet->sync_byte = b[0];
+        packet->transport_error_indicator = (b[1] >> 7) & 0x01;
+        packet->payload_unit_start_indicator = (b[1] >> 6) & 0x01;
+        packet->transport_priority = (b[1] >> 5) & 0x01;
+        packet->pid = (SrsTsPid)pid;
+        packet->transport_scrambling_control = (SrsTsScrambled)((b[3] >> 6) & 0x03);
+        packet->adaption_field_control = (SrsTsAdaptationFieldType)((b[3] >> 4) & 0x03);
+        packet->continuity_counter = b[3] & 0x0F;
+        p += 4;
+        
+        // skip the adaptation field, we never use the pcr to decode.
+        SrsTsAdaptationFieldType afc = packet->adaption_field_control;
+        if (afc == SrsTsAdaptationFieldTypeAdaptionOnly || afc == SrsTsAdaptationFieldTypeBoth) {
+            int nb_af = (u_int8_t)*p++;
+            if (afc == SrsTsAdaptationFieldTypeBoth && nb_af > 182) {
+                ret = ERROR_STREAM_CASTER_TS_AF;
+                srs_error("ts: demux af length failed, must in [0, 182], actual=%d. ret=%d", nb_af, ret);
+                return ret;
+            }
+            if (afc == SrsTsAdaptationFieldTypeAdaptionOnly && nb_af != 183) {
+                ret = ERROR_STREAM_CASTER_TS_AF;
+                srs_error("ts: demux af length failed, must be 183, actual=%d. ret=%d", nb_af, ret);
+                return ret;
+            }
+            p += nb_af;
+        }
+        
+        // no payload.
+        if (afc != SrsTsAdaptationFieldTypePayloadOnly && afc != SrsTsAdaptationFieldTypeBoth) {
+            continue;
+        }
+        
+        if ((ret = decode_pes_fast(channel, p, end, handler)) != ERROR_SUCCESS) {
+            srs_error("ts: demux payload failed. ret=%d", ret);
+            return ret;
+        }
+    }
+    
+    // the left bytes is not a whole ts packet.
+    if (!stream->empty()) {
+        return decode_packet(stream, handler);
+    }
+    
+    return ret;
+}
+
+int SrsTsContext::decode_pes_fast(SrsTsChannel* channel, char* p, char* end, ISrsTsHandler* handler)
+{
+    int ret = ERROR_SUCCESS;
+    
+    bool pusi = packet->payload_unit_start_indicator;
+    int8_t cc = packet->continuity_counter;
+    
+    // the msg of channel is reused for all PES.
+    SrsTsMessage* msg = channel->msg;
+    if (!msg) {
+        msg = channel->msg = new SrsTsMessage(channel, packet);
+    }
+    msg->packet = packet;
+    
+    // for the PES_packet_length is 0, the first payload_unit_start_indicator always 1,
+    // so should check for the fresh and not completed it.
+    bool is_fresh_msg = msg->fresh();
+    
+    if (is_fresh_msg && !pusi) {
+        ret = ERROR_STREAM_CASTER_TS_PSE;
+        srs_error("ts: PES fresh packet length=%d, us=%d, cc=%d. ret=%d", msg->PES_packet_length, pusi, cc, ret);
+        return ret;
+    }
+    
+    if (!is_fresh_msg) {
+        // the PES_packet_length>0, the unit start should never be 1 when not completed, drop the msg.
+        if (msg->PES_packet_length > 0 && pusi && !msg->completed(pusi)) {
+            srs_error("ts: PES packet length=%d, payload=%d, us=%d, cc=%d. ret=%d",
+                msg->PES_packet_length, msg->payload->length(), pusi, cc, ERROR_STREAM_CASTER_TS_PSE);
+            srs_ts_reset_message(msg);
+            is_fresh_msg = true;
+        } else if (msg->continuity_counter >= cc && ((msg->continuity_counter + 1) & 0x0f) > cc) {
+            // late-incoming or duplicated continuity, drop packet.
+            srs_warn("ts: drop PES %dB for duplicated cc=%#x", (int)(end - p), msg->continuity_counter);
+            return ret;
+        } else if (((msg->continuity_counter + 1) & 0x0f) != cc) {
+            srs_error("ts: continuity must be continous, msg=%#x, packet=%#x. ret=%d",
+                msg->continuity_counter, cc, ERROR_STREAM_CASTER_TS_PSE);
+            srs_ts_reset_message(msg);
+            is_fresh_msg = true;
+            
+            // the reparsed msg must start by unit start.
+            if (!pusi) {
+                ret = ERROR_STREAM_CASTER_TS_PSE;
+                srs_error("ts: PES fresh packet length=%d, us=%d, cc=%d. ret=%d", msg->PES_packet_length, pusi, cc, ret);
+                return ret;
+            }
+        } else if (msg->completed(pusi)) {
+            // for the PES_packet_length(0), reap previous PES packet when completed.
+            if ((ret = handler->on_ts_message(msg)) != ERROR_SUCCESS) {
+                srs_error("mpegts: handler ts message failed. ret=%d", ret);
+                return ret;
+            }
+            srs_ts_reset_message(msg);
+            is_fresh_msg = true;
+        }
+    }
+    msg->continuity_counter = cc;
+    
+    // when unit start, parse the PES header in place.
+    if (pusi) {
+        // 6B fixed header.
+        if (end - p < 6) {
+            ret = ERROR_STREAM_CASTER_TS_PSE;
+            srs_error("ts: demux PSE failed. ret=%d", ret);
+            return ret;
+        }
+        u_int8_t* b = (u_int8_t*)p;
+        int32_t packet_start_code_prefix = (b[0] << 16) | (b[1] << 8) | b[2];
+        if (packet_start_code_prefix != 0x01) {
+            ret = ERROR_STREAM_CASTER_TS_PSE;
+            srs_error("ts: demux PES start code failed, expect=0x01, actual=%#x. ret=%d", packet_start_code_prefix, ret);
+            return ret;
+        }
+        SrsTsPESStreamId sid = (SrsTsPESStreamId)b[3];
+        int PES_packet_length = (b[4] << 8) | b[5];
+        p += 6;
+        msg->sid = sid;
+        
+        if (sid == SrsTsPESStreamIdPaddingStream) {
+            srs_info("ts: drop %dB padding bytes", (int)(end - p));
+            p = end;
+        } else if (sid == SrsTsPESStreamIdProgramStreamMap
+            || sid == SrsTsPESStreamIdPrivateStream2
+            || sid == SrsTsPESStreamIdEcmStream
+            || sid == SrsTsPESStreamIdEmmStream
+            || sid == SrsTsPESStreamIdProgramStreamDirectory
+            || sid == SrsTsPESStreamIdDsmccStream
+            || sid == SrsTsPESStreamIdH2221TypeE
+        ) {
+            // the PES_packet_data_byte follows the length.
+        } else {
+            // 3B flags.
+            if (end - p < 3) {
+                ret = ERROR_STREAM_CASTER_TS_PSE;
+                srs_error("ts: demux PES flags failed. ret=%d", ret);
+                return ret;
+            }
+            int8_t pefv = p[1];
+            int PES_header_data_length = (u_int8_t)p[2];
+            p += 3;
+            
+            int8_t PTS_DTS_flags = (pefv >> 6) & 0x03;
+            int nb_required = 0;
+            nb_required += (PTS_DTS_flags == 0x2)? 5:0;
+            nb_required += (PTS_DTS_flags == 0x3)? 10:0;
+            nb_required += ((pefv >> 5) & 0x01)? 6:0;
+            nb_required += ((pefv >> 4) & 0x01)? 3:0;
+            nb_required += ((pefv >> 3) & 0x01)? 1:0;
+            nb_required += ((pefv >> 2) & 0x01)? 1:0;
+            nb_required += ((pefv >> 1) & 0x01)? 2:0;
+            nb_required += (pefv & 0x01)? 1:0;
+            if (nb_required > PES_header_data_length || end - p < PES_header_data_length) {
+                ret = ERROR_STREAM_CASTER_TS_PSE;
+                srs_error("ts: demux PES payload failed. ret=%d", ret);
+                return ret;
+            }
+            
+            // 5B
+            if (PTS_DTS_flags == 0x2) {
+                if ((ret = srs_ts_decode_33bits(p, &msg->pts)) != ERROR_SUCCESS) {
+                    return ret;
+                }
+                msg->dts = msg->pts;
+            }
+            
+            // 10B
+            if (PTS_DTS_flags == 0x3) {
+                if ((ret = srs_ts_decode_33bits(p, &msg->pts)) != ERROR_SUCCESS) {
+                    return ret;
+                }
+                if ((ret = srs_ts_decode_33bits(p + 5, &msg->dts)) != ERROR_SUCCESS) {
+                    return ret;
+                }
+                
+                // check sync, the diff of dts and pts should never greater than 1s.
+                if (msg->dts - msg->pts > 90000 || msg->pts - msg->dts > 90000) {
+                    srs_warn("ts: sync dts=%"PRId64", pts=%"PRId64, msg->dts, msg->pts);
+                }
+            }
+            
+            // skip the optional fields and stuffings.
+            p += PES_header_data_length;
+            
+            // the packet size contains the header size, @see SrsTsPayloadPES::decode
+            if (PES_packet_length > 0) {
+                msg->PES_packet_length = srs_max(0, PES_packet_length - 3 - PES_header_data_length);
+            }
+        }
+    }
+    
+    // xB
+    int nb_bytes = (int)(end - p);
+    if (msg->PES_packet_length > 0) {
+        nb_bytes = srs_min(nb_bytes, msg->PES_packet_length - msg->payload->length());
+    }
+    if (nb_bytes > 0) {
+        msg->payload->append(p, nb_bytes);
+    }
+    
+    // when fresh and the PES_packet_length is 0,
+    // the payload_unit_start_indicator always be 1,
+    // the message should never EOF for the first packet.
+    if (is_fresh_msg && msg->PES_packet_length == 0) {
+        return ret;
+    }
+    
+    // check msg, reap when completed.
+    if (msg->completed(pusi)) {
+        if ((ret = handler->on_ts_message(msg)) != ERROR_SUCCESS) {
+            srs_error("mpegts: handler ts message failed. ret=%d", ret);
+            return ret;
+        }
+        srs_ts_reset_message(msg);
+    }
+    
+    return ret;
+}
+
 int SrsTsContext::encode(SrsFileWriter* writer, SrsTsMessage* msg, SrsCodecVideo vc, SrsCodecAudio ac)
 {
     int ret = ERROR_SUCCESS;
@@ -363,11 +730,23 @@ int SrsTsContext::encode(SrsFileWriter* writer, SrsTsMessage* msg, SrsCodecVideo
     }
 
     // encode the media frame to PES packets over TS.
-    if (msg->is_audio()) {
-        return encode_pes(writer, msg, audio_pid, as, vs == SrsTsStreamReserved);
-    } else {
-        return encode_pes(writer, msg, video_pid, vs, vs == SrsTsStreamReserved);
+    int16_t pid = msg->is_audio()? audio_pid : video_pid;
+    SrsTsStream sid = msg->is_audio()? as : vs;
+    if (!fast_encoder) {
+        return encode_pes(writer, msg, pid, sid, vs == SrsTsStreamReserved);
     }
+    
+    // write all packets of PES in a time.
+    if ((ret = encode_pes_fast(writer, msg, pid, sid, vs == SrsTsStreamReserved)) != ERROR_SUCCESS) {
+        nb_batch = 0;
+        return ret;
+    }
+    return flush_batch(writer);
+}
+
+void SrsTsContext::set_fast_encoder(bool v)
+{
+    fast_encoder = v;
 }
 
 int SrsTsContext::encode_pat_pmt(SrsFileWriter* writer, int16_t vpid, SrsTsStream vs, int16_t apid, SrsTsStream as)
@@ -528,6 +907,167 @@ int SrsTsContext::encode_pes(SrsFileWriter* writer, SrsTsMessage* msg, int16_t p
     return ret;
 }
 
+int SrsTsContext::encode_pes_fast(SrsFileWriter* writer, SrsTsMessage* msg, int16_t pid, SrsTsStream sid, bool pure_audio)
+{
+    int ret = ERROR_SUCCESS;
+
+    if (msg->payload->length() == 0) {
+        return ret;
+    }
+
+    if (sid != SrsTsStreamVideoH264 && sid != SrsTsStreamAudioMp3 && sid != SrsTsStreamAudioAAC) {
+        srs_info("ts: ignore the unknown stream, sid=%d", sid);
+        return ret;
+    }
+
+    SrsTsChannel* channel = get(pid);
+    srs_assert(channel);
+    
+    if (!batch) {
+        batch = new char[SRS_PERF_TS_BATCH_PACKETS * SRS_TS_PACKET_SIZE];
+    }
+
+    char* start = msg->payload->bytes();
+    char* end = start + msg->payload->length();
+    char* p = start;
+    
+    // check sync, the diff of dts and pts should never greater than 1s.
+    if (msg->dts - msg->pts > 90000 || msg->pts - msg->dts > 90000) {
+        srs_warn("ts: sync dts=%"PRId64", pts=%"PRId64, msg->dts, msg->pts);
+    }
+
+    while (p < end) {
+        if (nb_batch >= SRS_PERF_TS_BATCH_PACKETS) {
+            if ((ret = flush_batch(writer)) != ERROR_SUCCESS) {
+                return ret;
+            }
+        }
+        char* buf = batch + nb_batch * SRS_TS_PACKET_SIZE;
+        nb_batch++;
+        
+        // the pes header and pcr only for the first packet.
+        // @see SrsTsPacket::create_pes_first and SrsTsPacket::create_pes_continue
+        bool is_first = (p == start);
+        int64_t pcr = -1;
+        if (is_first) {
+            // for pure audio, always write pcr.
+            // it's ok to set pcr equals to dts,
+            // @see https://github.com/ossrs/srs/issues/311
+            if (msg->write_pcr || (pure_audio && msg->is_audio())) {
+                pcr = msg->dts;
+            }
+        }
+        
+        // 4B header, 2B af with 6B pcr, 9B pes header with 5B pts or 10B pts and dts.
+        int nb_af = (pcr >= 0)? 8 : 0;
+        int nb_pes = is_first? ((msg->dts == msg->pts)? 14 : 19) : 0;
+        
+        int left = (int)srs_min(end - p, SRS_TS_PACKET_SIZE - 4 - nb_af - nb_pes);
+        int nb_stuffings = SRS_TS_PACKET_SIZE - 4 - nb_af - nb_pes - left;
+        if (nb_stuffings > 0) {
+            // padding with stuffings in af, the af consume 2B when created.
+            // @see SrsTsPacket::padding
+            if (nb_af == 0) {
+                nb_af = 2;
+                nb_stuffings = srs_max(0, nb_stuffings - 2);
+            }
+            nb_af += nb_stuffings;
+            
+            left = (int)srs_min(end - p, SRS_TS_PACKET_SIZE - 4 - nb_af - nb_pes);
+            srs_assert(SRS_TS_PACKET_SIZE - 4 - nb_af - nb_pes - left == 0);
+        }
+        
+        // 4B ts packet header.
+        u_int8_t cc = channel->continuity_counter++;
+        SrsTsAdaptationFieldType afc = nb_af? SrsTsAdaptationFieldTypeBoth : SrsTsAdaptationFieldTypePayloadOnly;
+        char* pp = buf;
+        *pp++ = 0x47;
+        *pp++ = (is_first? 0x40 : 0x00) | ((pid >> 8) & 0x1F);
+        *pp++ = pid & 0xFF;
+        *pp++ = ((afc << 4) & 0x30) | (cc & 0x0F);
+        
+        // adaptation field.
+        if (nb_af) {
+            char* af_end = pp + nb_af;
+            
+            // adaption_field_length, and the flags of discontinuity and PCR.
+            *pp++ = nb_af - 1;
+            if (pcr >= 0) {
+                // TODO: FIXME: finger it why use discontinuity of msg.
+                *pp++ = (msg->is_discontinuity? 0x80 : 0x00) | 0x10;
+                
+                // @remark, use pcr base and ignore the extension
+                // @see https://github.com/ossrs/srs/issues/250#issuecomment-71349370
+                int64_t pcrv = (0x3F << 9) & 0x7E00;
+                pcrv |= (pcr << 15) & 0x1FFFFFFFF000000LL;
+                srs_be_store48(pp, (u_int64_t)pcrv);
+                pp += 6;
+            } else {
+                *pp++ = 0x00;
+            }
+            
+            // stuffing bytes.
+            memset(pp, 0xFF, af_end - pp);
+            pp = af_end;
+        }
+        
+        // PES header.
+        if (nb_pes) {
+            int size = msg->payload->length();
+            int nb_pes_header = nb_pes - 9;
+            
+            // the PES_packet_length is the actual bytes size plus the header size.
+            int32_t pplv = (size > 0xFFFF)? 0 : size;
+            if (pplv > 0) {
+                pplv += 3 + nb_pes_header;
+                pplv = (pplv > 0xFFFF)? 0 : pplv;
+            }
+            
+            *pp++ = 0x00;
+            *pp++ = 0x00;
+            *pp++ = 0x01;
+            *pp++ = (u_int8_t)msg->sid;
+            srs_be_store16(pp, (u_int16_t)pplv);
+            pp += 2;
+            
+            // const2bits '10', and PTS_DTS_flags.
+            bool has_dts = (msg->dts != msg->pts);
+            *pp++ = 0x80;
+            *pp++ = has_dts? 0xC0 : 0x80;
+            *pp++ = nb_pes_header;
+            
+            pp = srs_ts_encode_33bits(pp, has_dts? 0x03 : 0x02, msg->pts);
+            if (has_dts) {
+                pp = srs_ts_encode_33bits(pp, 0x01, msg->dts);
+            }
+        }
+        
+        memcpy(pp, p, left);
+        p += left;
+    }
+
+    return ret;
+}
+
+int SrsTsContext::flush_batch(SrsFileWriter* writer)
+{
+    int ret = ERROR_SUCCESS;
+    
+    int nb_bytes = nb_batch * SRS_TS_PACKET_SIZE;
+    nb_batch = 0;
+    
+    if (nb_bytes <= 0) {
+        return ret;
+    }
+    
+    if ((ret = writer->write(batch, nb_bytes, NULL)) != ERROR_SUCCESS) {
+        srs_error("ts write ts packets failed. ret=%d", ret);
+        return ret;
+    }
+    
+    return ret;
+}
+
 SrsTsPacket::SrsTsPacket(SrsTsContext* c)
 {
     context = c;
@@ -970,18 +1510,10 @@ int SrsTsAdaptationField::decode(SrsStream* stream)
             return ret;
         }
 
-        char* pp = NULL;
         char* p = stream->data() + stream->pos();
         stream->skip(6);
-
-        int64_t pcrv = 0;
-        pp = (char*)&pcrv;
-        pp[5] = *p++;
-        pp[4] = *p++;
-        pp[3] = *p++;
-        pp[2] = *p++;
-        pp[1] = *p++;
-        pp[0] = *p++;
+        
+        int64_t pcrv = (int64_t)srs_be_load48(p);
         
         // @remark, use pcr base and ignore the extension
         // @see https://github.com/ossrs/srs/issues/250#issuecomment-71349370
@@ -997,18 +1529,10 @@ int SrsTsAdaptationField::decode(SrsStream* stream)
             return ret;
         }
 
-        char* pp = NULL;
         char* p = stream->data() + stream->pos();
         stream->skip(6);
         
-        int64_t opcrv = 0;
-        pp = (char*)&opcrv;
-        pp[5] = *p++;
-        pp[4] = *p++;
-        pp[3] = *p++;
-        pp[2] = *p++;
-        pp[1] = *p++;
-        pp[0] = *p++;
+        int64_t opcrv = (int64_t)srs_be_load48(p);
         
         // @remark, use pcr base and ignore the extension
         // @see https://github.com/ossrs/srs/issues/250#issuecomment-71349370
@@ -1186,7 +1710,6 @@ int SrsTsAdaptationField::encode(SrsStream* stream)
             return ret;
         }
 
-        char* pp = NULL;
         char* p = stream->data() + stream->pos();
         stream->skip(6);
         
@@ -1196,13 +1719,7 @@ int SrsTsAdaptationField::encode(SrsStream* stream)
         pcrv |= (const1_value0 << 9) & 0x7E00;
         pcrv |= (program_clock_reference_base << 15) & 0x1FFFFFFFF000000LL;
 
-        pp = (char*)&pcrv;
-        *p++ = pp[5];
-        *p++ = pp[4];
-        *p++ = pp[3];
-        *p++ = pp[2];
-        *p++ = pp[1];
-        *p++ = pp[0];
+        srs_be_store48(p, (u_int64_t)pcrv);
     }
 
     if (OPCR_flag) {
@@ -3186,6 +3703,12 @@ int SrsTsEncoder::write_video(int64_t timestamp, char* data, int size)
     return flush_video();
 }
 
+void SrsTsEncoder::reset_pat_pmt()
+{
+    // the context write PAT/PMT when codec changed.
+    context->reset();
+}
+
 int SrsTsEncoder::flush_audio()
 {
     int ret = ERROR_SUCCESS;
@@ -350,11 +350,21 @@ class SrsTsContext
 private:
     std::map<int, SrsTsChannel*> pids;
     bool pure_audio;
+    // whether use the fast pes decoder, which parse the packets in place.
+    bool fast_decoder;
+    // the reused packet header of the fast decoder, for the msg->packet.
+    SrsTsPacket* packet;
 // encoder
 private:
     // when any codec changed, write the PAT/PMT.
     SrsCodecVideo vcodec;
     SrsCodecAudio acodec;
+    // whether use the fast pes encoder, which write ts packets to batch.
+    bool fast_encoder;
+    // the reused batch of ts packets, write to file when full or each pes written.
+    char* batch;
+    // the number of packets in batch.
+    int nb_batch;
 public:
     SrsTsContext();
     virtual ~SrsTsContext();
@@ -389,8 +399,26 @@ public:
     * the stream contains only one ts packet.
     * @param handler the ts message handler to process the msg.
     * @remark we will consume all bytes in stream.
+    * @remark the fast decoder accepts multiple ts packets in stream.
     */
     virtual int decode(SrsStream* stream, ISrsTsHandler* handler);
+    /**
+    * whether use the fast pes decoder, default to SRS_PERF_FAST_TS_DECODER.
+    * @remark for utest to compare with the ts packet object decoder.
+    */
+    virtual void set_fast_decoder(bool v);
+private:
+    /**
+    * decode the ts packet by the packet object decoder.
+    */
+    virtual int decode_packet(SrsStream* stream, ISrsTsHandler* handler);
+    /**
+    * decode the ts packets in place without allocation, the PES is parsed
+    * to the reused msg of channel, while the PSI by the packet object decoder.
+    * @remark the msg is reused when handler returns, handler should detach() it to keep.
+    */
+    virtual int decode_fast(SrsStream* stream, ISrsTsHandler* handler);
+    virtual int decode_pes_fast(SrsTsChannel* channel, char* p, char* end, ISrsTsHandler* handler);
 // encode methods
 public:
     /**
@@ -400,9 +428,23 @@ public:
     * @param ac the audio codec, write the PAT/PMT table when changed.
     */
     virtual int encode(SrsFileWriter* writer, SrsTsMessage* msg, SrsCodecVideo vc, SrsCodecAudio ac);
+    /**
+    * whether use the fast pes encoder, default to SRS_PERF_FAST_TS_ENCODER.
+    * @remark for utest to compare with the ts packet object encoder.
+    */
+    virtual void set_fast_encoder(bool v);
 private:
     virtual int encode_pat_pmt(SrsFileWriter* writer, int16_t vpid, SrsTsStream vs, int16_t apid, SrsTsStream as);
     virtual int encode_pes(SrsFileWriter* writer, SrsTsMessage* msg, int16_t pid, SrsTsStream sid, bool pure_audio);
+    /**
+    * encode the pes to ts packets in batch without any allocation,
+    * which generate the same bytes as encode_pes.
+    */
+    virtual int encode_pes_fast(SrsFileWriter* writer, SrsTsMessage* msg, int16_t pid, SrsTsStream sid, bool pure_audio);
+    /**
+    * write all ts packets in batch to writer.
+    */
+    virtual int flush_batch(SrsFileWriter* writer);
 };
 
 /**
@@ -1660,6 +1702,11 @@ public:
     */
     virtual int write_audio(int64_t timestamp, char* data, int size);
     virtual int write_video(int64_t timestamp, char* data, int size);
+    /**
+    * write the PAT/PMT table again before the next frame,
+    * for the stream can be decoded from the next frame.
+    */
+    virtual void reset_pat_pmt();
 private:
     virtual int flush_audio();
     virtual int flush_video();
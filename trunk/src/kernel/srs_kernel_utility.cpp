@@ -41,6 +41,13 @@ using namespace std;
 #include <srs_kernel_error.hpp>
 #include <srs_kernel_stream.hpp>
 #include <srs_kernel_flv.hpp>
+#include <srs_core_performance.hpp>
+
+#if defined(SRS_PERF_SIMD_ANNEXB) && defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(SRS_PERF_SIMD_ANNEXB) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 // this value must:
 // equals to (SRS_SYS_CYCLE_INTERVAL*SRS_SYS_TIME_RESOLUTION_MS_TIMES)*1000
@@ -427,6 +434,86 @@ bool srs_avc_startswith_annexb(SrsStream* stream, int* pnb_start_code)
     return false;
 }
 
+/**
+* find the first 00 00 01 in bytes, @return the position or size if not found.
+*/
+static int srs_avc_find_000001(char* bytes, int size)
+{
+    u_int8_t* p = (u_int8_t*)bytes;
+    int i = 0;
+    
+#if defined(SRS_PERF_SIMD_ANNEXB) && defined(__AVX2__)
+    // compare 32 positions a step, the 00 00 01 at p[i] is the lane i
+    // of the bytes, the bytes shift 1 and the bytes shift 2.
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi8(1);
+    for (; i + 34 <= size; i += 32) {
+        __m256i b0 = _mm256_loadu_si256((const __m256i*)(p + i));
+        __m256i b1 = _mm256_loadu_si256((const __m256i*)(p + i + 1));
+        __m256i b2 = _mm256_loadu_si256((const __m256i*)(p + i + 2));
+        __m256i m = _mm256_and_si256(_mm256_cmpeq_epi8(b0, zero), _mm256_cmpeq_epi8(b1, zero));
+        m = _mm256_and_si256(m, _mm256_cmpeq_epi8(b2, one));
+        
+        u_int32_t mask = (u_int32_t)_mm256_movemask_epi8(m);
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#elif defined(SRS_PERF_SIMD_ANNEXB) && defined(__SSE2__)
+    // compare 16 positions a step, @see the avx2 above.
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    for (; i + 18 <= size; i += 16) {
+        __m128i b0 = _mm_loadu_si128((const __m128i*)(p + i));
+        __m128i b1 = _mm_loadu_si128((const __m128i*)(p + i + 1));
+        __m128i b2 = _mm_loadu_si128((const __m128i*)(p + i + 2));
+        __m128i m = _mm_and_si128(_mm_cmpeq_epi8(b0, zero), _mm_cmpeq_epi8(b1, zero));
+        m = _mm_and_si128(m, _mm_cmpeq_epi8(b2, one));
+        
+        int mask = _mm_movemask_epi8(m);
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+    
+    // the scalar for the left bytes, skip 3 bytes when p[i+2]>1,
+    // for none of p[i], p[i+1] and p[i+2] can be the start.
+    while (i + 2 < size) {
+        if (p[i + 2] > 1) {
+            i += 3;
+        } else if (p[i + 1] != 0) {
+            i += 2;
+        } else if (p[i] != 0 || p[i + 2] != 1) {
+            i++;
+        } else {
+            return i;
+        }
+    }
+    
+    return size;
+}
+
+int srs_avc_find_annexb(char* bytes, int size, int* pnb_start_code)
+{
+    int pos = srs_avc_find_000001(bytes, size);
+    if (pos >= size) {
+        return size;
+    }
+    
+    // the start code is N[00] 00 00 01, include the zeros before it.
+    int start = pos;
+    while (start > 0 && bytes[start - 1] == 0x00) {
+        start--;
+    }
+    
+    if (pnb_start_code) {
+        *pnb_start_code = pos + 3 - start;
+    }
+    
+    return start;
+}
+
 bool srs_aac_startswith_adts(SrsStream* stream)
 {
     char* bytes = stream->data() + stream->pos();
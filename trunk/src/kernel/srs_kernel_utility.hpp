@@ -92,6 +92,16 @@ extern std::string srs_path_basename(std::string path);
 */
 extern bool srs_avc_startswith_annexb(SrsStream* stream, int* pnb_start_code = NULL);
 
+/**
+* find the first avc NALU start code in "AnnexB" of bytes,
+* that is the first position where srs_avc_startswith_annexb matches.
+* @param pnb_start_code output the size of start code, must >=3.
+*       NULL to ignore, not changed when not found.
+* @return the position of start code, or size when not found.
+* @remark use simd to scan the bytes, @see SRS_PERF_SIMD_ANNEXB
+*/
+extern int srs_avc_find_annexb(char* bytes, int size, int* pnb_start_code = NULL);
+
 /**
 * whether stream starts with the aac ADTS 
 * from aac-mp4a-format-ISO_IEC_14496-3+2001.pdf, page 75, 1.A.2.2 ADTS.
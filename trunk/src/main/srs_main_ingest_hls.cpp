@@ -628,6 +628,7 @@ int SrsIngestSrsInput::SrsTsPiece::fetch(string m3u8)
 
 // the context to output to rtmp server
 class SrsIngestSrsOutput : virtual public ISrsTsHandler, virtual public ISrsAacHandler
+    , virtual public ISrsTsRtmpHandler
 {
 private:
     SrsHttpUri* out_rtmp;
@@ -642,15 +643,8 @@ private:
     SrsRtmpClient* client;
     int stream_id;
 private:
-    SrsRawH264Stream* avc;
-    std::string h264_sps;
-    bool h264_sps_changed;
-    std::string h264_pps;
-    bool h264_pps_changed;
-    bool h264_sps_pps_sent;
-private:
-    SrsRawAacStream* aac;
-    std::string aac_specific_config;
+    // mux the ts messages and aac frames to flv packets.
+    SrsTsRtmpMuxer* muxer;
 public:
     SrsIngestSrsOutput(SrsHttpUri* rtmp) {
         out_rtmp = rtmp;
@@ -663,17 +657,12 @@ public:
         stfd = NULL;
         stream_id = 0;
         
-        avc = new SrsRawH264Stream();
-        aac = new SrsRawAacStream();
-        h264_sps_changed = false;
-        h264_pps_changed = false;
-        h264_sps_pps_sent = false;
+        muxer = new SrsTsRtmpMuxer(this);
     }
     virtual ~SrsIngestSrsOutput() {
         close();
         
-        srs_freep(avc);
-        srs_freep(aac);
+        srs_freep(muxer);
         
         std::multimap<int64_t, SrsTsMessage*>::iterator it;
         for (it = queue.begin(); it != queue.end(); ++it) {
@@ -688,16 +677,12 @@ public:
 // interface IAacHandler
 public:
     virtual int on_aac_frame(char* frame, int frame_size, double duration);
+// interface ISrsTsRtmpHandler
+public:
+    virtual int on_rtmp_packet(char type, u_int32_t timestamp, char* data, int size);
 private:
     virtual int do_on_aac_frame(SrsStream* avs, double duration);
     virtual int parse_message_queue();
-    virtual int on_ts_video(SrsTsMessage* msg, SrsStream* avs);
-    virtual int write_h264_sps_pps(u_int32_t dts, u_int32_t pts);
-    virtual int write_h264_ipb_frame(std::string ibps, SrsCodecVideoAVCFrame frame_type, u_int32_t dts, u_int32_t pts);
-    virtual int on_ts_audio(SrsTsMessage* msg, SrsStream* avs);
-    virtual int write_audio_raw_frame(char* frame, int frame_size, SrsRawAacStreamCodec* codec, u_int32_t dts);
-private:
-    virtual int rtmp_write_packet(char type, u_int32_t timestamp, char* data, int size);
 public:
     /**
      * connect to output rtmp server.
@@ -799,60 +784,13 @@ int SrsIngestSrsOutput::on_aac_frame(char* frame, int frame_size, double duratio
 
 int SrsIngestSrsOutput::do_on_aac_frame(SrsStream* avs, double duration)
 {
-    int ret = ERROR_SUCCESS;
-    
     u_int32_t duration_ms = (u_int32_t)(duration * 1000);
     
     // ts tbn to flv tbn.
     u_int32_t dts = (u_int32_t)raw_aac_dts;
     raw_aac_dts += duration_ms;
     
-    // got the next msg to calc the delta duration for each audio.
-    u_int32_t max_dts = dts + duration_ms;
-    
-    // send each frame.
-    while (!avs->empty()) {
-        char* frame = NULL;
-        int frame_size = 0;
-        SrsRawAacStreamCodec codec;
-        if ((ret = aac->adts_demux(avs, &frame, &frame_size, codec)) != ERROR_SUCCESS) {
-            return ret;
-        }
-        
-        // ignore invalid frame,
-        //  * atleast 1bytes for aac to decode the data.
-        if (frame_size <= 0) {
-            continue;
-        }
-        srs_info("mpegts: demux aac frame size=%d, dts=%d", frame_size, dts);
-        
-        // generate sh.
-        if (aac_specific_config.empty()) {
-            std::string sh;
-            if ((ret = aac->mux_sequence_header(&codec, sh)) != ERROR_SUCCESS) {
-                return ret;
-            }
-            aac_specific_config = sh;
-            
-            codec.aac_packet_type = 0;
-            
-            if ((ret = write_audio_raw_frame((char*)sh.data(), (int)sh.length(), &codec, dts)) != ERROR_SUCCESS) {
-                return ret;
-            }
-        }
-        
-        // audio raw data.
-        codec.aac_packet_type = 1;
-        if ((ret = write_audio_raw_frame(frame, frame_size, &codec, dts)) != ERROR_SUCCESS) {
-            return ret;
-        }
-        
-        // calc the delta of dts, when previous frame output.
-        u_int32_t delta = duration_ms / (avs->size() / frame_size);
-        dts = (u_int32_t)(srs_min(max_dts, dts + delta));
-    }
-    
-    return ret;
+    return muxer->on_aac_frames(avs, dts, duration_ms);
 }
 
 int SrsIngestSrsOutput::parse_message_queue()
@@ -892,11 +830,15 @@ int SrsIngestSrsOutput::parse_message_queue()
         std::multimap<int64_t, SrsTsMessage*>::iterator it = queue.begin();
         
         SrsTsMessage* msg = it->second;
+        SrsAutoFree(SrsTsMessage, msg);
         if (msg->channel->stream == SrsTsStreamVideoH264) {
             nb_videos--;
         }
         queue.erase(it);
         
+        // the dts of next msg to calc the duration of audio.
+        int64_t next_dts = queue.empty()? msg->dts : queue.begin()->second->dts;
+        
         // parse the stream.
         SrsStream avs;
         if ((ret = avs.initialize(msg->payload->bytes(), msg->payload->length())) != ERROR_SUCCESS) {
@@ -906,12 +848,12 @@ int SrsIngestSrsOutput::parse_message_queue()
         
         // publish audio or video.
         if (msg->channel->stream == SrsTsStreamVideoH264) {
-            if ((ret = on_ts_video(msg, &avs)) != ERROR_SUCCESS) {
+            if ((ret = muxer->on_ts_video(msg, &avs)) != ERROR_SUCCESS) {
                 return ret;
             }
         }
         if (msg->channel->stream == SrsTsStreamAudioAAC) {
-            if ((ret = on_ts_audio(msg, &avs)) != ERROR_SUCCESS) {
+            if ((ret = muxer->on_ts_audio(msg, &avs, next_dts)) != ERROR_SUCCESS) {
                 return ret;
             }
         }
@@ -929,8 +871,12 @@ int SrsIngestSrsOutput::flush_message_queue()
         std::multimap<int64_t, SrsTsMessage*>::iterator it = queue.begin();
         
         SrsTsMessage* msg = it->second;
+        SrsAutoFree(SrsTsMessage, msg);
         queue.erase(it);
         
+        // the dts of next msg to calc the duration of audio.
+        int64_t next_dts = queue.empty()? msg->dts : queue.begin()->second->dts;
+        
         // parse the stream.
         SrsStream avs;
         if ((ret = avs.initialize(msg->payload->bytes(), msg->payload->length())) != ERROR_SUCCESS) {
@@ -940,250 +886,21 @@ int SrsIngestSrsOutput::flush_message_queue()
         
         // publish audio or video.
         if (msg->channel->stream == SrsTsStreamVideoH264) {
-            if ((ret = on_ts_video(msg, &avs)) != ERROR_SUCCESS) {
+            if ((ret = muxer->on_ts_video(msg, &avs)) != ERROR_SUCCESS) {
                 return ret;
             }
         }
         if (msg->channel->stream == SrsTsStreamAudioAAC) {
-            if ((ret = on_ts_audio(msg, &avs)) != ERROR_SUCCESS) {
-                return ret;
-            }
-        }
-    }
-    
-    return ret;
-}
-
-int SrsIngestSrsOutput::on_ts_video(SrsTsMessage* msg, SrsStream* avs)
-{
-    int ret = ERROR_SUCCESS;
-    
-    // ts tbn to flv tbn.
-    u_int32_t dts = (u_int32_t)(msg->dts / 90);
-    u_int32_t pts = (u_int32_t)(msg->dts / 90);
-    
-    std::string ibps;
-    SrsCodecVideoAVCFrame frame_type = SrsCodecVideoAVCFrameInterFrame;
-    
-    // send each frame.
-    while (!avs->empty()) {
-        char* frame = NULL;
-        int frame_size = 0;
-        bool is_end = false;
-        if ((ret = avc->annexb_demux(avs, &frame, &frame_size, &is_end)) != ERROR_SUCCESS) {
-            return ret;
-        }
-        
-        // 5bits, 7.3.1 NAL unit syntax,
-        // H.264-AVC-ISO_IEC_14496-10.pdf, page 44.
-        //  7: SPS, 8: PPS, 5: I Frame, 1: P Frame
-        SrsAvcNaluType nal_unit_type = (SrsAvcNaluType)(frame[0] & 0x1f);
-        
-        // for IDR frame, the frame is keyframe.
-        if (nal_unit_type == SrsAvcNaluTypeIDR) {
-            frame_type = SrsCodecVideoAVCFrameKeyFrame;
-        }
-        
-        // ignore the nalu type aud(9)
-        if (nal_unit_type == SrsAvcNaluTypeAccessUnitDelimiter) {
-            continue;
-        }
-        
-        // for sps
-        if (avc->is_sps(frame, frame_size)) {
-            std::string sps;
-            if ((ret = avc->sps_demux(frame, frame_size, sps)) != ERROR_SUCCESS) {
-                return ret;
-            }
-            
-            if (h264_sps == sps) {
-                continue;
-            }
-            h264_sps_changed = true;
-            h264_sps = sps;
-            continue;
-        }
-        
-        // for pps
-        if (avc->is_pps(frame, frame_size)) {
-            std::string pps;
-            if ((ret = avc->pps_demux(frame, frame_size, pps)) != ERROR_SUCCESS) {
-                return ret;
-            }
-            
-            if (h264_pps == pps) {
-                continue;
-            }
-            h264_pps_changed = true;
-            h264_pps = pps;
-            continue;
-        }
-        
-        // ibp frame.
-        std::string ibp;
-        if ((ret = avc->mux_sei_ipb_frame(frame, frame_size, ibp)) != ERROR_SUCCESS) {
-            return ret;
-        }
-        ibps.append(ibp);
-    }
-    
-    if ((ret = write_h264_sps_pps(dts, pts)) != ERROR_SUCCESS) {
-        return ret;
-    }
-    
-    if ((ret = write_h264_ipb_frame(ibps, frame_type, dts, pts)) != ERROR_SUCCESS) {
-        // drop the ts message.
-        if (ret == ERROR_H264_DROP_BEFORE_SPS_PPS) {
-            return ERROR_SUCCESS;
-        }
-        return ret;
-    }
-    
-    return ret;
-}
-
-int SrsIngestSrsOutput::write_h264_sps_pps(u_int32_t dts, u_int32_t pts)
-{
-    int ret = ERROR_SUCCESS;
-    
-    // when sps or pps changed, update the sequence header,
-    // for the pps maybe not changed while sps changed.
-    // so, we must check when each video ts message frame parsed.
-    if (h264_sps_pps_sent && !h264_sps_changed && !h264_pps_changed) {
-        return ret;
-    }
-    
-    // when not got sps/pps, wait.
-    if (h264_pps.empty() || h264_sps.empty()) {
-        return ret;
-    }
-    
-    // h264 raw to h264 packet.
-    std::string sh;
-    if ((ret = avc->mux_sequence_header(h264_sps, h264_pps, dts, pts, sh)) != ERROR_SUCCESS) {
-        return ret;
-    }
-    
-    // h264 packet to flv packet.
-    int8_t frame_type = SrsCodecVideoAVCFrameKeyFrame;
-    int8_t avc_packet_type = SrsCodecVideoAVCTypeSequenceHeader;
-    char* flv = NULL;
-    int nb_flv = 0;
-    if ((ret = avc->mux_avc2flv(sh, frame_type, avc_packet_type, dts, pts, &flv, &nb_flv)) != ERROR_SUCCESS) {
-        return ret;
-    }
-    
-    // the timestamp in rtmp message header is dts.
-    u_int32_t timestamp = dts;
-    if ((ret = rtmp_write_packet(SrsCodecFlvTagVideo, timestamp, flv, nb_flv)) != ERROR_SUCCESS) {
-        return ret;
-    }
-    
-    // reset sps and pps.
-    h264_sps_changed = false;
-    h264_pps_changed = false;
-    h264_sps_pps_sent = true;
-    srs_trace("hls: h264 sps/pps sent, sps=%dB, pps=%dB", h264_sps.length(), h264_pps.length());
-    
-    return ret;
-}
-
-int SrsIngestSrsOutput::write_h264_ipb_frame(string ibps, SrsCodecVideoAVCFrame frame_type, u_int32_t dts, u_int32_t pts)
-{
-    int ret = ERROR_SUCCESS;
-    
-    // when sps or pps not sent, ignore the packet.
-    // @see https://github.com/ossrs/srs/issues/203
-    if (!h264_sps_pps_sent) {
-        return ERROR_H264_DROP_BEFORE_SPS_PPS;
-    }
-    
-    int8_t avc_packet_type = SrsCodecVideoAVCTypeNALU;
-    char* flv = NULL;
-    int nb_flv = 0;
-    if ((ret = avc->mux_avc2flv(ibps, frame_type, avc_packet_type, dts, pts, &flv, &nb_flv)) != ERROR_SUCCESS) {
-        return ret;
-    }
-    
-    // the timestamp in rtmp message header is dts.
-    u_int32_t timestamp = dts;
-    return rtmp_write_packet(SrsCodecFlvTagVideo, timestamp, flv, nb_flv);
-}
-
-int SrsIngestSrsOutput::on_ts_audio(SrsTsMessage* msg, SrsStream* avs)
-{
-    int ret = ERROR_SUCCESS;
-    
-    // ts tbn to flv tbn.
-    u_int32_t dts = (u_int32_t)(msg->dts / 90);
-    
-    // got the next msg to calc the delta duration for each audio.
-    u_int32_t duration = 0;
-    if (!queue.empty()) {
-        SrsTsMessage* nm = queue.begin()->second;
-        duration = (u_int32_t)(srs_max(0, nm->dts - msg->dts) / 90);
-    }
-    u_int32_t max_dts = dts + duration;
-    
-    // send each frame.
-    while (!avs->empty()) {
-        char* frame = NULL;
-        int frame_size = 0;
-        SrsRawAacStreamCodec codec;
-        if ((ret = aac->adts_demux(avs, &frame, &frame_size, codec)) != ERROR_SUCCESS) {
-            return ret;
-        }
-        
-        // ignore invalid frame,
-        //  * atleast 1bytes for aac to decode the data.
-        if (frame_size <= 0) {
-            continue;
-        }
-        srs_info("mpegts: demux aac frame size=%d, dts=%d", frame_size, dts);
-        
-        // generate sh.
-        if (aac_specific_config.empty()) {
-            std::string sh;
-            if ((ret = aac->mux_sequence_header(&codec, sh)) != ERROR_SUCCESS) {
-                return ret;
-            }
-            aac_specific_config = sh;
-            
-            codec.aac_packet_type = 0;
-            
-            if ((ret = write_audio_raw_frame((char*)sh.data(), (int)sh.length(), &codec, dts)) != ERROR_SUCCESS) {
+            if ((ret = muxer->on_ts_audio(msg, &avs, next_dts)) != ERROR_SUCCESS) {
                 return ret;
             }
         }
-        
-        // audio raw data.
-        codec.aac_packet_type = 1;
-        if ((ret = write_audio_raw_frame(frame, frame_size, &codec, dts)) != ERROR_SUCCESS) {
-            return ret;
-        }
-        
-        // calc the delta of dts, when previous frame output.
-        u_int32_t delta = duration / (msg->payload->length() / frame_size);
-        dts = (u_int32_t)(srs_min(max_dts, dts + delta));
     }
     
     return ret;
 }
 
-int SrsIngestSrsOutput::write_audio_raw_frame(char* frame, int frame_size, SrsRawAacStreamCodec* codec, u_int32_t dts)
-{
-    int ret = ERROR_SUCCESS;
-    
-    char* data = NULL;
-    int size = 0;
-    if ((ret = aac->mux_aac2flv(frame, frame_size, codec, dts, &data, &size)) != ERROR_SUCCESS) {
-        return ret;
-    }
-    
-    return rtmp_write_packet(SrsCodecFlvTagAudio, dts, data, size);
-}
-
-int SrsIngestSrsOutput::rtmp_write_packet(char type, u_int32_t timestamp, char* data, int size)
+int SrsIngestSrsOutput::on_rtmp_packet(char type, u_int32_t timestamp, char* data, int size)
 {
     int ret = ERROR_SUCCESS;
     
@@ -1324,7 +1041,9 @@ int SrsIngestSrsOutput::connect_app(string ep_server, string ep_port)
 void SrsIngestSrsOutput::close()
 {
     srs_trace("close output=%s", out_rtmp->get_url());
-    h264_sps_pps_sent = false;
+    
+    // the sequence header must be sent again when reconnected.
+    muxer->reset();
     
     srs_freep(client);
     srs_freep(io);
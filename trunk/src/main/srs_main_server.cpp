@@ -40,6 +40,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <srs_app_log.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_core_performance.hpp>
+#include <srs_app_worker.hpp>
+#include <srs_kernel_pool.hpp>
 
 // pre-declare
 int run();
@@ -276,6 +278,12 @@ int main(int argc, char** argv)
     #warning "gmp is not used for memory leak, please use gmc instead."
 #endif
     
+    // alloc the messages and payloads from pool, only the server use the pool,
+    // while never use it when check the memory leak, which requires heap allocs.
+#if !defined(SRS_AUTO_GPERF_MC) && !defined(SRS_AUTO_MEM_WATCH)
+    SrsMemoryPool::instance()->set_enabled(true);
+#endif
+    
     // never use srs log(srs_trace, srs_error, etc) before config parse the option,
     // which will load the log config and apply it.
     if ((ret = _srs_config->parse_options(argc, argv)) != ERROR_SUCCESS) {
@@ -372,6 +380,23 @@ int run_master()
 {
     int ret = ERROR_SUCCESS;
     
+    if ((ret = _srs_workers->initialize(_srs_config->get_workers())) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // the master forks the workers and supervises them,
+    // only the forked workers return to serve.
+    if (_srs_workers->enabled()) {
+        // the master holds the pid file for all workers.
+        if ((ret = _srs_server->acquire_pid_file()) != ERROR_SUCCESS) {
+            return ret;
+        }
+        
+        if ((ret = _srs_workers->cycle()) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
     if ((ret = _srs_server->initialize_st()) != ERROR_SUCCESS) {
         return ret;
     }
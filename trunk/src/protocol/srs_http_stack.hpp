@@ -199,6 +199,7 @@ public:
     virtual int write(char* data, int size) = 0;
     /**
      * for the HTTP FLV, to writev to improve performance.
+     * @remark send all ioves in a writev when header wrote with content length.
      * @see https://github.com/ossrs/srs/issues/405
      */
     virtual int writev(iovec* iov, int iovcnt, ssize_t* pnwrite) = 0;
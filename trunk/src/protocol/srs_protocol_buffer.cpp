@@ -29,6 +29,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <srs_kernel_log.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_core_performance.hpp>
+#include <srs_kernel_pool.hpp>
 
 // the default recv buffer size, 128KB.
 #define SRS_DEFAULT_RECV_BUFFER_SIZE 131072
@@ -59,15 +60,17 @@ SrsFastBuffer::SrsFastBuffer()
     _handler = NULL;
 #endif
     
-    nb_buffer = SRS_DEFAULT_RECV_BUFFER_SIZE;
-    buffer = (char*)malloc(nb_buffer);
+    nb_max_buffer = SRS_DEFAULT_RECV_BUFFER_SIZE;
+    nb_grow_buffer = nb_buffer = srs_min(SRS_PERF_RECV_BUFFER_MIN, nb_max_buffer);
+    nb_idle_reads = 0;
+    
+    buffer = srs_pool_alloc(nb_buffer);
     p = end = buffer;
 }
 
 SrsFastBuffer::~SrsFastBuffer()
 {
-    free(buffer);
-    buffer = NULL;
+    srs_pool_freepa(buffer);
 }
 
 int SrsFastBuffer::size()
@@ -80,6 +83,11 @@ char* SrsFastBuffer::bytes()
     return p;
 }
 
+int SrsFastBuffer::capacity()
+{
+    return nb_buffer;
+}
+
 void SrsFastBuffer::set_buffer(int buffer_size)
 {
     // never exceed the max size.
@@ -91,19 +99,12 @@ void SrsFastBuffer::set_buffer(int buffer_size)
     // the user-space buffer size limit to a max value.
     int nb_resize_buf = srs_min(buffer_size, SRS_MAX_SOCKET_BUFFER);
 
-    // only realloc when buffer changed bigger
-    if (nb_resize_buf <= nb_buffer) {
+    // only change when buffer changed bigger,
+    // the buffer grow to it when read more bytes.
+    if (nb_resize_buf <= nb_max_buffer) {
         return;
     }
-    
-    // realloc for buffer change bigger.
-    int start = (int)(p - buffer);
-    int nb_bytes = (int)(end - p);
-    
-    buffer = (char*)realloc(buffer, nb_resize_buf);
-    nb_buffer = nb_resize_buf;
-    p = buffer + start;
-    end = p + nb_bytes;
+    nb_max_buffer = nb_resize_buf;
 }
 
 char SrsFastBuffer::read_1byte()
@@ -152,9 +153,23 @@ int SrsFastBuffer::grow(ISrsBufferReader* reader, int required_size)
         int nb_exists_bytes = (int)(end - p);
         srs_assert(nb_exists_bytes >= 0);
         srs_verbose("move fast buffer %d bytes", nb_exists_bytes);
+        
+        // the size of buffer to move to, which is doubled when read fill the buffer,
+        // halved when idle, and grow to the required size.
+        int nb_size = nb_grow_buffer;
+        if (nb_idle_reads >= SRS_PERF_RECV_BUFFER_IDLE_READS) {
+            nb_size = srs_max(nb_buffer / 2, SRS_PERF_RECV_BUFFER_MIN);
+            nb_idle_reads = 0;
+        }
+        while (nb_size < nb_exists_bytes + required_size && nb_size < nb_max_buffer) {
+            nb_size = srs_min(nb_size * 2, nb_max_buffer);
+        }
+        nb_grow_buffer = nb_size;
 
-        // reset or move to get more space.
-        if (!nb_exists_bytes) {
+        // realloc, reset or move to get more space.
+        if (nb_size != nb_buffer) {
+            resize(nb_size);
+        } else if (!nb_exists_bytes) {
             // reset when buffer is empty.
             p = end = buffer;
             srs_verbose("all consumed, reset fast buffer");
@@ -197,6 +212,7 @@ int SrsFastBuffer::grow(ISrsBufferReader* reader, int required_size)
         
         // we just move the ptr to next.
         srs_assert((int)nread > 0);
+        on_read((int)nread, nb_free_space);
         end += nread;
         nb_free_space -= nread;
     }
@@ -204,6 +220,82 @@ int SrsFastBuffer::grow(ISrsBufferReader* reader, int required_size)
     return ret;
 }
 
+int SrsFastBuffer::read_fully(ISrsBufferReader* reader, char* dst, int size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(size >= 0);
+    
+    int nb_exists_bytes = (int)(end - p);
+    
+#ifdef SRS_PERF_ZERO_COPY_RECV
+    // the left bytes is large, consume the buffer then read to dst directly.
+    if (size - nb_exists_bytes >= SRS_PERF_ZERO_COPY_RECV_MIN) {
+        memcpy(dst, p, nb_exists_bytes);
+        
+        // all consumed, reset the buffer for next grow.
+        p = end = buffer;
+        
+        int nb_read = nb_exists_bytes;
+        while (nb_read < size) {
+            ssize_t nread;
+            if ((ret = reader->read(dst + nb_read, size - nb_read, &nread)) != ERROR_SUCCESS) {
+                return ret;
+            }
+            
+#ifdef SRS_PERF_MERGED_READ
+            if (merged_read && _handler) {
+                _handler->on_read(nread);
+            }
+#endif
+            
+            srs_assert((int)nread > 0);
+            nb_read += (int)nread;
+        }
+        
+        return ret;
+    }
+#endif
+    
+    if ((ret = grow(reader, size)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    memcpy(dst, read_slice(size), size);
+    
+    return ret;
+}
+
+void SrsFastBuffer::resize(int size)
+{
+    int nb_exists_bytes = (int)(end - p);
+    srs_assert(nb_exists_bytes <= size);
+    
+    char* buf = srs_pool_alloc(size);
+    memcpy(buf, p, nb_exists_bytes);
+    srs_pool_freepa(buffer);
+    
+    buffer = buf;
+    nb_buffer = size;
+    p = buffer;
+    end = p + nb_exists_bytes;
+}
+
+void SrsFastBuffer::on_read(int nread, int nb_free_space)
+{
+    // the small read, for instance, the control messages of play client.
+    if (nread < nb_buffer / 4) {
+        nb_idle_reads++;
+        return;
+    }
+    nb_idle_reads = 0;
+    
+    // more bytes maybe in socket when the large read fill the free space,
+    // double the buffer when move bytes.
+    if (nread >= nb_free_space) {
+        nb_grow_buffer = srs_max(nb_grow_buffer, srs_min(nb_buffer * 2, nb_max_buffer));
+    }
+}
+
 #ifdef SRS_PERF_MERGED_READ
 void SrsFastBuffer::set_merge_read(bool v, IMergeReadHandler* handler)
 {
@@ -65,6 +65,9 @@ public:
 *       fb->grow(r, 1024);
 *       char* header = fb->read_slice(100);
 *       char* payload = fb->read_payload(924);
+* @remark the buffer start small and grow to the max size on demand,
+*       shrink when idle, for the play client only send small messages.
+* @see SRS_PERF_RECV_BUFFER_MIN
 */
 // TODO: FIXME: add utest for it.
 class SrsFastBuffer
@@ -82,11 +85,17 @@ private:
     char* p;
     // ptr to the content end.
     char* end;
-    // ptr to the buffer.
+    // ptr to the buffer, alloc from memory pool.
     //      buffer <= p <= end <= buffer+nb_buffer
     char* buffer;
     // the size of buffer.
     int nb_buffer;
+    // the max size of buffer to grow to, set by set_buffer().
+    int nb_max_buffer;
+    // the size to grow to when move bytes, when read fill the free space.
+    int nb_grow_buffer;
+    // the continuous small reads, shrink the buffer when idle.
+    int nb_idle_reads;
 public:
     SrsFastBuffer();
     virtual ~SrsFastBuffer();
@@ -102,7 +111,11 @@ public:
     */
     virtual char* bytes();
     /**
-    * create buffer with specifeid size.
+    * get the size of buffer, the memory used by buffer.
+    */
+    virtual int capacity();
+    /**
+    * set the max size of buffer, the buffer grow to it on demand.
     * @param buffer the size of buffer. ignore when smaller than SRS_MAX_SOCKET_BUFFER.
     * @remark when MR(SRS_PERF_MERGED_READ) disabled, always set to 8K.
     * @remark when buffer changed, the previous ptr maybe invalid.
@@ -139,6 +152,25 @@ public:
     * @remark, we actually maybe read more than required_size, maybe 4k for example.
     */
     virtual int grow(ISrsBufferReader* reader, int required_size);
+    /**
+    * read size of bytes to dst, consume the bytes in buffer first.
+    * when the left bytes is large, read from skt to dst directly,
+    * to avoid copying the large chunk payload to buffer then to dst.
+    * @param reader, read more bytes from reader when buffer is not enough.
+    * @param dst, the bytes to fill, user must ensure it's large enough.
+    * @param size, the size of bytes to read.
+    */
+    virtual int read_fully(ISrsBufferReader* reader, char* dst, int size);
+private:
+    /**
+    * realloc the buffer to size and move the bytes to start of buffer.
+    */
+    virtual void resize(int size);
+    /**
+    * update the grow and idle state by the bytes read.
+    * @param nb_free_space the free space to read to.
+    */
+    virtual void on_read(int nread, int nb_free_space);
 public:
 #ifdef SRS_PERF_MERGED_READ
     /**
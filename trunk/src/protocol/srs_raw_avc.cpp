@@ -32,6 +32,7 @@ using namespace std;
 #include <srs_kernel_utility.hpp>
 #include <srs_core_autofree.hpp>
 #include <srs_kernel_codec.hpp>
+#include <srs_kernel_ts.hpp>
 
 SrsRawH264Stream::SrsRawH264Stream()
 {
@@ -59,13 +60,7 @@ int SrsRawH264Stream::annexb_demux(SrsStream* stream, char** pframe, int* pnb_fr
         
         // find the last frame prefixed by annexb format.
         stream->skip(pnb_start_code);
-
-        while (!stream->empty()) {
-            if (srs_avc_startswith_annexb(stream, NULL)) {
-                break;
-            }
-            stream->skip(1);
-        }
+        stream->skip(srs_avc_find_annexb(stream->data() + stream->pos(), stream->size() - stream->pos(), NULL));
 
         if (stream->empty())
             *is_end = true;
@@ -591,3 +586,255 @@ int SrsRawAacStream::mux_aac2flv(char* frame, int nb_frame, SrsRawAacStreamCodec
     return ret;
 }
 
+ISrsTsRtmpHandler::ISrsTsRtmpHandler()
+{
+}
+
+ISrsTsRtmpHandler::~ISrsTsRtmpHandler()
+{
+}
+
+SrsTsRtmpMuxer::SrsTsRtmpMuxer(ISrsTsRtmpHandler* h)
+{
+    handler = h;
+    
+    avc = new SrsRawH264Stream();
+    aac = new SrsRawAacStream();
+    h264_sps_changed = false;
+    h264_pps_changed = false;
+    h264_sps_pps_sent = false;
+}
+
+SrsTsRtmpMuxer::~SrsTsRtmpMuxer()
+{
+    srs_freep(avc);
+    srs_freep(aac);
+}
+
+void SrsTsRtmpMuxer::reset()
+{
+    h264_sps = h264_pps = aac_specific_config = "";
+    h264_sps_changed = h264_pps_changed = h264_sps_pps_sent = false;
+}
+
+int SrsTsRtmpMuxer::on_ts_video(SrsTsMessage* msg, SrsStream* avs)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // ts tbn to flv tbn.
+    u_int32_t dts = (u_int32_t)(msg->dts / 90);
+    u_int32_t pts = (u_int32_t)(msg->pts / 90);
+    
+    // group all nalus of pes to a flv frame.
+    std::string ibps;
+    SrsCodecVideoAVCFrame frame_type = SrsCodecVideoAVCFrameInterFrame;
+    
+    while (!avs->empty()) {
+        char* frame = NULL;
+        int frame_size = 0;
+        bool is_end = false;
+        if ((ret = avc->annexb_demux(avs, &frame, &frame_size, &is_end)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        
+        // 5bits, 7.3.1 NAL unit syntax,
+        // H.264-AVC-ISO_IEC_14496-10.pdf, page 44.
+        //  7: SPS, 8: PPS, 5: I Frame, 1: P Frame
+        SrsAvcNaluType nal_unit_type = (SrsAvcNaluType)(frame[0] & 0x1f);
+        
+        if (nal_unit_type == SrsAvcNaluTypeIDR) {
+            frame_type = SrsCodecVideoAVCFrameKeyFrame;
+        }
+        
+        // ignore the nalu type aud(9)
+        if (nal_unit_type == SrsAvcNaluTypeAccessUnitDelimiter) {
+            continue;
+        }
+        
+        if (avc->is_sps(frame, frame_size)) {
+            std::string sps;
+            if ((ret = avc->sps_demux(frame, frame_size, sps)) != ERROR_SUCCESS) {
+                return ret;
+            }
+            if (h264_sps != sps) {
+                h264_sps_changed = true;
+                h264_sps = sps;
+            }
+            continue;
+        }
+        
+        if (avc->is_pps(frame, frame_size)) {
+            std::string pps;
+            if ((ret = avc->pps_demux(frame, frame_size, pps)) != ERROR_SUCCESS) {
+                return ret;
+            }
+            if (h264_pps != pps) {
+                h264_pps_changed = true;
+                h264_pps = pps;
+            }
+            continue;
+        }
+        
+        std::string ibp;
+        if ((ret = avc->mux_sei_ipb_frame(frame, frame_size, ibp)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        ibps.append(ibp);
+    }
+    
+    if ((ret = write_h264_sps_pps(dts, pts)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if ((ret = write_h264_ipb_frame(ibps, frame_type, dts, pts)) != ERROR_SUCCESS) {
+        // drop the ts message.
+        if (ret == ERROR_H264_DROP_BEFORE_SPS_PPS) {
+            return ERROR_SUCCESS;
+        }
+        return ret;
+    }
+    
+    return ret;
+}
+
+int SrsTsRtmpMuxer::on_ts_audio(SrsTsMessage* msg, SrsStream* avs, int64_t next_dts)
+{
+    // ts tbn to flv tbn.
+    u_int32_t dts = (u_int32_t)(msg->dts / 90);
+    
+    // the duration of the pes, to calc the dts of each aac frame.
+    u_int32_t duration = (u_int32_t)(srs_max(0, next_dts - msg->dts) / 90);
+    
+    return on_aac_frames(avs, dts, duration);
+}
+
+int SrsTsRtmpMuxer::on_aac_frames(SrsStream* avs, u_int32_t dts, u_int32_t duration)
+{
+    int ret = ERROR_SUCCESS;
+    
+    u_int32_t max_dts = dts + duration;
+    
+    while (!avs->empty()) {
+        char* frame = NULL;
+        int frame_size = 0;
+        SrsRawAacStreamCodec codec;
+        if ((ret = aac->adts_demux(avs, &frame, &frame_size, codec)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        
+        // ignore invalid frame,
+        //  * atleast 1bytes for aac to decode the data.
+        if (frame_size <= 0) {
+            continue;
+        }
+        srs_info("ts: demux aac frame size=%d, dts=%d", frame_size, dts);
+        
+        // generate sh.
+        if (aac_specific_config.empty()) {
+            std::string sh;
+            if ((ret = aac->mux_sequence_header(&codec, sh)) != ERROR_SUCCESS) {
+                return ret;
+            }
+            aac_specific_config = sh;
+            
+            codec.aac_packet_type = 0;
+            
+            if ((ret = write_audio_raw_frame((char*)sh.data(), (int)sh.length(), &codec, dts)) != ERROR_SUCCESS) {
+                return ret;
+            }
+        }
+        
+        // audio raw data.
+        codec.aac_packet_type = 1;
+        if ((ret = write_audio_raw_frame(frame, frame_size, &codec, dts)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        
+        // calc the delta of dts, when previous frame output.
+        u_int32_t delta = duration / (avs->size() / frame_size);
+        dts = (u_int32_t)(srs_min(max_dts, dts + delta));
+    }
+    
+    return ret;
+}
+
+int SrsTsRtmpMuxer::write_h264_sps_pps(u_int32_t dts, u_int32_t pts)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // when sps or pps changed, update the sequence header,
+    // for the pps maybe not changed while sps changed.
+    if (h264_sps_pps_sent && !h264_sps_changed && !h264_pps_changed) {
+        return ret;
+    }
+    
+    // when not got sps/pps, wait.
+    if (h264_pps.empty() || h264_sps.empty()) {
+        return ret;
+    }
+    
+    std::string sh;
+    if ((ret = avc->mux_sequence_header(h264_sps, h264_pps, dts, pts, sh)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    int8_t frame_type = SrsCodecVideoAVCFrameKeyFrame;
+    int8_t avc_packet_type = SrsCodecVideoAVCTypeSequenceHeader;
+    char* flv = NULL;
+    int nb_flv = 0;
+    if ((ret = avc->mux_avc2flv(sh, frame_type, avc_packet_type, dts, pts, &flv, &nb_flv)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // the timestamp in rtmp message header is dts.
+    if ((ret = handler->on_rtmp_packet(SrsCodecFlvTagVideo, dts, flv, nb_flv)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    h264_sps_changed = false;
+    h264_pps_changed = false;
+    h264_sps_pps_sent = true;
+    srs_trace("ts: h264 sps/pps sent, sps=%dB, pps=%dB", (int)h264_sps.length(), (int)h264_pps.length());
+    
+    return ret;
+}
+
+int SrsTsRtmpMuxer::write_h264_ipb_frame(string ibps, SrsCodecVideoAVCFrame frame_type, u_int32_t dts, u_int32_t pts)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // when sps or pps not sent, ignore the packet.
+    // @see https://github.com/ossrs/srs/issues/203
+    if (!h264_sps_pps_sent) {
+        return ERROR_H264_DROP_BEFORE_SPS_PPS;
+    }
+    
+    // ignore the frame without any nalu.
+    if (ibps.empty()) {
+        return ret;
+    }
+    
+    int8_t avc_packet_type = SrsCodecVideoAVCTypeNALU;
+    char* flv = NULL;
+    int nb_flv = 0;
+    if ((ret = avc->mux_avc2flv(ibps, frame_type, avc_packet_type, dts, pts, &flv, &nb_flv)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // the timestamp in rtmp message header is dts.
+    return handler->on_rtmp_packet(SrsCodecFlvTagVideo, dts, flv, nb_flv);
+}
+
+int SrsTsRtmpMuxer::write_audio_raw_frame(char* frame, int frame_size, SrsRawAacStreamCodec* codec, u_int32_t dts)
+{
+    int ret = ERROR_SUCCESS;
+    
+    char* data = NULL;
+    int size = 0;
+    if ((ret = aac->mux_aac2flv(frame, frame_size, codec, dts, &data, &size)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return handler->on_rtmp_packet(SrsCodecFlvTagAudio, dts, data, size);
+}
+
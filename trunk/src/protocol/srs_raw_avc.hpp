@@ -35,6 +35,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <srs_kernel_codec.hpp>
 
 class SrsStream;
+class SrsTsMessage;
 
 /**
 * the raw h.264 stream, in annexb.
@@ -143,4 +144,70 @@ public:
     virtual int mux_aac2flv(char* frame, int nb_frame, SrsRawAacStreamCodec* codec, u_int32_t dts, char** flv, int* nb_flv);
 };
 
+/**
+* the handler for ts to rtmp muxer, to write the muxed flv packet.
+*/
+class ISrsTsRtmpHandler
+{
+public:
+    ISrsTsRtmpHandler();
+    virtual ~ISrsTsRtmpHandler();
+public:
+    /**
+    * write the flv packet, the handler owns the data.
+    * @param type the flv tag type, SrsCodecFlvTagAudio or SrsCodecFlvTagVideo.
+    * @param timestamp the dts in ms.
+    */
+    virtual int on_rtmp_packet(char type, u_int32_t timestamp, char* data, int size) = 0;
+};
+
+/**
+* mux the h.264 and aac ts messages to flv packets,
+* used by the mpegts caster and the hls ingester.
+*/
+class SrsTsRtmpMuxer
+{
+private:
+    ISrsTsRtmpHandler* handler;
+private:
+    SrsRawH264Stream* avc;
+    std::string h264_sps;
+    bool h264_sps_changed;
+    std::string h264_pps;
+    bool h264_pps_changed;
+    bool h264_sps_pps_sent;
+private:
+    SrsRawAacStream* aac;
+    std::string aac_specific_config;
+public:
+    SrsTsRtmpMuxer(ISrsTsRtmpHandler* h);
+    virtual ~SrsTsRtmpMuxer();
+public:
+    /**
+    * reset the sps/pps and aac specific config,
+    * the sequence headers must be sent again for the new source.
+    */
+    virtual void reset();
+    /**
+    * mux the nalus of video ts message to a flv frame.
+    * @remark the frames before the sps/pps are dropped.
+    */
+    virtual int on_ts_video(SrsTsMessage* msg, SrsStream* avs);
+    /**
+    * mux the adts frames of audio ts message to flv packets.
+    * @param next_dts the dts of next message, to calc the dts of each aac frame.
+    */
+    virtual int on_ts_audio(SrsTsMessage* msg, SrsStream* avs, int64_t next_dts);
+    /**
+    * mux the adts frames to flv packets, spread in duration from dts.
+    * @param dts the dts of the first frame in ms.
+    * @param duration the duration of all frames in ms.
+    */
+    virtual int on_aac_frames(SrsStream* avs, u_int32_t dts, u_int32_t duration);
+private:
+    virtual int write_h264_sps_pps(u_int32_t dts, u_int32_t pts);
+    virtual int write_h264_ipb_frame(std::string ibps, SrsCodecVideoAVCFrame frame_type, u_int32_t dts, u_int32_t pts);
+    virtual int write_audio_raw_frame(char* frame, int frame_size, SrsRawAacStreamCodec* codec, u_int32_t dts);
+};
+
 #endif
@@ -24,10 +24,12 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <srs_rtmp_handshake.hpp>
 
 #include <time.h>
+#include <unistd.h>
 
 #include <srs_core_autofree.hpp>
 #include <srs_kernel_error.hpp>
 #include <srs_kernel_log.hpp>
+#include <srs_kernel_utility.hpp>
 #include <srs_rtmp_io.hpp>
 #include <srs_rtmp_utility.hpp>
 #include <srs_rtmp_stack.hpp>
@@ -42,6 +44,8 @@ using namespace _srs_internal;
 #include <openssl/hmac.h>
 // for openssl_generate_key
 #include <openssl/dh.h>
+// for the locking of openssl in thread.
+#include <openssl/crypto.h>
 
 namespace _srs_internal
 {
@@ -291,7 +295,7 @@ namespace _srs_internal
         return ret;
     }
     
-    key_block::key_block()
+    key_block::key_block(const char* random)
     {
         offset = (int32_t)rand();
         random0 = NULL;
@@ -303,16 +307,28 @@ namespace _srs_internal
         random0_size = valid_offset;
         if (random0_size > 0) {
             random0 = new char[random0_size];
-            srs_random_generate(random0, random0_size);
+            if (random) {
+                memcpy(random0, random, random0_size);
+            } else {
+                srs_random_generate(random0, random0_size);
+            }
             snprintf(random0, random0_size, "%s", RTMP_SIG_SRS_HANDSHAKE);
         }
         
-        srs_random_generate(key, sizeof(key));
+        if (random) {
+            memcpy(key, random + random0_size, sizeof(key));
+        } else {
+            srs_random_generate(key, sizeof(key));
+        }
         
         random1_size = 764 - valid_offset - 128 - 4;
         if (random1_size > 0) {
             random1 = new char[random1_size];
-            srs_random_generate(random1, random1_size);
+            if (random) {
+                memcpy(random1, random + random0_size + sizeof(key), random1_size);
+            } else {
+                srs_random_generate(random1, random1_size);
+            }
             snprintf(random1, random1_size, "%s", RTMP_SIG_SRS_HANDSHAKE);
         }
     }
@@ -373,7 +389,7 @@ namespace _srs_internal
         return valid_offset % max_offset_size;
     }
     
-    digest_block::digest_block()
+    digest_block::digest_block(const char* random)
     {
         offset = (int32_t)rand();
         random0 = NULL;
@@ -385,16 +401,28 @@ namespace _srs_internal
         random0_size = valid_offset;
         if (random0_size > 0) {
             random0 = new char[random0_size];
-            srs_random_generate(random0, random0_size);
+            if (random) {
+                memcpy(random0, random, random0_size);
+            } else {
+                srs_random_generate(random0, random0_size);
+            }
             snprintf(random0, random0_size, "%s", RTMP_SIG_SRS_HANDSHAKE);
         }
         
-        srs_random_generate(digest, sizeof(digest));
+        if (random) {
+            memcpy(digest, random + random0_size, sizeof(digest));
+        } else {
+            srs_random_generate(digest, sizeof(digest));
+        }
         
         random1_size = 764 - 4 - valid_offset - 32;
         if (random1_size > 0) {
             random1 = new char[random1_size];
-            srs_random_generate(random1, random1_size);
+            if (random) {
+                memcpy(random1, random + random0_size + sizeof(digest), random1_size);
+            } else {
+                srs_random_generate(random1, random1_size);
+            }
             snprintf(random1, random1_size, "%s", RTMP_SIG_SRS_HANDSHAKE);
         }
     }
@@ -450,7 +478,8 @@ namespace _srs_internal
         return valid_offset % max_offset_size;
     }
     
-    c1s1_strategy::c1s1_strategy()
+    c1s1_strategy::c1s1_strategy(const char* random)
+        : key(random), digest(random? random + 760 : NULL)
     {
     }
     
@@ -513,21 +542,25 @@ namespace _srs_internal
         return ret;
     }
     
-    int c1s1_strategy::s1_create(c1s1* owner, c1s1* c1)
+    int c1s1_strategy::s1_create(c1s1* owner, c1s1* c1, SrsDH* dh)
     {
         int ret = ERROR_SUCCESS;
 
-        SrsDH dh;
-        
-        // ensure generate 128bytes public key.
-        if ((ret = dh.initialize(true)) != ERROR_SUCCESS) {
-            return ret;
+        // generate in place when no precomputed keypair.
+        SrsDH local;
+        if (!dh) {
+            dh = &local;
+            
+            // ensure generate 128bytes public key.
+            if ((ret = dh->initialize(true)) != ERROR_SUCCESS) {
+                return ret;
+            }
         }
         
         // directly generate the public key.
         // @see: https://github.com/ossrs/srs/issues/148
         int pkey_size = 128;
-        if ((ret = dh.copy_shared_key(c1->get_key(), 128, key.key, pkey_size)) != ERROR_SUCCESS) {
+        if ((ret = dh->copy_shared_key(c1->get_key(), 128, key.key, pkey_size)) != ERROR_SUCCESS) {
             srs_error("calc s1 key failed. ret=%d", ret);
             return ret;
         }
@@ -691,7 +724,8 @@ namespace _srs_internal
         }
     }
     
-    c1s1_strategy_schema0::c1s1_strategy_schema0()
+    c1s1_strategy_schema0::c1s1_strategy_schema0(const char* random)
+        : c1s1_strategy(random)
     {
     }
     
@@ -760,7 +794,8 @@ namespace _srs_internal
         return ret;
     }
     
-    c1s1_strategy_schema1::c1s1_strategy_schema1()
+    c1s1_strategy_schema1::c1s1_strategy_schema1(const char* random)
+        : c1s1_strategy(random)
     {
     }
     
@@ -926,7 +961,7 @@ namespace _srs_internal
         return payload->c1_validate_digest(this, is_valid);
     }
     
-    int c1s1::s1_create(c1s1* c1)
+    int c1s1::s1_create(c1s1* c1, SrsHandshakeKey* key)
     {
         int ret = ERROR_SUCCESS;
         
@@ -940,13 +975,14 @@ namespace _srs_internal
         version = 0x01000504; // server s1 version
         
         srs_freep(payload);
+        const char* random = key? key->s1_random : NULL;
         if (c1->schema() == srs_schema0) {
-            payload = new c1s1_strategy_schema0();
+            payload = new c1s1_strategy_schema0(random);
         } else {
-            payload = new c1s1_strategy_schema1();
+            payload = new c1s1_strategy_schema1(random);
         }
         
-        return payload->s1_create(this, c1);
+        return payload->s1_create(this, c1, key? key->dh : NULL);
     }
     
     int c1s1::s1_validate_digest(bool& is_valid)
@@ -956,15 +992,19 @@ namespace _srs_internal
         return payload->s1_validate_digest(this, is_valid);
     }
     
-    c2s2::c2s2()
+    c2s2::c2s2(const char* _random)
     {
-        srs_random_generate(random, 1504);
+        if (_random) {
+            memcpy(random, _random, 1504);
+            memcpy(digest, _random + 1504, 32);
+        } else {
+            srs_random_generate(random, 1504);
+            srs_random_generate(digest, 32);
+        }
         
         int size = snprintf(random, 1504, "%s", RTMP_SIG_SRS_HANDSHAKE);
         srs_assert(++size < 1504);
         snprintf(random + 1504 - size, size, "%s", RTMP_SIG_SRS_HANDSHAKE);
-        
-        srs_random_generate(digest, 32);
     }
     
     c2s2::~c2s2()
@@ -1084,6 +1124,47 @@ namespace _srs_internal
         
         return ret;
     }
+    
+    SrsHandshakeKey::SrsHandshakeKey()
+    {
+        dh = NULL;
+    }
+    
+    SrsHandshakeKey::~SrsHandshakeKey()
+    {
+        srs_freep(dh);
+    }
+    
+    int SrsHandshakeKey::initialize()
+    {
+        int ret = ERROR_SUCCESS;
+        
+        // ensure generate 128bytes public key,
+        // the SrsDH.initialize(true) logs when regenerate, so we check it here.
+        for (;;) {
+            srs_freep(dh);
+            dh = new SrsDH();
+            
+            if ((ret = dh->initialize(false)) != ERROR_SUCCESS) {
+                return ret;
+            }
+            
+            char pkey[128];
+            int32_t pkey_size = 128;
+            if ((ret = dh->copy_public_key(pkey, pkey_size)) != ERROR_SUCCESS) {
+                return ret;
+            }
+            
+            if (pkey_size == 128) {
+                break;
+            }
+        }
+        
+        srs_random_generate(s1_random, sizeof(s1_random));
+        srs_random_generate(s2_random, sizeof(s2_random));
+        
+        return ret;
+    }
 }
 
 #endif
@@ -1232,9 +1313,14 @@ int SrsComplexHandshake::handshake_with_client(SrsHandshakeBytes* hs_bytes, ISrs
     }
     srs_verbose("decode c1 success.");
     
+    // take the precomputed dh keypair and random of s1s2,
+    // generate in place when pool is empty.
+    SrsHandshakeKey* key = SrsHandshakeKeyPool::instance()->take();
+    SrsAutoFree(SrsHandshakeKey, key);
+    
     // encode s1
     c1s1 s1;
-    if ((ret = s1.s1_create(&c1)) != ERROR_SUCCESS) {
+    if ((ret = s1.s1_create(&c1, key)) != ERROR_SUCCESS) {
         srs_error("create s1 from c1 failed. ret=%d", ret);
         return ret;
     }
@@ -1247,7 +1333,7 @@ int SrsComplexHandshake::handshake_with_client(SrsHandshakeBytes* hs_bytes, ISrs
     }
     srs_verbose("verify s1 success.");
     
-    c2s2 s2;
+    c2s2 s2(key? key->s2_random : NULL);
     if ((ret = s2.s2_create(&c1)) != ERROR_SUCCESS) {
         srs_error("create s2 from c1 failed. ret=%d", ret);
         return ret;
@@ -1384,4 +1470,309 @@ int SrsComplexHandshake::handshake_with_server(SrsHandshakeBytes* hs_bytes, ISrs
 }
 #endif
 
+// the interval in ms to sample the rate of handshakes.
+#define SRS_HANDSHAKE_RATE_SAMPLE_MS 10000
+// the sleep in us when thread failed to generate key.
+#define SRS_HANDSHAKE_KEY_ERROR_SLEEP_US 100000
+
+#ifdef SRS_AUTO_SSL
+// the locks of openssl 1.0.x, for the thread of key pool
+// generate keys while st compute the shared key.
+static pthread_mutex_t* _srs_openssl_locks = NULL;
+
+static void srs_openssl_locking(int mode, int n, const char* /*file*/, int /*line*/)
+{
+    if (mode & CRYPTO_LOCK) {
+        pthread_mutex_lock(&_srs_openssl_locks[n]);
+    } else {
+        pthread_mutex_unlock(&_srs_openssl_locks[n]);
+    }
+}
+
+static void srs_openssl_thread_setup()
+{
+    // ignore when user already setup the locks.
+    if (CRYPTO_get_locking_callback() != NULL) {
+        return;
+    }
+    
+    int nb_locks = CRYPTO_num_locks();
+    _srs_openssl_locks = new pthread_mutex_t[nb_locks];
+    for (int i = 0; i < nb_locks; i++) {
+        pthread_mutex_init(&_srs_openssl_locks[i], NULL);
+    }
+    
+    // the default thread id of openssl 1.0.x is the address of errno,
+    // which is unique for each thread, so we only set the locking callback.
+    CRYPTO_set_locking_callback(srs_openssl_locking);
+}
+#endif
+
+SrsHandshakeKeyPool* SrsHandshakeKeyPool::_instance = NULL;
+
+SrsHandshakeKeyPool::SrsHandshakeKeyPool()
+{
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&cond, NULL);
+    max_keys = 0;
+    quit = false;
+    started = false;
+    nb_generated = nb_errors = 0;
+    nb_simple = nb_complex = 0;
+    nb_hits = nb_misses = 0;
+    sample_time = 0;
+    sample_handshakes = 0;
+    _rate = _peak_rate = 0;
+}
+
+SrsHandshakeKeyPool::~SrsHandshakeKeyPool()
+{
+    stop();
+    
+    pthread_mutex_destroy(&lock);
+    pthread_cond_destroy(&cond);
+}
+
+SrsHandshakeKeyPool* SrsHandshakeKeyPool::instance()
+{
+    if (!_instance) {
+        _instance = new SrsHandshakeKeyPool();
+    }
+    return _instance;
+}
+
+#ifndef SRS_AUTO_SSL
+int SrsHandshakeKeyPool::start(int /*nb_keys*/)
+{
+    srs_trace("ignore the handshake key pool for ssl disabled.");
+    return ERROR_SUCCESS;
+}
+
+void SrsHandshakeKeyPool::stop()
+{
+}
+
+_srs_internal::SrsHandshakeKey* SrsHandshakeKeyPool::take()
+{
+    return NULL;
+}
+
+void SrsHandshakeKeyPool::cycle()
+{
+}
+#else
+int SrsHandshakeKeyPool::start(int nb_keys)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (started || nb_keys <= 0) {
+        return ret;
+    }
+    
+    srs_openssl_thread_setup();
+    
+    // initialize the random in st, for it logs.
+    char random[1];
+    srs_random_generate(random, sizeof(random));
+    
+    max_keys = nb_keys;
+    quit = false;
+    
+    if (pthread_create(&tid, NULL, SrsHandshakeKeyPool::pool_fn, this) != 0) {
+        ret = ERROR_SYSTEM_CREATE_THREAD;
+        srs_error("create handshake key thread failed. ret=%d", ret);
+        return ret;
+    }
+    started = true;
+    
+    srs_trace("handshake key pool started, max=%d", max_keys);
+    
+    return ret;
+}
+
+void SrsHandshakeKeyPool::stop()
+{
+    if (!started) {
+        return;
+    }
+    
+    pthread_mutex_lock(&lock);
+    quit = true;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&lock);
+    
+    pthread_join(tid, NULL);
+    started = false;
+    
+    std::deque<SrsHandshakeKey*>::iterator it;
+    for (it = keys.begin(); it != keys.end(); ++it) {
+        SrsHandshakeKey* key = *it;
+        srs_freep(key);
+    }
+    keys.clear();
+}
+
+SrsHandshakeKey* SrsHandshakeKeyPool::take()
+{
+    SrsHandshakeKey* key = NULL;
+    
+    if (started) {
+        pthread_mutex_lock(&lock);
+        if (!keys.empty()) {
+            key = keys.front();
+            keys.pop_front();
+            // wakeup the thread to generate more.
+            pthread_cond_signal(&cond);
+        }
+        pthread_mutex_unlock(&lock);
+    }
+    
+    if (key) {
+        nb_hits++;
+    } else {
+        nb_misses++;
+    }
+    
+    return key;
+}
+
+void SrsHandshakeKeyPool::cycle()
+{
+    for (;;) {
+        pthread_mutex_lock(&lock);
+        while (!quit && (int)keys.size() >= max_keys) {
+            pthread_cond_wait(&cond, &lock);
+        }
+        bool should_quit = quit;
+        pthread_mutex_unlock(&lock);
+        
+        if (should_quit) {
+            break;
+        }
+        
+        // generate the key without lock, for it's expensive.
+        SrsHandshakeKey* key = new SrsHandshakeKey();
+        if (key->initialize() != ERROR_SUCCESS) {
+            srs_freep(key);
+            
+            pthread_mutex_lock(&lock);
+            nb_errors++;
+            pthread_mutex_unlock(&lock);
+            
+            usleep(SRS_HANDSHAKE_KEY_ERROR_SLEEP_US);
+            continue;
+        }
+        
+        pthread_mutex_lock(&lock);
+        keys.push_back(key);
+        nb_generated++;
+        pthread_mutex_unlock(&lock);
+    }
+}
+#endif
+
+void SrsHandshakeKeyPool::on_handshake(bool complex)
+{
+    if (complex) {
+        nb_complex++;
+    } else {
+        nb_simple++;
+    }
+    
+    int64_t now = srs_get_system_time_ms();
+    if (sample_time <= 0) {
+        sample_time = now;
+    }
+    sample_handshakes++;
+    
+    int64_t elapsed = now - sample_time;
+    if (elapsed < SRS_HANDSHAKE_RATE_SAMPLE_MS) {
+        return;
+    }
+    
+    _rate = sample_handshakes * 1000.0 / elapsed;
+    _peak_rate = srs_max(_peak_rate, _rate);
+    
+    sample_time = now;
+    sample_handshakes = 0;
+}
+
+bool SrsHandshakeKeyPool::enabled()
+{
+    return started;
+}
+
+int SrsHandshakeKeyPool::capacity()
+{
+    return max_keys;
+}
+
+int SrsHandshakeKeyPool::size()
+{
+    pthread_mutex_lock(&lock);
+    int nb_keys = (int)keys.size();
+    pthread_mutex_unlock(&lock);
+    
+    return nb_keys;
+}
+
+int64_t SrsHandshakeKeyPool::generated()
+{
+    pthread_mutex_lock(&lock);
+    int64_t v = nb_generated;
+    pthread_mutex_unlock(&lock);
+    
+    return v;
+}
+
+int64_t SrsHandshakeKeyPool::errors()
+{
+    pthread_mutex_lock(&lock);
+    int64_t v = nb_errors;
+    pthread_mutex_unlock(&lock);
+    
+    return v;
+}
+
+int64_t SrsHandshakeKeyPool::simples()
+{
+    return nb_simple;
+}
+
+int64_t SrsHandshakeKeyPool::complexes()
+{
+    return nb_complex;
+}
+
+int64_t SrsHandshakeKeyPool::hits()
+{
+    return nb_hits;
+}
+
+int64_t SrsHandshakeKeyPool::misses()
+{
+    return nb_misses;
+}
+
+double SrsHandshakeKeyPool::rate()
+{
+    // the rate decay to 0 when no handshakes in sample.
+    int64_t elapsed = srs_get_system_time_ms() - sample_time;
+    if (sample_time > 0 && elapsed >= 2 * SRS_HANDSHAKE_RATE_SAMPLE_MS) {
+        return sample_handshakes * 1000.0 / elapsed;
+    }
+    return _rate;
+}
+
+double SrsHandshakeKeyPool::peak_rate()
+{
+    return _peak_rate;
+}
+
+void* SrsHandshakeKeyPool::pool_fn(void* arg)
+{
+    SrsHandshakeKeyPool* pool = (SrsHandshakeKeyPool*)arg;
+    pool->cycle();
+    return NULL;
+}
 
@@ -30,11 +30,19 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include <srs_core.hpp>
 
+#include <pthread.h>
+#include <deque>
+
 class ISrsProtocolReaderWriter;
 class SrsComplexHandshake;
 class SrsHandshakeBytes;
 class SrsStream;
 
+namespace _srs_internal
+{
+    class SrsHandshakeKey;
+}
+
 #ifdef SRS_AUTO_SSL
 
 // for openssl.
@@ -133,7 +141,10 @@ namespace _srs_internal
         // 4bytes
         int32_t offset;
     public:
-        key_block();
+        /**
+        * @param random the 760bytes random to fill the block, NULL to generate.
+        */
+        key_block(const char* random = NULL);
         virtual ~key_block();
     public:
         // parse key block from c1s1.
@@ -171,7 +182,10 @@ namespace _srs_internal
         char* random1;
         int random1_size;
     public:
-        digest_block();
+        /**
+        * @param random the 760bytes random to fill the block, NULL to generate.
+        */
+        digest_block(const char* random = NULL);
         virtual ~digest_block();
     public:
         // parse digest block from c1s1.
@@ -197,7 +211,10 @@ namespace _srs_internal
         key_block key;
         digest_block digest;
     public:
-        c1s1_strategy();
+        /**
+        * @param random the 1520bytes random to fill the key and digest, NULL to generate.
+        */
+        c1s1_strategy(const char* random = NULL);
         virtual ~c1s1_strategy();
     public:
         /**
@@ -269,8 +286,9 @@ namespace _srs_internal
         *       s1-digest-data = HMACsha256(c1s1-joined, FMSKey, 36)
         *       copy s1-digest-data and s1-key-data to s1.
         * @param c1, to get the peer_pub_key of client.
+        * @param dh, the precomputed dh keypair, NULL to generate.
         */
-        virtual int s1_create(c1s1* owner, c1s1* c1);
+        virtual int s1_create(c1s1* owner, c1s1* c1, SrsDH* dh);
         /**
         * server: validate the parsed s1 schema
         */
@@ -311,7 +329,7 @@ namespace _srs_internal
     class c1s1_strategy_schema0 : public c1s1_strategy
     {
     public:
-        c1s1_strategy_schema0();
+        c1s1_strategy_schema0(const char* random = NULL);
         virtual ~c1s1_strategy_schema0();
     public:
         virtual srs_schema_type schema();
@@ -328,7 +346,7 @@ namespace _srs_internal
     class c1s1_strategy_schema1 : public c1s1_strategy
     {
     public:
-        c1s1_strategy_schema1();
+        c1s1_strategy_schema1(const char* random = NULL);
         virtual ~c1s1_strategy_schema1();
     public:
         virtual srs_schema_type schema();
@@ -435,8 +453,9 @@ namespace _srs_internal
         *       get c1s1-joined by specified schema
         *       s1-digest-data = HMACsha256(c1s1-joined, FMSKey, 36)
         *       copy s1-digest-data and s1-key-data to s1.
+        * @param key, the precomputed dh keypair and random, NULL to generate.
         */
-        virtual int s1_create(c1s1* c1);
+        virtual int s1_create(c1s1* c1, SrsHandshakeKey* key);
         /**
         * server: validate the parsed s1 schema
         */
@@ -455,7 +474,10 @@ namespace _srs_internal
         char random[1504];
         char digest[32];
     public:
-        c2s2();
+        /**
+        * @param _random the 1536bytes random to fill the c2s2, NULL to generate.
+        */
+        c2s2(const char* _random = NULL);
         virtual ~c2s2();
     public:
         /**
@@ -499,6 +521,30 @@ namespace _srs_internal
         */
         virtual int s2_validate(c1s1* c1, bool& is_valid);
     };
+    
+    /**
+    * the precomputed key of server complex handshake,
+    * generated by the thread of key pool, used by s1 and s2 once.
+    */
+    class SrsHandshakeKey
+    {
+    public:
+        // the dh keypair, the public key always 128bytes.
+        SrsDH* dh;
+        // the random for the key and digest block of s1, 760bytes each.
+        char s1_random[1520];
+        // the random of s2.
+        char s2_random[1536];
+    public:
+        SrsHandshakeKey();
+        virtual ~SrsHandshakeKey();
+    public:
+        /**
+        * generate the dh keypair and random.
+        * @remark never use st or log, for it's called in thread.
+        */
+        virtual int initialize();
+    };
 }
 
 #endif
@@ -543,4 +589,82 @@ public:
     virtual int handshake_with_server(SrsHandshakeBytes* hs_bytes, ISrsProtocolReaderWriter* io);
 };
 
+/**
+* the pool of precomputed keys for server complex handshake,
+* for the DH_generate_key is expensive and blocks the st event loop,
+* a thread generates the dh keypairs and random of s1s2 in background,
+* and the handshake takes a key from pool in O(1).
+* @remark the key is generated in place when pool is empty or not started.
+* @remark the rate of handshakes is sampled, to size the pool.
+*/
+class SrsHandshakeKeyPool
+{
+private:
+    static SrsHandshakeKeyPool* _instance;
+    SrsHandshakeKeyPool();
+public:
+    virtual ~SrsHandshakeKeyPool();
+public:
+    static SrsHandshakeKeyPool* instance();
+private:
+    pthread_t tid;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    std::deque<_srs_internal::SrsHandshakeKey*> keys;
+    int max_keys;
+    bool quit;
+    bool started;
+    // the keys generated and failed by thread.
+    int64_t nb_generated;
+    int64_t nb_errors;
+private:
+    // the stat in st.
+    int64_t nb_simple;
+    int64_t nb_complex;
+    int64_t nb_hits;
+    int64_t nb_misses;
+    // the handshakes in current sample.
+    int64_t sample_time;
+    int64_t sample_handshakes;
+    // the handshakes per second of last sample, and the peak.
+    double _rate;
+    double _peak_rate;
+public:
+    /**
+    * start the thread to generate keys, must be called after daemon forked.
+    * @param nb_keys the max keys in pool, 0 to disable.
+    * @remark ignore when ssl disabled.
+    */
+    virtual int start(int nb_keys);
+    virtual void stop();
+    /**
+    * take a key from pool, NULL when pool is empty,
+    * user must free the key.
+    */
+    virtual _srs_internal::SrsHandshakeKey* take();
+    /**
+    * when handshake with client done.
+    * @param complex whether complex handshake, otherwise simple.
+    */
+    virtual void on_handshake(bool complex);
+public:
+    virtual bool enabled();
+    virtual int capacity();
+    virtual int size();
+    virtual int64_t generated();
+    virtual int64_t errors();
+    virtual int64_t simples();
+    virtual int64_t complexes();
+    virtual int64_t hits();
+    virtual int64_t misses();
+    /**
+    * the handshakes per second of last sample, and the max of samples.
+    */
+    virtual double rate();
+    virtual double peak_rate();
+private:
+    virtual void cycle();
+    static void* pool_fn(void* arg);
+};
+
 #endif
@@ -147,18 +147,18 @@ int SrsPacket::encode(int& psize, char*& ppayload)
     SrsStream stream;
     
     if (size > 0) {
-        payload = new char[size];
+        payload = srs_pool_alloc(size);
         
         if ((ret = stream.initialize(payload, size)) != ERROR_SUCCESS) {
             srs_error("initialize the stream failed. ret=%d", ret);
-            srs_freepa(payload);
+            srs_pool_freepa(payload);
             return ret;
         }
     }
     
     if ((ret = encode_packet(&stream)) != ERROR_SUCCESS) {
         srs_error("encode the packet failed. ret=%d", ret);
-        srs_freepa(payload);
+        srs_pool_freepa(payload);
         return ret;
     }
     
@@ -353,6 +353,11 @@ int64_t SrsProtocol::get_send_bytes()
     return skt->get_send_bytes();
 }
 
+int SrsProtocol::get_recv_buffer_size()
+{
+    return in_buffer->capacity();
+}
+
 int SrsProtocol::recv_message(SrsCommonMessage** pmsg)
 {
     *pmsg = NULL;
@@ -464,15 +469,27 @@ int SrsProtocol::do_send_messages(SrsSharedPtrMessage** msgs, int nb_msgs)
         char* p = msg->payload;
         char* pend = msg->payload + msg->size;
         
+        // the chunk headers shared by all connections,
+        // NULL to generate the header in the c0c3 cache of connection.
+        SrsSharedChunkHeader* sh = msg->shared_chunk_header();
+        
         // always write the header event payload is empty.
         while (p < pend) {
             // always has header
-            int nb_cache = SRS_CONSTS_C0C3_HEADERS_MAX - c0c3_cache_index;
-            int nbh = msg->chunk_header(c0c3_cache, nb_cache, p == msg->payload);
+            char* header = NULL;
+            int nbh = 0;
+            if (sh) {
+                header = (p == msg->payload)? sh->c0 : sh->c3;
+                nbh = (p == msg->payload)? sh->nb_c0 : sh->nb_c3;
+            } else {
+                int nb_cache = SRS_CONSTS_C0C3_HEADERS_MAX - c0c3_cache_index;
+                nbh = msg->chunk_header(c0c3_cache, nb_cache, p == msg->payload);
+                header = c0c3_cache;
+            }
             srs_assert(nbh > 0);
             
             // header iov
-            iovs[0].iov_base = c0c3_cache;
+            iovs[0].iov_base = header;
             iovs[0].iov_len = nbh;
             
             // payload iov
@@ -500,9 +517,11 @@ int SrsProtocol::do_send_messages(SrsSharedPtrMessage** msgs, int nb_msgs)
             iov_index += 2;
             iovs = out_iovs + iov_index;
 
-            // to next c0c3 header cache
-            c0c3_cache_index += nbh;
-            c0c3_cache = out_c0c3_caches + c0c3_cache_index;
+            // to next c0c3 header cache, the shared header never consume it.
+            if (!sh) {
+                c0c3_cache_index += nbh;
+                c0c3_cache = out_c0c3_caches + c0c3_cache_index;
+            }
             
             // the cache header should never be realloc again,
             // for the ptr is set to iovs, so we just warn user to set larger
@@ -563,6 +582,10 @@ int SrsProtocol::do_send_messages(SrsSharedPtrMessage** msgs, int nb_msgs)
         char* p = msg->payload;
         char* pend = msg->payload + msg->size;
         
+        // the chunk headers shared by all connections,
+        // NULL to generate the header in the c0c3 cache of connection.
+        SrsSharedChunkHeader* sh = msg->shared_chunk_header();
+        
         // always write the header event payload is empty.
         while (p < pend) {
             // for simple send, send each chunk one by one
@@ -571,11 +594,19 @@ int SrsProtocol::do_send_messages(SrsSharedPtrMessage** msgs, int nb_msgs)
             int nb_cache = SRS_CONSTS_C0C3_HEADERS_MAX;
             
             // always has header
-            int nbh = msg->chunk_header(c0c3_cache, nb_cache, p == msg->payload);
+            char* header = NULL;
+            int nbh = 0;
+            if (sh) {
+                header = (p == msg->payload)? sh->c0 : sh->c3;
+                nbh = (p == msg->payload)? sh->nb_c0 : sh->nb_c3;
+            } else {
+                nbh = msg->chunk_header(c0c3_cache, nb_cache, p == msg->payload);
+                header = c0c3_cache;
+            }
             srs_assert(nbh > 0);
             
             // header iov
-            iovs[0].iov_base = c0c3_cache;
+            iovs[0].iov_base = header;
             iovs[0].iov_len = nbh;
             
             // payload iov
@@ -632,7 +663,7 @@ int SrsProtocol::do_send_and_free_packet(SrsPacket* packet, int stream_id)
     header.perfer_cid = packet->get_prefer_cid();
     
     ret = do_simple_send(&header, payload, size);
-    srs_freepa(payload);
+    srs_pool_freepa(payload);
     if (ret == ERROR_SUCCESS) {
         ret = on_send_packet(&header, packet);
     }
@@ -781,7 +812,8 @@ int SrsProtocol::do_decode_message(SrsMessageHeader& header, SrsStream* stream,
             srs_info("decode the AMF0/AMF3 command(pause message).");
             *ppacket = packet = new SrsPausePacket();
             return packet->decode(stream);
-        } else if (command == RTMP_AMF0_COMMAND_ON_STATUS) {
+        } else if (command == RTMP_AMF0_COMMAND_ON_STATUS && (header.is_amf0_command() || header.is_amf3_command())) {
+            // the onStatus data message(NetStream.Data.Start) has no transaction id, ignore it.
             srs_info("decode the AMF0/AMF3 command(onStatus).");
             *ppacket = packet = new SrsOnStatusResPacket();
             return packet->decode(stream);
@@ -864,6 +896,20 @@ int SrsProtocol::send_and_free_message(SrsSharedPtrMessage* msg, int stream_id)
 }
 
 int SrsProtocol::send_and_free_messages(SrsSharedPtrMessage** msgs, int nb_msgs, int stream_id)
+{
+    // donot use the auto free to free the msg,
+    // for performance issue.
+    int ret = send_messages(msgs, nb_msgs, stream_id);
+    
+    for (int i = 0; i < nb_msgs; i++) {
+        SrsSharedPtrMessage* msg = msgs[i];
+        srs_freep(msg);
+    }
+    
+    return ret;
+}
+
+int SrsProtocol::send_messages(SrsSharedPtrMessage** msgs, int nb_msgs, int stream_id)
 {
     // always not NULL msg.
     srs_assert(msgs);
@@ -884,15 +930,8 @@ int SrsProtocol::send_and_free_messages(SrsSharedPtrMessage** msgs, int nb_msgs,
         }
     }
     
-    // donot use the auto free to free the msg,
-    // for performance issue.
     int ret = do_send_messages(msgs, nb_msgs);
     
-    for (int i = 0; i < nb_msgs; i++) {
-        SrsSharedPtrMessage* msg = msgs[i];
-        srs_freep(msg);
-    }
-    
     // donot flush when send failed
     if (ret != ERROR_SUCCESS) {
         return ret;
@@ -1428,14 +1467,13 @@ int SrsProtocol::read_message_payload(SrsChunkStream* chunk, SrsCommonMessage**
         chunk->msg->create_payload(chunk->header.payload_length);
     }
     
-    // read payload to buffer
-    if ((ret = in_buffer->grow(skt, payload_size)) != ERROR_SUCCESS) {
+    // read payload to message, the large payload is read from skt directly.
+    if ((ret = in_buffer->read_fully(skt, chunk->msg->payload + chunk->msg->size, payload_size)) != ERROR_SUCCESS) {
         if (ret != ERROR_SOCKET_TIMEOUT && !srs_is_client_gracefully_close(ret)) {
             srs_error("read payload failed. required_size=%d, ret=%d", payload_size, ret);
         }
         return ret;
     }
-    memcpy(chunk->msg->payload + chunk->msg->size, in_buffer->read_slice(payload_size), payload_size);
     chunk->msg->size += payload_size;
     
     srs_verbose("chunk payload read completed. payload_size=%d", payload_size);
@@ -2517,6 +2555,11 @@ int64_t SrsRtmpServer::get_send_bytes()
     return protocol->get_send_bytes();
 }
 
+int SrsRtmpServer::get_recv_buffer_size()
+{
+    return protocol->get_recv_buffer_size();
+}
+
 int SrsRtmpServer::recv_message(SrsCommonMessage** pmsg)
 {
     return protocol->recv_message(pmsg);
@@ -2537,6 +2580,11 @@ int SrsRtmpServer::send_and_free_messages(SrsSharedPtrMessage** msgs, int nb_msg
     return protocol->send_and_free_messages(msgs, nb_msgs, stream_id);
 }
 
+int SrsRtmpServer::send_messages(SrsSharedPtrMessage** msgs, int nb_msgs, int stream_id)
+{
+    return protocol->send_messages(msgs, nb_msgs, stream_id);
+}
+
 int SrsRtmpServer::send_and_free_packet(SrsPacket* packet, int stream_id)
 {
     return protocol->send_and_free_packet(packet, stream_id);
@@ -2555,9 +2603,11 @@ int SrsRtmpServer::handshake()
             if ((ret = simple_hs.handshake_with_client(hs_bytes, io)) != ERROR_SUCCESS) {
                 return ret;
             }
+            SrsHandshakeKeyPool::instance()->on_handshake(false);
         }
         return ret;
     }
+    SrsHandshakeKeyPool::instance()->on_handshake(true);
     
     srs_freep(hs_bytes);
     
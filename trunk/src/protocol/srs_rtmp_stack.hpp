@@ -155,6 +155,7 @@ public:
      * for example, video and audio will directly set the payload withou memory copy,
      * other packet which need to serialize/encode to bytes by override the
      * get_size and encode_packet.
+     * @remark the payload is alloc from pool, free it by srs_pool_freepa.
      */
     virtual int encode(int& size, char*& payload);
     // decode functions for concrete packet to override.
@@ -331,6 +332,10 @@ public:
     */
     virtual int64_t get_recv_bytes();
     virtual int64_t get_send_bytes();
+    /**
+    * get the size of recv buffer, the memory used by buffer.
+    */
+    virtual int get_recv_buffer_size();
 public:
     /**
     * recv a RTMP message, which is bytes oriented.
@@ -367,6 +372,14 @@ public:
     */
     virtual int send_and_free_messages(SrsSharedPtrMessage** msgs, int nb_msgs, int stream_id);
     /**
+    * send the RTMP messages and never free them,
+    * for the msgs owned by others, for instance, the consumer.
+    * @param msgs, the msgs to send out, never be NULL.
+    * @param nb_msgs, the size of msgs to send out.
+    * @param stream_id, the stream id of packet to send over, 0 for control message.
+    */
+    virtual int send_messages(SrsSharedPtrMessage** msgs, int nb_msgs, int stream_id);
+    /**
     * send the RTMP packet and always free it.
     * user must never free or use the packet after this method,
     * for it will always free the packet.
@@ -941,6 +954,10 @@ public:
      */
     virtual int64_t get_recv_bytes();
     virtual int64_t get_send_bytes();
+    /**
+     * get the size of recv buffer, the memory used by buffer.
+     */
+    virtual int get_recv_buffer_size();
     /**
      * recv a RTMP message, which is bytes oriented.
      * user can use decode_message to get the decoded RTMP packet.
@@ -978,6 +995,14 @@ public:
      *       @see https://github.com/ossrs/srs/issues/194
      */
     virtual int send_and_free_messages(SrsSharedPtrMessage** msgs, int nb_msgs, int stream_id);
+    /**
+     * send the RTMP messages and never free them,
+     * for the msgs owned by others, for instance, the consumer.
+     * @param msgs, the msgs to send out, never be NULL.
+     * @param nb_msgs, the size of msgs to send out.
+     * @param stream_id, the stream id of packet to send over, 0 for control message.
+     */
+    virtual int send_messages(SrsSharedPtrMessage** msgs, int nb_msgs, int stream_id);
     /**
      * send the RTMP packet and always free it.
      * user must never free or use the packet after this method,
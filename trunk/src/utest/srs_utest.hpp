@@ -39,6 +39,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 // enable all utest.
 #ifndef SRS_UTEST_DEV
     #define ENABLE_UTEST_AMF0
+    #define ENABLE_UTEST_BENCHMARK
     #define ENABLE_UTEST_CONFIG
     #define ENABLE_UTEST_CORE
     #define ENABLE_UTEST_KERNEL
@@ -49,6 +50,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 // disable some for fast dev, compile and startup.
 #ifdef SRS_UTEST_DEV
     #undef ENABLE_UTEST_AMF0
+    #undef ENABLE_UTEST_BENCHMARK
     #undef ENABLE_UTEST_CONFIG
     #undef ENABLE_UTEST_CORE
     #undef ENABLE_UTEST_KERNEL
@@ -0,0 +1,2109 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <srs_utest_app.hpp>
+
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_kernel_codec.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_rtmp_stack.hpp>
+#include <srs_rtmp_msg_array.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_app_st.hpp>
+#include <srs_app_http_client.hpp>
+#include <srs_http_stack.hpp>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+MockSrsGlobalConfig::MockSrsGlobalConfig()
+{
+    previous = _srs_config;
+    _srs_config = &conf;
+}
+
+MockSrsGlobalConfig::~MockSrsGlobalConfig()
+{
+    _srs_config = previous;
+}
+
+MockSrsSource::MockSrsSource()
+{
+}
+
+MockSrsSource::~MockSrsSource()
+{
+}
+
+MockSrsConsumer::MockSrsConsumer(SrsSource* s) : SrsConsumer(s, NULL)
+{
+    nb_wakeups = 0;
+}
+
+MockSrsConsumer::~MockSrsConsumer()
+{
+}
+
+void MockSrsConsumer::wakeup()
+{
+    nb_wakeups++;
+}
+
+MockSrsSourceHandler::MockSrsSourceHandler()
+{
+    nb_publish = nb_unpublish = 0;
+}
+
+MockSrsSourceHandler::~MockSrsSourceHandler()
+{
+}
+
+int MockSrsSourceHandler::on_publish(SrsSource* /*s*/, SrsRequest* /*r*/)
+{
+    nb_publish++;
+    return ERROR_SUCCESS;
+}
+
+void MockSrsSourceHandler::on_unpublish(SrsSource* /*s*/, SrsRequest* /*r*/)
+{
+    nb_unpublish++;
+}
+
+int MockSrsSourceHandler::on_hls_publish(SrsRequest* /*r*/)
+{
+    return ERROR_SUCCESS;
+}
+
+int MockSrsSourceHandler::on_update_m3u8(SrsRequest* /*r*/, string /*m3u8*/)
+{
+    return ERROR_SUCCESS;
+}
+
+int MockSrsSourceHandler::on_update_ts(SrsRequest* /*r*/, string /*uri*/, SrsHlsSharedBuffer* /*ts*/)
+{
+    return ERROR_SUCCESS;
+}
+
+int MockSrsSourceHandler::on_remove_ts(SrsRequest* /*r*/, string /*uri*/)
+{
+    return ERROR_SUCCESS;
+}
+
+int MockSrsSourceHandler::on_hls_unpublish(SrsRequest* /*r*/)
+{
+    return ERROR_SUCCESS;
+}
+
+MockSrsLocalPublisher::MockSrsLocalPublisher(bool* done)
+{
+    nb_hooks = 0;
+    hook_publishing = hook_finished = true;
+    hook_done = done;
+    *hook_done = false;
+}
+
+MockSrsLocalPublisher::~MockSrsLocalPublisher()
+{
+}
+
+void MockSrsLocalPublisher::http_hooks_on_unpublish()
+{
+    nb_hooks++;
+    hook_publishing = is_publishing();
+    hook_finished = is_finished();
+    
+    // the http hooks switch context, and fail when interrupted.
+    *hook_done = (st_usleep(300 * 1000) == 0);
+}
+
+#ifdef SRS_AUTO_HTTP_SERVER
+
+MockSrsTsEncoder::MockSrsTsEncoder()
+{
+    writer = NULL;
+    pat_pmt = false;
+}
+
+MockSrsTsEncoder::~MockSrsTsEncoder()
+{
+}
+
+int MockSrsTsEncoder::initialize(SrsFileWriter* fw)
+{
+    writer = fw;
+    return ERROR_SUCCESS;
+}
+
+int MockSrsTsEncoder::write_audio(int64_t /*timestamp*/, char* /*data*/, int /*size*/)
+{
+    return write_packet('A');
+}
+
+int MockSrsTsEncoder::write_video(int64_t /*timestamp*/, char* /*data*/, int /*size*/)
+{
+    return write_packet('V');
+}
+
+void MockSrsTsEncoder::reset_pat_pmt()
+{
+    pat_pmt = true;
+}
+
+int MockSrsTsEncoder::write_packet(char type)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (pat_pmt) {
+        pat_pmt = false;
+        if ((ret = writer->write((void*)"P", 1, NULL)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    return writer->write(&type, 1, NULL);
+}
+
+MockSrsTsStreamCache::MockSrsTsStreamCache(SrsRequest* r) : SrsTsStreamCache(NULL, r)
+{
+    writer = new SrsTsChunkWriter();
+    enc = new MockSrsTsEncoder();
+    enc->initialize(writer);
+}
+
+MockSrsTsStreamCache::~MockSrsTsStreamCache()
+{
+}
+
+void MockSrsTsStreamCache::append(bool key)
+{
+    char packet[188];
+    memset(packet, 0, sizeof(packet));
+    packet[0] = key? 'P' : 'A';
+    
+    writer->write(packet, sizeof(packet), NULL);
+    writing_key = key;
+    flush_chunk();
+}
+
+MockSrsLiveStream::MockSrsLiveStream(SrsRequest* r) : SrsLiveStream(NULL, r, NULL, NULL)
+{
+}
+
+MockSrsLiveStream::~MockSrsLiveStream()
+{
+}
+
+#endif
+
+#ifdef SRS_AUTO_HTTP_CALLBACK
+
+// the read timeout of mock http server, the idle connection is closed after it.
+#define MOCK_HTTP_SERVER_TIMEOUT_US (500 * 1000)
+
+MockSrsHttpServer::MockSrsHttpServer(int port)
+{
+    listener = new SrsTcpListener(this, "127.0.0.1", port);
+    nb_conns = 0;
+    nb_requests = 0;
+    close_request = false;
+    status = SRS_CONSTS_HTTP_OK;
+    body = "0";
+}
+
+MockSrsHttpServer::~MockSrsHttpServer()
+{
+    srs_freep(listener);
+    
+    // wait for the connections to close, which use the server.
+    for (int i = 0; i < 100 && nb_conns > 0; i++) {
+        st_usleep(MOCK_HTTP_SERVER_TIMEOUT_US / 50);
+    }
+}
+
+int MockSrsHttpServer::listen()
+{
+    return listener->listen();
+}
+
+int MockSrsHttpServer::on_tcp_client(st_netfd_t stfd)
+{
+    int ret = ERROR_SUCCESS;
+    
+    nb_conns++;
+    
+    if (st_thread_create(serve, new std::pair<MockSrsHttpServer*, st_netfd_t>(this, stfd), 0, 0) == NULL) {
+        nb_conns--;
+        srs_close_stfd(stfd);
+        ret = ERROR_ST_CREATE_CYCLE_THREAD;
+        return ret;
+    }
+    
+    return ret;
+}
+
+void* MockSrsHttpServer::serve(void* arg)
+{
+    std::pair<MockSrsHttpServer*, st_netfd_t>* conn = (std::pair<MockSrsHttpServer*, st_netfd_t>*)arg;
+    MockSrsHttpServer* server = conn->first;
+    st_netfd_t stfd = conn->second;
+    srs_freep(conn);
+    
+    server->do_serve(stfd);
+    server->nb_conns--;
+    
+    return NULL;
+}
+
+void MockSrsHttpServer::do_serve(st_netfd_t stfd)
+{
+    char buf[4096];
+    
+    // the request of hooks is small, read in a time.
+    while (st_read(stfd, buf, sizeof(buf), MOCK_HTTP_SERVER_TIMEOUT_US) > 0) {
+        nb_requests++;
+        
+        if (close_request) {
+            break;
+        }
+        
+        std::stringstream ss;
+        ss << "HTTP/1.1 " << status << " OK" << SRS_HTTP_CRLF
+            << "Connection: Keep-Alive" << SRS_HTTP_CRLF
+            << "Content-Length: " << body.length() << SRS_HTTP_CRLF
+            << SRS_HTTP_CRLF
+            << body;
+        std::string res = ss.str();
+        
+        if (st_write(stfd, res.data(), res.length(), MOCK_HTTP_SERVER_TIMEOUT_US) != (ssize_t)res.length()) {
+            break;
+        }
+    }
+    
+    srs_close_stfd(stfd);
+}
+
+#endif
+
+#if defined(SRS_AUTO_INGEST) && defined(SRS_AUTO_HTTP_CORE)
+
+MockSrsIngestHls::MockSrsIngestHls(int jitter)
+{
+    this->jitter = jitter;
+}
+
+MockSrsIngestHls::~MockSrsIngestHls()
+{
+}
+
+void MockSrsIngestHls::append(int64_t seq, double duration, SrsIngestHlsSegmentState state)
+{
+    SrsIngestHlsSegment* segment = new SrsIngestHlsSegment();
+    segment->seq = seq;
+    segment->duration = duration;
+    segment->state = state;
+    segments.push_back(segment);
+}
+
+int MockSrsIngestHls::publish()
+{
+    return ERROR_SUCCESS;
+}
+
+int MockSrsIngestHls::deliver(SrsIngestHlsSegment* segment)
+{
+    delivered.push_back(segment->seq);
+    return ERROR_SUCCESS;
+}
+
+/**
+* resolve the url of segment or media playlist.
+*/
+VOID TEST(AppIngestHlsTest, ResolveUrl)
+{
+    EXPECT_STREQ("http://cdn.com/live/a.ts",
+        srs_ingest_hls_resolve("http://127.0.0.1:8080/hls/index.m3u8", "http://cdn.com/live/a.ts").c_str());
+    EXPECT_STREQ("https://cdn.com/live/a.ts",
+        srs_ingest_hls_resolve("http://127.0.0.1:8080/hls/index.m3u8", "https://cdn.com/live/a.ts").c_str());
+    
+    // the absolute path, use the server of playlist.
+    EXPECT_STREQ("http://127.0.0.1:8080/live/a.ts",
+        srs_ingest_hls_resolve("http://127.0.0.1:8080/hls/index.m3u8", "/live/a.ts").c_str());
+    EXPECT_STREQ("http://127.0.0.1:80/live/a.ts",
+        srs_ingest_hls_resolve("http://127.0.0.1/hls/index.m3u8?k=v", "/live/a.ts").c_str());
+    
+    // the relative path, ignore the query of playlist.
+    EXPECT_STREQ("http://127.0.0.1:8080/hls/a.ts",
+        srs_ingest_hls_resolve("http://127.0.0.1:8080/hls/index.m3u8", "a.ts").c_str());
+    EXPECT_STREQ("http://127.0.0.1:8080/hls/live/a.ts?k=v",
+        srs_ingest_hls_resolve("http://127.0.0.1:8080/hls/index.m3u8?t=/x/y", "live/a.ts?k=v").c_str());
+}
+
+/**
+* the variant playlist, use the first media playlist.
+*/
+VOID TEST(AppIngestHlsTest, ParseVariant)
+{
+    MockSrsIngestHls hls(3);
+    
+    bool is_variant = false;
+    EXPECT_EQ(ERROR_SUCCESS, hls.parse_m3u8("http://127.0.0.1:8080/hls/index.m3u8?token=x",
+        "#EXTM3U\r\n"
+        "#EXT-X-STREAM-INF:PROGRAM-ID=1,BANDWIDTH=73207,CODECS=\"mp4a.40.2\"\r\n"
+        "live/livestream.m3u8?k=v\r\n"
+        "#EXT-X-STREAM-INF:PROGRAM-ID=1,BANDWIDTH=36000\r\n"
+        "live/low.m3u8\r\n", is_variant));
+    EXPECT_TRUE(is_variant);
+    EXPECT_STREQ("http://127.0.0.1:8080/hls/live/livestream.m3u8?k=v", hls.m3u8.c_str());
+    EXPECT_TRUE(hls.segments.empty());
+    
+    // the variant without media playlist.
+    EXPECT_NE(ERROR_SUCCESS, hls.parse_m3u8("http://127.0.0.1:8080/hls/index.m3u8",
+        "#EXTM3U\n"
+        "#EXT-X-STREAM-INF:PROGRAM-ID=1,BANDWIDTH=73207\n", is_variant));
+}
+
+/**
+* the media playlist, start from the last segment, then append the new ones.
+*/
+VOID TEST(AppIngestHlsTest, ParseMedia)
+{
+    MockSrsIngestHls hls(10);
+    string url = "http://127.0.0.1:8080/hls/live.m3u8";
+    
+    bool is_variant = true;
+    EXPECT_EQ(ERROR_SUCCESS, hls.parse_m3u8(url,
+        "#EXTM3U\n"
+        "#EXT-X-VERSION:3\n"
+        "#EXT-X-MEDIA-SEQUENCE:10\n"
+        "#EXT-X-TARGETDURATION:5\n"
+        "#EXTINF:4.0,\n"
+        "a-10.ts\n"
+        "#EXTINF:4.5, no desc\n"
+        "a-11.ts\n"
+        "#EXTINF:5.0,\n"
+        "a-12.ts", is_variant));
+    EXPECT_FALSE(is_variant);
+    EXPECT_EQ(12, hls.last_seq);
+    ASSERT_EQ(1, (int)hls.segments.size());
+    EXPECT_EQ(12, hls.segments[0]->seq);
+    EXPECT_EQ(5.0, hls.segments[0]->duration);
+    EXPECT_STREQ("http://127.0.0.1:8080/hls/a-12.ts", hls.segments[0]->url.c_str());
+    EXPECT_EQ(SrsIngestHlsSegmentPending, hls.segments[0]->state);
+    
+    // refresh, append the absolute path and url.
+    EXPECT_EQ(ERROR_SUCCESS, hls.parse_m3u8(url,
+        "#EXTM3U\n"
+        "#EXT-X-MEDIA-SEQUENCE:12\n"
+        "#EXT-X-TARGETDURATION:5\n"
+        "#EXTINF:5.0,\n"
+        "a-12.ts\n"
+        "#EXTINF:4.0,\n"
+        "/live/a-13.ts\n"
+        "#EXTINF:3.0,\n"
+        "http://cdn.com/live/a-14.ts\n", is_variant));
+    EXPECT_EQ(14, hls.last_seq);
+    ASSERT_EQ(3, (int)hls.segments.size());
+    EXPECT_EQ(13, hls.segments[1]->seq);
+    EXPECT_STREQ("http://127.0.0.1:8080/live/a-13.ts", hls.segments[1]->url.c_str());
+    EXPECT_EQ(14, hls.segments[2]->seq);
+    EXPECT_EQ(3.0, hls.segments[2]->duration);
+    EXPECT_STREQ("http://cdn.com/live/a-14.ts", hls.segments[2]->url.c_str());
+    
+    // refresh without new segment.
+    EXPECT_EQ(ERROR_SUCCESS, hls.parse_m3u8(url,
+        "#EXTM3U\n"
+        "#EXT-X-MEDIA-SEQUENCE:13\n"
+        "#EXTINF:4.0,\n"
+        "/live/a-13.ts\n"
+        "#EXTINF:3.0,\n"
+        "http://cdn.com/live/a-14.ts\n", is_variant));
+    EXPECT_EQ(14, hls.last_seq);
+    EXPECT_EQ(3, (int)hls.segments.size());
+}
+
+/**
+* the media sequence reset when stream restarted, start from the last segment.
+*/
+VOID TEST(AppIngestHlsTest, ParseSequenceReset)
+{
+    MockSrsIngestHls hls(10);
+    string url = "http://127.0.0.1:8080/hls/live.m3u8";
+    
+    bool is_variant = false;
+    EXPECT_EQ(ERROR_SUCCESS, hls.parse_m3u8(url,
+        "#EXTM3U\n"
+        "#EXT-X-MEDIA-SEQUENCE:100\n"
+        "#EXTINF:2.0,\n"
+        "a-100.ts\n"
+        "#EXTINF:2.0,\n"
+        "a-101.ts\n", is_variant));
+    EXPECT_EQ(101, hls.last_seq);
+    EXPECT_EQ(1, (int)hls.segments.size());
+    
+    EXPECT_EQ(ERROR_SUCCESS, hls.parse_m3u8(url,
+        "#EXTM3U\n"
+        "#EXT-X-MEDIA-SEQUENCE:0\n"
+        "#EXTINF:2.0,\n"
+        "b-0.ts\n"
+        "#EXTINF:2.0,\n"
+        "b-1.ts\n"
+        "#EXTINF:2.0,\n"
+        "b-2.ts\n", is_variant));
+    EXPECT_EQ(2, hls.last_seq);
+    ASSERT_EQ(2, (int)hls.segments.size());
+    EXPECT_EQ(101, hls.segments[0]->seq);
+    EXPECT_EQ(2, hls.segments[1]->seq);
+    EXPECT_STREQ("http://127.0.0.1:8080/hls/b-2.ts", hls.segments[1]->url.c_str());
+    
+    // the empty playlist is ignored.
+    EXPECT_EQ(ERROR_SUCCESS, hls.parse_m3u8(url, "#EXTM3U\n#EXT-X-MEDIA-SEQUENCE:0\n", is_variant));
+    EXPECT_EQ(2, hls.last_seq);
+    EXPECT_EQ(2, (int)hls.segments.size());
+}
+
+/**
+* drop the oldest segments when jitter buffer full, but never the fetching one.
+*/
+VOID TEST(AppIngestHlsTest, JitterShrink)
+{
+    MockSrsIngestHls hls(2);
+    
+    hls.append(1, 2.0, SrsIngestHlsSegmentFetching);
+    hls.append(2, 2.0, SrsIngestHlsSegmentReady);
+    hls.append(3, 2.0, SrsIngestHlsSegmentPending);
+    hls.append(4, 2.0, SrsIngestHlsSegmentPending);
+    
+    // wait for the fetching head.
+    hls.shrink();
+    EXPECT_EQ(4, (int)hls.segments.size());
+    EXPECT_EQ(0, hls.nb_drops);
+    
+    // drop the oldest in order.
+    hls.segments[0]->state = SrsIngestHlsSegmentReady;
+    hls.shrink();
+    ASSERT_EQ(2, (int)hls.segments.size());
+    EXPECT_EQ(3, hls.segments[0]->seq);
+    EXPECT_EQ(4, hls.segments[1]->seq);
+    EXPECT_EQ(2, hls.nb_drops);
+}
+
+/**
+* deliver in order of sequence, skip the failed, and in time of duration.
+*/
+VOID TEST(AppIngestHlsTest, JitterConsume)
+{
+    MockSrsIngestHls hls(10);
+    srs_update_system_time_ms();
+    
+    // wait for the pending head, even the next is ready.
+    hls.append(1, 0, SrsIngestHlsSegmentPending);
+    hls.append(2, 0, SrsIngestHlsSegmentFailed);
+    hls.append(3, 0, SrsIngestHlsSegmentReady);
+    hls.append(4, 100, SrsIngestHlsSegmentReady);
+    hls.append(5, 100, SrsIngestHlsSegmentReady);
+    
+    EXPECT_EQ(ERROR_SUCCESS, hls.consume());
+    EXPECT_TRUE(hls.delivered.empty());
+    EXPECT_EQ(5, (int)hls.segments.size());
+    
+    // the head fetched, drop the failed, then wait for the duration of 4.
+    hls.segments[0]->state = SrsIngestHlsSegmentReady;
+    EXPECT_EQ(ERROR_SUCCESS, hls.consume());
+    ASSERT_EQ(3, (int)hls.delivered.size());
+    EXPECT_EQ(1, hls.delivered[0]);
+    EXPECT_EQ(3, hls.delivered[1]);
+    EXPECT_EQ(4, hls.delivered[2]);
+    EXPECT_EQ(1, hls.nb_drops);
+    ASSERT_EQ(1, (int)hls.segments.size());
+    EXPECT_EQ(5, hls.segments[0]->seq);
+    
+    // the failed segment never wait for the time.
+    hls.segments[0]->state = SrsIngestHlsSegmentFailed;
+    EXPECT_EQ(ERROR_SUCCESS, hls.consume());
+    EXPECT_EQ(3, (int)hls.delivered.size());
+    EXPECT_TRUE(hls.segments.empty());
+    EXPECT_EQ(2, hls.nb_drops);
+}
+
+#endif
+
+/**
+* create the shared message of audio or video, with the flv tag header bytes.
+*/
+void srs_utest_shared_message(SrsSharedPtrMessage* m, bool video, int64_t timestamp, char b0, char b1)
+{
+    SrsCommonMessage* msg = new SrsCommonMessage();
+    if (video) {
+        msg->header.initialize_video(2, (u_int32_t)timestamp, 1);
+    } else {
+        msg->header.initialize_audio(2, (u_int32_t)timestamp, 1);
+    }
+    msg->create_payload(2);
+    msg->size = 2;
+    msg->payload[0] = b0;
+    msg->payload[1] = b1;
+    
+    m->create(msg);
+    srs_freep(msg);
+}
+
+void srs_utest_ring_enqueue(SrsMessageRing* ring, bool video, int64_t timestamp, char b0, char b1, bool* is_overflow = NULL)
+{
+    SrsSharedPtrMessage m;
+    srs_utest_shared_message(&m, video, timestamp, b0, b1);
+    ring->enqueue(&m, is_overflow);
+}
+
+VOID TEST(AppMessageRingTest, Grow)
+{
+    SrsMessageRing ring;
+    ring.set_queue_size(1000);
+    
+    int nb_msgs = SRS_PERF_QUEUE_RING_SIZE * 2 + 1;
+    for (int i = 0; i < nb_msgs; i++) {
+        srs_utest_ring_enqueue(&ring, true, i, 0x27, 0x01);
+    }
+    EXPECT_EQ(nb_msgs, ring.size());
+    EXPECT_EQ(nb_msgs - 1, ring.duration());
+    
+    // the order is kept when grow.
+    SrsSharedPtrMessage** pmsgs = new SrsSharedPtrMessage*[nb_msgs];
+    SrsAutoFreeA(SrsSharedPtrMessage*, pmsgs);
+    
+    int count = 0;
+    EXPECT_TRUE(ERROR_SUCCESS == ring.dump_packets(nb_msgs, pmsgs, count));
+    ASSERT_EQ(nb_msgs, count);
+    for (int i = 0; i < count; i++) {
+        EXPECT_EQ(i, pmsgs[i]->timestamp);
+    }
+    EXPECT_EQ(0, ring.size());
+}
+
+VOID TEST(AppMessageRingTest, ShrinkDropAll)
+{
+    SrsMessageRing ring;
+    ring.set_queue_size(10);
+    
+    // the keyframe is the first message, the messages from it overflow,
+    // so drop all except the sequence header, never loop forever.
+    bool is_overflow = false;
+    srs_utest_ring_enqueue(&ring, true, 0, 0x17, 0x00);
+    srs_utest_ring_enqueue(&ring, true, 0, 0x17, 0x01);
+    for (int i = 1; i <= 11; i++) {
+        srs_utest_ring_enqueue(&ring, true, i * 1000, 0x27, 0x01, &is_overflow);
+    }
+    EXPECT_TRUE(is_overflow);
+    EXPECT_EQ(1, ring.size());
+    EXPECT_EQ(0, ring.duration());
+    
+    SrsSharedPtrMessage* pmsgs[4];
+    int count = 0;
+    EXPECT_TRUE(ERROR_SUCCESS == ring.dump_packets(4, pmsgs, count));
+    ASSERT_EQ(1, count);
+    EXPECT_TRUE(SrsFlvCodec::video_is_sequence_header(pmsgs[0]->payload, pmsgs[0]->size));
+    EXPECT_EQ(11000, pmsgs[0]->timestamp);
+}
+
+VOID TEST(AppMessageRingTest, ShrinkToKeyframe)
+{
+    SrsMessageRing ring;
+    ring.set_queue_size(10);
+    
+    bool is_overflow = false;
+    srs_utest_ring_enqueue(&ring, true, 0, 0x17, 0x00);
+    srs_utest_ring_enqueue(&ring, false, 0, (char)0xaf, 0x00);
+    srs_utest_ring_enqueue(&ring, true, 0, 0x17, 0x01);
+    for (int i = 1; i <= 4; i++) {
+        srs_utest_ring_enqueue(&ring, true, i * 1000, 0x27, 0x01);
+    }
+    srs_utest_ring_enqueue(&ring, true, 5000, 0x17, 0x01);
+    for (int i = 6; i <= 10; i++) {
+        srs_utest_ring_enqueue(&ring, true, i * 1000, 0x27, 0x01, &is_overflow);
+    }
+    EXPECT_FALSE(is_overflow);
+    EXPECT_EQ(13, ring.size());
+    
+    // drop the messages before the keyframe at 5000,
+    // and resend the sequence headers before it.
+    srs_utest_ring_enqueue(&ring, true, 11000, 0x27, 0x01, &is_overflow);
+    EXPECT_TRUE(is_overflow);
+    EXPECT_EQ(9, ring.size());
+    EXPECT_EQ(6000, ring.duration());
+    
+    SrsSharedPtrMessage* pmsgs[16];
+    int count = 0;
+    EXPECT_TRUE(ERROR_SUCCESS == ring.dump_packets(16, pmsgs, count));
+    ASSERT_EQ(9, count);
+    EXPECT_TRUE(SrsFlvCodec::video_is_sequence_header(pmsgs[0]->payload, pmsgs[0]->size));
+    EXPECT_EQ(5000, pmsgs[0]->timestamp);
+    EXPECT_TRUE(SrsFlvCodec::audio_is_sequence_header(pmsgs[1]->payload, pmsgs[1]->size));
+    EXPECT_EQ(5000, pmsgs[1]->timestamp);
+    EXPECT_TRUE(SrsFlvCodec::video_is_keyframe(pmsgs[2]->payload, pmsgs[2]->size));
+    EXPECT_EQ(5000, pmsgs[2]->timestamp);
+    for (int i = 3; i < count; i++) {
+        EXPECT_EQ((i + 3) * 1000, pmsgs[i]->timestamp);
+    }
+}
+
+VOID TEST(AppMessageRingTest, DumpPackets)
+{
+    SrsMessageRing ring;
+    ring.set_queue_size(10);
+    
+    for (int i = 0; i < 5; i++) {
+        srs_utest_ring_enqueue(&ring, true, i * 100, 0x27, 0x01);
+    }
+    
+    // dump by the max count, the messages are valid util next dump.
+    SrsSharedPtrMessage* pmsgs[3];
+    int count = 0;
+    EXPECT_TRUE(ERROR_SUCCESS == ring.dump_packets(3, pmsgs, count));
+    ASSERT_EQ(3, count);
+    EXPECT_EQ(0, pmsgs[0]->timestamp);
+    EXPECT_EQ(200, pmsgs[2]->timestamp);
+    EXPECT_TRUE(pmsgs[2]->payload != NULL);
+    EXPECT_EQ(2, ring.size());
+    EXPECT_EQ(200, ring.duration());
+    
+    // the ring is writen when sending.
+    srs_utest_ring_enqueue(&ring, true, 500, 0x27, 0x01);
+    EXPECT_EQ(200, pmsgs[2]->timestamp);
+    EXPECT_TRUE(pmsgs[2]->payload != NULL);
+    
+    EXPECT_TRUE(ERROR_SUCCESS == ring.dump_packets(3, pmsgs, count));
+    ASSERT_EQ(3, count);
+    EXPECT_EQ(300, pmsgs[0]->timestamp);
+    EXPECT_EQ(500, pmsgs[2]->timestamp);
+    EXPECT_EQ(0, ring.size());
+    
+    // empty ring dumps nothing.
+    count = 0;
+    EXPECT_TRUE(ERROR_SUCCESS == ring.dump_packets(3, pmsgs, count));
+    EXPECT_EQ(0, count);
+}
+
+void srs_utest_source_append(SrsSourceRing* ring, bool video, int64_t timestamp, char b0, char b1)
+{
+    SrsSharedPtrMessage m;
+    srs_utest_shared_message(&m, video, timestamp, b0, b1);
+    ring->append(&m);
+    ring->cache(ring->at(ring->end() - 1));
+}
+
+VOID TEST(AppSourceRingTest, AppendShrink)
+{
+    SrsSourceRing ring;
+    ring.set_queue_size(1);
+    
+    // gop0: keyframe at 0, gop1: keyframe at 500.
+    srs_utest_source_append(&ring, true, 0, 0x17, 0x01);
+    for (int i = 1; i <= 4; i++) {
+        srs_utest_source_append(&ring, true, i * 100, 0x27, 0x01);
+    }
+    srs_utest_source_append(&ring, true, 500, 0x17, 0x01);
+    srs_utest_source_append(&ring, true, 600, 0x27, 0x01);
+    
+    EXPECT_EQ(0, ring.begin());
+    EXPECT_EQ(7, ring.end());
+    EXPECT_EQ(600, ring.duration(0));
+    EXPECT_EQ(100, ring.duration(5));
+    EXPECT_EQ(0, ring.duration(7));
+    EXPECT_EQ(5, ring.last_keyframe());
+    EXPECT_EQ(5, ring.gop());
+    EXPECT_EQ(500, ring.start_time());
+    
+    // the consumer at 0 keeps all messages.
+    ring.shrink(0);
+    EXPECT_EQ(0, ring.begin());
+    
+    // the cached gop is always kept.
+    ring.shrink(ring.end());
+    EXPECT_EQ(5, ring.begin());
+    EXPECT_EQ(500, ring.at(ring.begin())->timestamp);
+    
+    // the jitter timestamp never increase the duration.
+    srs_utest_source_append(&ring, true, 100, 0x27, 0x01);
+    srs_utest_source_append(&ring, true, 110, 0x27, 0x01);
+    EXPECT_EQ(110, ring.duration(5));
+}
+
+VOID TEST(AppSourceRingTest, Waiters)
+{
+    MockSrsGlobalConfig config;
+    MockSrsSource source;
+    SrsSourceRing* ring = source.ring;
+    
+    MockSrsConsumer c0(&source), c1(&source), c2(&source);
+    srs_utest_source_append(ring, true, 0, 0x17, 0x01);
+    
+    // c0 wait for 300ms, c1 wait for 100ms and 10 messages, c2 unwait.
+    int64_t end = ring->end();
+    int64_t t0 = ring->wait(&c0, end, 300, end + 1);
+    int64_t t1 = ring->wait(&c1, end, 100, end + 10);
+    int64_t t2 = ring->wait(&c2, end, 100, end + 1);
+    EXPECT_EQ(300, t0);
+    EXPECT_EQ(100, t1);
+    ring->unwait(&c2, t2, end + 1);
+    
+    // the duration of c1 is ok, but wait for the messages.
+    for (int i = 1; i <= 4; i++) {
+        srs_utest_source_append(ring, true, i * 100, 0x27, 0x01);
+    }
+    EXPECT_EQ(1, c0.nb_wakeups);
+    EXPECT_EQ(0, c1.nb_wakeups);
+    EXPECT_EQ(0, c2.nb_wakeups);
+    
+    for (int i = 5; i <= 9; i++) {
+        srs_utest_source_append(ring, true, i * 100, 0x27, 0x01);
+    }
+    EXPECT_EQ(0, c1.nb_wakeups);
+    srs_utest_source_append(ring, true, 1000, 0x27, 0x01);
+    EXPECT_EQ(1, c1.nb_wakeups);
+    
+    // the consumer waiting for messages is unwait.
+    end = ring->end();
+    t1 = ring->wait(&c1, end, 0, end + 2);
+    srs_utest_source_append(ring, true, 1100, 0x27, 0x01);
+    ring->unwait(&c1, t1, end + 2);
+    srs_utest_source_append(ring, true, 1200, 0x27, 0x01);
+    EXPECT_EQ(1, c1.nb_wakeups);
+    
+    // wakeup all, for example, when unpublish.
+    end = ring->end();
+    ring->wait(&c0, end, 1000, end + 1);
+    ring->wait(&c1, end, 0, end + 100);
+    srs_utest_source_append(ring, true, 1300, 0x27, 0x01);
+    ring->wakeup();
+    EXPECT_EQ(2, c0.nb_wakeups);
+    EXPECT_EQ(2, c1.nb_wakeups);
+    EXPECT_EQ(0, c2.nb_wakeups);
+    
+    // no waiters.
+    srs_utest_source_append(ring, true, 3000, 0x27, 0x01);
+    EXPECT_EQ(2, c0.nb_wakeups);
+    EXPECT_EQ(2, c1.nb_wakeups);
+}
+
+VOID TEST(AppSourceRingTest, ConsumerSkipOverwrite)
+{
+    MockSrsGlobalConfig config;
+    MockSrsSource source;
+    SrsSourceRing* ring = source.ring;
+    
+    SrsSharedPtrMessage sh;
+    srs_utest_shared_message(&sh, true, 0, 0x17, 0x00);
+    source.cache_sh_video = sh.copy();
+    
+    MockSrsConsumer consumer(&source);
+    consumer.set_queue_size(1);
+    EXPECT_EQ(0, consumer.get_cursor());
+    
+    srs_utest_source_append(ring, true, 0, 0x17, 0x01);
+    srs_utest_source_append(ring, true, 100, 0x27, 0x01);
+    srs_utest_source_append(ring, true, 200, 0x17, 0x01);
+    srs_utest_source_append(ring, true, 300, 0x27, 0x01);
+    
+    // the messages of consumer are removed, for example, by a faster consumer.
+    ring->set(false);
+    ring->shrink(3);
+    EXPECT_EQ(3, ring->begin());
+    
+    // the keyframes are removed, skip to the end and resend the sequence header.
+    SrsMessageArray msgs(8);
+    int count = 0;
+    EXPECT_TRUE(ERROR_SUCCESS == consumer.dump_packets(&msgs, count));
+    ASSERT_EQ(1, count);
+    EXPECT_TRUE(SrsFlvCodec::video_is_sequence_header(msgs.msgs[0]->payload, msgs.msgs[0]->size));
+    EXPECT_EQ(4, consumer.get_cursor());
+    
+    // the consumer lags more than queue length, skip to the last keyframe.
+    srs_utest_source_append(ring, true, 400, 0x17, 0x01);
+    for (int i = 5; i <= 15; i++) {
+        srs_utest_source_append(ring, true, i * 100, 0x27, 0x01);
+    }
+    srs_utest_source_append(ring, true, 1600, 0x17, 0x01);
+    srs_utest_source_append(ring, true, 1700, 0x27, 0x01);
+    EXPECT_EQ(1300, ring->duration(consumer.get_cursor()));
+    
+    count = 0;
+    EXPECT_TRUE(ERROR_SUCCESS == consumer.dump_packets(&msgs, count));
+    ASSERT_EQ(3, count);
+    EXPECT_TRUE(SrsFlvCodec::video_is_sequence_header(msgs.msgs[0]->payload, msgs.msgs[0]->size));
+    EXPECT_TRUE(SrsFlvCodec::video_is_keyframe(msgs.msgs[1]->payload, msgs.msgs[1]->size));
+    EXPECT_EQ(100, msgs.msgs[2]->timestamp - msgs.msgs[1]->timestamp);
+    EXPECT_EQ(ring->end(), consumer.get_cursor());
+}
+
+/**
+* only the request to local rtmp port and not edge vhost is published in process.
+*/
+VOID TEST(AppLocalPublisherTest, IsLocal)
+{
+    MockSrsGlobalConfig gc;
+    ASSERT_TRUE(ERROR_SUCCESS == gc.conf.parse("listen 1935 19350; vhost edge.utest.com {mode remote; origin 127.0.0.1:19351;}"));
+    
+    SrsRequest req;
+    req.vhost = "__defaultVhost__";
+    req.host = "127.0.0.1";
+    req.port = "1935";
+    EXPECT_TRUE(SrsLocalPublisher::is_local(&req));
+    
+    req.port = "19350";
+    EXPECT_TRUE(SrsLocalPublisher::is_local(&req));
+    
+    req.port = "1936";
+    EXPECT_FALSE(SrsLocalPublisher::is_local(&req));
+    
+    req.host = "localhost";
+    req.port = "1935";
+    EXPECT_TRUE(SrsLocalPublisher::is_local(&req));
+    
+    // the address for documentation never be the ip of server.
+    req.host = "192.0.2.1";
+    EXPECT_FALSE(SrsLocalPublisher::is_local(&req));
+    
+    // the edge proxy the publish to origin.
+    req.host = "127.0.0.1";
+    req.vhost = "edge.utest.com";
+    EXPECT_FALSE(SrsLocalPublisher::is_local(&req));
+}
+
+/**
+* the idle thread unpublish the publisher when timeout, and the user
+* should never free the publisher until the unpublish hooks are done.
+*/
+VOID TEST(AppLocalPublisherTest, IdleUnpublish)
+{
+    MockSrsGlobalConfig gc;
+    ASSERT_TRUE(ERROR_SUCCESS == gc.conf.parse(_MIN_OK_CONF"vhost __defaultVhost__ {publish_1stpkt_timeout 100;}"));
+    
+    // the idle thread and the hooks run in st.
+    ASSERT_EQ(0, st_init());
+    
+    SrsRequest req;
+    req.vhost = "__defaultVhost__";
+    req.app = "utest";
+    req.stream = "idle";
+    
+    // create the source with mock handler, for the server is NULL in utest,
+    // the source is kept in pool, so the handler must never be freed.
+    static MockSrsSourceHandler handler;
+    SrsSource* source = NULL;
+    ASSERT_TRUE(ERROR_SUCCESS == SrsSource::create(&req, &handler, &handler, &source));
+    
+    // unpublish by the idle thread, wait for it to finish,
+    // the system time is updated by server, so we must update it.
+    bool done = false;
+    MockSrsLocalPublisher* publisher = new MockSrsLocalPublisher(&done);
+    ASSERT_TRUE(ERROR_SUCCESS == publisher->publish(&req, SRS_CONSTS_LOCALHOST));
+    EXPECT_TRUE(publisher->is_publishing());
+    EXPECT_FALSE(publisher->is_finished());
+    EXPECT_FALSE(source->can_publish(false));
+    
+    for (int i = 0; i < 30 && publisher->nb_hooks == 0; i++) {
+        st_usleep(100 * 1000);
+        srs_update_system_time_ms();
+    }
+    EXPECT_EQ(1, publisher->nb_hooks);
+    EXPECT_FALSE(publisher->hook_publishing);
+    EXPECT_FALSE(publisher->hook_finished);
+    EXPECT_FALSE(publisher->is_publishing());
+    EXPECT_FALSE(publisher->is_finished());
+    EXPECT_TRUE(source->can_publish(false));
+    
+    for (int i = 0; i < 10 && !publisher->is_finished(); i++) {
+        st_usleep(100 * 1000);
+    }
+    EXPECT_TRUE(done);
+    EXPECT_TRUE(publisher->is_finished());
+    
+    SrsSharedPtrMessage msg;
+    srs_utest_shared_message(&msg, true, 0, 0x17, 0x01);
+    EXPECT_TRUE(ERROR_SOCKET_TIMEOUT == publisher->on_message(&msg));
+    srs_freep(publisher);
+    
+    // free the publisher when unpublishing, which waits for the hooks.
+    publisher = new MockSrsLocalPublisher(&done);
+    ASSERT_TRUE(ERROR_SUCCESS == publisher->publish(&req, SRS_CONSTS_LOCALHOST));
+    for (int i = 0; i < 30 && publisher->nb_hooks == 0; i++) {
+        st_usleep(100 * 1000);
+        srs_update_system_time_ms();
+    }
+    EXPECT_EQ(1, publisher->nb_hooks);
+    EXPECT_FALSE(done);
+    srs_freep(publisher);
+    EXPECT_TRUE(done);
+    
+    EXPECT_EQ(2, handler.nb_publish);
+    EXPECT_EQ(2, handler.nb_unpublish);
+}
+
+#ifdef SRS_AUTO_HTTP_CALLBACK
+
+// the port of mock http server for hooks.
+#define MOCK_HTTP_SERVER_PORT 19781
+
+VOID TEST(AppHttpHooksTest, DecisionKey)
+{
+    SrsRequest req;
+    req.ip = "192.168.1.10";
+    req.vhost = "v1";
+    req.app = "live";
+    req.stream = "livestream";
+    req.tcUrl = "rtmp://v1/live";
+    req.pageUrl = "http://v1/player.html";
+    
+    string url = "http://127.0.0.1:8085/api/v1/sessions";
+    string key = MockSrsHttpHooks::decision_key("on_play", url, &req);
+    
+    // same for the clients of a page, without the client_id.
+    EXPECT_STREQ(key.c_str(), MockSrsHttpHooks::decision_key("on_play", url, &req).c_str());
+    
+    EXPECT_STRNE(key.c_str(), MockSrsHttpHooks::decision_key("on_connect", url, &req).c_str());
+    EXPECT_STRNE(key.c_str(), MockSrsHttpHooks::decision_key("on_play", "http://127.0.0.1:8085/api/v1/clients", &req).c_str());
+    
+    req.stream = "livestream2";
+    EXPECT_STRNE(key.c_str(), MockSrsHttpHooks::decision_key("on_play", url, &req).c_str());
+    
+    req.stream = "livestream";
+    req.ip = "192.168.1.11";
+    EXPECT_STRNE(key.c_str(), MockSrsHttpHooks::decision_key("on_play", url, &req).c_str());
+}
+
+VOID TEST(AppHttpHooksTest, FetchDecisionExpire)
+{
+    MockSrsGlobalConfig gc;
+    ASSERT_TRUE(ERROR_SUCCESS == gc.conf.parse(_MIN_OK_CONF"vhost v1 {http_hooks {enabled on; cache_ttl 10;}} vhost v2 {http_hooks {enabled on;}}"));
+    
+    MockSrsHttpHooks::decisions.clear();
+    srs_update_system_time_ms();
+    
+    int ret = ERROR_SUCCESS;
+    EXPECT_FALSE(MockSrsHttpHooks::fetch_decision("v1", "k1", ret));
+    
+    MockSrsHttpHooks::save_decision("v1", "k1", ERROR_RESPONSE_CODE);
+    EXPECT_TRUE(MockSrsHttpHooks::fetch_decision("v1", "k1", ret));
+    EXPECT_EQ(ERROR_RESPONSE_CODE, ret);
+    
+    // never cache for the vhost without ttl.
+    MockSrsHttpHooks::save_decision("v2", "k2", ERROR_SUCCESS);
+    EXPECT_FALSE(MockSrsHttpHooks::fetch_decision("v2", "k2", ret));
+    EXPECT_EQ(1, (int)MockSrsHttpHooks::decisions.size());
+    
+    // remove the expired decision when fetch.
+    MockSrsHttpHooks::decisions["k1"].expire = srs_get_system_time_ms() - 1;
+    EXPECT_FALSE(MockSrsHttpHooks::fetch_decision("v1", "k1", ret));
+    EXPECT_EQ(0, (int)MockSrsHttpHooks::decisions.size());
+}
+
+VOID TEST(AppHttpHooksTest, SaveDecisionEvict)
+{
+    MockSrsGlobalConfig gc;
+    ASSERT_TRUE(ERROR_SUCCESS == gc.conf.parse(_MIN_OK_CONF"vhost v1 {http_hooks {enabled on; cache_ttl 10;}}"));
+    
+    MockSrsHttpHooks::decisions.clear();
+    srs_update_system_time_ms();
+    
+    for (int i = 0; i < SRS_HTTP_HOOK_MAX_DECISIONS; i++) {
+        std::stringstream ss;
+        ss << i;
+        MockSrsHttpHooks::save_decision("v1", ss.str(), ERROR_SUCCESS);
+    }
+    EXPECT_EQ(SRS_HTTP_HOOK_MAX_DECISIONS, (int)MockSrsHttpHooks::decisions.size());
+    
+    // ignore when full of decisions not expired.
+    int ret = ERROR_SUCCESS;
+    MockSrsHttpHooks::save_decision("v1", "full", ERROR_SUCCESS);
+    EXPECT_EQ(SRS_HTTP_HOOK_MAX_DECISIONS, (int)MockSrsHttpHooks::decisions.size());
+    EXPECT_FALSE(MockSrsHttpHooks::fetch_decision("v1", "full", ret));
+    
+    // evict the expired decisions when full.
+    MockSrsHttpHooks::decisions["0"].expire = srs_get_system_time_ms() - 1;
+    MockSrsHttpHooks::decisions["1"].expire = srs_get_system_time_ms() - 1;
+    MockSrsHttpHooks::save_decision("v1", "full", ERROR_SUCCESS);
+    EXPECT_EQ(SRS_HTTP_HOOK_MAX_DECISIONS - 1, (int)MockSrsHttpHooks::decisions.size());
+    EXPECT_TRUE(MockSrsHttpHooks::fetch_decision("v1", "full", ret));
+    EXPECT_FALSE(MockSrsHttpHooks::fetch_decision("v1", "0", ret));
+    
+    MockSrsHttpHooks::decisions.clear();
+}
+
+VOID TEST(AppHttpHooksTest, CacheDecisionOnly)
+{
+    MockSrsGlobalConfig gc;
+    ASSERT_TRUE(ERROR_SUCCESS == gc.conf.parse(_MIN_OK_CONF"vhost v1 {http_hooks {enabled on; cache_ttl 10;}}"));
+    ASSERT_EQ(0, st_init());
+    
+    MockSrsHttpHooks::decisions.clear();
+    
+    EXPECT_TRUE(MockSrsHttpHooks::is_decision(SRS_CONSTS_HTTP_OK, ERROR_SUCCESS));
+    EXPECT_TRUE(MockSrsHttpHooks::is_decision(SRS_CONSTS_HTTP_OK, ERROR_RESPONSE_CODE));
+    EXPECT_FALSE(MockSrsHttpHooks::is_decision(SRS_CONSTS_HTTP_OK, ERROR_HTTP_DATA_INVALID));
+    EXPECT_FALSE(MockSrsHttpHooks::is_decision(500, ERROR_HTTP_STATUS_INVALID));
+    EXPECT_FALSE(MockSrsHttpHooks::is_decision(0, ERROR_SOCKET_CONNECT));
+    
+    MockSrsHttpServer server(MOCK_HTTP_SERVER_PORT);
+    ASSERT_TRUE(ERROR_SUCCESS == server.listen());
+    
+    SrsRequest req;
+    req.ip = "192.168.1.10";
+    req.vhost = "v1";
+    req.app = "live";
+    req.stream = "livestream";
+    
+    std::stringstream ss;
+    ss << "http://127.0.0.1:" << MOCK_HTTP_SERVER_PORT << "/api/v1/sessions";
+    string url = ss.str();
+    
+    // never cache the 5xx response.
+    server.status = 500;
+    EXPECT_TRUE(ERROR_HTTP_STATUS_INVALID == SrsHttpHooks::on_play(url, &req));
+    EXPECT_EQ(0, (int)MockSrsHttpHooks::decisions.size());
+    
+    // never cache the malformed response.
+    server.status = SRS_CONSTS_HTTP_OK;
+    server.body = "{\"data\": 0}";
+    EXPECT_TRUE(ERROR_HTTP_DATA_INVALID == SrsHttpHooks::on_play(url, &req));
+    EXPECT_EQ(0, (int)MockSrsHttpHooks::decisions.size());
+    
+    // cache the deny of server, use it without request.
+    server.body = "{\"code\": 1}";
+    EXPECT_TRUE(ERROR_RESPONSE_CODE == SrsHttpHooks::on_play(url, &req));
+    EXPECT_EQ(1, (int)MockSrsHttpHooks::decisions.size());
+    
+    int nb_requests = server.nb_requests;
+    server.body = "0";
+    EXPECT_TRUE(ERROR_RESPONSE_CODE == SrsHttpHooks::on_play(url, &req));
+    EXPECT_EQ(nb_requests, server.nb_requests);
+    
+    // cache the allow of server.
+    EXPECT_TRUE(ERROR_SUCCESS == SrsHttpHooks::on_connect(url, &req));
+    EXPECT_EQ(2, (int)MockSrsHttpHooks::decisions.size());
+    
+    MockSrsHttpHooks::decisions.clear();
+}
+
+VOID TEST(AppHttpClientPoolTest, AcquireRelease)
+{
+    ASSERT_EQ(0, st_init());
+    
+    MockSrsHttpServer server(MOCK_HTTP_SERVER_PORT);
+    ASSERT_TRUE(ERROR_SUCCESS == server.listen());
+    
+    SrsHttpClientPool pool;
+    
+    SrsHttpClient* c0 = NULL;
+    ASSERT_TRUE(ERROR_SUCCESS == pool.acquire("127.0.0.1", MOCK_HTTP_SERVER_PORT, 1000 * 1000, &c0));
+    EXPECT_FALSE(c0->is_connected());
+    
+    if (true) {
+        ISrsHttpMessage* msg = NULL;
+        ASSERT_TRUE(ERROR_SUCCESS == c0->post("/api/v1/sessions", "{}", &msg));
+        SrsAutoFree(ISrsHttpMessage, msg);
+        
+        string res;
+        EXPECT_TRUE(ERROR_SUCCESS == msg->body_read_all(res));
+        EXPECT_STREQ("0", res.c_str());
+    }
+    EXPECT_TRUE(c0->is_connected());
+    pool.release(c0, true);
+    
+    // reuse the keep-alive client.
+    SrsHttpClient* c1 = NULL;
+    ASSERT_TRUE(ERROR_SUCCESS == pool.acquire("127.0.0.1", MOCK_HTTP_SERVER_PORT, 1000 * 1000, &c1));
+    EXPECT_EQ(c0, c1);
+    EXPECT_TRUE(c1->is_connected());
+    
+    // new client when no idle one.
+    SrsHttpClient* c2 = NULL;
+    ASSERT_TRUE(ERROR_SUCCESS == pool.acquire("127.0.0.1", MOCK_HTTP_SERVER_PORT, 1000 * 1000, &c2));
+    EXPECT_NE(c1, c2);
+    EXPECT_FALSE(c2->is_connected());
+    
+    pool.release(c2, true);
+    pool.release(c1, false);
+    
+    // busy when exceed the max connections, until released.
+    std::vector<SrsHttpClient*> clients;
+    for (int i = 0; i < SRS_HTTP_CLIENT_POOL_MAX_CONNS; i++) {
+        SrsHttpClient* c = NULL;
+        ASSERT_TRUE(ERROR_SUCCESS == pool.acquire("127.0.0.1", MOCK_HTTP_SERVER_PORT, 1000 * 1000, &c));
+        clients.push_back(c);
+    }
+    
+    SrsHttpClient* c3 = NULL;
+    EXPECT_TRUE(ERROR_HTTP_CLIENT_POOL_BUSY == pool.acquire("127.0.0.1", MOCK_HTTP_SERVER_PORT, 100 * 1000, &c3));
+    
+    // the other server is not limited.
+    EXPECT_TRUE(ERROR_SUCCESS == pool.acquire("127.0.0.1", MOCK_HTTP_SERVER_PORT + 1, 100 * 1000, &c3));
+    pool.release(c3, false);
+    
+    pool.release(clients.back(), false);
+    clients.pop_back();
+    EXPECT_TRUE(ERROR_SUCCESS == pool.acquire("127.0.0.1", MOCK_HTTP_SERVER_PORT, 100 * 1000, &c3));
+    clients.push_back(c3);
+    
+    for (int i = 0; i < (int)clients.size(); i++) {
+        pool.release(clients.at(i), false);
+    }
+}
+
+VOID TEST(AppHttpClientPoolTest, CanRetry)
+{
+    ASSERT_EQ(0, st_init());
+    
+    MockSrsHttpServer server(MOCK_HTTP_SERVER_PORT);
+    ASSERT_TRUE(ERROR_SUCCESS == server.listen());
+    
+    SrsHttpClientPool pool;
+    ISrsHttpMessage* msg = NULL;
+    
+    // retry when server closed the connection before response.
+    server.close_request = true;
+    SrsHttpClient* c0 = NULL;
+    ASSERT_TRUE(ERROR_SUCCESS == pool.acquire("127.0.0.1", MOCK_HTTP_SERVER_PORT, 1000 * 1000, &c0));
+    EXPECT_TRUE(ERROR_SUCCESS != c0->post("/api/v1/sessions", "{}", &msg));
+    EXPECT_TRUE(c0->can_retry());
+    EXPECT_FALSE(c0->is_connected());
+    
+    // the retry request got response.
+    server.close_request = false;
+    EXPECT_TRUE(ERROR_SUCCESS == c0->post("/api/v1/sessions", "{}", &msg));
+    EXPECT_FALSE(c0->can_retry());
+    srs_freep(msg);
+    pool.release(c0, false);
+    
+    // never retry when connect failed.
+    SrsHttpClient* c1 = NULL;
+    ASSERT_TRUE(ERROR_SUCCESS == pool.acquire("127.0.0.1", MOCK_HTTP_SERVER_PORT + 1, 1000 * 1000, &c1));
+    EXPECT_TRUE(ERROR_SUCCESS != c1->post("/api/v1/sessions", "{}", &msg));
+    EXPECT_FALSE(c1->can_retry());
+    pool.release(c1, false);
+}
+
+#endif
+
+#ifdef SRS_AUTO_HTTP_SERVER
+
+/**
+* dump the ts chunks after cursor, return the first byte of each chunk.
+*/
+string srs_utest_dump_chunks(MockSrsTsStreamCache* cache, int64_t& cursor, int max)
+{
+    SrsMessageArray msgs(max);
+    
+    int count = 0;
+    if (cache->dump_chunks(cursor, &msgs, count) != ERROR_SUCCESS) {
+        return "error";
+    }
+    
+    string heads;
+    for (int i = 0; i < count; i++) {
+        SrsSharedPtrMessage* msg = msgs.msgs[i];
+        heads.append(msg->payload, 1);
+        srs_freep(msg);
+    }
+    
+    return heads;
+}
+
+VOID TEST(AppTsStreamCacheTest, ChunkWriter)
+{
+    SrsTsChunkWriter writer;
+    EXPECT_TRUE(NULL == writer.detach());
+    
+    EXPECT_TRUE(ERROR_SUCCESS == writer.write((void*)"abc", 3, NULL));
+    EXPECT_EQ(3, (int)writer.tellg());
+    
+    SrsSharedPtrMessage* msg = writer.detach();
+    ASSERT_TRUE(NULL != msg);
+    EXPECT_EQ(0, (int)writer.tellg());
+    EXPECT_EQ(3, msg->size);
+    EXPECT_EQ(0, memcmp(msg->payload, "abc", 3));
+    
+    // the chunk shares the packets by refcount.
+    if (true) {
+        SrsTsChunk chunk(0, true, msg);
+        SrsSharedPtrMessage* cp = chunk.packets->copy();
+        EXPECT_TRUE(cp->payload == msg->payload);
+        srs_freep(cp);
+    }
+    
+    // grow the block for large chunk.
+    char packet[188];
+    int nb_packets = 0;
+    for (; nb_packets < 512; nb_packets++) {
+        memset(packet, (char)nb_packets, sizeof(packet));
+        EXPECT_TRUE(ERROR_SUCCESS == writer.write(packet, sizeof(packet), NULL));
+    }
+    EXPECT_EQ(512 * 188, (int)writer.tellg());
+    
+    msg = writer.detach();
+    ASSERT_TRUE(NULL != msg);
+    SrsAutoFree(SrsSharedPtrMessage, msg);
+    EXPECT_EQ(512 * 188, msg->size);
+    for (int i = 0; i < nb_packets; i++) {
+        EXPECT_EQ((char)i, msg->payload[i * 188]);
+        EXPECT_EQ((char)i, msg->payload[i * 188 + 187]);
+    }
+}
+
+VOID TEST(AppTsStreamCacheTest, Cursor)
+{
+    ASSERT_EQ(0, st_init());
+    
+    SrsRequest req;
+    MockSrsTsStreamCache cache(&req);
+    
+    // wait for the keyframe to start.
+    int64_t cursor = -1;
+    EXPECT_STREQ("", srs_utest_dump_chunks(&cache, cursor, 8).c_str());
+    EXPECT_EQ(-1, cursor);
+    
+    cache.append(false);
+    EXPECT_STREQ("", srs_utest_dump_chunks(&cache, cursor, 8).c_str());
+    EXPECT_EQ(-1, cursor);
+    
+    // start from the keyframe.
+    cache.append(true);
+    cache.append(false);
+    EXPECT_STREQ("PA", srs_utest_dump_chunks(&cache, cursor, 8).c_str());
+    EXPECT_EQ(3, cursor);
+    
+    cache.append(false);
+    EXPECT_STREQ("A", srs_utest_dump_chunks(&cache, cursor, 8).c_str());
+    EXPECT_EQ(4, cursor);
+    EXPECT_STREQ("", srs_utest_dump_chunks(&cache, cursor, 8).c_str());
+    EXPECT_EQ(4, cursor);
+    
+    // consume the chunks in batches.
+    for (int i = 0; i < 10; i++) {
+        cache.append(false);
+    }
+    EXPECT_STREQ("AAAAAAAA", srs_utest_dump_chunks(&cache, cursor, 8).c_str());
+    EXPECT_EQ(12, cursor);
+    EXPECT_STREQ("AA", srs_utest_dump_chunks(&cache, cursor, 8).c_str());
+    EXPECT_EQ(14, cursor);
+    
+    // remove the chunks before the previous keyframe.
+    cache.append(true);
+    cache.append(true);
+    for (int i = 0; i < 6; i++) {
+        cache.append(false);
+    }
+    EXPECT_EQ(16, (int)cache.chunks.size());
+    EXPECT_EQ(6, cache.chunks.front()->sequence);
+    EXPECT_EQ(15, cache.last_key_sequence);
+    
+    // the slow viewer jump to the last keyframe.
+    cursor = 2;
+    EXPECT_STREQ("PAAAAAA", srs_utest_dump_chunks(&cache, cursor, 8).c_str());
+    EXPECT_EQ(22, cursor);
+    
+    // restart from keyframe when remux is stopped.
+    cache.stop();
+    EXPECT_TRUE(cache.chunks.empty());
+    EXPECT_STREQ("", srs_utest_dump_chunks(&cache, cursor, 8).c_str());
+    EXPECT_EQ(-1, cursor);
+}
+
+VOID TEST(AppTsStreamCacheTest, KeyChunkAlign)
+{
+    ASSERT_EQ(0, st_init());
+    
+    SrsRequest req;
+    MockSrsTsStreamCache cache(&req);
+    
+    SrsSharedPtrMessage audio;
+    srs_utest_shared_message(&audio, false, 0, (char)0xaf, 0x01);
+    SrsSharedPtrMessage inter;
+    srs_utest_shared_message(&inter, true, 0, 0x27, 0x01);
+    SrsSharedPtrMessage key;
+    srs_utest_shared_message(&key, true, 0, 0x17, 0x01);
+    SrsSharedPtrMessage sh;
+    srs_utest_shared_message(&sh, true, 0, 0x17, 0x00);
+    
+    // for pure audio, each chunk starts with PAT/PMT.
+    EXPECT_TRUE(ERROR_SUCCESS == cache.write_message(&audio));
+    EXPECT_TRUE(ERROR_SUCCESS == cache.write_message(&audio));
+    cache.flush_chunk();
+    ASSERT_EQ(1, (int)cache.chunks.size());
+    EXPECT_TRUE(cache.chunks.back()->is_key);
+    EXPECT_EQ(0, memcmp("PAA", cache.chunks.back()->packets->payload, 3));
+    
+    // the video never starts chunk except the keyframe.
+    EXPECT_TRUE(ERROR_SUCCESS == cache.write_message(&inter));
+    EXPECT_TRUE(ERROR_SUCCESS == cache.write_message(&audio));
+    
+    // the keyframe flush the chunk, and starts a new chunk with PAT/PMT.
+    EXPECT_TRUE(ERROR_SUCCESS == cache.write_message(&key));
+    ASSERT_EQ(2, (int)cache.chunks.size());
+    EXPECT_FALSE(cache.chunks.back()->is_key);
+    EXPECT_EQ(2, cache.chunks.back()->packets->size);
+    EXPECT_EQ(0, memcmp("VA", cache.chunks.back()->packets->payload, 2));
+    
+    // the sequence header is not keyframe.
+    EXPECT_TRUE(ERROR_SUCCESS == cache.write_message(&sh));
+    EXPECT_TRUE(ERROR_SUCCESS == cache.write_message(&audio));
+    cache.flush_chunk();
+    ASSERT_EQ(3, (int)cache.chunks.size());
+    EXPECT_TRUE(cache.chunks.back()->is_key);
+    EXPECT_EQ(4, cache.chunks.back()->packets->size);
+    EXPECT_EQ(0, memcmp("PVVA", cache.chunks.back()->packets->payload, 4));
+    EXPECT_EQ(2, cache.last_key_sequence);
+}
+
+/**
+* the http server notify the streams of vhost to apply the mw config.
+*/
+VOID TEST(AppHttpStreamTest, ReloadMw)
+{
+    MockSrsGlobalConfig gc;
+    ASSERT_TRUE(ERROR_SUCCESS == gc.conf.parse(_MIN_OK_CONF"vhost v1 {http_remux {enabled on; mw_latency 100; mw_msgs 5;}}"));
+    
+    SrsRequest req;
+    req.vhost = "v1";
+    req.app = "live";
+    req.stream = "livestream";
+    MockSrsLiveStream stream(&req);
+    MockSrsTsStreamCache cache(&req);
+    
+    SrsHttpStreamServer server(NULL);
+    SrsLiveEntry* entry = new SrsLiveEntry("[vhost]/[app]/[stream].ts", false);
+    entry->stream = &stream;
+    entry->ts_cache = &cache;
+    server.sflvs[req.get_stream_url()] = entry;
+    
+    // ignore the other vhosts.
+    EXPECT_TRUE(ERROR_SUCCESS == server.on_reload_vhost_mw("v2"));
+    EXPECT_EQ(SRS_PERF_MW_SLEEP, stream.mw_sleep);
+    EXPECT_EQ(SRS_PERF_MW_SLEEP, cache.mw_sleep);
+    
+    EXPECT_TRUE(ERROR_SUCCESS == server.on_reload_vhost_mw("v1"));
+    EXPECT_EQ(100, stream.mw_sleep);
+    EXPECT_EQ(5, stream.mw_msgs);
+    EXPECT_EQ(100, cache.mw_sleep);
+    EXPECT_EQ(5, cache.mw_msgs);
+    
+    // the realtime and http remux changed, apply the new config.
+    if (true) {
+        MockSrsGlobalConfig reload;
+        ASSERT_TRUE(ERROR_SUCCESS == reload.conf.parse(_MIN_OK_CONF"vhost v1 {min_latency on; http_remux {enabled on; mw_latency 350;}}"));
+        
+        EXPECT_TRUE(ERROR_SUCCESS == server.on_reload_vhost_realtime("v1"));
+        EXPECT_TRUE(stream.realtime);
+        EXPECT_EQ(350, stream.mw_sleep);
+        EXPECT_EQ(0, stream.mw_msgs);
+        EXPECT_TRUE(cache.realtime);
+        EXPECT_EQ(350, cache.mw_sleep);
+        EXPECT_EQ(0, cache.mw_msgs);
+    }
+    
+    EXPECT_TRUE(ERROR_SUCCESS == stream.on_reload_vhost_http_remux_updated("v1"));
+    EXPECT_FALSE(stream.realtime);
+    EXPECT_EQ(100, stream.mw_sleep);
+    EXPECT_EQ(5, stream.mw_msgs);
+}
+
+#endif
+
+/**
+* dump the bytes of the flushed blocks.
+*/
+string srs_utest_dump_hls_buffer(SrsHlsSharedBuffer* buf)
+{
+    std::vector<iovec> iovs(buf->size());
+    if (!iovs.empty()) {
+        buf->dump(&iovs[0]);
+    }
+    
+    string bytes;
+    for (int i = 0; i < (int)iovs.size(); i++) {
+        bytes.append((char*)iovs[i].iov_base, iovs[i].iov_len);
+    }
+    
+    return bytes;
+}
+
+/**
+* the bytes for buffer, never repeat in a block.
+*/
+string srs_utest_hls_bytes(int size)
+{
+    string bytes;
+    for (int i = 0; i < size; i++) {
+        bytes.append(1, (char)(i % 251));
+    }
+    return bytes;
+}
+
+/**
+* the block grows from 4KB to 64KB, each full block is flushed.
+*/
+VOID TEST(AppHlsSharedBufferTest, AppendBlocks)
+{
+    int sizes[] = {4096, 8192, 16384, 32768, 65536, 65536};
+    int nb_full = 0;
+    for (int i = 0; i < (int)(sizeof(sizes) / sizeof(int)); i++) {
+        nb_full += sizes[i];
+    }
+    
+    string bytes = srs_utest_hls_bytes(nb_full + 100);
+    
+    SrsHlsSharedBuffer buf;
+    for (int pos = 0; pos < (int)bytes.length(); pos += 1000) {
+        int size = srs_min(1000, (int)bytes.length() - pos);
+        buf.append((char*)bytes.data() + pos, size);
+    }
+    
+    // the partial block is not visible.
+    EXPECT_EQ(6, buf.size());
+    EXPECT_EQ(nb_full, buf.length());
+    
+    buf.flush();
+    ASSERT_EQ(7, buf.size());
+    EXPECT_EQ((int64_t)bytes.length(), buf.length());
+    
+    iovec iovs[7];
+    buf.dump(iovs);
+    for (int i = 0; i < 6; i++) {
+        EXPECT_EQ(sizes[i], (int)iovs[i].iov_len);
+    }
+    EXPECT_EQ(100, (int)iovs[6].iov_len);
+    
+    EXPECT_TRUE(bytes == srs_utest_dump_hls_buffer(&buf));
+}
+
+/**
+* flush the block in writing, ignore when nothing to flush.
+*/
+VOID TEST(AppHlsSharedBufferTest, FlushPartial)
+{
+    SrsHlsSharedBuffer buf;
+    buf.flush();
+    EXPECT_EQ(0, buf.size());
+    EXPECT_EQ(0, buf.length());
+    
+    buf.append((char*)"hello", 5);
+    EXPECT_EQ(0, buf.size());
+    EXPECT_EQ(0, buf.length());
+    
+    buf.flush();
+    EXPECT_EQ(1, buf.size());
+    EXPECT_EQ(5, buf.length());
+    
+    buf.flush();
+    EXPECT_EQ(1, buf.size());
+    
+    // the partial block never grows the block size, the next block is 4KB.
+    string bytes = srs_utest_hls_bytes(4096);
+    buf.append((char*)bytes.data(), (int)bytes.length());
+    EXPECT_EQ(2, buf.size());
+    EXPECT_EQ(4101, buf.length());
+    
+    buf.append((char*)"srs", 3);
+    buf.flush();
+    EXPECT_EQ(3, buf.size());
+    EXPECT_TRUE("hello" + bytes + "srs" == srs_utest_dump_hls_buffer(&buf));
+}
+
+/**
+* the copy shares the flushed blocks, and keeps them after the source freed.
+*/
+VOID TEST(AppHlsSharedBufferTest, CopySurvivesFree)
+{
+    string bytes = srs_utest_hls_bytes(5000);
+    
+    SrsHlsSharedBuffer* buf = new SrsHlsSharedBuffer();
+    buf->append((char*)bytes.data(), (int)bytes.length());
+    
+    // the copy only has the flushed blocks.
+    SrsHlsSharedBuffer* cp = buf->copy();
+    SrsAutoFree(SrsHlsSharedBuffer, cp);
+    EXPECT_EQ(1, cp->size());
+    EXPECT_EQ(4096, cp->length());
+    
+    buf->flush();
+    SrsHlsSharedBuffer* all = buf->copy();
+    SrsAutoFree(SrsHlsSharedBuffer, all);
+    EXPECT_EQ(2, all->size());
+    
+    // the copy never copy the bytes.
+    iovec src[2], dst[2];
+    buf->dump(src);
+    all->dump(dst);
+    EXPECT_EQ(src[0].iov_base, dst[0].iov_base);
+    EXPECT_EQ(src[1].iov_base, dst[1].iov_base);
+    
+    srs_freep(buf);
+    
+    EXPECT_EQ(5000, all->length());
+    EXPECT_TRUE(bytes == srs_utest_dump_hls_buffer(all));
+    EXPECT_TRUE(bytes.substr(0, 4096) == srs_utest_dump_hls_buffer(cp));
+    
+    // the copy of copy shares the blocks too.
+    SrsHlsSharedBuffer* cp2 = all->copy();
+    srs_freep(cp2);
+    EXPECT_TRUE(bytes == srs_utest_dump_hls_buffer(all));
+}
+
+MockSrsDnsResolver::MockSrsDnsResolver()
+{
+}
+
+MockSrsDnsResolver::~MockSrsDnsResolver()
+{
+}
+
+/**
+* the names to query, apply the search list by ndots like libc.
+*/
+VOID TEST(AppDnsTest, SearchNames)
+{
+    MockSrsDnsResolver dns;
+    
+    // without search list.
+    std::vector<std::string> names = dns.search_names("www");
+    ASSERT_EQ(1, (int)names.size());
+    EXPECT_STREQ("www", names[0].c_str());
+    
+    dns.searches.push_back("ossrs.net");
+    dns.searches.push_back("example.com");
+    
+    // less dots than ndots, the search list first.
+    names = dns.search_names("www");
+    ASSERT_EQ(3, (int)names.size());
+    EXPECT_STREQ("www.ossrs.net", names[0].c_str());
+    EXPECT_STREQ("www.example.com", names[1].c_str());
+    EXPECT_STREQ("www", names[2].c_str());
+    
+    // enough dots, the host as is first.
+    names = dns.search_names("a.b");
+    ASSERT_EQ(3, (int)names.size());
+    EXPECT_STREQ("a.b", names[0].c_str());
+    EXPECT_STREQ("a.b.ossrs.net", names[1].c_str());
+    EXPECT_STREQ("a.b.example.com", names[2].c_str());
+    
+    // the absolute host never apply the search list.
+    names = dns.search_names("a.b.");
+    ASSERT_EQ(1, (int)names.size());
+    EXPECT_STREQ("a.b", names[0].c_str());
+    
+    dns.ndots = 3;
+    names = dns.search_names("a.b");
+    ASSERT_EQ(3, (int)names.size());
+    EXPECT_STREQ("a.b.ossrs.net", names[0].c_str());
+    EXPECT_STREQ("a.b", names[2].c_str());
+    
+    dns.ndots = 0;
+    names = dns.search_names("www");
+    ASSERT_EQ(3, (int)names.size());
+    EXPECT_STREQ("www", names[0].c_str());
+}
+
+VOID TEST(AppDnsTest, RandomId)
+{
+    u_int16_t id = srs_dns_random_id();
+    
+    int nb_same = 0;
+    for (int i = 0; i < 1000; i++) {
+        if (srs_dns_random_id() == id) {
+            nb_same++;
+        }
+    }
+    EXPECT_GT(10, nb_same);
+}
+
+VOID TEST(AppDnsTest, EncodeQuery)
+{
+    char buf[SRS_DNS_MAX_MESSAGE];
+    int size = 0;
+    
+    EXPECT_TRUE(ERROR_SUCCESS == srs_dns_encode_query(0x1234, "www.ossrs.net", buf, sizeof(buf), &size));
+    ASSERT_EQ(12 + 15 + 4, size);
+    EXPECT_EQ(0x12, buf[0]);
+    EXPECT_EQ(0x34, buf[1]);
+    EXPECT_EQ(1, buf[5]);
+    EXPECT_EQ(0, memcmp("\003www\005ossrs\003net\000\000\001\000\001", buf + 12, 19));
+    
+    // the invalid hosts.
+    EXPECT_FALSE(ERROR_SUCCESS == srs_dns_encode_query(0, "", buf, sizeof(buf), &size));
+    EXPECT_FALSE(ERROR_SUCCESS == srs_dns_encode_query(0, "www..net", buf, sizeof(buf), &size));
+    EXPECT_FALSE(ERROR_SUCCESS == srs_dns_encode_query(0, std::string(64, 'a') + ".net", buf, sizeof(buf), &size));
+    EXPECT_FALSE(ERROR_SUCCESS == srs_dns_encode_query(0, "www.ossrs.net", buf, 20, &size));
+}
+
+/**
+* build the dns response of query, append the answers in bytes.
+*/
+class MockDnsResponse
+{
+public:
+    char buf[SRS_DNS_MAX_MESSAGE];
+    int size;
+    int nb_answers;
+public:
+    MockDnsResponse(u_int16_t id, std::string host, u_int16_t flags)
+    {
+        size = 0;
+        nb_answers = 0;
+        srs_dns_encode_query(id, host, buf, sizeof(buf), &size);
+        buf[2] = (char)(flags >> 8);
+        buf[3] = (char)flags;
+    }
+public:
+    /**
+    * append the answer, the name maybe compressed.
+    * @return the offset of the data of answer.
+    */
+    int answer(const char* name, int nb_name, int type, int ttl, const char* data, int nb_data)
+    {
+        append(name, nb_name);
+        
+        char v[] = {
+            (char)(type >> 8), (char)type, 0x00, 0x01,
+            (char)(ttl >> 24), (char)(ttl >> 16), (char)(ttl >> 8), (char)ttl,
+            (char)(nb_data >> 8), (char)nb_data
+        };
+        append(v, sizeof(v));
+        
+        int offset = size;
+        append(data, nb_data);
+        
+        nb_answers++;
+        buf[6] = (char)(nb_answers >> 8);
+        buf[7] = (char)nb_answers;
+        
+        return offset;
+    }
+    void append(const char* data, int nb_data)
+    {
+        memcpy(buf + size, data, nb_data);
+        size += nb_data;
+    }
+};
+
+/**
+* the name of answer maybe compressed by pointer, to the prior name only.
+*/
+VOID TEST(AppDnsTest, DecodePointer)
+{
+    std::string ip;
+    int ttl = 0;
+    
+    // the pointer to the question.
+    if (true) {
+        MockDnsResponse res(0x1234, "www.ossrs.net", 0x8180);
+        res.answer("\xc0\x0c", 2, 1, 600, "\x01\x02\x03\x04", 4);
+        EXPECT_TRUE(ERROR_SUCCESS == srs_dns_decode_response(0x1234, "www.ossrs.net", res.buf, res.size, ip, ttl));
+        EXPECT_STREQ("1.2.3.4", ip.c_str());
+        EXPECT_EQ(600, ttl);
+    }
+    
+    // the label ends with pointer to the domain of question.
+    if (true) {
+        MockDnsResponse res(0x1234, "api.ossrs.net", 0x8180);
+        res.answer("\003www\xc0\x10", 6, 1, 1, "\x01\x02\x03\x05", 4);
+        res.answer("\003api\xc0\x10", 6, 1, 600000, "\x01\x02\x03\x06", 4);
+        EXPECT_TRUE(ERROR_SUCCESS == srs_dns_decode_response(0x1234, "api.ossrs.net", res.buf, res.size, ip, ttl));
+        EXPECT_STREQ("1.2.3.6", ip.c_str());
+        EXPECT_EQ(SRS_DNS_MAX_TTL, ttl);
+    }
+    
+    // the pointer to itself or forward, which maybe loop.
+    if (true) {
+        MockDnsResponse res(0x1234, "www.ossrs.net", 0x8180);
+        char name[] = {(char)0xc0, (char)res.size};
+        res.answer(name, 2, 1, 600, "\x01\x02\x03\x04", 4);
+        EXPECT_FALSE(ERROR_SUCCESS == srs_dns_decode_response(0x1234, "www.ossrs.net", res.buf, res.size, ip, ttl));
+    }
+    
+    // the pointer out of message.
+    if (true) {
+        MockDnsResponse res(0x1234, "www.ossrs.net", 0x8180);
+        res.answer("\xc0", 1, 1, 600, "", 0);
+        EXPECT_FALSE(ERROR_SUCCESS == srs_dns_decode_response(0x1234, "www.ossrs.net", res.buf, res.size - 10, ip, ttl));
+    }
+}
+
+/**
+* follow the CNAME chain of host to the A record, ignore the records of others.
+*/
+VOID TEST(AppDnsTest, DecodeCnameChain)
+{
+    std::string ip;
+    int ttl = 0;
+    
+    if (true) {
+        MockDnsResponse res(0x1234, "www.ossrs.net", 0x8180);
+        int cname = res.answer("\xc0\x0c", 2, 5, 20, "\003cdn\007example\003com\000", 17);
+        res.answer("\005other\003net\000", 11, 1, 600, "\x09\x09\x09\x09", 4);
+        char name[] = {(char)0xc0, (char)cname};
+        res.answer(name, 2, 1, 30, "\x05\x06\x07\x08", 4);
+        EXPECT_TRUE(ERROR_SUCCESS == srs_dns_decode_response(0x1234, "www.ossrs.net", res.buf, res.size, ip, ttl));
+        EXPECT_STREQ("5.6.7.8", ip.c_str());
+        EXPECT_EQ(20, ttl);
+    }
+    
+    // the CNAME of CNAME, with the pointer in data.
+    if (true) {
+        MockDnsResponse res(0x1234, "www.ossrs.net", 0x8180);
+        int cname = res.answer("\xc0\x0c", 2, 5, 600, "\003cdn\xc0\x10", 6);
+        char name[] = {(char)0xc0, (char)cname};
+        int cname2 = res.answer(name, 2, 5, 600, "\004edge\xc0\x10", 7);
+        char name2[] = {(char)0xc0, (char)cname2};
+        res.answer(name2, 2, 1, 600, "\x05\x06\x07\x09", 4);
+        EXPECT_TRUE(ERROR_SUCCESS == srs_dns_decode_response(0x1234, "www.ossrs.net", res.buf, res.size, ip, ttl));
+        EXPECT_STREQ("5.6.7.9", ip.c_str());
+    }
+    
+    // the A record of other name, not in chain.
+    if (true) {
+        MockDnsResponse res(0x1234, "www.ossrs.net", 0x8180);
+        res.answer("\xc0\x0c", 2, 5, 20, "\003cdn\007example\003com\000", 17);
+        res.answer("\xc0\x0c", 2, 1, 600, "\x09\x09\x09\x09", 4);
+        EXPECT_FALSE(ERROR_SUCCESS == srs_dns_decode_response(0x1234, "www.ossrs.net", res.buf, res.size, ip, ttl));
+    }
+}
+
+/**
+* use the complete answers of truncated response.
+*/
+VOID TEST(AppDnsTest, DecodeTruncated)
+{
+    std::string ip;
+    int ttl = 0;
+    
+    if (true) {
+        MockDnsResponse res(0x1234, "www.ossrs.net", 0x8380);
+        res.answer("\xc0\x0c", 2, 1, 600, "\x01\x02\x03\x04", 4);
+        res.answer("\xc0\x0c", 2, 1, 600, "\x01\x02\x03\x05", 4);
+        EXPECT_TRUE(ERROR_SUCCESS == srs_dns_decode_response(0x1234, "www.ossrs.net", res.buf, res.size - 6, ip, ttl));
+        EXPECT_STREQ("1.2.3.4", ip.c_str());
+    }
+    
+    if (true) {
+        MockDnsResponse res(0x1234, "www.ossrs.net", 0x8380);
+        res.answer("\xc0\x0c", 2, 1, 600, "\x01\x02\x03\x04", 4);
+        EXPECT_FALSE(ERROR_SUCCESS == srs_dns_decode_response(0x1234, "www.ossrs.net", res.buf, res.size - 2, ip, ttl));
+    }
+}
+
+/**
+* the response must echo the id and question, or ignore it.
+*/
+VOID TEST(AppDnsTest, DecodeMismatch)
+{
+    std::string ip;
+    int ttl = 0;
+    
+    MockDnsResponse res(0x1234, "www.ossrs.net", 0x8180);
+    res.answer("\xc0\x0c", 2, 1, 600, "\x01\x02\x03\x04", 4);
+    
+    EXPECT_EQ(ERROR_SYSTEM_DNS_MISMATCH, srs_dns_decode_response(0x1235, "www.ossrs.net", res.buf, res.size, ip, ttl));
+    EXPECT_EQ(ERROR_SYSTEM_DNS_MISMATCH, srs_dns_decode_response(0x1234, "api.ossrs.net", res.buf, res.size, ip, ttl));
+    EXPECT_EQ(ERROR_SYSTEM_DNS_MISMATCH, srs_dns_decode_response(0x1234, "www.ossrs.net", res.buf, 10, ip, ttl));
+    
+    // the name is case-insensitive.
+    EXPECT_TRUE(ERROR_SUCCESS == srs_dns_decode_response(0x1234, "WWW.ossrs.NET", res.buf, res.size, ip, ttl));
+    
+    // the type of question.
+    res.buf[12 + 15 + 1] = 28;
+    EXPECT_EQ(ERROR_SYSTEM_DNS_MISMATCH, srs_dns_decode_response(0x1234, "www.ossrs.net", res.buf, res.size, ip, ttl));
+    res.buf[12 + 15 + 1] = 1;
+    
+    // not response.
+    res.buf[2] = 0x01;
+    EXPECT_EQ(ERROR_SYSTEM_DNS_MISMATCH, srs_dns_decode_response(0x1234, "www.ossrs.net", res.buf, res.size, ip, ttl));
+    
+    // the nxdomain.
+    res.buf[2] = (char)0x81;
+    res.buf[3] = (char)0x83;
+    EXPECT_EQ(ERROR_SYSTEM_DNS_RESOLVE, srs_dns_decode_response(0x1234, "www.ossrs.net", res.buf, res.size, ip, ttl));
+}
+
+MockSrsAsyncIO::MockSrsAsyncIO()
+{
+}
+
+MockSrsAsyncIO::~MockSrsAsyncIO()
+{
+}
+
+#define MOCK_ASYNC_IO_FILE "srs_utest_async_io.tmp"
+
+/**
+* read the whole file to string.
+*/
+std::string mock_read_file(const char* path)
+{
+    std::string v;
+    
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return v;
+    }
+    
+    char buf[4096];
+    ssize_t nread = 0;
+    while ((nread = ::read(fd, buf, sizeof(buf))) > 0) {
+        v.append(buf, nread);
+    }
+    ::close(fd);
+    
+    return v;
+}
+
+/**
+* read the available bytes of the nonblock fd.
+*/
+std::string mock_read_available(int fd)
+{
+    std::string v;
+    
+    char buf[4096];
+    ssize_t nread = 0;
+    while ((nread = ::read(fd, buf, sizeof(buf))) > 0) {
+        v.append(buf, nread);
+    }
+    
+    return v;
+}
+
+/**
+* the writer in place when async io disabled,
+* the bytes are merged and written at the seeked position in order.
+*/
+VOID TEST(AppAsyncIOTest, WriterSeekOrder)
+{
+    SrsAsyncIO* pool = _srs_async_io;
+    _srs_async_io = new SrsAsyncIO();
+    
+    if (true) {
+        SrsAsyncFileWriter writer;
+        ASSERT_TRUE(ERROR_SUCCESS == writer.open(MOCK_ASYNC_IO_FILE));
+        EXPECT_TRUE(writer.is_open());
+        
+        EXPECT_TRUE(ERROR_SUCCESS == writer.write((void*)"abc", 3, NULL));
+        writer.lseek(10);
+        EXPECT_TRUE(ERROR_SUCCESS == writer.write((void*)"xyz", 3, NULL));
+        EXPECT_EQ(13, writer.tellg());
+        writer.lseek(3);
+        EXPECT_TRUE(ERROR_SUCCESS == writer.write((void*)"def", 3, NULL));
+        
+        // the merged bytes are written when seek, the left util close.
+        std::string v = mock_read_file(MOCK_ASYNC_IO_FILE);
+        ASSERT_EQ(13, (int)v.length());
+        EXPECT_EQ(0, v.at(3));
+        
+        writer.close();
+        EXPECT_FALSE(writer.is_open());
+        
+        v = mock_read_file(MOCK_ASYNC_IO_FILE);
+        ASSERT_EQ(13, (int)v.length());
+        EXPECT_EQ(0, memcmp("abcdef", v.data(), 6));
+        EXPECT_EQ(0, memcmp("xyz", v.data() + 10, 3));
+    }
+    
+    // append to the file.
+    if (true) {
+        SrsAsyncFileWriter writer;
+        ASSERT_TRUE(ERROR_SUCCESS == writer.open_append(MOCK_ASYNC_IO_FILE));
+        EXPECT_EQ(13, writer.tellg());
+        EXPECT_TRUE(ERROR_SUCCESS == writer.write((void*)"0", 1, NULL));
+        writer.close();
+        EXPECT_EQ(14, (int)mock_read_file(MOCK_ASYNC_IO_FILE).length());
+    }
+    
+    ::unlink(MOCK_ASYNC_IO_FILE);
+    srs_freep(_srs_async_io);
+    _srs_async_io = pool;
+}
+
+/**
+* the writer flush the merged chunk to io threads, and close wait for all bytes.
+*/
+VOID TEST(AppAsyncIOTest, WriterFlushClose)
+{
+    ASSERT_EQ(0, st_init());
+    
+    SrsAsyncIO* pool = _srs_async_io;
+    _srs_async_io = new SrsAsyncIO();
+    ASSERT_TRUE(ERROR_SUCCESS == _srs_async_io->initialize(2));
+    EXPECT_TRUE(_srs_async_io->enabled());
+    
+    if (true) {
+        SrsAsyncFileWriter writer;
+        ASSERT_TRUE(ERROR_SUCCESS == writer.open(MOCK_ASYNC_IO_FILE));
+        
+        // less than a chunk, merged util close.
+        char buf[1000];
+        for (int i = 0; i < 10; i++) {
+            memset(buf, 'a' + i, sizeof(buf));
+            EXPECT_TRUE(ERROR_SUCCESS == writer.write(buf, sizeof(buf), NULL));
+        }
+        st_usleep(10 * 1000);
+        EXPECT_EQ(0, (int)mock_read_file(MOCK_ASYNC_IO_FILE).length());
+        
+        // the chunks are flushed in order.
+        int nb_chunks = SRS_PERF_ASYNC_IO_CHUNK * 3 / (int)sizeof(buf);
+        for (int i = 10; i < nb_chunks; i++) {
+            memset(buf, 'a' + i % 26, sizeof(buf));
+            EXPECT_TRUE(ERROR_SUCCESS == writer.write(buf, sizeof(buf), NULL));
+        }
+        
+        writer.close();
+        
+        std::string v = mock_read_file(MOCK_ASYNC_IO_FILE);
+        ASSERT_EQ(nb_chunks * (int)sizeof(buf), (int)v.length());
+        for (int i = 0; i < nb_chunks; i++) {
+            EXPECT_EQ('a' + i % 26, v.at(i * sizeof(buf)));
+            EXPECT_EQ('a' + i % 26, v.at(i * sizeof(buf) + sizeof(buf) - 1));
+        }
+    }
+    
+    ::unlink(MOCK_ASYNC_IO_FILE);
+    srs_freep(_srs_async_io);
+    _srs_async_io = pool;
+}
+
+/**
+* the logs are merged, then written when flush, timeout or close.
+*/
+VOID TEST(AppAsyncIOTest, LogBatch)
+{
+    ASSERT_EQ(0, st_init());
+    
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL, 0) | O_NONBLOCK);
+    
+    MockSrsAsyncIO pool;
+    ASSERT_TRUE(ERROR_SUCCESS == pool.initialize(1));
+    
+    // merged, not written.
+    pool.append(fds[1], (char*)"l0\n", 3, false);
+    pool.append(fds[1], (char*)"l1\n", 3, false);
+    EXPECT_EQ(1, (int)pool.batches.size());
+    st_usleep(10 * 1000);
+    EXPECT_STREQ("", mock_read_available(fds[0]).c_str());
+    
+    // written in order when flush.
+    pool.append(fds[1], (char*)"e2\n", 3, true);
+    EXPECT_TRUE(pool.batches.empty());
+    for (int i = 0; i < 100 && pool.full(fds[1]); i++) {
+        st_usleep(10 * 1000);
+    }
+    st_usleep(10 * 1000);
+    EXPECT_STREQ("l0\nl1\ne2\n", mock_read_available(fds[0]).c_str());
+    
+    // written by the io st thread when timeout.
+    pool.append(fds[1], (char*)"l3\n", 3, false);
+    std::string v;
+    for (int i = 0; i < 100 && v.empty(); i++) {
+        st_usleep(10 * 1000);
+        v = mock_read_available(fds[0]);
+    }
+    EXPECT_STREQ("l3\n", v.c_str());
+    
+    // written before the close of fd.
+    pool.append(fds[1], (char*)"l4\n", 3, false);
+    pool.submit(new SrsAsyncIOJob(SrsAsyncIOClose, fds[1], NULL));
+    EXPECT_TRUE(pool.batches.empty());
+    
+    // the pipe is closed after the log written.
+    v = "";
+    for (int i = 0; i < 100; i++) {
+        char buf[64];
+        ssize_t nread = ::read(fds[0], buf, sizeof(buf));
+        if (nread == 0) {
+            break;
+        }
+        if (nread > 0) {
+            v.append(buf, nread);
+        }
+        st_usleep(10 * 1000);
+    }
+    EXPECT_STREQ("l4\n", v.c_str());
+    
+    ::close(fds[0]);
+}
+
+/**
+* the logs are dropped when the queue of io thread is full.
+*/
+VOID TEST(AppAsyncIOTest, LogDrop)
+{
+    ASSERT_EQ(0, st_init());
+    
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    
+    MockSrsAsyncIO pool;
+    pool.max_queue = 1024;
+    ASSERT_TRUE(ERROR_SUCCESS == pool.initialize(1));
+    
+    // the io thread is blocked by the full pipe.
+    int size = 1024 * 1024;
+    SrsAsyncIOJob* job = new SrsAsyncIOJob(SrsAsyncIOWrite, fds[1], NULL);
+    job->buf = new char[size];
+    job->size = size;
+    memset(job->buf, 'x', size);
+    pool.submit(job);
+    EXPECT_TRUE(pool.full(fds[1]));
+    
+    pool.append(fds[1], (char*)"l0\n", 3, true);
+    EXPECT_EQ(1, pool.nb_drops);
+    EXPECT_TRUE(pool.batches.empty());
+    
+    // drain the pipe, then the queue is not full.
+    std::string v;
+    char buf[4096];
+    while ((int)v.length() < size) {
+        ssize_t nread = ::read(fds[0], buf, sizeof(buf));
+        ASSERT_TRUE(nread > 0);
+        v.append(buf, nread);
+    }
+    for (int i = 0; i < 100 && pool.full(fds[1]); i++) {
+        st_usleep(10 * 1000);
+    }
+    EXPECT_FALSE(pool.full(fds[1]));
+    
+    pool.append(fds[1], (char*)"l1\n", 3, true);
+    EXPECT_EQ(1, pool.nb_drops);
+    
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL, 0) | O_NONBLOCK);
+    v = "";
+    for (int i = 0; i < 100 && v.empty(); i++) {
+        st_usleep(10 * 1000);
+        v = mock_read_available(fds[0]);
+    }
+    EXPECT_STREQ("l1\n", v.c_str());
+    
+    ::close(fds[1]);
+    ::close(fds[0]);
+}
@@ -0,0 +1,271 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef SRS_UTEST_APP_HPP
+#define SRS_UTEST_APP_HPP
+
+/*
+#include <srs_utest_app.hpp>
+*/
+#include <srs_core.hpp>
+
+#include <srs_utest.hpp>
+
+#include <vector>
+
+#include <srs_app_ingest_hls.hpp>
+#include <srs_app_source.hpp>
+#include <srs_app_hls.hpp>
+#include <srs_app_publisher.hpp>
+#include <srs_app_listener.hpp>
+#include <srs_app_http_hooks.hpp>
+#include <srs_app_http_stream.hpp>
+#include <srs_app_dns.hpp>
+#include <srs_app_async_io.hpp>
+#include <srs_kernel_ts.hpp>
+#include <srs_utest_config.hpp>
+
+/**
+* use the mock config as the global config in scope,
+* for the source and others use the global config.
+*/
+class MockSrsGlobalConfig
+{
+public:
+    MockSrsConfig conf;
+    SrsConfig* previous;
+public:
+    MockSrsGlobalConfig();
+    virtual ~MockSrsGlobalConfig();
+};
+
+class MockSrsSource : public SrsSource
+{
+public:
+    MockSrsSource();
+    virtual ~MockSrsSource();
+public:
+    using SrsSource::ring;
+    using SrsSource::cache_sh_video;
+};
+
+class MockSrsConsumer : public SrsConsumer
+{
+public:
+    int nb_wakeups;
+public:
+    MockSrsConsumer(SrsSource* s);
+    virtual ~MockSrsConsumer();
+public:
+    virtual void wakeup();
+};
+
+/**
+* the handler of source, for the server is NULL in utest.
+*/
+class MockSrsSourceHandler : public ISrsSourceHandler, public ISrsHlsHandler
+{
+public:
+    int nb_publish;
+    int nb_unpublish;
+public:
+    MockSrsSourceHandler();
+    virtual ~MockSrsSourceHandler();
+public:
+    virtual int on_publish(SrsSource* s, SrsRequest* r);
+    virtual void on_unpublish(SrsSource* s, SrsRequest* r);
+    virtual int on_hls_publish(SrsRequest* r);
+    virtual int on_update_m3u8(SrsRequest* r, std::string m3u8);
+    virtual int on_update_ts(SrsRequest* r, std::string uri, SrsHlsSharedBuffer* ts);
+    virtual int on_remove_ts(SrsRequest* r, std::string uri);
+    virtual int on_hls_unpublish(SrsRequest* r);
+};
+
+/**
+* the local publisher whose unpublish hooks switch context.
+*/
+class MockSrsLocalPublisher : public SrsLocalPublisher
+{
+public:
+    int nb_hooks;
+    // the state of publisher when the unpublish hooks are running.
+    bool hook_publishing;
+    bool hook_finished;
+    // set to true when the hooks are done without interrupted.
+    bool* hook_done;
+public:
+    MockSrsLocalPublisher(bool* done);
+    virtual ~MockSrsLocalPublisher();
+protected:
+    virtual void http_hooks_on_unpublish();
+};
+
+#ifdef SRS_AUTO_HTTP_SERVER
+
+/**
+* the ts encoder writes a byte for each packet,
+* P for PAT/PMT, A for audio and V for video.
+*/
+class MockSrsTsEncoder : public SrsTsEncoder
+{
+private:
+    SrsFileWriter* writer;
+    // write the PAT/PMT before the next packet.
+    bool pat_pmt;
+public:
+    MockSrsTsEncoder();
+    virtual ~MockSrsTsEncoder();
+public:
+    virtual int initialize(SrsFileWriter* fw);
+    virtual int write_audio(int64_t timestamp, char* data, int size);
+    virtual int write_video(int64_t timestamp, char* data, int size);
+    virtual void reset_pat_pmt();
+private:
+    virtual int write_packet(char type);
+};
+
+/**
+* the shared ts remux without source, write chunks by mock encoder.
+*/
+class MockSrsTsStreamCache : public SrsTsStreamCache
+{
+public:
+    MockSrsTsStreamCache(SrsRequest* r);
+    virtual ~MockSrsTsStreamCache();
+public:
+    using SrsTsStreamCache::chunks;
+    using SrsTsStreamCache::last_key_sequence;
+    using SrsTsStreamCache::write_message;
+    using SrsTsStreamCache::flush_chunk;
+    using SrsTsStreamCache::realtime;
+    using SrsTsStreamCache::mw_sleep;
+    using SrsTsStreamCache::mw_msgs;
+public:
+    /**
+    * append a chunk of a ts packet, the key chunk starts with PAT/PMT.
+    */
+    virtual void append(bool key);
+};
+
+class MockSrsLiveStream : public SrsLiveStream
+{
+public:
+    MockSrsLiveStream(SrsRequest* r);
+    virtual ~MockSrsLiveStream();
+public:
+    using SrsLiveStream::realtime;
+    using SrsLiveStream::mw_sleep;
+    using SrsLiveStream::mw_msgs;
+};
+
+#endif
+
+#ifdef SRS_AUTO_HTTP_CALLBACK
+
+class MockSrsHttpHooks : public SrsHttpHooks
+{
+public:
+    using SrsHttpHooks::decisions;
+    using SrsHttpHooks::decision_key;
+    using SrsHttpHooks::fetch_decision;
+    using SrsHttpHooks::save_decision;
+    using SrsHttpHooks::is_decision;
+};
+
+/**
+* the api server of http hooks, response each request of
+* the keep-alive connection with the status and body.
+*/
+class MockSrsHttpServer : public ISrsTcpHandler
+{
+public:
+    SrsTcpListener* listener;
+    int nb_conns;
+    int nb_requests;
+    // close the connection without response when true.
+    bool close_request;
+    int status;
+    std::string body;
+public:
+    MockSrsHttpServer(int port);
+    virtual ~MockSrsHttpServer();
+public:
+    virtual int listen();
+    virtual int on_tcp_client(st_netfd_t stfd);
+private:
+    static void* serve(void* arg);
+    virtual void do_serve(st_netfd_t stfd);
+};
+
+#endif
+
+#if defined(SRS_AUTO_INGEST) && defined(SRS_AUTO_HTTP_CORE)
+
+class MockSrsIngestHls : public SrsIngestHls
+{
+public:
+    // the sequence of delivered segments.
+    std::vector<int64_t> delivered;
+public:
+    MockSrsIngestHls(int jitter);
+    virtual ~MockSrsIngestHls();
+public:
+    using SrsIngestHls::m3u8;
+    using SrsIngestHls::segments;
+    using SrsIngestHls::last_seq;
+    using SrsIngestHls::nb_drops;
+    using SrsIngestHls::parse_m3u8;
+    using SrsIngestHls::shrink;
+    using SrsIngestHls::consume;
+public:
+    virtual void append(int64_t seq, double duration, SrsIngestHlsSegmentState state);
+protected:
+    virtual int publish();
+    virtual int deliver(SrsIngestHlsSegment* segment);
+};
+
+#endif
+
+class MockSrsDnsResolver : public SrsDnsResolver
+{
+public:
+    MockSrsDnsResolver();
+    virtual ~MockSrsDnsResolver();
+public:
+    using SrsDnsResolver::searches;
+    using SrsDnsResolver::ndots;
+    using SrsDnsResolver::search_names;
+};
+
+class MockSrsAsyncIO : public SrsAsyncIO
+{
+public:
+    MockSrsAsyncIO();
+    virtual ~MockSrsAsyncIO();
+public:
+    using SrsAsyncIO::max_queue;
+    using SrsAsyncIO::batches;
+    using SrsAsyncIO::nb_drops;
+};
+
+#endif
@@ -0,0 +1,463 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <srs_utest_benchmark.hpp>
+
+#ifdef ENABLE_UTEST_BENCHMARK
+
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_kernel_stream.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_kernel_ts.hpp>
+#include <srs_kernel_codec.hpp>
+#include <srs_kernel_file.hpp>
+#include <srs_rtmp_amf0.hpp>
+#include <srs_utest_kernel.hpp>
+
+// the bytes of buffer for codec to read and write.
+#define SRS_UTEST_BENCHMARK_BYTES (1024 * 1024)
+
+// the sample ts file for the demuxer, @see research/hls/ts_info.cc
+// @remark use env SRS_UTEST_TS_FILE to specifies the file.
+#define SRS_UTEST_BENCHMARK_TS_FILE "livestream-1347.ts"
+
+/**
+* the benchmark timer, print the MB/s of codec.
+*/
+class MockBenchmark
+{
+private:
+    std::string name;
+    int64_t starttime;
+public:
+    int64_t nb_bytes;
+public:
+    MockBenchmark(std::string n)
+    {
+        name = n;
+        nb_bytes = 0;
+        
+        srs_update_system_time_ms();
+        starttime = srs_get_system_time_ms();
+    }
+    virtual ~MockBenchmark()
+    {
+        srs_update_system_time_ms();
+        int64_t elapsed = srs_max(1, srs_get_system_time_ms() - starttime);
+        printf("benchmark %s: %d MB in %dms, %d MB/s\n", name.c_str(),
+            (int)(nb_bytes / 1024 / 1024), (int)elapsed, (int)(nb_bytes * 1000 / elapsed / 1024 / 1024));
+    }
+};
+
+/**
+* the stream read and write the integers of 1, 2, 3, 4 and 8 bytes.
+*/
+VOID TEST(BenchmarkTest, StreamCodec)
+{
+    char* buf = new char[SRS_UTEST_BENCHMARK_BYTES];
+    SrsAutoFreeA(char, buf);
+    memset(buf, 0x5a, SRS_UTEST_BENCHMARK_BYTES);
+    
+    SrsStream s;
+    EXPECT_EQ(ERROR_SUCCESS, s.initialize(buf, SRS_UTEST_BENCHMARK_BYTES));
+    
+    int sizes[] = {1, 2, 3, 4, 8};
+    for (int i = 0; i < (int)(sizeof(sizes) / sizeof(int)); i++) {
+        int size = sizes[i];
+        int nb_values = SRS_UTEST_BENCHMARK_BYTES / size;
+        
+        char name[32];
+        int64_t sum = 0;
+        if (true) {
+            snprintf(name, sizeof(name), "stream write %dbytes", size);
+            MockBenchmark mb(name);
+            for (int j = 0; j < 32; j++) {
+                s.skip(-s.pos());
+                for (int k = 0; k < nb_values; k++) {
+                    switch (size) {
+                        case 1: s.write_1bytes((int8_t)k); break;
+                        case 2: s.write_2bytes((int16_t)k); break;
+                        case 3: s.write_3bytes(k); break;
+                        case 4: s.write_4bytes(k); break;
+                        default: s.write_8bytes(k); break;
+                    }
+                }
+                mb.nb_bytes += s.pos();
+            }
+        }
+        
+        if (true) {
+            snprintf(name, sizeof(name), "stream read %dbytes", size);
+            MockBenchmark mb(name);
+            for (int j = 0; j < 32; j++) {
+                s.skip(-s.pos());
+                for (int k = 0; k < nb_values; k++) {
+                    switch (size) {
+                        case 1: sum += s.read_1bytes(); break;
+                        case 2: sum += s.read_2bytes(); break;
+                        case 3: sum += s.read_3bytes(); break;
+                        case 4: sum += s.read_4bytes(); break;
+                        default: sum += s.read_8bytes(); break;
+                    }
+                }
+                mb.nb_bytes += s.pos();
+            }
+        }
+        
+        // the last value written is read back.
+        s.skip(-size);
+        switch (size) {
+            case 1: EXPECT_EQ((int8_t)(nb_values - 1), s.read_1bytes()); break;
+            case 2: EXPECT_EQ((int16_t)(nb_values - 1), s.read_2bytes()); break;
+            case 3: EXPECT_EQ(nb_values - 1, s.read_3bytes()); break;
+            case 4: EXPECT_EQ(nb_values - 1, s.read_4bytes()); break;
+            default: EXPECT_EQ(nb_values - 1, s.read_8bytes()); break;
+        }
+        EXPECT_TRUE(sum != 0);
+    }
+}
+
+/**
+* the amf0 encode and decode the numbers.
+*/
+VOID TEST(BenchmarkTest, Amf0Number)
+{
+    char* buf = new char[SRS_UTEST_BENCHMARK_BYTES];
+    SrsAutoFreeA(char, buf);
+    
+    SrsStream s;
+    EXPECT_EQ(ERROR_SUCCESS, s.initialize(buf, SRS_UTEST_BENCHMARK_BYTES));
+    
+    // the marker and 8bytes number.
+    int nb_values = SRS_UTEST_BENCHMARK_BYTES / 9;
+    
+    if (true) {
+        MockBenchmark mb("amf0 write number");
+        for (int j = 0; j < 32; j++) {
+            s.skip(-s.pos());
+            for (int k = 0; k < nb_values; k++) {
+                EXPECT_EQ(ERROR_SUCCESS, srs_amf0_write_number(&s, k + 0.5));
+            }
+            mb.nb_bytes += s.pos();
+        }
+    }
+    
+    double sum = 0;
+    if (true) {
+        MockBenchmark mb("amf0 read number");
+        for (int j = 0; j < 32; j++) {
+            s.skip(-s.pos());
+            for (int k = 0; k < nb_values; k++) {
+                double v = 0;
+                EXPECT_EQ(ERROR_SUCCESS, srs_amf0_read_number(&s, v));
+                sum += v;
+            }
+            mb.nb_bytes += s.pos();
+        }
+    }
+    
+    EXPECT_DOUBLE_EQ(32.0 * nb_values * nb_values / 2, sum);
+}
+
+/**
+* the flv decoder read the tag header, data and previous tag size.
+*/
+VOID TEST(BenchmarkTest, FlvTagHeader)
+{
+    MockSrsFileReader reader;
+    EXPECT_EQ(ERROR_SUCCESS, reader.open(""));
+    
+    // the video tags of 32 bytes data.
+    char tag[11 + 32 + 4];
+    memset(tag, 0, sizeof(tag));
+    tag[0] = SrsCodecFlvTagVideo;
+    tag[3] = 32;
+    tag[7] = 0x01;
+    
+    int nb_tags = SRS_UTEST_BENCHMARK_BYTES / sizeof(tag);
+    for (int i = 0; i < nb_tags; i++) {
+        reader.mock_append_data(tag, sizeof(tag));
+    }
+    
+    char data[32];
+    char pps[4];
+    int64_t sum = 0;
+    
+    if (true) {
+        MockBenchmark mb("flv read tag");
+        for (int j = 0; j < 32; j++) {
+            reader.mock_reset_offset();
+            
+            SrsFlvDecoder dec;
+            EXPECT_EQ(ERROR_SUCCESS, dec.initialize(&reader));
+            
+            for (int k = 0; k < nb_tags; k++) {
+                char type;
+                int32_t size;
+                u_int32_t time;
+                EXPECT_EQ(ERROR_SUCCESS, dec.read_tag_header(&type, &size, &time));
+                EXPECT_EQ(ERROR_SUCCESS, dec.read_tag_data(data, size));
+                EXPECT_EQ(ERROR_SUCCESS, dec.read_previous_tag_size(pps));
+                sum += time;
+            }
+            mb.nb_bytes += nb_tags * sizeof(tag);
+        }
+    }
+    
+    // the extended timestamp is the high 8bits.
+    EXPECT_EQ(32LL * nb_tags * 0x01000000, sum);
+}
+
+class MockTsHandler : public ISrsTsHandler
+{
+public:
+    int nb_msgs;
+    int64_t nb_bytes;
+public:
+    MockTsHandler()
+    {
+        nb_msgs = 0;
+        nb_bytes = 0;
+    }
+    virtual ~MockTsHandler()
+    {
+    }
+public:
+    virtual int on_ts_message(SrsTsMessage* msg)
+    {
+        nb_msgs++;
+        nb_bytes += msg->payload->length();
+        return ERROR_SUCCESS;
+    }
+};
+
+/**
+* the ts context encode and decode the pes of video.
+*/
+VOID TEST(BenchmarkTest, TsPesCodec)
+{
+    MockSrsFileWriter writer;
+    
+    SrsTsMessage msg;
+    msg.sid = SrsTsPESStreamIdVideoCommon;
+    msg.write_pcr = true;
+    char frame[64 * 1024];
+    memset(frame, 0x01, sizeof(frame));
+    msg.payload->append(frame, sizeof(frame));
+    
+    // the frames in a buffer, the decoder need the pat and pmt.
+    int nb_frames = SRS_UTEST_BENCHMARK_BYTES / 2 / sizeof(frame);
+    
+    if (true) {
+        MockBenchmark mb("ts encode pes");
+        for (int j = 0; j < 512; j++) {
+            SrsTsContext ctx;
+            writer.mock_reset_offset();
+            
+            for (int k = 0; k < nb_frames; k++) {
+                msg.dts = msg.pts = k * 3600;
+                EXPECT_EQ(ERROR_SUCCESS, ctx.encode(&writer, &msg, SrsCodecVideoAVC, SrsCodecAudioAAC));
+            }
+            mb.nb_bytes += writer.offset;
+        }
+    }
+    EXPECT_EQ(0, writer.offset % SRS_TS_PACKET_SIZE);
+    
+    // the last pes is completed by the next pes, so add a frame.
+    if (true) {
+        SrsTsContext ctx;
+        writer.mock_reset_offset();
+        for (int k = 0; k < nb_frames + 1; k++) {
+            msg.dts = msg.pts = k * 3600;
+            EXPECT_EQ(ERROR_SUCCESS, ctx.encode(&writer, &msg, SrsCodecVideoAVC, SrsCodecAudioAAC));
+        }
+    }
+    
+    MockTsHandler handler;
+    if (true) {
+        MockBenchmark mb("ts decode pes");
+        for (int j = 0; j < 32; j++) {
+            SrsTsContext ctx;
+            
+            SrsStream s;
+            for (int k = 0; k < writer.offset; k += SRS_TS_PACKET_SIZE) {
+                EXPECT_EQ(ERROR_SUCCESS, s.initialize(writer.data + k, SRS_TS_PACKET_SIZE));
+                EXPECT_EQ(ERROR_SUCCESS, ctx.decode(&s, &handler));
+            }
+            mb.nb_bytes += writer.offset;
+        }
+    }
+    
+    EXPECT_EQ(32 * nb_frames, handler.nb_msgs);
+    EXPECT_EQ(32LL * nb_frames * (int)sizeof(frame), handler.nb_bytes);
+}
+
+/**
+* the ts demuxer of the packet object decoder and the fast decoder,
+* use the sample ts file when exists, or the interleaved audio and video.
+*/
+VOID TEST(BenchmarkTest, TsDemuxer)
+{
+    MockSrsFileWriter writer;
+    writer.mock_reset_offset();
+    
+    std::string file = SRS_UTEST_BENCHMARK_TS_FILE;
+    if (getenv("SRS_UTEST_TS_FILE")) {
+        file = getenv("SRS_UTEST_TS_FILE");
+    }
+    
+    SrsFileReader reader;
+    if (reader.open(file) == ERROR_SUCCESS) {
+        int size = (int)srs_min(reader.filesize(), (int64_t)SRS_UTEST_BENCHMARK_BYTES);
+        ssize_t nread = 0;
+        EXPECT_EQ(ERROR_SUCCESS, reader.read(writer.data, size, &nread));
+        writer.offset = (int)nread / SRS_TS_PACKET_SIZE * SRS_TS_PACKET_SIZE;
+    } else {
+        SrsTsContext ctx;
+        SrsTsMessage msg;
+        char frame[16 * 1024];
+        memset(frame, 0x01, sizeof(frame));
+        
+        for (int k = 0; writer.offset < SRS_UTEST_BENCHMARK_BYTES - 2 * (int)sizeof(frame); k++) {
+            // the video frames of 4KB to 16KB, and the audio frame of 300B.
+            msg.sid = SrsTsPESStreamIdVideoCommon;
+            msg.write_pcr = (k % 25) == 0;
+            msg.dts = msg.pts = k * 3600;
+            msg.payload->erase(msg.payload->length());
+            msg.payload->append(frame, 4096 + (k * 4099) % (12 * 1024));
+            EXPECT_EQ(ERROR_SUCCESS, ctx.encode(&writer, &msg, SrsCodecVideoAVC, SrsCodecAudioAAC));
+            
+            msg.sid = SrsTsPESStreamIdAudioCommon;
+            msg.write_pcr = false;
+            msg.payload->erase(msg.payload->length());
+            msg.payload->append(frame, 300);
+            EXPECT_EQ(ERROR_SUCCESS, ctx.encode(&writer, &msg, SrsCodecVideoAVC, SrsCodecAudioAAC));
+        }
+    }
+    printf("benchmark ts demuxer: %s %dB\n", reader.is_open()? file.c_str() : "synthetic", writer.offset);
+    
+    MockTsHandler slow, fast;
+    for (int i = 0; i < 2; i++) {
+        bool is_fast = (i == 1);
+        MockTsHandler* handler = is_fast? &fast : &slow;
+        MockBenchmark mb(is_fast? "ts demux fast" : "ts demux packet");
+        
+        for (int j = 0; j < 32; j++) {
+            SrsTsContext ctx;
+            ctx.set_fast_decoder(is_fast);
+            
+            SrsStream s;
+            for (int k = 0; k < writer.offset; k += SRS_TS_PACKET_SIZE) {
+                EXPECT_EQ(ERROR_SUCCESS, s.initialize(writer.data + k, SRS_TS_PACKET_SIZE));
+                EXPECT_EQ(ERROR_SUCCESS, ctx.decode(&s, handler));
+            }
+            mb.nb_bytes += writer.offset;
+        }
+    }
+    
+    EXPECT_EQ(slow.nb_msgs, fast.nb_msgs);
+    EXPECT_EQ(slow.nb_bytes, fast.nb_bytes);
+}
+
+/**
+* the ts encoder of the packet object and the fast encoder,
+* encode the 64KB video frames with pcr.
+*/
+VOID TEST(BenchmarkTest, TsEncoder)
+{
+    MockSrsFileWriter writer;
+    
+    SrsTsMessage msg;
+    msg.sid = SrsTsPESStreamIdVideoCommon;
+    msg.write_pcr = true;
+    char frame[64 * 1024];
+    memset(frame, 0x01, sizeof(frame));
+    msg.payload->append(frame, sizeof(frame));
+    
+    int64_t nb_packets[2] = {0, 0};
+    for (int i = 0; i < 2; i++) {
+        bool fast = (i == 1);
+        
+        SrsTsContext ctx;
+        ctx.set_fast_encoder(fast);
+        
+        MockBenchmark mb(fast? "ts encode fast" : "ts encode packet");
+        for (int j = 0; j < 300; j++) {
+            writer.mock_reset_offset();
+            msg.dts = msg.pts = j * 3600;
+            EXPECT_TRUE(ERROR_SUCCESS == ctx.encode(&writer, &msg, SrsCodecVideoAVC, SrsCodecAudioAAC));
+            nb_packets[i] += writer.offset / SRS_TS_PACKET_SIZE;
+            mb.nb_bytes += writer.offset;
+        }
+    }
+    
+    EXPECT_EQ(nb_packets[0], nb_packets[1]);
+}
+
+/**
+* the annexb finder for the 1080p frames, byte by byte and the fast finder,
+* an I frame of 4 slices in 200KB and 29 P frames in 20KB.
+*/
+VOID TEST(BenchmarkTest, AvcFindAnnexb)
+{
+    u_int32_t seed = 1;
+    std::string frame;
+    mock_annexb_frame(frame, 4, 50 * 1024, seed);
+    for (int i = 0; i < 29; i++) {
+        mock_annexb_frame(frame, 1, 20 * 1024, seed);
+    }
+    
+    int nb_nalus[2] = {0, 0};
+    for (int i = 0; i < 2; i++) {
+        bool fast = (i == 1);
+        MockBenchmark mb(fast? "annexb find fast" : "annexb find bytewise");
+        
+        for (int j = 0; j < 30; j++) {
+            char* p = (char*)frame.data();
+            int size = (int)frame.length();
+            
+            while (size > 0) {
+                int nb_start_code = 0;
+                int pos = fast? srs_avc_find_annexb(p, size, &nb_start_code)
+                    : mock_find_annexb_bytewise(p, size, &nb_start_code);
+                if (pos >= size) {
+                    break;
+                }
+                
+                p += pos + nb_start_code;
+                size -= pos + nb_start_code;
+                nb_nalus[i]++;
+            }
+            mb.nb_bytes += frame.length();
+        }
+    }
+    
+    EXPECT_EQ(30 * 33, nb_nalus[0]);
+    EXPECT_EQ(nb_nalus[0], nb_nalus[1]);
+}
+
+#endif
+
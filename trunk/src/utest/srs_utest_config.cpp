@@ -76,6 +76,56 @@ int MockSrsConfig::parse(string buf)
     return check_config();
 }
 
+MockSrsCompiledConfig::MockSrsCompiledConfig()
+{
+}
+
+MockSrsCompiledConfig::~MockSrsCompiledConfig()
+{
+}
+
+int MockSrsCompiledConfig::reload(string buf)
+{
+    int ret = ERROR_SUCCESS;
+    
+    MockSrsConfig conf;
+    if ((ret = conf.parse(buf)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return reload_conf(&conf);
+}
+
+MockSrsCompiledHandler::MockSrsCompiledHandler(SrsConfig* c)
+{
+    conf = c;
+    added = false;
+    realtime = false;
+    mw_sleep_ms = 0;
+}
+
+MockSrsCompiledHandler::~MockSrsCompiledHandler()
+{
+}
+
+int MockSrsCompiledHandler::on_reload_vhost_added(string vhost)
+{
+    added = (conf->get_vhost_config(vhost)->conf == conf->get_vhost(vhost));
+    return ERROR_SUCCESS;
+}
+
+int MockSrsCompiledHandler::on_reload_vhost_mw(string vhost)
+{
+    mw_sleep_ms = conf->get_mw_sleep_ms(vhost);
+    return ERROR_SUCCESS;
+}
+
+int MockSrsCompiledHandler::on_reload_vhost_realtime(string vhost)
+{
+    realtime = conf->get_realtime_enabled(vhost);
+    return ERROR_SUCCESS;
+}
+
 #ifdef ENABLE_UTEST_CONFIG
 
 // full.conf
@@ -5054,5 +5104,116 @@ VOID TEST(ConfigMainTest, CheckConf_vhost_ingest_id)
     EXPECT_TRUE(ERROR_SUCCESS != conf.parse(_MIN_OK_CONF"vhost v{ingest{} ingest{}}"));
 }
 
-#endif
+/**
+* the compiled settings of vhost must equal to the settings from directive.
+*/
+void srs_utest_expect_compiled(MockSrsCompiledConfig* conf, string vhost)
+{
+    SrsVhostConfig* vc = conf->get_vhost_config(vhost);
+    SrsConfDirective* v = vc->conf;
+    
+    EXPECT_EQ(conf->get_vhost_enabled(v), vc->enabled);
+    EXPECT_EQ(conf->get_vhost_is_edge(v), vc->is_edge);
+    EXPECT_EQ(conf->get_gop_cache(v), vc->gop_cache);
+    EXPECT_EQ(conf->get_queue_length(v), vc->queue_length);
+    EXPECT_EQ(conf->get_atc(v), vc->atc);
+    EXPECT_EQ(conf->get_atc_auto(v), vc->atc_auto);
+    EXPECT_EQ(conf->get_time_jitter(v), vc->time_jitter);
+    EXPECT_EQ(conf->get_mix_correct(v), vc->mix_correct);
+    EXPECT_EQ(conf->get_parse_sps(v), vc->parse_sps);
+    EXPECT_EQ(conf->get_reduce_sequence_header(v), vc->reduce_sequence_header);
+    EXPECT_EQ(conf->get_mr_enabled(v), vc->mr_enabled);
+    EXPECT_EQ(conf->get_mr_sleep_ms(v), vc->mr_sleep_ms);
+    EXPECT_EQ(conf->get_mw_sleep_ms(v), vc->mw_sleep_ms);
+    EXPECT_EQ(conf->get_realtime_enabled(v), vc->realtime);
+    EXPECT_EQ(conf->get_tcp_nodelay(v), vc->tcp_nodelay);
+    EXPECT_EQ(conf->get_send_min_interval(v), vc->send_min_interval);
+    EXPECT_EQ(conf->get_hls_enabled(v), vc->hls_enabled);
+    EXPECT_STREQ(conf->get_hls_on_error(v).c_str(), vc->hls_on_error.c_str());
+    
+    // the getters by vhost name read the compiled settings.
+    EXPECT_EQ(vc->gop_cache, conf->get_gop_cache(vhost));
+    EXPECT_EQ(vc->mw_sleep_ms, conf->get_mw_sleep_ms(vhost));
+    EXPECT_EQ(vc->realtime, conf->get_realtime_enabled(vhost));
+    EXPECT_EQ(vc->security_allow, conf->get_security_allow(vhost));
+    EXPECT_EQ(vc->security_deny, conf->get_security_deny(vhost));
+}
 
+VOID TEST(ConfigCompileTest, VhostConfig)
+{
+    MockSrsCompiledConfig conf;
+    EXPECT_TRUE(ERROR_SUCCESS == conf.parse(_MIN_OK_CONF
+        "vhost v1 {gop_cache off; queue_length 20; atc on; atc_auto off; time_jitter zero; mix_correct on;"
+        "   mr {enabled on; latency 500;} mw_latency 200; min_latency on; tcp_nodelay on; send_min_interval 10;"
+        "   reduce_sequence_header on; publish {parse_sps off;} hls {enabled on; hls_on_error ignore;}}"
+        "vhost v2 {enabled off; mode remote; origin 127.0.0.1;}"
+        "vhost v1 {gop_cache on;}"));
+    
+    srs_utest_expect_compiled(&conf, "v1");
+    srs_utest_expect_compiled(&conf, "v2");
+    
+    // use the first one for the duplicated vhost.
+    SrsVhostConfig* vc = conf.get_vhost_config("v1");
+    EXPECT_TRUE(vc->conf == conf.get_vhost("v1"));
+    EXPECT_FALSE(vc->gop_cache);
+    EXPECT_EQ(20, vc->queue_length);
+    EXPECT_TRUE(vc->atc);
+    EXPECT_FALSE(vc->atc_auto);
+    EXPECT_TRUE(vc->mix_correct);
+    EXPECT_FALSE(vc->parse_sps);
+    EXPECT_TRUE(vc->mr_enabled);
+    EXPECT_EQ(500, vc->mr_sleep_ms);
+    EXPECT_EQ(200, vc->mw_sleep_ms);
+    EXPECT_TRUE(vc->realtime);
+    EXPECT_TRUE(vc->tcp_nodelay);
+    EXPECT_EQ(10, vc->send_min_interval);
+    EXPECT_TRUE(vc->reduce_sequence_header);
+    EXPECT_TRUE(vc->hls_enabled);
+    EXPECT_STREQ("ignore", vc->hls_on_error.c_str());
+    
+    vc = conf.get_vhost_config("v2");
+    EXPECT_FALSE(vc->enabled);
+    EXPECT_TRUE(vc->is_edge);
+    
+    // use the default settings when vhost not found.
+    vc = conf.get_vhost_config("v3");
+    EXPECT_TRUE(NULL == vc->conf);
+    srs_utest_expect_compiled(&conf, "v3");
+    
+    // use the default vhost when vhost not found.
+    MockSrsCompiledConfig dconf;
+    EXPECT_TRUE(ERROR_SUCCESS == dconf.parse(_MIN_OK_CONF"vhost __defaultVhost__ {mw_latency 100;}"));
+    vc = dconf.get_vhost_config("v3");
+    EXPECT_TRUE(vc == dconf.get_vhost_config(SRS_CONSTS_RTMP_DEFAULT_VHOST));
+    EXPECT_TRUE(vc->conf == dconf.get_vhost(SRS_CONSTS_RTMP_DEFAULT_VHOST));
+    EXPECT_EQ(100, vc->mw_sleep_ms);
+    srs_utest_expect_compiled(&dconf, "v3");
+}
+
+VOID TEST(ConfigCompileTest, ReloadBeforeNotify)
+{
+    MockSrsCompiledConfig conf;
+    MockSrsCompiledHandler handler(&conf);
+    conf.subscribe(&handler);
+    
+    EXPECT_TRUE(ERROR_SUCCESS == conf.parse(_MIN_OK_CONF"vhost v1 {mw_latency 100;}"));
+    EXPECT_EQ(100, conf.get_mw_sleep_ms("v1"));
+    EXPECT_FALSE(conf.get_realtime_enabled("v1"));
+    
+    // the handlers read the new settings when notified.
+    EXPECT_TRUE(ERROR_SUCCESS == conf.reload(_MIN_OK_CONF"vhost v1 {mw_latency 300; min_latency on;} vhost v2 {}"));
+    EXPECT_EQ(300, handler.mw_sleep_ms);
+    EXPECT_TRUE(handler.realtime);
+    EXPECT_TRUE(handler.added);
+    srs_utest_expect_compiled(&conf, "v1");
+    srs_utest_expect_compiled(&conf, "v2");
+    
+    // the settings of removed vhost is the default.
+    EXPECT_TRUE(ERROR_SUCCESS == conf.reload(_MIN_OK_CONF"vhost v2 {}"));
+    EXPECT_TRUE(NULL == conf.get_vhost_config("v1")->conf);
+    EXPECT_EQ(SRS_PERF_MW_SLEEP, conf.get_mw_sleep_ms("v1"));
+    
+    conf.unsubscribe(&handler);
+}
+
+#endif
@@ -32,6 +32,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <string>
 
 #include <srs_app_config.hpp>
+#include <srs_app_reload.hpp>
 
 #define _MIN_OK_CONF "listen 1935; "
 
@@ -53,5 +54,53 @@ public:
     virtual int parse(std::string buf);
 };
 
+/**
+* the config to read the settings from vhost directive.
+*/
+class MockSrsCompiledConfig : public MockSrsConfig
+{
+public:
+    MockSrsCompiledConfig();
+    virtual ~MockSrsCompiledConfig();
+public:
+    using SrsConfig::get_gop_cache;
+    using SrsConfig::get_atc;
+    using SrsConfig::get_atc_auto;
+    using SrsConfig::get_time_jitter;
+    using SrsConfig::get_mix_correct;
+    using SrsConfig::get_queue_length;
+    using SrsConfig::get_parse_sps;
+    using SrsConfig::get_mr_enabled;
+    using SrsConfig::get_mr_sleep_ms;
+    using SrsConfig::get_mw_sleep_ms;
+    using SrsConfig::get_realtime_enabled;
+    using SrsConfig::get_tcp_nodelay;
+    using SrsConfig::get_send_min_interval;
+    using SrsConfig::get_reduce_sequence_header;
+    using SrsConfig::get_hls_enabled;
+    using SrsConfig::get_hls_on_error;
+public:
+    virtual int reload(std::string buf);
+};
+
+/**
+* the handler to record the compiled settings when notified.
+*/
+class MockSrsCompiledHandler : public ISrsReloadHandler
+{
+public:
+    SrsConfig* conf;
+    bool added;
+    bool realtime;
+    int mw_sleep_ms;
+public:
+    MockSrsCompiledHandler(SrsConfig* c);
+    virtual ~MockSrsCompiledHandler();
+public:
+    virtual int on_reload_vhost_added(std::string vhost);
+    virtual int on_reload_vhost_mw(std::string vhost);
+    virtual int on_reload_vhost_realtime(std::string vhost);
+};
+
 #endif
 
@@ -30,6 +30,10 @@ using namespace std;
 #include <srs_kernel_utility.hpp>
 #include <srs_rtmp_utility.hpp>
 #include <srs_kernel_stream.hpp>
+#include <srs_kernel_ts.hpp>
+#include <srs_kernel_pool.hpp>
+#include <srs_kernel_cidr.hpp>
+#include <srs_kernel_timer.hpp>
 
 #define MAX_MOCK_DATA_SIZE 1024 * 1024
 
@@ -199,6 +203,46 @@ int MockBufferReader::read(void* buf, size_t size, ssize_t* nread)
     return ERROR_SUCCESS;
 }
 
+// find the annexb by the startswith byte by byte, the reference of finder.
+int mock_find_annexb_bytewise(char* bytes, int size, int* pnb_start_code)
+{
+    SrsStream stream;
+    if (size <= 0 || stream.initialize(bytes, size) != ERROR_SUCCESS) {
+        return size;
+    }
+    
+    while (!stream.empty()) {
+        if (srs_avc_startswith_annexb(&stream, pnb_start_code)) {
+            break;
+        }
+        stream.skip(1);
+    }
+    
+    return stream.pos();
+}
+
+// generate the annexb frame of nb_nalus slices, each slice nb_bytes,
+// the payload is random with emulation prevention, so no start code in it.
+void mock_annexb_frame(string& frame, int nb_nalus, int nb_bytes, u_int32_t& seed)
+{
+    for (int i = 0; i < nb_nalus; i++) {
+        frame.append("\x00\x00\x00\x01", 4);
+        frame.append(1, (char)0x65);
+        
+        for (int j = 0; j < nb_bytes; j++) {
+            seed = seed * 1103515245 + 12345;
+            u_int8_t v = (u_int8_t)(seed >> 16);
+            
+            // 00 00 0x where x<=3 is escaped to 00 00 03 0x.
+            int n = (int)frame.length();
+            if (n >= 2 && frame[n - 1] == 0 && frame[n - 2] == 0 && v <= 3) {
+                frame.append(1, (char)0x03);
+            }
+            frame.append(1, (char)v);
+        }
+    }
+}
+
 #ifdef ENABLE_UTEST_KERNEL
 
 VOID TEST(KernelBufferTest, DefaultObject)
@@ -282,6 +326,39 @@ VOID TEST(KernelFastBufferTest, Grow)
     EXPECT_EQ('w', b.read_1byte());
 }
 
+VOID TEST(KernelFastBufferTest, GrowAndShrink)
+{
+    SrsFastBuffer b;
+    EXPECT_EQ(SRS_PERF_RECV_BUFFER_MIN, b.capacity());
+    
+    // the large read fill the buffer, double it.
+    std::string large(SRS_PERF_RECV_BUFFER_MIN * 4, 'x');
+    MockBufferReader lr(large.c_str());
+    EXPECT_EQ(ERROR_SUCCESS, b.grow(&lr, 1));
+    EXPECT_EQ(SRS_PERF_RECV_BUFFER_MIN, b.size());
+    b.read_slice(b.size());
+    EXPECT_EQ(ERROR_SUCCESS, b.grow(&lr, 1));
+    EXPECT_EQ(SRS_PERF_RECV_BUFFER_MIN * 2, b.capacity());
+    
+    // grow to the required size, and keep the bytes.
+    b.read_slice(b.size() - 1);
+    EXPECT_EQ(ERROR_SUCCESS, b.grow(&lr, SRS_PERF_RECV_BUFFER_MIN * 3));
+    EXPECT_EQ(SRS_PERF_RECV_BUFFER_MIN * 4, b.capacity());
+    EXPECT_EQ('x', b.read_1byte());
+    
+    // never exceed the max size.
+    b.read_slice(b.size());
+    EXPECT_EQ(ERROR_READER_BUFFER_OVERFLOW, b.grow(&lr, 131072 + 1));
+    
+    // the small reads shrink the buffer to the min size.
+    MockBufferReader sr("winlin");
+    for (int i = 0; i < 100000 && b.capacity() > SRS_PERF_RECV_BUFFER_MIN; i++) {
+        EXPECT_EQ(ERROR_SUCCESS, b.grow(&sr, 6));
+        EXPECT_EQ('w', b.read_slice(6)[0]);
+    }
+    EXPECT_EQ(SRS_PERF_RECV_BUFFER_MIN, b.capacity());
+}
+
 /**
 * test the codec,
 * whether H.264 keyframe
@@ -1429,6 +1506,174 @@ VOID TEST(KernelStreamTest, StreamWriteBytes)
     EXPECT_EQ(0x19, s.read_1bytes());
 }
 
+/**
+* encode a ts message by the packet object encoder or the fast encoder.
+*/
+static int mock_ts_encode(MockSrsFileWriter* writer, bool fast, bool video, int size, bool pcr, int64_t dts, int64_t pts)
+{
+    SrsTsContext ctx;
+    ctx.set_fast_encoder(fast);
+    
+    SrsTsMessage msg;
+    msg.sid = video? SrsTsPESStreamIdVideoCommon : SrsTsPESStreamIdAudioCommon;
+    msg.write_pcr = pcr;
+    msg.dts = dts;
+    msg.pts = pts;
+    for (int i = 0; i < size; i++) {
+        char v = (char)i;
+        msg.payload->append(&v, 1);
+    }
+    
+    writer->mock_reset_offset();
+    return ctx.encode(writer, &msg, SrsCodecVideoAVC, SrsCodecAudioAAC);
+}
+
+/**
+* test the fast ts encoder, which must generate the same bytes.
+*/
+VOID TEST(KernelTSTest, FastEncoderSameBytes)
+{
+    MockSrsFileWriter slow;
+    MockSrsFileWriter fast;
+    
+    int sizes[] = {1, 2, 150, 164, 165, 166, 167, 168, 169, 170, 171, 172, 177, 178, 
+        179, 180, 182, 183, 184, 185, 186, 367, 368, 369, 1000, 65535, 70000};
+    for (int i = 0; i < (int)(sizeof(sizes) / sizeof(int)); i++) {
+        for (int j = 0; j < 8; j++) {
+            bool video = j & 0x01;
+            bool pcr = j & 0x02;
+            int64_t pts = 0x1ABCDEF12LL;
+            int64_t dts = (j & 0x04)? pts - 3600 : pts;
+            
+            EXPECT_TRUE(ERROR_SUCCESS == mock_ts_encode(&slow, false, video, sizes[i], pcr, dts, pts));
+            EXPECT_TRUE(ERROR_SUCCESS == mock_ts_encode(&fast, true, video, sizes[i], pcr, dts, pts));
+            
+            EXPECT_EQ(0, slow.offset % SRS_TS_PACKET_SIZE);
+            ASSERT_EQ(slow.offset, fast.offset);
+            EXPECT_EQ(0, memcmp(slow.data, fast.data, slow.offset));
+        }
+    }
+}
+
+/**
+* record the ts messages, to compare the decoders.
+*/
+class MockTsRecorder : public ISrsTsHandler
+{
+public:
+    bool detach;
+    std::vector<SrsTsMessage*> msgs;
+public:
+    MockTsRecorder(bool d)
+    {
+        detach = d;
+    }
+    virtual ~MockTsRecorder()
+    {
+        std::vector<SrsTsMessage*>::iterator it;
+        for (it = msgs.begin(); it != msgs.end(); ++it) {
+            SrsTsMessage* msg = *it;
+            srs_freep(msg);
+        }
+    }
+public:
+    virtual int on_ts_message(SrsTsMessage* msg)
+    {
+        if (detach) {
+            msgs.push_back(msg->detach());
+            return ERROR_SUCCESS;
+        }
+        
+        SrsTsMessage* cp = new SrsTsMessage(msg->channel, NULL);
+        cp->sid = msg->sid;
+        cp->dts = msg->dts;
+        cp->pts = msg->pts;
+        cp->PES_packet_length = msg->PES_packet_length;
+        cp->payload->append(msg->payload->bytes(), msg->payload->length());
+        msgs.push_back(cp);
+        return ERROR_SUCCESS;
+    }
+};
+
+/**
+* test the fast ts decoder, which must get the same messages.
+*/
+VOID TEST(KernelTSTest, FastDecoderSameMessages)
+{
+    MockSrsFileWriter writer;
+    writer.mock_reset_offset();
+    
+    int sizes[] = {1, 2, 150, 164, 165, 166, 167, 168, 169, 170, 171, 172, 177, 178, 
+        179, 180, 182, 183, 184, 185, 186, 367, 368, 369, 1000, 65535, 70000};
+    int nb_sizes = (int)(sizeof(sizes) / sizeof(int));
+    
+    SrsTsContext enc;
+    SrsTsMessage msg;
+    for (int i = 0; i < nb_sizes; i++) {
+        for (int j = 0; j < 2; j++) {
+            bool video = (j == 0);
+            msg.sid = video? SrsTsPESStreamIdVideoCommon : SrsTsPESStreamIdAudioCommon;
+            msg.write_pcr = video;
+            msg.pts = 0x1ABCDEF12LL + i * 3600;
+            msg.dts = video? msg.pts - 3600 : msg.pts;
+            msg.payload->erase(msg.payload->length());
+            for (int k = 0; k < sizes[i]; k++) {
+                char v = (char)(k + i + j);
+                msg.payload->append(&v, 1);
+            }
+            EXPECT_TRUE(ERROR_SUCCESS == enc.encode(&writer, &msg, SrsCodecVideoAVC, SrsCodecAudioAAC));
+        }
+    }
+    ASSERT_EQ(0, writer.offset % SRS_TS_PACKET_SIZE);
+    
+    // decode per packet by slow decoder, by the fast decoder, and all packets in a time.
+    MockTsRecorder slow(false), fast(false), bulk(true);
+    if (true) {
+        SrsTsContext ctx;
+        ctx.set_fast_decoder(false);
+        SrsStream s;
+        for (int k = 0; k < writer.offset; k += SRS_TS_PACKET_SIZE) {
+            EXPECT_TRUE(ERROR_SUCCESS == s.initialize(writer.data + k, SRS_TS_PACKET_SIZE));
+            EXPECT_TRUE(ERROR_SUCCESS == ctx.decode(&s, &slow));
+        }
+    }
+    if (true) {
+        SrsTsContext ctx;
+        ctx.set_fast_decoder(true);
+        SrsStream s;
+        for (int k = 0; k < writer.offset; k += SRS_TS_PACKET_SIZE) {
+            EXPECT_TRUE(ERROR_SUCCESS == s.initialize(writer.data + k, SRS_TS_PACKET_SIZE));
+            EXPECT_TRUE(ERROR_SUCCESS == ctx.decode(&s, &fast));
+        }
+    }
+    if (true) {
+        SrsTsContext ctx;
+        ctx.set_fast_decoder(true);
+        SrsStream s;
+        EXPECT_TRUE(ERROR_SUCCESS == s.initialize(writer.data, writer.offset));
+        EXPECT_TRUE(ERROR_SUCCESS == ctx.decode(&s, &bulk));
+        EXPECT_TRUE(s.empty());
+    }
+    
+    // the last audio and video of 70000 bytes use PES_packet_length 0, reaped by the next unit start.
+    EXPECT_EQ(2 * nb_sizes - 2, (int)slow.msgs.size());
+    ASSERT_EQ(slow.msgs.size(), fast.msgs.size());
+    ASSERT_EQ(slow.msgs.size(), bulk.msgs.size());
+    for (int i = 0; i < (int)slow.msgs.size(); i++) {
+        SrsTsMessage* m = slow.msgs[i];
+        SrsTsMessage* fs[] = {fast.msgs[i], bulk.msgs[i]};
+        for (int j = 0; j < 2; j++) {
+            SrsTsMessage* f = fs[j];
+            EXPECT_EQ(m->sid, f->sid);
+            EXPECT_EQ(m->dts, f->dts);
+            EXPECT_EQ(m->pts, f->pts);
+            EXPECT_EQ(m->PES_packet_length, f->PES_packet_length);
+            ASSERT_EQ(m->payload->length(), f->payload->length());
+            EXPECT_EQ(0, memcmp(m->payload->bytes(), f->payload->bytes(), m->payload->length()));
+        }
+    }
+}
+
 /**
 * test the kernel utility, time
 */
@@ -1511,5 +1756,355 @@ VOID TEST(KernelUtilityTest, UtilityString)
     EXPECT_TRUE(srs_string_ends_with("Hello", "lo"));
 }
 
+/**
+* the annexb finder must match the startswith byte by byte,
+* for the start code in any position and in the simd tail.
+*/
+VOID TEST(KernelUtilityTest, UtilityFindAnnexb)
+{
+    char buf[160];
+    
+    // empty and no start code.
+    EXPECT_EQ(0, srs_avc_find_annexb(buf, 0, NULL));
+    memset(buf, 0x00, sizeof(buf));
+    EXPECT_EQ(100, srs_avc_find_annexb(buf, 100, NULL));
+    
+    // the start code at each position, with N zeros before it.
+    for (int size = 3; size <= 80; size++) {
+        for (int pos = 0; pos + 3 <= size; pos++) {
+            for (int nb_zeros = 0; nb_zeros <= 2; nb_zeros++) {
+                memset(buf, 0x02, sizeof(buf));
+                for (int i = srs_max(0, pos - nb_zeros); i < pos + 2; i++) {
+                    buf[i] = 0x00;
+                }
+                buf[pos + 2] = 0x01;
+                
+                int nb_start_code = 0;
+                int nb_expect = 0;
+                int expect = mock_find_annexb_bytewise(buf, size, &nb_expect);
+                ASSERT_EQ(expect, srs_avc_find_annexb(buf, size, &nb_start_code));
+                EXPECT_EQ(nb_expect, nb_start_code);
+            }
+        }
+    }
+    
+    // the random bytes in 0, 1 and 2.
+    u_int32_t seed = 1;
+    for (int i = 0; i < 10000; i++) {
+        int size = i % (int)sizeof(buf);
+        for (int j = 0; j < size; j++) {
+            seed = seed * 1103515245 + 12345;
+            buf[j] = (char)((seed >> 16) % 3);
+        }
+        
+        int nb_start_code = 0;
+        int nb_expect = 0;
+        int expect = mock_find_annexb_bytewise(buf, size, &nb_expect);
+        ASSERT_EQ(expect, srs_avc_find_annexb(buf, size, &nb_start_code));
+        if (expect < size) {
+            EXPECT_EQ(nb_expect, nb_start_code);
+        }
+    }
+}
+
+/**
+* the memory pool alloc from size class and reuse the freed block,
+* and free the bytes not from pool by delete[].
+*/
+VOID TEST(KernelPoolTest, AllocFree)
+{
+    SrsMemoryPool* pool = SrsMemoryPool::instance();
+    bool enabled = pool->is_enabled();
+    pool->set_enabled(true);
+    
+    SrsPoolClass* c = NULL;
+    for (int i = 0; i < pool->size(); i++) {
+        if (pool->at(i)->size == 128) {
+            c = pool->at(i);
+        }
+    }
+    ASSERT_TRUE(c != NULL);
+    
+    int64_t hits = c->hits;
+    int used = c->nb_used;
+    
+    char* p = pool->alloc(100);
+    EXPECT_EQ(used + 1, c->nb_used);
+    pool->free(p);
+    EXPECT_EQ(used, c->nb_used);
+    
+    // the freed block is reused.
+    char* p1 = pool->alloc(128);
+    EXPECT_TRUE(p == p1);
+    EXPECT_EQ(hits + 1, c->hits);
+    srs_pool_freepa(p1);
+    EXPECT_TRUE(p1 == NULL);
+    
+    // larger than max size, alloc from heap.
+    int64_t heap_allocs = pool->heap_allocs();
+    p = pool->alloc(SRS_PERF_POOL_MAX_SIZE + 1);
+    EXPECT_EQ(heap_allocs + 1, pool->heap_allocs());
+    pool->free(p);
+    
+    // free the bytes not from pool.
+    p = new char[100];
+    pool->free(p);
+    EXPECT_EQ(used, c->nb_used);
+    
+    // alloc from heap when disabled.
+    pool->set_enabled(false);
+    heap_allocs = pool->heap_allocs();
+    p = pool->alloc(100);
+    EXPECT_EQ(heap_allocs + 1, pool->heap_allocs());
+    EXPECT_EQ(used, c->nb_used);
+    pool->free(p);
+    
+    pool->set_enabled(enabled);
+}
+
+/**
+* the cidr trie match the ipv4 and ipv6 prefixes,
+* and return the union mask of all prefixes contain the address.
+*/
+VOID TEST(KernelCidrTest, MatchPrefixes)
+{
+    SrsCidrTrie trie;
+    EXPECT_EQ(0, trie.match("10.0.0.1"));
+    
+    EXPECT_EQ(ERROR_SUCCESS, trie.add("10.0.0.0/8", 0x01));
+    EXPECT_EQ(ERROR_SUCCESS, trie.add("10.1.2.3", 0x02));
+    EXPECT_EQ(ERROR_SUCCESS, trie.add("2001:db8::/32", 0x04));
+    EXPECT_EQ(3, trie.size());
+    
+    EXPECT_EQ(0x01, trie.match("10.0.0.1"));
+    EXPECT_EQ(0x03, trie.match("10.1.2.3"));
+    EXPECT_EQ(0x01, trie.match("10.1.2.4"));
+    EXPECT_EQ(0, trie.match("11.0.0.1"));
+    EXPECT_EQ(0x04, trie.match("2001:db8::1"));
+    EXPECT_EQ(0, trie.match("2001:db9::1"));
+    
+    // the ipv4 mapped ipv6 is the ipv4.
+    EXPECT_EQ(0x03, trie.match("::ffff:10.1.2.3"));
+    
+    // invalid address never match the prefixes.
+    EXPECT_EQ(0, trie.match("invalid"));
+    
+    // all matches any address.
+    EXPECT_EQ(ERROR_SUCCESS, trie.add("all", 0x08));
+    EXPECT_EQ(0x08, trie.match("11.0.0.1"));
+    EXPECT_EQ(0x0b, trie.match("10.1.2.3"));
+    EXPECT_EQ(0x08, trie.match("invalid"));
+    
+    trie.clear();
+    EXPECT_EQ(0, trie.size());
+    EXPECT_EQ(0, trie.match("10.1.2.3"));
+}
+
+/**
+* the cidr trie reject the invalid address and prefix.
+*/
+VOID TEST(KernelCidrTest, InvalidPrefixes)
+{
+    SrsCidrTrie trie;
+    
+    EXPECT_EQ(ERROR_SYSTEM_CIDR_INVALID, trie.add("", 0x01));
+    EXPECT_EQ(ERROR_SYSTEM_CIDR_INVALID, trie.add("10.0.0", 0x01));
+    EXPECT_EQ(ERROR_SYSTEM_CIDR_INVALID, trie.add("10.0.0.256", 0x01));
+    EXPECT_EQ(ERROR_SYSTEM_CIDR_INVALID, trie.add("10.0.0.0/33", 0x01));
+    EXPECT_EQ(ERROR_SYSTEM_CIDR_INVALID, trie.add("10.0.0.0/", 0x01));
+    EXPECT_EQ(ERROR_SYSTEM_CIDR_INVALID, trie.add("10.0.0.0/-1", 0x01));
+    EXPECT_EQ(ERROR_SYSTEM_CIDR_INVALID, trie.add("::1/129", 0x01));
+    EXPECT_EQ(ERROR_SYSTEM_CIDR_INVALID, trie.add("localhost", 0x01));
+    EXPECT_EQ(0, trie.size());
+    
+    // the prefix 0 of ipv4 only matches ipv4.
+    EXPECT_EQ(ERROR_SUCCESS, trie.add("0.0.0.0/0", 0x01));
+    EXPECT_EQ(0x01, trie.match("1.2.3.4"));
+    EXPECT_EQ(0, trie.match("::1"));
+}
+
+/**
+* record the time fired, and rearm or remove other timer when fired.
+*/
+class MockTimerHandler : public ISrsTimerHandler
+{
+public:
+    SrsTimerWheel* wheel;
+    int64_t now;
+    int nb_fired;
+    int64_t fired_at;
+    // rearm the fired timer after interval when not zero.
+    int64_t interval;
+    // the timer to remove when fired.
+    SrsTimerEntry* victim;
+public:
+    MockTimerHandler(SrsTimerWheel* w) {
+        wheel = w;
+        now = 0;
+        nb_fired = 0;
+        fired_at = -1;
+        interval = 0;
+        victim = NULL;
+    }
+    virtual ~MockTimerHandler() {
+    }
+public:
+    virtual void on_timer(SrsTimerEntry* entry) {
+        nb_fired++;
+        fired_at = now;
+        if (interval > 0) {
+            wheel->add(entry, now + interval);
+        }
+        if (victim) {
+            wheel->remove(victim);
+        }
+    }
+};
+
+/**
+* the timers in all levels fire in time, never before expire.
+*/
+VOID TEST(KernelTimerTest, FireInTime)
+{
+    SrsTimerWheel wheel(10, 1000);
+    EXPECT_EQ(-1, wheel.next_ms());
+    
+    MockTimerHandler h0(&wheel), h1(&wheel), h2(&wheel), h3(&wheel);
+    SrsTimerEntry t0(&h0), t1(&h1), t2(&h2), t3(&h3);
+    wheel.add(&t0, 1015);
+    wheel.add(&t1, 1005);
+    wheel.add(&t2, 4000);
+    wheel.add(&t3, 3001000);
+    EXPECT_EQ(4, wheel.size());
+    EXPECT_TRUE(t0.pending());
+    EXPECT_EQ(1010, wheel.next_ms());
+    
+    EXPECT_EQ(0, wheel.advance(1004));
+    EXPECT_EQ(1, wheel.advance(1010));
+    EXPECT_EQ(1, h1.nb_fired);
+    EXPECT_FALSE(t1.pending());
+    EXPECT_EQ(1020, wheel.next_ms());
+    
+    EXPECT_EQ(0, wheel.advance(1019));
+    EXPECT_EQ(1, wheel.advance(1020));
+    EXPECT_EQ(1, h0.nb_fired);
+    
+    // the timer in upper level cascades, wakeup when the first level wraps.
+    EXPECT_EQ(2560, wheel.next_ms());
+    EXPECT_EQ(0, wheel.advance(3999));
+    EXPECT_EQ(1, wheel.advance(4000));
+    EXPECT_EQ(1, h2.nb_fired);
+    
+    EXPECT_EQ(0, wheel.advance(3000999));
+    EXPECT_EQ(1, wheel.advance(3001005));
+    EXPECT_EQ(1, h3.nb_fired);
+    EXPECT_EQ(0, wheel.size());
+    
+    // the lag is from expire to advance.
+    EXPECT_EQ(4, wheel.fired());
+    EXPECT_EQ(5, wheel.lag_max());
+    
+    // the expired timer fires at next advance.
+    wheel.add(&t0, 100);
+    EXPECT_EQ(1, wheel.advance(3001010));
+    EXPECT_EQ(2, h0.nb_fired);
+}
+
+/**
+* the handler rearms or removes timers when fired.
+*/
+VOID TEST(KernelTimerTest, RearmAndRemove)
+{
+    SrsTimerWheel wheel(10, 0);
+    
+    MockTimerHandler h0(&wheel), h1(&wheel);
+    SrsTimerEntry t0(&h0), t1(&h1);
+    
+    // periodic timer.
+    h0.interval = 100;
+    wheel.add(&t0, 100);
+    for (int64_t now = 0; now <= 1000; now += 10) {
+        h0.now = now;
+        wheel.advance(now);
+    }
+    EXPECT_EQ(10, h0.nb_fired);
+    EXPECT_EQ(1000, h0.fired_at);
+    EXPECT_TRUE(t0.pending());
+    
+    // the timer fired in the same batch is removed by handler.
+    h0.interval = 0;
+    h0.victim = &t1;
+    wheel.add(&t0, 1100);
+    wheel.add(&t1, 1100);
+    EXPECT_EQ(1, wheel.advance(1100));
+    EXPECT_EQ(0, h1.nb_fired);
+    EXPECT_EQ(0, wheel.size());
+    
+    // modify the pending timer.
+    wheel.add(&t1, 1200);
+    wheel.add(&t1, 1500);
+    EXPECT_EQ(1, wheel.size());
+    EXPECT_EQ(0, wheel.advance(1490));
+    EXPECT_EQ(1, wheel.advance(1500));
+    
+    // the timer removes itself when destroy.
+    if (true) {
+        SrsTimerEntry t2(&h1);
+        wheel.add(&t2, 2000);
+        EXPECT_EQ(1, wheel.size());
+    }
+    EXPECT_EQ(0, wheel.size());
+    EXPECT_EQ(0, wheel.advance(2000));
+}
+
+/**
+* the random timers fire exactly once, in a tick after expire.
+*/
+VOID TEST(KernelTimerTest, RandomTimers)
+{
+    int64_t start = 123456789;
+    SrsTimerWheel wheel(10, start);
+    
+    srand(0);
+    int nb_timers = 2000;
+    std::vector<MockTimerHandler*> handlers;
+    std::vector<SrsTimerEntry*> timers;
+    for (int i = 0; i < nb_timers; i++) {
+        MockTimerHandler* h = new MockTimerHandler(&wheel);
+        SrsTimerEntry* t = new SrsTimerEntry(h);
+        handlers.push_back(h);
+        timers.push_back(t);
+        
+        // from now to about 3 hours, cover the first three levels.
+        int64_t timeout = (i % 4 == 0)? rand() % 2000 : (int64_t)rand() % 10000000;
+        wheel.add(t, start + timeout);
+    }
+    
+    int64_t now = start;
+    while (wheel.size() > 0) {
+        now += 1 + rand() % 3000;
+        for (int i = 0; i < nb_timers; i++) {
+            handlers[i]->now = now;
+        }
+        wheel.advance(now);
+        
+        // the next time to advance never after the first timer.
+        int64_t next = wheel.next_ms();
+        for (int i = 0; i < nb_timers && next >= 0; i++) {
+            if (timers[i]->pending()) {
+                EXPECT_LE(next, timers[i]->expire_ms() + 10);
+            }
+        }
+    }
+    
+    for (int i = 0; i < nb_timers; i++) {
+        MockTimerHandler* h = handlers[i];
+        EXPECT_EQ(1, h->nb_fired);
+        EXPECT_GE(h->fired_at, timers[i]->expire_ms());
+        srs_freep(timers[i]);
+        srs_freep(h);
+    }
+}
+
 #endif
 
@@ -92,5 +92,15 @@ public:
     void mock_reset_offset();
 };
 
+/**
+* find the annexb by the startswith byte by byte, the reference of finder.
+*/
+extern int mock_find_annexb_bytewise(char* bytes, int size, int* pnb_start_code);
+/**
+* generate the annexb frame of nb_nalus slices, each slice nb_bytes,
+* the payload is random with emulation prevention, so no start code in it.
+*/
+extern void mock_annexb_frame(std::string& frame, int nb_nalus, int nb_bytes, u_int32_t& seed);
+
 #endif
 
@@ -32,6 +32,10 @@ using namespace std;
 #include <srs_kernel_utility.hpp>
 #include <srs_app_st.hpp>
 #include <srs_rtmp_amf0.hpp>
+#include <srs_kernel_ts.hpp>
+#include <srs_kernel_stream.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_codec.hpp>
 #include <srs_rtmp_stack.hpp>
 
 MockEmptyIO::MockEmptyIO()
@@ -203,6 +207,23 @@ int MockBufferIO::read(void* buf, size_t size, ssize_t* nread)
     return ERROR_SUCCESS;
 }
 
+MockTsRtmpHandler::MockTsRtmpHandler()
+{
+}
+
+MockTsRtmpHandler::~MockTsRtmpHandler()
+{
+}
+
+int MockTsRtmpHandler::on_rtmp_packet(char type, u_int32_t timestamp, char* data, int size)
+{
+    types.push_back(type);
+    timestamps.push_back(timestamp);
+    packets.push_back(string(data, size));
+    srs_freepa(data);
+    return ERROR_SUCCESS;
+}
+
 #ifdef ENABLE_UTEST_PROTOCOL
 
 #ifdef SRS_AUTO_SSL
@@ -370,6 +391,67 @@ VOID TEST(ProtocolHandshakeTest, ComplexHandshake)
     }
 }
 
+/**
+* the server takes the precomputed key from pool,
+* the s1 and s2 must be valid for client.
+*/
+VOID TEST(ProtocolHandshakeTest, ComplexHandshakePooledKey)
+{
+    SrsHandshakeKeyPool* pool = SrsHandshakeKeyPool::instance();
+    ASSERT_EQ(ERROR_SUCCESS, pool->start(2));
+    
+    // wait for the thread to generate the keys.
+    for (int i = 0; i < 500 && pool->size() < 2; i++) {
+        usleep(10 * 1000);
+    }
+    ASSERT_EQ(2, pool->size());
+    EXPECT_EQ(0, pool->errors());
+    
+    c1s1 c1;
+    ASSERT_EQ(ERROR_SUCCESS, c1.c1_create(srs_schema1));
+    
+    char c0c1[1537];
+    c0c1[0] = 0x03;
+    ASSERT_EQ(ERROR_SUCCESS, c1.dump(c0c1 + 1, 1536));
+    
+    char c2[1536];
+    memset(c2, 0, sizeof(c2));
+    
+    MockBufferIO io;
+    io.in_buffer.append(c0c1, sizeof(c0c1));
+    io.in_buffer.append(c2, sizeof(c2));
+    
+    int64_t hits = pool->hits();
+    
+    SrsHandshakeBytes bytes;
+    SrsComplexHandshake hs;
+    ASSERT_EQ(ERROR_SUCCESS, hs.handshake_with_client(&bytes, &io));
+    EXPECT_EQ(hits + 1, pool->hits());
+    ASSERT_EQ(3073, io.out_buffer.length());
+    
+    // the client validate the s1 and s2.
+    bool is_valid = false;
+    c1s1 s1;
+    ASSERT_EQ(ERROR_SUCCESS, s1.parse(io.out_buffer.bytes() + 1, 1536, c1.schema()));
+    ASSERT_EQ(ERROR_SUCCESS, s1.s1_validate_digest(is_valid));
+    EXPECT_TRUE(is_valid);
+    
+    c2s2 s2;
+    ASSERT_EQ(ERROR_SUCCESS, s2.parse(io.out_buffer.bytes() + 1537, 1536));
+    ASSERT_EQ(ERROR_SUCCESS, s2.s2_validate(&c1, is_valid));
+    EXPECT_TRUE(is_valid);
+    
+    // the client computes the shared key with the pooled public key.
+    SrsDH dh;
+    ASSERT_EQ(ERROR_SUCCESS, dh.initialize(true));
+    char skey[128];
+    int32_t skey_size = sizeof(skey);
+    EXPECT_EQ(ERROR_SUCCESS, dh.copy_shared_key(s1.get_key(), 128, skey, skey_size));
+    
+    pool->stop();
+    EXPECT_EQ(0, pool->size());
+}
+
 #endif
 
 VOID TEST(ProtocolHandshakeTest, SimpleHandshake)
@@ -4642,6 +4724,111 @@ VOID TEST(ProtocolStackTest, ProtocolSendVMessage)
     EXPECT_EQ(16, bio.out_buffer.length());
 }
 
+/**
+* send a video message in chunks to multiple connections,
+* which use the shared chunk headers.
+*/
+VOID TEST(ProtocolStackTest, ProtocolSendVMessageSharedHeader)
+{
+    MockBufferIO bio0;
+    SrsProtocol proto0(&bio0);
+
+    MockBufferIO bio1;
+    SrsProtocol proto1(&bio1);
+
+    SrsCommonMessage* msg = new SrsCommonMessage();
+    msg->header.initialize_video(300, 0x10, 1);
+    msg->create_payload(300);
+    msg->size = 300;
+    memset(msg->payload, 0x0f, msg->size);
+
+    SrsSharedPtrMessage m;
+    ASSERT_TRUE(ERROR_SUCCESS == m.create(msg));
+    srs_freep(msg);
+
+    // 12B c0 + 128B, 1B c3 + 128B, 1B c3 + 44B.
+    EXPECT_TRUE(ERROR_SUCCESS == proto0.send_and_free_message(m.copy(), 1));
+    EXPECT_EQ(314, bio0.out_buffer.length());
+
+    EXPECT_TRUE(ERROR_SUCCESS == proto1.send_and_free_message(m.copy(), 1));
+    EXPECT_EQ(314, bio1.out_buffer.length());
+    EXPECT_TRUE(srs_bytes_equals(bio0.out_buffer.bytes(), bio1.out_buffer.bytes(), 314));
+
+    // the header is cached for each timestamp, util the cache is full.
+    m.check(1);
+    SrsSharedChunkHeader* h = m.shared_chunk_header();
+    ASSERT_TRUE(h != NULL);
+    EXPECT_EQ(12, h->nb_c0);
+    EXPECT_EQ(1, h->nb_c3);
+    EXPECT_TRUE(h == m.shared_chunk_header());
+
+    for (int i = 1; i < SRS_PERF_CHUNK_HEADER_CACHE; i++) {
+        SrsSharedPtrMessage* copy = m.copy();
+        copy->timestamp += i;
+        EXPECT_TRUE(copy->shared_chunk_header() != NULL);
+        srs_freep(copy);
+    }
+
+    SrsSharedPtrMessage* copy = m.copy();
+    copy->timestamp = 0xffffff;
+    EXPECT_TRUE(copy->shared_chunk_header() == NULL);
+    srs_freep(copy);
+
+    // the full cache still serves the cached timestamps.
+    EXPECT_TRUE(h == m.shared_chunk_header());
+}
+
+/**
+* share the payload of message in message objects,
+* which are reused without alloc.
+*/
+VOID TEST(ProtocolStackTest, ProtocolSharedPtrMessageShare)
+{
+    SrsCommonMessage* msg = new SrsCommonMessage();
+    msg->header.initialize_video(10, 0x10, 1);
+    msg->create_payload(10);
+    msg->size = 10;
+    
+    SrsSharedPtrMessage m;
+    ASSERT_TRUE(ERROR_SUCCESS == m.create(msg));
+    srs_freep(msg);
+    EXPECT_EQ(0, m.count());
+    
+    SrsSharedPtrMessage* slots = new SrsSharedPtrMessage[2];
+    SrsAutoFreeA(SrsSharedPtrMessage, slots);
+    
+    slots[0].share(&m);
+    slots[0].timestamp = 100;
+    EXPECT_EQ(1, m.count());
+    EXPECT_EQ(0x10, m.timestamp);
+    EXPECT_TRUE(m.payload == slots[0].payload);
+    EXPECT_EQ(10, slots[0].size);
+    
+    // share again release the previous payload.
+    slots[0].share(&m);
+    EXPECT_EQ(1, m.count());
+    
+    // share itself keeps the payload.
+    slots[0].share(&slots[0]);
+    EXPECT_EQ(1, m.count());
+    EXPECT_TRUE(m.payload == slots[0].payload);
+    
+    // swap never change the count.
+    slots[1].swap(&slots[0]);
+    EXPECT_EQ(1, m.count());
+    EXPECT_TRUE(slots[0].payload == NULL);
+    EXPECT_EQ(0, slots[0].size);
+    EXPECT_TRUE(m.payload == slots[1].payload);
+    
+    slots[1].release();
+    EXPECT_EQ(0, m.count());
+    EXPECT_TRUE(slots[1].payload == NULL);
+    
+    // the released message can be reused.
+    slots[1].share(&m);
+    EXPECT_EQ(1, m.count());
+}
+
 /**
 * send a SrsConnectAppPacket packet
 */
@@ -5536,6 +5723,67 @@ VOID TEST(ProtocolStackTest, ProtocolExcpectMessage)
     ASSERT_TRUE(NULL != pkt);
 }
 
+/**
+* recv the large messages, which payload is read from socket directly.
+*/
+VOID TEST(ProtocolStackTest, ProtocolRecvLargeMessage)
+{
+    MockBufferIO bio;
+    SrsProtocol proto(&bio);
+    
+    if (true) {
+        SrsSetChunkSizePacket* pkt = new SrsSetChunkSizePacket();
+        pkt->chunk_size = 60000;
+        
+        EXPECT_TRUE(ERROR_SUCCESS == proto.send_and_free_packet(pkt, 0));
+    }
+    
+    // larger than the recv buffer, 128KB.
+    for (int i = 0; i < 2; i++) {
+        SrsCommonMessage* msg = new SrsCommonMessage();
+        msg->header.payload_length = msg->size = 300000 + i;
+        msg->payload = new char[msg->size];
+        for (int j = 0; j < msg->size; j++) {
+            msg->payload[j] = (char)(j + i);
+        }
+        msg->header.message_type = 9;
+    
+        SrsSharedPtrMessage m;
+        ASSERT_TRUE(ERROR_SUCCESS == m.create(msg));
+
+        EXPECT_TRUE(ERROR_SUCCESS == proto.send_and_free_message(m.copy(), 1));
+    }
+    
+    // copy output to input
+    if (true) {
+        bio.in_buffer.append(bio.out_buffer.bytes(), bio.out_buffer.length());
+        bio.out_buffer.erase(bio.out_buffer.length());
+    }
+    
+    // recv SrsSetChunkSizePacket
+    if (true) {
+        SrsCommonMessage* msg = NULL;
+        ASSERT_TRUE(ERROR_SUCCESS == proto.recv_message(&msg));
+        SrsAutoFree(SrsCommonMessage, msg);
+        ASSERT_TRUE(msg->header.is_set_chunk_size());
+    }
+    // recv videos
+    for (int i = 0; i < 2; i++) {
+        SrsCommonMessage* msg = NULL;
+        ASSERT_TRUE(ERROR_SUCCESS == proto.recv_message(&msg));
+        SrsAutoFree(SrsCommonMessage, msg);
+        ASSERT_TRUE(msg->header.is_video());
+        ASSERT_EQ(300000 + i, msg->size);
+        
+        bool ok = true;
+        for (int j = 0; j < msg->size; j++) {
+            ok = ok && msg->payload[j] == (char)(j + i);
+        }
+        EXPECT_TRUE(ok);
+    }
+    EXPECT_EQ(0, bio.in_buffer.length());
+}
+
 VOID TEST(ProtocolRTMPTest, RTMPRequest)
 {
     SrsRequest req;
@@ -5608,5 +5856,145 @@ VOID TEST(ProtocolRTMPTest, RTMPHandshakeBytes)
     EXPECT_TRUE(bytes.s0s1s2 != NULL);
 }
 
+/**
+* feed the payload as a ts message to the muxer.
+*/
+int mock_ts_rtmp_mux(SrsTsRtmpMuxer* muxer, bool video, char* data, int size, int64_t dts, int64_t pts, int64_t next_dts)
+{
+    SrsTsMessage msg;
+    msg.dts = dts;
+    msg.pts = pts;
+    msg.payload->append(data, size);
+    
+    SrsStream avs;
+    int ret = avs.initialize(msg.payload->bytes(), msg.payload->length());
+    if (ret != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if (video) {
+        return muxer->on_ts_video(&msg, &avs);
+    }
+    return muxer->on_ts_audio(&msg, &avs, next_dts);
+}
+
+/**
+* the nalus of pes must be grouped to one flv frame, with the cts of pts.
+*/
+VOID TEST(ProtocolRawTest, TsRtmpMuxerVideo)
+{
+    MockTsRtmpHandler h;
+    SrsTsRtmpMuxer muxer(&h);
+    
+    // aud, sps, pps, and the idr in two slices.
+    char idr[] = {
+        0x00, 0x00, 0x00, 0x01, 0x09, (char)0xf0,
+        0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x1e, (char)0xab,
+        0x00, 0x00, 0x00, 0x01, 0x68, (char)0xce, 0x3c, (char)0x80,
+        0x00, 0x00, 0x00, 0x01, 0x65, (char)0x88, (char)0x84,
+        0x00, 0x00, 0x01, 0x65, (char)0xaa, (char)0xbb
+    };
+    EXPECT_TRUE(ERROR_SUCCESS == mock_ts_rtmp_mux(&muxer, true, idr, sizeof(idr), 90 * 1000, 90 * 1040, 0));
+    ASSERT_EQ(2, (int)h.packets.size());
+    
+    // the sequence header.
+    EXPECT_EQ(SrsCodecFlvTagVideo, h.types[0]);
+    EXPECT_EQ(1000, (int)h.timestamps[0]);
+    EXPECT_EQ(0x17, h.packets[0].at(0));
+    EXPECT_EQ(0x00, h.packets[0].at(1));
+    
+    // the idr frame with two nalus, in 4bytes size.
+    std::string& frame = h.packets[1];
+    EXPECT_EQ(1000, (int)h.timestamps[1]);
+    ASSERT_EQ(5 + 4 + 3 + 4 + 3, (int)frame.length());
+    EXPECT_EQ(0x17, frame.at(0));
+    EXPECT_EQ(0x01, frame.at(1));
+    EXPECT_EQ(0x00, frame.at(2));
+    EXPECT_EQ(0x00, frame.at(3));
+    EXPECT_EQ(40, frame.at(4));
+    EXPECT_EQ(3, frame.at(8));
+    EXPECT_EQ(0x65, frame.at(9));
+    EXPECT_EQ(3, frame.at(15));
+    EXPECT_EQ((char)0xaa, frame.at(17));
+    
+    // the inter frame, without sequence header.
+    char p[] = {0x00, 0x00, 0x00, 0x01, 0x41, (char)0x9a, 0x01};
+    EXPECT_TRUE(ERROR_SUCCESS == mock_ts_rtmp_mux(&muxer, true, p, sizeof(p), 90 * 1040, 90 * 1040, 0));
+    ASSERT_EQ(3, (int)h.packets.size());
+    EXPECT_EQ(1040, (int)h.timestamps[2]);
+    EXPECT_EQ(0x27, h.packets[2].at(0));
+    EXPECT_EQ(0x01, h.packets[2].at(1));
+}
+
+/**
+* the frames before sps/pps are dropped, and the sequence header is sent again after reset.
+*/
+VOID TEST(ProtocolRawTest, TsRtmpMuxerReset)
+{
+    MockTsRtmpHandler h;
+    SrsTsRtmpMuxer muxer(&h);
+    
+    char p[] = {0x00, 0x00, 0x00, 0x01, 0x41, (char)0x9a, 0x01};
+    EXPECT_TRUE(ERROR_SUCCESS == mock_ts_rtmp_mux(&muxer, true, p, sizeof(p), 0, 0, 0));
+    EXPECT_EQ(0, (int)h.packets.size());
+    
+    char idr[] = {
+        0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x1e, (char)0xab,
+        0x00, 0x00, 0x00, 0x01, 0x68, (char)0xce, 0x3c, (char)0x80,
+        0x00, 0x00, 0x00, 0x01, 0x65, (char)0x88, (char)0x84
+    };
+    EXPECT_TRUE(ERROR_SUCCESS == mock_ts_rtmp_mux(&muxer, true, idr, sizeof(idr), 0, 0, 0));
+    EXPECT_EQ(2, (int)h.packets.size());
+    
+    // same sps/pps, no sequence header.
+    EXPECT_TRUE(ERROR_SUCCESS == mock_ts_rtmp_mux(&muxer, true, idr, sizeof(idr), 0, 0, 0));
+    EXPECT_EQ(3, (int)h.packets.size());
+    
+    // for the new source, drop util got the sps/pps again.
+    muxer.reset();
+    EXPECT_TRUE(ERROR_SUCCESS == mock_ts_rtmp_mux(&muxer, true, p, sizeof(p), 0, 0, 0));
+    EXPECT_EQ(3, (int)h.packets.size());
+    
+    EXPECT_TRUE(ERROR_SUCCESS == mock_ts_rtmp_mux(&muxer, true, idr, sizeof(idr), 0, 0, 0));
+    ASSERT_EQ(5, (int)h.packets.size());
+    EXPECT_EQ(0x00, h.packets[3].at(1));
+    EXPECT_EQ(0x01, h.packets[4].at(1));
+}
+
+/**
+* the adts frames of pes are spread in the duration to the next message.
+*/
+VOID TEST(ProtocolRawTest, TsRtmpMuxerAudio)
+{
+    MockTsRtmpHandler h;
+    SrsTsRtmpMuxer muxer(&h);
+    
+    // aac lc, 44.1kHZ, stereo, 4bytes raw data in each adts frame.
+    char adts[] = {
+        (char)0xff, (char)0xf1, 0x50, (char)0x80, 0x01, 0x7f, (char)0xfc, 0x01, 0x02, 0x03, 0x04,
+        (char)0xff, (char)0xf1, 0x50, (char)0x80, 0x01, 0x7f, (char)0xfc, 0x05, 0x06, 0x07, 0x08
+    };
+    EXPECT_TRUE(ERROR_SUCCESS == mock_ts_rtmp_mux(&muxer, false, adts, sizeof(adts), 90 * 1000, 90 * 1000, 90 * 1040));
+    ASSERT_EQ(3, (int)h.packets.size());
+    
+    // the sequence header.
+    EXPECT_EQ(SrsCodecFlvTagAudio, h.types[0]);
+    EXPECT_EQ(1000, (int)h.timestamps[0]);
+    EXPECT_EQ(0x00, h.packets[0].at(1));
+    
+    // the raw frames.
+    EXPECT_EQ(1000, (int)h.timestamps[1]);
+    EXPECT_EQ(0x01, h.packets[1].at(1));
+    EXPECT_EQ(0x01, h.packets[1].at(2));
+    EXPECT_LT(1000, (int)h.timestamps[2]);
+    EXPECT_GE(1040, (int)h.timestamps[2]);
+    EXPECT_EQ(0x05, h.packets[2].at(2));
+    
+    // the sequence header is sent once.
+    EXPECT_TRUE(ERROR_SUCCESS == mock_ts_rtmp_mux(&muxer, false, adts, sizeof(adts), 90 * 1040, 90 * 1040, 90 * 1040));
+    ASSERT_EQ(5, (int)h.packets.size());
+    EXPECT_EQ(h.timestamps[3], h.timestamps[4]);
+}
+
 #endif
 
@@ -41,6 +41,9 @@ using namespace _srs_internal;
 #endif
 
 #include <srs_rtmp_io.hpp>
+#include <srs_raw_avc.hpp>
+
+#include <vector>
 
 class MockEmptyIO : public ISrsProtocolReaderWriter
 {
@@ -107,5 +110,21 @@ public:
     virtual int read(void* buf, size_t size, ssize_t* nread);
 };
 
+/**
+* record the flv packets of ts to rtmp muxer.
+*/
+class MockTsRtmpHandler : public ISrsTsRtmpHandler
+{
+public:
+    std::vector<char> types;
+    std::vector<u_int32_t> timestamps;
+    std::vector<std::string> packets;
+public:
+    MockTsRtmpHandler();
+    virtual ~MockTsRtmpHandler();
+public:
+    virtual int on_rtmp_packet(char type, u_int32_t timestamp, char* data, int size);
+};
+
 #endif
 
@@ -26,6 +26,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 using namespace std;
 
 #include <srs_kernel_error.hpp>
+#include <srs_rtmp_stack.hpp>
+#include <srs_app_statistic.hpp>
 
 MockReloadHandler::MockReloadHandler()
 {
@@ -302,6 +304,55 @@ int MockReloadHandler::on_reload_ingest_updated(string /*vhost*/, string /*inges
     return ERROR_SUCCESS;
 }
 
+MockReloadOrderHandler::MockReloadOrderHandler(int i, vector<int>* n)
+{
+    id = i;
+    notified = n;
+}
+
+MockReloadOrderHandler::~MockReloadOrderHandler()
+{
+}
+
+int MockReloadOrderHandler::on_reload_vhost_atc(string /*vhost*/)
+{
+    notified->push_back(id);
+    return ERROR_SUCCESS;
+}
+
+MockSrsConnection::MockSrsConnection() : SrsConnection(NULL, NULL)
+{
+    send_bytes = recv_bytes = 0;
+}
+
+MockSrsConnection::~MockSrsConnection()
+{
+}
+
+void MockSrsConnection::resample()
+{
+}
+
+int64_t MockSrsConnection::get_send_bytes_delta()
+{
+    return send_bytes;
+}
+
+int64_t MockSrsConnection::get_recv_bytes_delta()
+{
+    return recv_bytes;
+}
+
+void MockSrsConnection::cleanup()
+{
+    send_bytes = recv_bytes = 0;
+}
+
+int MockSrsConnection::do_cycle()
+{
+    return ERROR_SUCCESS;
+}
+
 MockSrsReloadConfig::MockSrsReloadConfig()
 {
 }
@@ -943,5 +994,182 @@ VOID TEST(ConfigReloadTest, ReloadVhostIngestUpdated)
     handler.reset();
 }
 
-#endif
+VOID TEST(ConfigReloadTest, SubscribeOrder)
+{
+    vector<int> notified;
+    MockReloadOrderHandler h1(1, &notified), h2(2, &notified), h3(3, &notified);
+    MockSrsReloadConfig conf;
+    
+    conf.subscribe(&h1);
+    conf.subscribe(&h2);
+    conf.subscribe(&h3);
+    // subscribe again is ignored.
+    conf.subscribe(&h2);
+    EXPECT_TRUE(ERROR_SUCCESS == conf.parse(_MIN_OK_CONF"vhost a{atc off;}"));
+    
+    EXPECT_TRUE(ERROR_SUCCESS == conf.reload(_MIN_OK_CONF"vhost a{atc on;}"));
+    ASSERT_EQ(3, (int)notified.size());
+    EXPECT_EQ(1, notified.at(0));
+    EXPECT_EQ(2, notified.at(1));
+    EXPECT_EQ(3, notified.at(2));
+    notified.clear();
+    
+    // unsubscribe the middle, then subscribe it to the tail.
+    conf.unsubscribe(&h2);
+    EXPECT_TRUE(ERROR_SUCCESS == conf.reload(_MIN_OK_CONF"vhost a{atc off;}"));
+    ASSERT_EQ(2, (int)notified.size());
+    EXPECT_EQ(1, notified.at(0));
+    EXPECT_EQ(3, notified.at(1));
+    notified.clear();
+    
+    conf.subscribe(&h2);
+    EXPECT_TRUE(ERROR_SUCCESS == conf.reload(_MIN_OK_CONF"vhost a{atc on;}"));
+    ASSERT_EQ(3, (int)notified.size());
+    EXPECT_EQ(1, notified.at(0));
+    EXPECT_EQ(3, notified.at(1));
+    EXPECT_EQ(2, notified.at(2));
+    notified.clear();
+    
+    // unsubscribe the head and tail, and the unknown or removed handler.
+    conf.unsubscribe(&h1);
+    conf.unsubscribe(&h2);
+    conf.unsubscribe(&h1);
+    EXPECT_TRUE(ERROR_SUCCESS == conf.reload(_MIN_OK_CONF"vhost a{atc off;}"));
+    ASSERT_EQ(1, (int)notified.size());
+    EXPECT_EQ(3, notified.at(0));
+    notified.clear();
+    
+    conf.unsubscribe(&h3);
+    EXPECT_TRUE(ERROR_SUCCESS == conf.reload(_MIN_OK_CONF"vhost a{atc on;}"));
+    EXPECT_EQ(0, (int)notified.size());
+}
+
+/**
+* the clients of stream are linked to the head, so the fetched order
+* is the reverse of connected order.
+*/
+void srs_utest_check_clients(SrsStatistic* stat, string vhost, SrsConnection** expect, int nb_expect)
+{
+    vector<SrsConnection*> conns;
+    stat->fetch_clients(vhost, conns);
+    
+    ASSERT_EQ(nb_expect, (int)conns.size());
+    for (int i = 0; i < nb_expect; i++) {
+        EXPECT_TRUE(expect[i] == conns.at(i));
+    }
+}
 
+VOID TEST(ConfigReloadTest, StatisticClientsUnlink)
+{
+    SrsStatistic* stat = SrsStatistic::instance();
+    
+    SrsRequest req;
+    req.vhost = "utest.reload.clients";
+    req.app = "live";
+    req.stream = "livestream";
+    
+    MockSrsConnection c0, c1, c2;
+    SrsConnection* head[] = {&c1, &c0};
+    SrsConnection* middle[] = {&c2, &c0};
+    SrsConnection* tail[] = {&c2, &c1};
+    
+    // unlink the head, the last connected one.
+    EXPECT_TRUE(ERROR_SUCCESS == stat->on_client(20100, &req, &c0, SrsRtmpConnPlay));
+    EXPECT_TRUE(ERROR_SUCCESS == stat->on_client(20101, &req, &c1, SrsRtmpConnPlay));
+    EXPECT_TRUE(ERROR_SUCCESS == stat->on_client(20102, &req, &c2, SrsRtmpConnPlay));
+    stat->on_disconnect(20102);
+    srs_utest_check_clients(stat, req.vhost, head, 2);
+    if (true) {
+        vector<SrsConnection*> conns;
+        stat->fetch_clients(req.vhost, req.app, req.stream, conns);
+        EXPECT_EQ(2, (int)conns.size());
+        
+        conns.clear();
+        stat->fetch_clients(req.vhost, req.app, "notfound", conns);
+        EXPECT_EQ(0, (int)conns.size());
+    }
+    EXPECT_TRUE(NULL == stat->find_client(20101)->prev);
+    stat->on_disconnect(20101);
+    stat->on_disconnect(20100);
+    srs_utest_check_clients(stat, req.vhost, NULL, 0);
+    
+    // unlink the middle.
+    EXPECT_TRUE(ERROR_SUCCESS == stat->on_client(20200, &req, &c0, SrsRtmpConnPlay));
+    EXPECT_TRUE(ERROR_SUCCESS == stat->on_client(20201, &req, &c1, SrsRtmpConnPlay));
+    EXPECT_TRUE(ERROR_SUCCESS == stat->on_client(20202, &req, &c2, SrsRtmpConnPlay));
+    stat->on_disconnect(20201);
+    srs_utest_check_clients(stat, req.vhost, middle, 2);
+    EXPECT_TRUE(stat->find_client(20200) == stat->find_client(20202)->next);
+    EXPECT_TRUE(stat->find_client(20202) == stat->find_client(20200)->prev);
+    stat->on_disconnect(20202);
+    stat->on_disconnect(20200);
+    srs_utest_check_clients(stat, req.vhost, NULL, 0);
+    
+    // unlink the tail, the first connected one.
+    EXPECT_TRUE(ERROR_SUCCESS == stat->on_client(20300, &req, &c0, SrsRtmpConnPlay));
+    EXPECT_TRUE(ERROR_SUCCESS == stat->on_client(20301, &req, &c1, SrsRtmpConnPlay));
+    EXPECT_TRUE(ERROR_SUCCESS == stat->on_client(20302, &req, &c2, SrsRtmpConnPlay));
+    stat->on_disconnect(20300);
+    srs_utest_check_clients(stat, req.vhost, tail, 2);
+    EXPECT_TRUE(NULL == stat->find_client(20301)->next);
+    stat->on_disconnect(20302);
+    stat->on_disconnect(20301);
+    srs_utest_check_clients(stat, req.vhost, NULL, 0);
+}
+
+VOID TEST(ConfigReloadTest, StatisticKbpsDelta)
+{
+    SrsStatistic* stat = SrsStatistic::instance();
+    
+    SrsRequest r0, r1;
+    r0.vhost = r1.vhost = "utest.reload.kbps";
+    r0.app = r1.app = "live";
+    r0.stream = "s0";
+    r1.stream = "s1";
+    
+    MockSrsConnection c0, c1, c2;
+    EXPECT_TRUE(ERROR_SUCCESS == stat->on_client(20400, &r0, &c0, SrsRtmpConnPlay));
+    EXPECT_TRUE(ERROR_SUCCESS == stat->on_client(c1.srs_id(), &r0, &c1, SrsRtmpConnPlay));
+    EXPECT_TRUE(ERROR_SUCCESS == stat->on_client(20402, &r1, &c2, SrsRtmpConnPlay));
+    
+    SrsStatisticStream* s0 = stat->find_client(20400)->stream;
+    SrsStatisticStream* s1 = stat->find_client(20402)->stream;
+    SrsStatisticVhost* vhost = s0->vhost;
+    EXPECT_TRUE(vhost == s1->vhost);
+    
+    int64_t server_send = stat->kbps_sample()->get_send_bytes();
+    int64_t server_recv = stat->kbps_sample()->get_recv_bytes();
+    
+    // the delta of clients is added to stream, vhost and server.
+    c0.send_bytes = 100; c0.recv_bytes = 1;
+    c1.send_bytes = 200; c1.recv_bytes = 2;
+    c2.send_bytes = 400; c2.recv_bytes = 4;
+    stat->kbps_add_delta();
+    EXPECT_EQ(300, s0->kbps->get_send_bytes());
+    EXPECT_EQ(3, s0->kbps->get_recv_bytes());
+    EXPECT_EQ(400, s1->kbps->get_send_bytes());
+    EXPECT_EQ(700, vhost->kbps->get_send_bytes());
+    EXPECT_EQ(7, vhost->kbps->get_recv_bytes());
+    EXPECT_EQ(server_send + 700, stat->kbps_sample()->get_send_bytes());
+    EXPECT_EQ(server_recv + 7, stat->kbps_sample()->get_recv_bytes());
+    
+    // the delta is cleanup, never added twice.
+    stat->kbps_add_delta();
+    EXPECT_EQ(700, vhost->kbps->get_send_bytes());
+    EXPECT_EQ(server_send + 700, stat->kbps_sample()->get_send_bytes());
+    
+    // the delta of removed client is added to stream, then vhost and server.
+    c1.send_bytes = 1000;
+    stat->kbps_add_delta(&c1);
+    stat->on_disconnect(c1.srs_id());
+    EXPECT_EQ(1300, s0->kbps->get_send_bytes());
+    EXPECT_EQ(700, vhost->kbps->get_send_bytes());
+    stat->kbps_add_delta();
+    EXPECT_EQ(1700, vhost->kbps->get_send_bytes());
+    EXPECT_EQ(server_send + 1700, stat->kbps_sample()->get_send_bytes());
+    
+    stat->on_disconnect(20400);
+    stat->on_disconnect(20402);
+}
+
+#endif
@@ -29,8 +29,11 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 #include <srs_core.hpp>
 
+#include <vector>
+
 #include <srs_utest_config.hpp>
 #include <srs_app_reload.hpp>
+#include <srs_app_conn.hpp>
 
 class MockReloadHandler : public ISrsReloadHandler
 {
@@ -99,6 +102,42 @@ public:
     virtual int on_reload_ingest_updated(std::string vhost, std::string ingest_id);
 };
 
+/**
+* the handler to record the order of reload notify.
+*/
+class MockReloadOrderHandler : public ISrsReloadHandler
+{
+public:
+    int id;
+    std::vector<int>* notified;
+public:
+    MockReloadOrderHandler(int i, std::vector<int>* n);
+    virtual ~MockReloadOrderHandler();
+public:
+    virtual int on_reload_vhost_atc(std::string vhost);
+};
+
+/**
+* the connection without socket, to index in statistic.
+*/
+class MockSrsConnection : public SrsConnection
+{
+public:
+    int64_t send_bytes;
+    int64_t recv_bytes;
+public:
+    MockSrsConnection();
+    virtual ~MockSrsConnection();
+// interface IKbpsDelta
+public:
+    virtual void resample();
+    virtual int64_t get_send_bytes_delta();
+    virtual int64_t get_recv_bytes_delta();
+    virtual void cleanup();
+protected:
+    virtual int do_cycle();
+};
+
 class MockSrsReloadConfig : public MockSrsConfig
 {
 public: